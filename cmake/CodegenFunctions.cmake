@@ -1,4 +1,41 @@
 # Instrumentation Functions for CMake
+#
+# These all set up add_custom_command rules, so code generation
+# happens at build time, in parallel with everything else, and only
+# reruns when something it read changed. Each program writes a
+# depfile listing what it read for the build system to pick up.
+
+#-----------------------------------------------------------------
+# _codegen_find_tool sets VAR to something add_custom_command can
+# run for one of our programs. If we're being built as part of the
+# same project (or you imported our targets with find_package) it's
+# the target, so the generated files depend on the program itself
+# too. Otherwise we go looking in the path.
+#-----------------------------------------------------------------
+
+function(_codegen_find_tool VAR TOOL)
+  if (TARGET ${TOOL})
+    set(${VAR} ${TOOL} PARENT_SCOPE)
+  elseif (TARGET FR::${TOOL})
+    set(${VAR} FR::${TOOL} PARENT_SCOPE)
+  else()
+    find_program(CODEGEN_${TOOL} ${TOOL} REQUIRED)
+    set(${VAR} "${CODEGEN_${TOOL}}" PARENT_SCOPE)
+  endif()
+endfunction()
+
+#-----------------------------------------------------------------
+# _codegen_tool_depends sets VAR to TOOL if it's a target, so a
+# rebuilt generator reruns its rules.
+#-----------------------------------------------------------------
+
+function(_codegen_tool_depends VAR TOOL)
+  if (TARGET ${TOOL})
+    set(${VAR} ${TOOL} PARENT_SCOPE)
+  else()
+    set(${VAR} "" PARENT_SCOPE)
+  endif()
+endfunction()
 
 #-----------------------------------------------------------------
 # codegen_index_objects reads a set of C++ Headers and creates a
@@ -6,13 +43,32 @@
 #
 # Arguments:
 # HEADERS keyword followed by a list of headers
+# ROOT - Optional, directories to index every header under instead
+#         of (or as well as) listing them in HEADERS
+# GLOB - Optional, file name patterns ROOT looks for. Defaults to
+#         *.h and *.hpp.
+# DETAIL - Optional, how much to index: enums, members or full
+#         (the default). An index that only feeds
+#         codegen_ostream_operators only needs enums, and the smaller
+#         levels parse faster and make a smaller index.
+# SHARED - Optional, also publish the index in shared memory so
+#         the generators reading it can map it instead of parsing
+#         the JSON.
+# FLAT - Optional, also write the index to this file in the flat
+#         format, which is what you'd install with
+#         codegen_install_index.
 # INDEX Followed by the JSON file to write to
 #
 # INDEX is optional and will default to
 # "${CMAKE_CURRENT_BINARY_DIR}/index.json"
+# TARGET - Optional, name of a custom target to create that builds
+#         the index. You only need this if something in another
+#         directory wants the index; rules in this directory that
+#         read it depend on the file directly.
 #
 # example:
 # codegen_index_objects(INDEX classes.json HEADERS ${HEADER_LIST})
+# codegen_index_objects(INDEX classes.json ROOT ${CMAKE_CURRENT_SOURCE_DIR}/include)
 #-----------------------------------------------------------------
 
 function(codegen_index_objects)
@@ -21,9 +77,9 @@ function(codegen_index_objects)
   
   set(INDEX_FILE "${CMAKE_CURRENT_BINARY_DIR}/index.json")
   set(HEADER_LIST "")
-  set(options "")
-  set(oneValueArgs "INDEX")
-  set(multiValueArgs "HEADERS")
+  set(options SHARED)
+  set(oneValueArgs INDEX TARGET DETAIL FLAT)
+  set(multiValueArgs HEADERS ROOT GLOB)
   cmake_parse_arguments(PARSE_ARGV 0 arg
     "${options}" "${oneValueArgs}" "${multiValueArgs}"
   )
@@ -35,22 +91,73 @@ function(codegen_index_objects)
   endif()
   if (arg_HEADERS)
     set(HEADER_LIST "${arg_HEADERS}")
-  else()
-    message(FATAL_ERROR "No headers were provided to codegen_index_object")
+  elseif (NOT arg_ROOT)
+    message(FATAL_ERROR "No headers or ROOT were provided to codegen_index_object")
+  endif()
+  set(GLOB_LIST "*.h" "*.hpp")
+  if (arg_GLOB)
+    set(GLOB_LIST "${arg_GLOB}")
   endif()
 
+  # IndexCode does its own crawling, but globbing here too means a
+  # header showing up or going away reruns the index
+  set(CRAWLED_HEADERS "")
+  foreach (ROOT_DIR IN LISTS arg_ROOT)
+    foreach (GLOB_PATTERN IN LISTS GLOB_LIST)
+      file(GLOB_RECURSE FOUND_HEADERS CONFIGURE_DEPENDS "${ROOT_DIR}/${GLOB_PATTERN}")
+      list(APPEND CRAWLED_HEADERS ${FOUND_HEADERS})
+    endforeach()
+  endforeach()
+
   # Generate Command Line
-  find_program(INDEX_CODE IndexCode)
+  _codegen_find_tool(INDEX_CODE IndexCode)
+  _codegen_tool_depends(TOOL_DEPENDS ${INDEX_CODE})
   set(COMMAND_LINE "${INDEX_CODE}")
   list(APPEND COMMAND_LINE "-o" "${INDEX_FILE}")
   foreach (HEADER_FILE IN LISTS HEADER_LIST)
     list(APPEND COMMAND_LINE "-h" "${HEADER_FILE}")
   endforeach()
-  message(STATUS "Command line: ${COMMAND_LINE}")
-  execute_process(
+  foreach (ROOT_DIR IN LISTS arg_ROOT)
+    list(APPEND COMMAND_LINE "--root" "${ROOT_DIR}")
+  endforeach()
+  if (arg_ROOT)
+    foreach (GLOB_PATTERN IN LISTS GLOB_LIST)
+      list(APPEND COMMAND_LINE "--glob" "${GLOB_PATTERN}")
+    endforeach()
+  endif()
+  if (arg_DETAIL)
+    list(APPEND COMMAND_LINE "--detail" "${arg_DETAIL}")
+  endif()
+  if (arg_SHARED)
+    list(APPEND COMMAND_LINE "--shared")
+  endif()
+  set(FLAT_FILE "")
+  if (arg_FLAT)
+    set(FLAT_FILE "${arg_FLAT}")
+    list(APPEND COMMAND_LINE "--flat" "${FLAT_FILE}")
+  endif()
+  list(APPEND COMMAND_LINE "--depfile" "${INDEX_FILE}.d")
+  add_custom_command(
+    OUTPUT "${INDEX_FILE}" ${FLAT_FILE}
     COMMAND ${COMMAND_LINE}
+    DEPENDS ${HEADER_LIST} ${CRAWLED_HEADERS} ${TOOL_DEPENDS}
+    DEPFILE "${INDEX_FILE}.d"
+    COMMENT "Indexing ${INDEX_FILE}"
+    VERBATIM
   )
-  
+  if (arg_TARGET)
+    add_custom_target(${arg_TARGET} DEPENDS "${INDEX_FILE}" ${FLAT_FILE})
+  endif()
+
+  # codegen_ostream_operators needs the header list to know which
+  # companion headers it's going to write. Only a HEADERS list is
+  # known at configure time, the ROOT crawl happens at build time.
+  if (arg_HEADERS AND NOT arg_ROOT)
+    cmake_path(ABSOLUTE_PATH INDEX_FILE BASE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}" NORMALIZE
+      OUTPUT_VARIABLE INDEX_KEY)
+    set_property(GLOBAL PROPERTY "CODEGEN_INDEX_HEADERS_${INDEX_KEY}" "${HEADER_LIST}")
+  endif()
+
 endfunction()
 
 #--------------------------------------------------------------------
@@ -64,7 +171,22 @@ endfunction()
 #         ${CMAKE_CURRENT_BINARY_DIR}/ops.h
 # SOURCE - cpp file to generate (Defaults to
 #         ${CMAKE_CURRENT_BINARY_DIR}/ops.cpp
-# TARGET - Target to add CPP file to
+# SHARDS - Optional, split SOURCE into this many files (ops_shard0.cpp
+#         and so on) grouped by the header each enum is defined in,
+#         so they can be compiled in parallel.
+# TARGET - Target to add CPP file (or all the shards) to
+# COMPANION_HEADERS - Optional flag. Write a foo_ops.h next to HEADER
+#         for each indexed header foo.h, declaring only foo.h's enums
+#         (forward declared where possible), and make HEADER an
+#         umbrella header that includes them all. If the index was
+#         built from a HEADERS list, the companions are listed as
+#         BYPRODUCTS so ninja knows where they come from. Indexes
+#         built with ROOT don't know their headers until build time,
+#         so their companions aren't.
+# DEPS - Optional, sidecar file recording what each output was
+#         generated from. Outputs whose enums didn't change since
+#         the last run don't get rewritten, just touched so make
+#         doesn't keep running the rule.
 # -------------------------------------------------------------------
 
 function(codegen_ostream_operators)
@@ -72,8 +194,9 @@ function(codegen_ostream_operators)
   set(INDEX_FILE "${CMAKE_CURRENT_BINARY_DIR}/index.json")
   set(HEADER "${CMAKE_CURRENT_BINARY_DIR}/ops.h")
   set(SOURCE "${CMAKE_CURRENT_BINARY_DIR}/ops.cpp")
-  set(options "")
-  set(oneValueArgs INDEX HEADER SOURCE TARGET)
+  set(SHARDS 0)
+  set(options COMPANION_HEADERS)
+  set(oneValueArgs INDEX HEADER SOURCE SHARDS TARGET DEPS)
   set(multiValueArgs "")
   # Parse args
   cmake_parse_arguments(PARSE_ARGV 0 arg
@@ -89,22 +212,78 @@ function(codegen_ostream_operators)
   if (arg_SOURCE)
     set(SOURCE "${arg_SOURCE}")
   endif()
+  if (arg_SHARDS)
+    set(SHARDS "${arg_SHARDS}")
+  endif()
   if(arg_TARGET)
     set(TARGET ${arg_TARGET})
   endif()
 
+  # OstreamOpsFromIndex names the shards SOURCE_shardN.cpp
+  set(GENERATED_SOURCES "")
+  if (SHARDS GREATER 0)
+    cmake_path(GET SOURCE STEM LAST_ONLY SHARD_STEM)
+    cmake_path(GET SOURCE EXTENSION LAST_ONLY SHARD_EXT)
+    math(EXPR LAST_SHARD "${SHARDS} - 1")
+    foreach (SHARD RANGE ${LAST_SHARD})
+      set(SHARD_FILE "${SOURCE}")
+      cmake_path(REPLACE_FILENAME SHARD_FILE "${SHARD_STEM}_shard${SHARD}${SHARD_EXT}")
+      list(APPEND GENERATED_SOURCES "${SHARD_FILE}")
+    endforeach()
+  else()
+    set(GENERATED_SOURCES "${SOURCE}")
+  endif()
+
   # generate command line
-  find_program(OPS_GEN OstreamOpsFromIndex)
+  _codegen_find_tool(OPS_GEN OstreamOpsFromIndex)
+  _codegen_tool_depends(TOOL_DEPENDS ${OPS_GEN})
   set(COMMAND_LINE "${OPS_GEN}")
   list(APPEND COMMAND_LINE "-i" "${INDEX_FILE}")
   list(APPEND COMMAND_LINE "-h" "${HEADER}")
   list(APPEND COMMAND_LINE "-c" "${SOURCE}")
-  message(STATUS "Command line: ${COMMAND_LINE}")
-  execute_process(
+  list(APPEND COMMAND_LINE "-n" "${SHARDS}")
+  set(COMPANION_FILES "")
+  if (arg_COMPANION_HEADERS)
+    list(APPEND COMMAND_LINE "--companions")
+    # Same names OstreamOpsFromIndex picks: foo.h gets foo_ops.h and
+    # the second a.h in sorted order gets a_2_ops.h
+    cmake_path(ABSOLUTE_PATH INDEX_FILE BASE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}" NORMALIZE
+      OUTPUT_VARIABLE INDEX_KEY)
+    get_property(INDEXED_HEADERS GLOBAL PROPERTY "CODEGEN_INDEX_HEADERS_${INDEX_KEY}")
+    list(REMOVE_DUPLICATES INDEXED_HEADERS)
+    list(SORT INDEXED_HEADERS)
+    set(USED_NAMES "")
+    foreach (INDEXED_HEADER IN LISTS INDEXED_HEADERS)
+      cmake_path(GET INDEXED_HEADER STEM LAST_ONLY COMPANION_STEM)
+      set(COMPANION_NAME "${COMPANION_STEM}_ops.h")
+      set(SUFFIX 2)
+      while (COMPANION_NAME IN_LIST USED_NAMES)
+        set(COMPANION_NAME "${COMPANION_STEM}_${SUFFIX}_ops.h")
+        math(EXPR SUFFIX "${SUFFIX} + 1")
+      endwhile()
+      list(APPEND USED_NAMES "${COMPANION_NAME}")
+      set(COMPANION_FILE "${HEADER}")
+      cmake_path(REPLACE_FILENAME COMPANION_FILE "${COMPANION_NAME}")
+      list(APPEND COMPANION_FILES "${COMPANION_FILE}")
+      # So it gets written even if the header has no enums
+      list(APPEND COMMAND_LINE "--companion-for" "${INDEXED_HEADER}")
+    endforeach()
+  endif()
+  if (arg_DEPS)
+    list(APPEND COMMAND_LINE "-d" "${arg_DEPS}")
+  endif()
+  list(APPEND COMMAND_LINE "--depfile" "${HEADER}.d")
+  add_custom_command(
+    OUTPUT "${HEADER}" ${GENERATED_SOURCES}
+    BYPRODUCTS ${COMPANION_FILES}
     COMMAND ${COMMAND_LINE}
+    DEPENDS "${INDEX_FILE}" ${TOOL_DEPENDS}
+    DEPFILE "${HEADER}.d"
+    COMMENT "Generating ostream operators in ${HEADER}"
+    VERBATIM
   )
   if (TARGET)
-    target_sources(${TARGET} PRIVATE "${SOURCE}")
+    target_sources(${TARGET} PRIVATE ${GENERATED_SOURCES})
   endif()
   
 endfunction()
@@ -128,8 +307,20 @@ endfunction()
 # Arguments:
 # INDEX - Index json to read (will default to the same one
 #         as codegen_index_objects)
+# INDEXES - Optional, more indexes to look classes up in, like the
+#         ones packages you use installed with codegen_install_index
+#         (find_package puts them in CODEGEN_INDEXES). INDEX gets
+#         looked in first. Nothing gets merged or re-parsed.
 # SOURCE - Source file to read
 # DESTINATION - Destination file to write
+# DEPS - Optional, sidecar file recording which classes DESTINATION
+#        was generated from. If none of them changed since the last
+#        run, DESTINATION doesn't get rewritten, just touched so
+#        make doesn't keep running the rule.
+# TARGET - Optional, target that uses DESTINATION. It gets added to
+#        the target's sources so it's generated before the target
+#        compiles. If you leave this off, something else has to
+#        depend on DESTINATION or it'll never be generated.
 #------------------------------------------------------------------
 function(codegen_generate_methods)
   # defaults
@@ -137,8 +328,8 @@ function(codegen_generate_methods)
   set(SOURCE_FILE "")
   set(DESTINATION_FILE "")
   # Set up options
-  set(oneValueArgs INDEX SOURCE DESTINATION)
-  set(multiValueArgs "")
+  set(oneValueArgs INDEX SOURCE DESTINATION DEPS TARGET)
+  set(multiValueArgs INDEXES)
   # Parse Args
   cmake_parse_arguments(PARSE_ARGV 0 arg
     "${options}" "${oneValueArgs}" "${multiValueArgs}"
@@ -161,11 +352,179 @@ function(codegen_generate_methods)
   endif()
 
   # Generate Command Line
-  find_program(OPS_GEN "GenerateFunctions")
+  _codegen_find_tool(OPS_GEN GenerateFunctions)
+  _codegen_tool_depends(TOOL_DEPENDS ${OPS_GEN})
   set(COMMAND_LINE "${OPS_GEN}")
   list(APPEND COMMAND_LINE "-i" "${INDEX_FILE}")
+  foreach (EXTRA_INDEX IN LISTS arg_INDEXES)
+    list(APPEND COMMAND_LINE "-i" "${EXTRA_INDEX}")
+  endforeach()
   list(APPEND COMMAND_LINE "-h" "${SOURCE_FILE}")
   list(APPEND COMMAND_LINE "-o" "${DESTINATION_FILE}")
-  message(STATUS "codegen_generate_methods: Command Line: ${COMMAND_LINE}")
-  execute_process(COMMAND ${COMMAND_LINE})
+  if (arg_DEPS)
+    list(APPEND COMMAND_LINE "-d" "${arg_DEPS}")
+  endif()
+  list(APPEND COMMAND_LINE "--depfile" "${DESTINATION_FILE}.d")
+  add_custom_command(
+    OUTPUT "${DESTINATION_FILE}"
+    COMMAND ${COMMAND_LINE}
+    DEPENDS "${SOURCE_FILE}" "${INDEX_FILE}" ${arg_INDEXES} ${TOOL_DEPENDS}
+    DEPFILE "${DESTINATION_FILE}.d"
+    COMMENT "Generating methods in ${DESTINATION_FILE}"
+    VERBATIM
+  )
+
+  if (arg_TARGET)
+    target_sources(${arg_TARGET} PRIVATE "${DESTINATION_FILE}")
+  endif()
+endfunction()
+
+#------------------------------------------------------------------
+# codegen_python_api runs GeneratePythonApi on a template .cpp file
+# with [[StartModule (ModuleName)]] and [[PythonApi]] annotations
+# and generates a nanobind module for all the classes in the index.
+#
+# Arguments:
+# INDEX - Index json to read (will default to the same one
+#         as codegen_index_objects)
+# SOURCE - Template .cpp file to read
+# DESTINATION - .cpp file to write
+# SHARDS - Optional, split the class bindings across this many
+#          files (DESTINATION_shard0.cpp and so on) so they can
+#          be compiled in parallel.
+# TARGET - Optional, target to add the generated files to
+# DEPS - Optional, sidecar file recording which classes went into
+#        each output. Only the outputs whose classes changed since
+#        the last run get rewritten. The rest just get touched so
+#        make doesn't keep running the rule.
+#------------------------------------------------------------------
+function(codegen_python_api)
+  # defaults
+  set(INDEX_FILE "${CMAKE_CURRENT_BINARY_DIR}/index.json")
+  set(SOURCE_FILE "")
+  set(DESTINATION_FILE "")
+  set(SHARDS 0)
+  set(options "")
+  set(oneValueArgs INDEX SOURCE DESTINATION SHARDS TARGET DEPS)
+  set(multiValueArgs "")
+  cmake_parse_arguments(PARSE_ARGV 0 arg
+    "${options}" "${oneValueArgs}" "${multiValueArgs}"
+  )
+
+  if (arg_INDEX)
+    set(INDEX_FILE "${arg_INDEX}")
+  endif()
+
+  if (arg_SOURCE)
+    set(SOURCE_FILE "${arg_SOURCE}")
+  else()
+    message(FATAL_ERROR "You must specify a source file for codegen_python_api")
+  endif()
+
+  if (arg_DESTINATION)
+    set(DESTINATION_FILE "${arg_DESTINATION}")
+  else()
+    message(FATAL_ERROR "You must specify a destination file for codegen_python_api")
+  endif()
+
+  if (arg_SHARDS)
+    set(SHARDS "${arg_SHARDS}")
+  endif()
+
+  # GeneratePythonApi names the shards DESTINATION_shardN.cpp
+  set(GENERATED_FILES "${DESTINATION_FILE}")
+  if (SHARDS GREATER 0)
+    cmake_path(GET DESTINATION_FILE STEM LAST_ONLY SHARD_STEM)
+    cmake_path(GET DESTINATION_FILE EXTENSION LAST_ONLY SHARD_EXT)
+    math(EXPR LAST_SHARD "${SHARDS} - 1")
+    foreach (SHARD RANGE ${LAST_SHARD})
+      set(SHARD_FILE "${DESTINATION_FILE}")
+      cmake_path(REPLACE_FILENAME SHARD_FILE "${SHARD_STEM}_shard${SHARD}${SHARD_EXT}")
+      list(APPEND GENERATED_FILES "${SHARD_FILE}")
+    endforeach()
+  endif()
+
+  # Generate Command Line
+  _codegen_find_tool(PYTHON_API_GEN GeneratePythonApi)
+  _codegen_tool_depends(TOOL_DEPENDS ${PYTHON_API_GEN})
+  set(COMMAND_LINE "${PYTHON_API_GEN}")
+  list(APPEND COMMAND_LINE "-i" "${INDEX_FILE}")
+  list(APPEND COMMAND_LINE "-s" "${SOURCE_FILE}")
+  list(APPEND COMMAND_LINE "-o" "${DESTINATION_FILE}")
+  list(APPEND COMMAND_LINE "-n" "${SHARDS}")
+  if (arg_DEPS)
+    list(APPEND COMMAND_LINE "-d" "${arg_DEPS}")
+  endif()
+  list(APPEND COMMAND_LINE "--depfile" "${DESTINATION_FILE}.d")
+  add_custom_command(
+    OUTPUT ${GENERATED_FILES}
+    COMMAND ${COMMAND_LINE}
+    DEPENDS "${SOURCE_FILE}" "${INDEX_FILE}" ${TOOL_DEPENDS}
+    DEPFILE "${DESTINATION_FILE}.d"
+    COMMENT "Generating Python API in ${DESTINATION_FILE}"
+    VERBATIM
+  )
+
+  if (arg_TARGET)
+    target_sources(${arg_TARGET} PRIVATE ${GENERATED_FILES})
+  endif()
+endfunction()
+
+#------------------------------------------------------------------
+# codegen_install_index installs an index next to your package's
+# CMake config, so projects using your package can generate code
+# against your classes without indexing your headers themselves.
+# It also writes a ${PACKAGE}CodegenIndex.cmake to install with it.
+# Include that from your package's Config.cmake:
+#
+# include("${CMAKE_CURRENT_LIST_DIR}/${PACKAGE}CodegenIndex.cmake")
+#
+# and find_package(${PACKAGE}) will set ${PACKAGE}_CODEGEN_INDEX to
+# the installed index and add it to CODEGEN_INDEXES, which you can
+# hand straight to codegen_generate_methods' INDEXES.
+#
+# Arguments:
+# PACKAGE - Name of your package, as find_package sees it
+# INDEX - Index to install. The FLAT file from codegen_index_objects
+#         is the one you want, since the generators map it instead
+#         of parsing it, but the JSON works too.
+# DESTINATION - Optional, where to install it. Defaults to
+#         lib/cmake/${PACKAGE}, which is where your Config.cmake
+#         should be too.
+#
+# example:
+# codegen_index_objects(INDEX index.json FLAT mylib.flat
+#   ROOT ${CMAKE_CURRENT_SOURCE_DIR}/include TARGET mylib_index)
+# codegen_install_index(PACKAGE MyLib
+#   INDEX ${CMAKE_CURRENT_BINARY_DIR}/mylib.flat)
+#------------------------------------------------------------------
+function(codegen_install_index)
+  set(options "")
+  set(oneValueArgs PACKAGE INDEX DESTINATION)
+  set(multiValueArgs "")
+  cmake_parse_arguments(PARSE_ARGV 0 arg
+    "${options}" "${oneValueArgs}" "${multiValueArgs}"
+  )
+
+  if (NOT arg_PACKAGE)
+    message(FATAL_ERROR "You must specify a package for codegen_install_index")
+  endif()
+  if (NOT arg_INDEX)
+    message(FATAL_ERROR "You must specify an index for codegen_install_index")
+  endif()
+  set(DESTINATION "lib/cmake/${arg_PACKAGE}")
+  if (arg_DESTINATION)
+    set(DESTINATION "${arg_DESTINATION}")
+  endif()
+
+  cmake_path(GET arg_INDEX FILENAME INDEX_NAME)
+  set(INDEX_CONFIG "${CMAKE_CURRENT_BINARY_DIR}/${arg_PACKAGE}CodegenIndex.cmake")
+  file(CONFIGURE OUTPUT "${INDEX_CONFIG}" @ONLY CONTENT
+"# Written by codegen_install_index
+set(@arg_PACKAGE@_CODEGEN_INDEX \"\${CMAKE_CURRENT_LIST_DIR}/@INDEX_NAME@\")
+list(APPEND CODEGEN_INDEXES \"\${@arg_PACKAGE@_CODEGEN_INDEX}\")
+list(REMOVE_DUPLICATES CODEGEN_INDEXES)
+")
+
+  install(FILES "${arg_INDEX}" "${INDEX_CONFIG}" DESTINATION "${DESTINATION}")
 endfunction()
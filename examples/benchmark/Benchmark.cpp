@@ -0,0 +1,308 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Times the code the generators write against the same thing written
+ * by hand, over the synthetic classes and enums Synthesize.cmake made.
+ * An op is one call of to_string or operator<< on one enum, or all
+ * five getters, all five setters, or one save or load on one object.
+ * If it was built with the allocation hooks you get allocations per op
+ * too, but the counting slows allocation down some, so compare times
+ * from a build without them (-DBENCH_COUNT_ALLOCATIONS=OFF).
+ *
+ * Run it with an iteration count if the default's too quick or too
+ * slow for you.
+ */
+
+#include "Handwritten.h"
+#include "Synthetic.h"
+#include "ops.h"
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/json.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fr/codegen/alloc.h>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  // Appends to a string that keeps its capacity when you clear it, so
+  // writing to the stream doesn't allocate once it's warmed up
+  class StringBuffer : public std::streambuf {
+    std::string _data;
+
+  protected:
+    int_type overflow(int_type c) override {
+      if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        _data.push_back(traits_type::to_char_type(c));
+      }
+      return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+      _data.append(s, n);
+      return n;
+    }
+
+  public:
+    void clear() {
+      _data.clear();
+    }
+
+    std::string_view view() const {
+      return _data;
+    }
+  };
+
+  // Reads out of a string somebody else owns, without copying it
+  class ViewBuffer : public std::streambuf {
+  public:
+    void reset(std::string_view data) {
+      char* begin = const_cast<char*>(data.data());
+      setg(begin, begin, begin + data.size());
+    }
+  };
+
+  constexpr size_t classes = std::tuple_size_v<SyntheticClasses>;
+
+  // Calls f on every element of a tuple
+  template <typename Tuple, typename F>
+  void each(Tuple& tuple, F f) {
+    std::apply([&](auto&... element) { (f(element), ...); }, tuple);
+  }
+
+  // Times f, which does one op on each of the classes, over iterations
+  // calls and prints how long each op took
+  template <typename F>
+  void time(const std::string& name, int iterations, F f) {
+    // Once to warm up
+    f();
+    alloc::reset();
+    auto start = std::chrono::steady_clock::now();
+    {
+      alloc::Phase phase("benchmark");
+      for (int i = 0; i < iterations; ++i) {
+        f();
+      }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ops = static_cast<double>(iterations) * classes;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns << " ns/op";
+    if (alloc::instrumented()) {
+      std::cout << std::setprecision(2) << std::setw(10) << alloc::report("benchmark").allocations / ops
+                << " allocs/op";
+    }
+    std::cout << std::endl;
+  }
+
+  // Long enough that copying them has to allocate
+  std::string nameOf(size_t i) {
+    return "Synthetic object number " + std::to_string(i);
+  }
+
+  std::string descriptionOf(size_t i) {
+    return "A made up object for the benchmark to push around, number " + std::to_string(i);
+  }
+
+  template <typename Kind>
+  Kind kindOf(size_t i) {
+    return static_cast<Kind>(i % 4);
+  }
+
+  template <typename Archive, typename Tuple>
+  std::vector<std::string> saveAll(Tuple& objects) {
+    std::vector<std::string> ret;
+    each(objects, [&](auto& object) {
+      StringBuffer buffer;
+      std::ostream stream(&buffer);
+      {
+        Archive archive(stream);
+        archive(object);
+      }
+      ret.emplace_back(buffer.view());
+    });
+    return ret;
+  }
+
+  /**
+   * Times saving and loading everything in objects with one kind of
+   * cereal archive. who is "generated" or "hand written".
+   */
+  template <typename OutputArchive, typename InputArchive, typename Tuple>
+  void timeArchive(const std::string& format, const std::string& who, int iterations, Tuple& objects) {
+    StringBuffer out;
+    std::ostream outStream(&out);
+    size_t sink = 0;
+    time(format + " save (" + who + ")", iterations, [&]() {
+      each(objects, [&](auto& object) {
+        out.clear();
+        {
+          OutputArchive archive(outStream);
+          archive(object);
+        }
+        sink += out.view().size();
+      });
+    });
+    auto saved = saveAll<OutputArchive>(objects);
+    ViewBuffer in;
+    std::istream inStream(&in);
+    time(format + " load (" + who + ")", iterations, [&]() {
+      size_t i = 0;
+      each(objects, [&](auto& object) {
+        in.reset(saved[i++]);
+        inStream.clear();
+        InputArchive archive(inStream);
+        archive(object);
+      });
+    });
+    if (sink == 0) {
+      std::cout << "(nothing saved)" << std::endl;
+    }
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+  SyntheticKinds syntheticKinds;
+  HandwrittenKinds handwrittenKinds;
+  SyntheticClasses synthetic;
+  HandwrittenClasses handwritten;
+  {
+    size_t i = 0;
+    each(synthetic, [&](auto& object) {
+      object.set_name(nameOf(i));
+      object.set_description(descriptionOf(i));
+      object.set_count(i);
+      object.set_weight(i * 1.5);
+      object.set_kind(kindOf<decltype(object.get_kind())>(i));
+      ++i;
+    });
+    i = 0;
+    each(handwritten, [&](auto& object) {
+      object.setName(nameOf(i));
+      object.setDescription(descriptionOf(i));
+      object.setCount(i);
+      object.setWeight(i * 1.5);
+      object.setKind(kindOf<decltype(object.kind())>(i));
+      ++i;
+    });
+  }
+
+  // Both sides should be writing the same thing before we time them
+  auto generatedJson = saveAll<cereal::JSONOutputArchive>(synthetic);
+  auto handwrittenJson = saveAll<cereal::JSONOutputArchive>(handwritten);
+  if (generatedJson != handwrittenJson) {
+    std::cerr << "Generated and hand written archives differ:" << std::endl
+              << generatedJson[0] << std::endl
+              << handwrittenJson[0] << std::endl;
+    return 1;
+  }
+
+  std::cout << classes << " classes and enums, " << iterations << " iterations" << std::endl;
+  if (!alloc::instrumented()) {
+    std::cout << "Not counting allocations (configure with -DBENCH_COUNT_ALLOCATIONS=ON)" << std::endl;
+  }
+
+  size_t sink = 0;
+  int step = 0;
+  time("to_string (generated)", iterations, [&]() {
+    ++step;
+    each(syntheticKinds, [&](auto& kind) {
+      sink += to_string(kindOf<std::decay_t<decltype(kind)>>(step)).size();
+    });
+  });
+  time("to_string (hand written)", iterations, [&]() {
+    ++step;
+    each(handwrittenKinds, [&](auto& kind) {
+      sink += to_string(kindOf<std::decay_t<decltype(kind)>>(step)).size();
+    });
+  });
+
+  StringBuffer buffer;
+  std::ostream stream(&buffer);
+  time("operator<< (generated)", iterations, [&]() {
+    ++step;
+    buffer.clear();
+    each(syntheticKinds, [&](auto& kind) {
+      stream << kindOf<std::decay_t<decltype(kind)>>(step);
+    });
+    sink += buffer.view().size();
+  });
+  time("operator<< (hand written)", iterations, [&]() {
+    ++step;
+    buffer.clear();
+    each(handwrittenKinds, [&](auto& kind) {
+      stream << kindOf<std::decay_t<decltype(kind)>>(step);
+    });
+    sink += buffer.view().size();
+  });
+
+  time("getters (generated)", iterations, [&]() {
+    each(synthetic, [&](auto& object) {
+      sink += object.get_name().size() + object.get_description().size() + object.get_count() +
+              static_cast<size_t>(object.get_weight()) + static_cast<size_t>(object.get_kind());
+    });
+  });
+  time("getters (hand written)", iterations, [&]() {
+    each(handwritten, [&](auto& object) {
+      sink += object.name().size() + object.description().size() + object.count() +
+              static_cast<size_t>(object.weight()) + static_cast<size_t>(object.kind());
+    });
+  });
+
+  std::string name = nameOf(classes);
+  std::string description = descriptionOf(classes);
+  time("setters (generated)", iterations, [&]() {
+    ++step;
+    each(synthetic, [&](auto& object) {
+      object.set_name(name);
+      object.set_description(description);
+      object.set_count(step);
+      object.set_weight(step * 0.5);
+      object.set_kind(kindOf<decltype(object.get_kind())>(step));
+    });
+  });
+  time("setters (hand written)", iterations, [&]() {
+    ++step;
+    each(handwritten, [&](auto& object) {
+      object.setName(name);
+      object.setDescription(description);
+      object.setCount(step);
+      object.setWeight(step * 0.5);
+      object.setKind(kindOf<decltype(object.kind())>(step));
+    });
+  });
+
+  timeArchive<cereal::BinaryOutputArchive, cereal::BinaryInputArchive>("binary", "generated", iterations, synthetic);
+  timeArchive<cereal::BinaryOutputArchive, cereal::BinaryInputArchive>("binary", "hand written", iterations,
+                                                                       handwritten);
+  timeArchive<cereal::JSONOutputArchive, cereal::JSONInputArchive>("JSON", "generated", iterations, synthetic);
+  timeArchive<cereal::JSONOutputArchive, cereal::JSONInputArchive>("JSON", "hand written", iterations, handwritten);
+
+  std::cout << "(" << sink << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,170 @@
+# Writes the synthetic headers the benchmark runs over.
+#
+# bench_synthesize(COUNT n DESTINATION dir) writes these to dir:
+#
+# SyntheticEnums.h - n enums for OstreamOpsFromIndex to generate
+#         to_string and operator<< for. They have to be in their own
+#         header because ops.h includes the header each enum came from.
+# Synthetic.h.in - n annotated classes for GenerateFunctions to turn
+#         into Synthetic.h
+# Handwritten.h - the same enums and classes, with the functions
+#         written the way you'd write them by hand
+#
+# Each header ends with a std::tuple of everything in it so the
+# benchmark can run over all of them without knowing n. The files are
+# only rewritten if they change, so rerunning cmake doesn't rerun the
+# generators.
+
+set(_BENCH_ENUMS_HEAD [=[
+/* This is generated by Synthesize.cmake. */
+#pragma once
+#include <tuple>
+
+]=])
+
+set(_BENCH_ENUM [=[
+enum class Kind@ID@ {
+  alpha,
+  beta,
+  gamma,
+  delta
+};
+]=])
+
+set(_BENCH_CLASSES_HEAD [=[
+/* This is generated by Synthesize.cmake. */
+#pragma once
+#include "SyntheticEnums.h"
+#include <cereal/cereal.hpp>
+#include <string>
+#include <tuple>
+
+]=])
+
+set(_BENCH_CLASS [=[
+class Synthetic@ID@ {
+  [[cereal,get,set]] std::string _name;
+  [[cereal,get,set]] std::string _description;
+  [[cereal,get,set]] int _count = 0;
+  [[cereal,get,set]] double _weight = 0.0;
+  [[cereal,get,set]] Kind@ID@ _kind = Kind@ID@::alpha;
+
+public:
+  [[genGetSetMethods]]
+  [[genCerealLoadSave]]
+};
+]=])
+
+# Hand written versions of what the generators write. The enum names
+# are the same length as the generated ones so to_string returns the
+# same size strings. Everything's at the top level because the
+# indexer loses track of namespaces after the first declaration in
+# one.
+set(_BENCH_HANDWRITTEN_HEAD [=[
+/* This is generated by Synthesize.cmake. */
+#pragma once
+#include <cereal/cereal.hpp>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+]=])
+
+set(_BENCH_HANDWRITTEN [=[
+enum class Hand@ID@ {
+  alpha,
+  beta,
+  gamma,
+  delta
+};
+
+inline std::string_view name(Hand@ID@ value) {
+  switch (value) {
+  case Hand@ID@::alpha: return "Hand@ID@::alpha";
+  case Hand@ID@::beta: return "Hand@ID@::beta";
+  case Hand@ID@::gamma: return "Hand@ID@::gamma";
+  case Hand@ID@::delta: return "Hand@ID@::delta";
+  }
+  return "UKNOWN VALUE IN Hand@ID@";
+}
+
+inline std::string to_string(Hand@ID@ value) {
+  return std::string(name(value));
+}
+
+inline std::ostream& operator<<(std::ostream& stream, Hand@ID@ value) {
+  return stream << name(value);
+}
+
+class Handwritten@ID@ {
+  std::string _name;
+  std::string _description;
+  int _count = 0;
+  double _weight = 0.0;
+  Hand@ID@ _kind = Hand@ID@::alpha;
+
+public:
+  const std::string& name() const { return _name; }
+  const std::string& description() const { return _description; }
+  int count() const { return _count; }
+  double weight() const { return _weight; }
+  Hand@ID@ kind() const { return _kind; }
+
+  void setName(const std::string& name) { _name = name; }
+  void setDescription(const std::string& description) { _description = description; }
+  void setCount(int count) { _count = count; }
+  void setWeight(double weight) { _weight = weight; }
+  void setKind(Hand@ID@ kind) { _kind = kind; }
+
+  template <typename Archive>
+  void serialize(Archive& ar) {
+    ar(cereal::make_nvp("_name", _name),
+       cereal::make_nvp("_description", _description),
+       cereal::make_nvp("_count", _count),
+       cereal::make_nvp("_weight", _weight),
+       cereal::make_nvp("_kind", _kind));
+  }
+};
+]=])
+
+function(bench_synthesize)
+  set(oneValueArgs COUNT DESTINATION)
+  cmake_parse_arguments(BENCH "" "${oneValueArgs}" "" ${ARGN})
+
+  set(enums "${_BENCH_ENUMS_HEAD}")
+  set(classes "${_BENCH_CLASSES_HEAD}")
+  set(handwritten "${_BENCH_HANDWRITTEN_HEAD}")
+  set(kindList "")
+  set(classList "")
+  set(handList "")
+  set(handwrittenList "")
+  math(EXPR last "${BENCH_COUNT} - 1")
+  foreach(id RANGE ${last})
+    string(REPLACE "@ID@" "${id}" chunk "${_BENCH_ENUM}")
+    string(APPEND enums "${chunk}\n")
+    string(REPLACE "@ID@" "${id}" chunk "${_BENCH_CLASS}")
+    string(APPEND classes "${chunk}\n")
+    string(REPLACE "@ID@" "${id}" chunk "${_BENCH_HANDWRITTEN}")
+    string(APPEND handwritten "${chunk}\n")
+    list(APPEND kindList "Kind${id}")
+    list(APPEND classList "Synthetic${id}")
+    list(APPEND handList "Hand${id}")
+    list(APPEND handwrittenList "Handwritten${id}")
+  endforeach()
+
+  list(JOIN kindList ", " kindList)
+  list(JOIN classList ", " classList)
+  list(JOIN handList ", " handList)
+  list(JOIN handwrittenList ", " handwrittenList)
+  string(APPEND enums "using SyntheticKinds = std::tuple<${kindList}>;\n")
+  string(APPEND classes "using SyntheticClasses = std::tuple<${classList}>;\n")
+  string(APPEND handwritten "using HandwrittenKinds = std::tuple<${handList}>;\n"
+    "using HandwrittenClasses = std::tuple<${handwrittenList}>;\n")
+
+  # file(CONFIGURE) leaves the file alone if it didn't change. There's
+  # nothing in the C++ for it to substitute.
+  file(CONFIGURE OUTPUT "${BENCH_DESTINATION}/SyntheticEnums.h" CONTENT "${enums}" @ONLY)
+  file(CONFIGURE OUTPUT "${BENCH_DESTINATION}/Synthetic.h.in" CONTENT "${classes}" @ONLY)
+  file(CONFIGURE OUTPUT "${BENCH_DESTINATION}/Handwritten.h" CONTENT "${handwritten}" @ONLY)
+endfunction()
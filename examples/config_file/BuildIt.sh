@@ -6,6 +6,9 @@
 # Assumes you've installed the various Generate* programs build
 # by the top level project, or have them in your path somewhere.
 
+# codegen run manifest.json does all three of these in one go,
+# without writing index.json out
+
 # Generates the Index that the generators use
 IndexCode -h Config.h.in -o index.json
 
@@ -26,3 +29,4 @@ echo "If that didn't give you any errors you should be able to cd to build,"
 echo "Run python and import ConfigExample (You may need '.' in your python"
 echo "path.) Then try declaring a variable as a ConfigExample.config and"
 echo "calling its to_json() method."
+echo "./JsonBenchmark times the generated JSON codec against cereal's."
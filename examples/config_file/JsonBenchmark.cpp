@@ -0,0 +1,80 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Times the [[genJsonCodec]] functions against going through cereal's
+ * JSON archives for the same Config. Run it with an iteration count
+ * if the default's too quick or too slow for you.
+ */
+
+#include "Config.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+  // Time f over iterations calls and print how long each one took
+  template <typename F>
+  void time(const std::string& name, int iterations, F f) {
+    // Once to warm up
+    f();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::cout << name << ": " << ns << " ns/op" << std::endl;
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+  Config config;
+  config.configFileLocation = "/etc/example/config.json";
+  config.searchPath = "/usr/local/share/example:/usr/share/example:\"quoted\"";
+  config.gravitationalConstant = 6.6743e-11;
+  config.numNipples = 8;
+  config.approximatePi = 3;
+  config.moreText = "Some more text\twith a tab in it";
+
+  std::string direct = config.to_json();
+  std::string cereal = config.to_cereal_json();
+  // Make sure both ways agree before timing anything
+  Config check;
+  check.from_json(direct);
+  if (check.to_json() != direct) {
+    std::cerr << "Direct codec didn't round trip: " << direct << std::endl;
+    return 1;
+  }
+
+  size_t sink = 0;
+  time("to_json (generated)", iterations, [&]() { sink += config.to_json().size(); });
+  time("to_json (cereal)", iterations, [&]() { sink += config.to_cereal_json().size(); });
+  // Reusing the writer's buffer saves the allocation too
+  fr::codegen::json::JsonWriter writer;
+  time("saveJson (reused writer)", iterations, [&]() {
+    writer.clear();
+    config.saveJson(writer);
+    sink += writer.view().size();
+  });
+  time("from_json (generated)", iterations, [&]() { check.from_json(direct); sink += check.numNipples; });
+  time("from_json (cereal)", iterations, [&]() { check.from_cereal_json(cereal); sink += check.numNipples; });
+  std::cout << "(" << sink << ")" << std::endl;
+  return 0;
+}
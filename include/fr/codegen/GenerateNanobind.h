@@ -25,8 +25,14 @@
 #include <fr/codegen/LblFilter.h>
 #include <fr/codegen/LblMiniParser.h>
 #include <fr/codegen/LblEmitFunctions.h>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace fr::codegen {
 
@@ -85,6 +91,10 @@ namespace fr::codegen {
   /**
    * This iterates through all the classes in ClassMap and emits a nanobind
    * class_ for each one. It's triggered by [[PythonApi]].
+   *
+   * With a few hundred classes the one big NB_MODULE takes forever
+   * to compile, so you can also ask it to split the bindings up into
+   * shard files (see setShards) that the build can compile in parallel.
    */
   
   class LblEmitPythonApi : public LblMiniParserFilter {
@@ -103,7 +113,7 @@ namespace fr::codegen {
       out.append(">(m, \"");
       out.append(data->name);
       out.append("\")");
-      emit(out);
+      emitBinding(out);
     }
 
     void emitConstructor(const MethodData& method) {
@@ -127,7 +137,7 @@ namespace fr::codegen {
         out.append(parameter.type);        
       }
       out.append(">())");
-      emit(out);
+      emitBinding(out);
     }
     
     void emitMethods(std::shared_ptr<ClassData> data) {
@@ -166,7 +176,7 @@ namespace fr::codegen {
             out.append("::");
             out.append(method.name);
             out.append("))");
-            emit(out);
+            emitBinding(out);
           }
         }
       }
@@ -187,27 +197,124 @@ namespace fr::codegen {
           out.append("::");
           out.append(member.name);
           out.append(")");
-          emit(out);
+          emitBinding(out);
         }
       }
     }
 
     void emitEndClass() {
       // This just goes at the end of a bunch of .defs.
-      emit("    ;");
+      emitBinding("    ;");
+    }
+
+    // Class bindings either go down the filter chain or, if we're sharding,
+    // into the shard file we're currently writing.
+    void emitBinding(const std::string& line) {
+      if (_shardStream) {
+        *_shardStream << line << std::endl;
+      } else {
+        emit(line);
+      }
+    }
+
+    void emitClass(std::shared_ptr<ClassData> data) {
+      emitClassHeader(data);
+      // Todo: emitMethods handle static methods correctly
+      emitMethods(data);
+      emitMembers(data);
+      emitEndClass();
+      emitBinding("\n");
+    }
+
+    // Writes one bind_shard_N function with the classes in the shard
+    void emitShard(int shard, const std::vector<std::shared_ptr<ClassData>>& classes) {
+      std::string filename = shardFileName(_shardBaseName, shard);
+      processingShard(filename);
+      std::ofstream stream(filename);
+      if (!stream) {
+        throw std::runtime_error("Couldn't write " + filename);
+      }
+      stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+      // Shards need the same includes the template gave the module
+      for (const auto& line : _preamble) {
+        stream << line << std::endl;
+      }
+      stream << "void " << shardFunctionName(shard) << "(nanobind::module_& m) {" << std::endl;
+      _shardStream = &stream;
+      for (auto data : classes) {
+        emitClass(data);
+      }
+      _shardStream = nullptr;
+      stream << "}" << std::endl;
+      stream.close();
+      if (!stream) {
+        throw std::runtime_error("Couldn't write " + filename);
+      }
     }
 
     void emitAllClasses() {
-      for (auto [name, data] : _classes) {
-        emitClassHeader(data);
-        // Todo: emitMethods handle static methods correctly
-        emitMethods(data);
-        emitMembers(data);
-        emitEndClass();
-        emit("\n");
+      if (_shardCount <= 0) {
+        for (auto data : dependencyOrder()) {
+          emitClass(data);
+        }
+        return;
+      }
+      auto shards = shardClasses();
+      for (int shard = 0; shard < _shardCount; ++shard) {
+        if (!_skippedShards.contains(shard)) {
+          emitShard(shard, shards[shard]);
+        }
+      }
+      // Block scope function declarations are perfectly legal and save us
+      // from having to reach back up above NB_MODULE to declare these.
+      for (int shard = 0; shard < _shardCount; ++shard) {
+        std::string out("  void ");
+        out.append(shardFunctionName(shard));
+        out.append("(nanobind::module_&);");
+        emit(out);
+      }
+      for (int shard = 0; shard < _shardCount; ++shard) {
+        std::string out("  ");
+        out.append(shardFunctionName(shard));
+        out.append("(m);");
+        emit(out);
       }
     }
 
+    // Depth first walk so a class's parent (if we know about it) lands
+    // in front of the class. Nanobind gets cranky if you bind a child
+    // before its parent.
+    void visitClass(std::shared_ptr<ClassData> data,
+                    std::set<std::string>& visited,
+                    std::vector<std::shared_ptr<ClassData>>& ordered) {
+      if (visited.contains(data->name)) {
+        return;
+      }
+      visited.insert(data->name);
+      if (data->parents.size() > 0) {
+        std::string parent = data->parents[0];
+        // Parents may be namespace qualified, but _classes is keyed
+        // on the bare class name
+        auto colons = parent.rfind("::");
+        if (colons != std::string::npos) {
+          parent = parent.substr(colons + 2);
+        }
+        if (_classes.contains(parent)) {
+          visitClass(_classes[parent], visited, ordered);
+        }
+      }
+      ordered.push_back(data);
+    }
+
+    int _shardCount = 0;
+    std::string _shardBaseName;
+    std::set<int> _skippedShards;
+    std::ofstream* _shardStream = nullptr;
+    // Includes and using lines from the template ahead of NB_MODULE,
+    // which get copied into each shard
+    std::vector<std::string> _preamble;
+    bool _inModule = false;
+
   public:
     LblEmitPythonApi(const ClassMap &classes) : LblMiniParserFilter(classes) {}
     virtual ~LblEmitPythonApi() = default;
@@ -216,8 +323,100 @@ namespace fr::codegen {
     boost::signals2::signal<void()> processingConstructor;
     boost::signals2::signal<void(const std::string&)> processingMethod;
     boost::signals2::signal<void(const std::string&)> processingMember;
+    // Called with the file name when we start writing a shard
+    boost::signals2::signal<void(const std::string&)> processingShard;
+
+    /**
+     * Split the class bindings across count files instead of putting
+     * them all in the NB_MODULE body. Shard files are named after
+     * outputFile (see shardFileName) and each one defines a
+     * bind_shard_N(nanobind::module_&) function that the module calls.
+     * A count of 0 turns sharding off.
+     */
+    void setShards(int count, const std::string& outputFile) {
+      _shardCount = count;
+      _shardBaseName = outputFile;
+    }
+
+    // Foo/PythonApi.cpp, 2 -> Foo/PythonApi_shard2.cpp
+    static std::string shardFileName(const std::string& outputFile, int shard) {
+      std::filesystem::path path(outputFile);
+      std::string name = path.stem().string();
+      name.append("_shard");
+      name.append(std::to_string(shard));
+      name.append(path.extension().string());
+      return path.replace_filename(name).string();
+    }
+
+    // Leave this shard's file alone, it's already up to date
+    void skipShard(int shard) {
+      _skippedShards.insert(shard);
+    }
+
+    static std::string shardFunctionName(int shard) {
+      return std::string("bind_shard_") + std::to_string(shard);
+    }
+
+    // All the classes we know about with parents ahead of their children
+    std::vector<std::shared_ptr<ClassData>> dependencyOrder() {
+      std::set<std::string> visited;
+      std::vector<std::shared_ptr<ClassData>> ordered;
+      for (auto [name, data] : _classes) {
+        visitClass(data, visited, ordered);
+      }
+      return ordered;
+    }
+
+    // Which classes go in which shard. Classes are split into contiguous
+    // runs of the dependency order and the shards are called in order,
+    // so a parent is always bound before its children no matter which
+    // shard it lands in.
+    std::vector<std::vector<std::shared_ptr<ClassData>>> shardClasses() {
+      std::vector<std::vector<std::shared_ptr<ClassData>>> shards(std::max(_shardCount, 0));
+      auto classes = dependencyOrder();
+      for (int shard = 0; shard < _shardCount; ++shard) {
+        auto first = classes.begin() + (classes.size() * shard) / _shardCount;
+        auto last = classes.begin() + (classes.size() * (shard + 1)) / _shardCount;
+        shards[shard].assign(first, last);
+      }
+      return shards;
+    }
+
+    /**
+     * Whether a line ahead of NB_MODULE goes into the shards too. Only
+     * includes, namespace aliases and using lines do, since they don't
+     * define anything. Anything else up there (a helper function, a
+     * global) would get defined once per shard and break the one
+     * definition rule, so put it in the module body or a header.
+     */
+    static bool sharedWithShards(const std::string& line) {
+      auto start = line.find_first_not_of(" \t");
+      if (start == std::string::npos) {
+        return false;
+      }
+      std::string_view text(line);
+      text.remove_prefix(start);
+      if (text.starts_with("#")) {
+        text.remove_prefix(1);
+        text.remove_prefix(std::min(text.find_first_not_of(" \t"), text.size()));
+        return text.starts_with("include");
+      }
+      if (text.starts_with("using ")) {
+        return true;
+      }
+      // namespace foo = bar::baz;
+      return text.starts_with("namespace ") && text.find('=') != std::string_view::npos &&
+        text.find('{') == std::string_view::npos;
+    }
 
     void process(const std::string& line) override {
+      if (!_inModule) {
+        if (line.find("NB_MODULE(") != std::string::npos) {
+          _inModule = true;
+        } else if (sharedWithShards(line)) {
+          _preamble.push_back(line);
+        }
+      }
       // Look for tag
       std::string lineCopy = line;
       lineCopy.erase(std::remove_if(lineCopy.begin(),
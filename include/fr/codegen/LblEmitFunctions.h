@@ -28,6 +28,8 @@
 #include <algorithm>
 #include <cctype>
 #include <fr/codegen/data.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/json.h>
 #include <fr/codegen/LblFilter.h>
 #include <fr/codegen/LblMiniParser.h>
 #include <iostream>
@@ -36,8 +38,6 @@
 
 namespace fr::codegen {
 
-  using ClassMap = std::map<std::string, std::shared_ptr<ClassData>>;
-
   // Base classes for other things that need to know class name
   // to subscribe to. All of these need to accept a ClassMap
   // created by IndexCode.cpp
@@ -46,6 +46,10 @@ namespace fr::codegen {
   protected:
     ClassMap _classes;
     std::shared_ptr<ClassData> _currentClass;
+    // Where to look for classes that aren't in _classes, if anywhere
+    const IndexSet* _resolve = nullptr;
+    // Where warnings go
+    std::ostream* _warnings = &std::cerr;
   public:
     
     boost::signals2::signal<void(const std::string&)> classPush;
@@ -62,6 +66,27 @@ namespace fr::codegen {
     // A parent unsubscribes so we don't need to
     virtual ~LblMiniParserFilter() = default;
 
+    /**
+     * Look up classes we weren't given in indexes, so a header whose
+     * classes some other package indexed can still be processed.
+     * They don't get added to _classes, so filters that do something
+     * for every class still only do it for the ones you gave them.
+     * indexes has to stick around as long as the filter does.
+     */
+    void resolveWith(const IndexSet& indexes) {
+      _resolve = &indexes;
+    }
+
+    /**
+     * Send warnings to stream instead of std::cerr. The tools point
+     * this at their output, so a program codegend ran for you prints
+     * them instead of the daemon. stream has to stick around as long
+     * as the filter does.
+     */
+    void warnTo(std::ostream& stream) {
+      _warnings = &stream;
+    }
+
     // Some more subscribeTo functions. Since these don't have the
     // same parameter type as the previous ones, they should be
     // new functions and subscribing to emitters should still
@@ -69,7 +94,7 @@ namespace fr::codegen {
     // classPush and classPop
     virtual void subscribeTo(fr::codegen::miniparser::LblMiniparser* emitter) {
       auto subscription = emitter->emit.connect([&](const std::string& toProcess) {
-        process(toProcess);
+        traceProcess(toProcess);
       });
       auto classPushSub = emitter->classPush.connect([&](const std::string& className) {
         handleClassPush(className);
@@ -89,7 +114,7 @@ namespace fr::codegen {
 
     virtual void subscribeTo(LblMiniParserFilter* emitter) {
       auto subscription = emitter->emit.connect([&](const std::string& toProcess) {
-        process(toProcess);
+        traceProcess(toProcess);
       });
       auto classPushSub = emitter->classPush.connect([&](const std::string& className) {
         handleClassPush(className);
@@ -130,8 +155,10 @@ namespace fr::codegen {
     void handleClassPush(const std::string& className) {
       if (_classes.contains(className)) {
         _currentClass = _classes[className];
+      } else if (auto found = _resolve ? _resolve->findClassByName(className) : nullptr) {
+        _currentClass = found;
       } else {
-        std::cerr << "WARNING: Class " << className << " was not found in class data" << std::endl;
+        *_warnings << "WARNING: Class " << className << " was not found in class data" << std::endl;
       }
       // Forward the signal to the next thing in the filter chain
       classPush(className);
@@ -159,7 +186,7 @@ namespace fr::codegen {
     virtual ~LblEmitGetSetMethods() = default;
 
     void emitGetMethods() {
-      for (auto member : _currentClass->members) {
+      for (const auto& member : _currentClass->members) {
         if (member.generateGetter) {
           std::string out(member.type);
           out.append(" get");
@@ -173,7 +200,7 @@ namespace fr::codegen {
     }
 
     void emitSetMethods() {
-      for (auto member : _currentClass->members) {
+      for (const auto& member : _currentClass->members) {
         if (member.generateSetter) {
           std::string out("void set");
           out.append(member.name);
@@ -201,7 +228,7 @@ namespace fr::codegen {
           emitGetMethods();
           emitSetMethods();
         } else {
-          std::cerr << "WARNING: [[genGetSetMethods]] encountered, but not in a class" << std::endl;
+          *_warnings << "WARNING: [[genGetSetMethods]] encountered, but not in a class" << std::endl;
         }
       } else {
         emit(line);
@@ -225,7 +252,7 @@ namespace fr::codegen {
     void emitSaveMethod() {
       emit("template <typename Archive>");
       emit("void save(Archive& ar) const {");
-      for(auto member : _currentClass->members) {
+      for (const auto& member : _currentClass->members) {
         if (member.serializable | _currentClass->serializable) {
           // The make_nvp makes a nice text tag for your members
           // if you're serializing to json or xml.
@@ -243,7 +270,7 @@ namespace fr::codegen {
     void emitLoadMethod() {
       emit("template <typename Archive>");
       emit("void load(Archive& ar) {");
-      for(auto member : _currentClass->members) {
+      for (const auto& member : _currentClass->members) {
         if (member.serializable | _currentClass->serializable) {
           // We don't need to use make_nvp on read though.
           std::string out("ar(");
@@ -268,7 +295,88 @@ namespace fr::codegen {
           emitSaveMethod();
           emitLoadMethod();
         } else {
-          std::cerr << "WARNING: [[genCerealLoadSave]] encountered, but not in a class" << std::endl;
+          *_warnings << "WARNING: [[genCerealLoadSave]] encountered, but not in a class" << std::endl;
+        }
+      } else {
+        emit(line);
+      }
+    }
+    
+  };
+
+  /**
+   * When this class encounters [[genJsonCodec]] on a line by itself,
+   * it will NOT emit that line and will instead emit saveJson and
+   * loadJson methods for the same members [[genCerealLoadSave]]
+   * would serialize. These go straight to and from JSON text with the
+   * JsonWriter and JsonReader in json.h, so the generated header
+   * needs to include that. loadJson finds fields with a perfect hash
+   * worked out here, skips any it doesn't know and leaves members
+   * that aren't in the JSON alone.
+   */
+
+  class LblEmitJsonCodec : public LblMiniParserFilter {
+  public:
+
+    LblEmitJsonCodec(const ClassMap& classes) : LblMiniParserFilter(classes) {}
+    virtual ~LblEmitJsonCodec() = default;
+
+    std::vector<std::string> serializedMembers() {
+      std::vector<std::string> names;
+      for (const auto& member : _currentClass->members) {
+        if (member.serializable | _currentClass->serializable) {
+          names.push_back(member.name);
+        }
+      }
+      return names;
+    }
+
+    void emitSaveMethod(const std::vector<std::string>& names) {
+      emit("void saveJson(fr::codegen::json::JsonWriter& writer) const {");
+      emit("writer.beginObject();");
+      for (const auto& name : names) {
+        emit("writer.field(\"" + name + "\", " + name + ");");
+      }
+      emit("writer.endObject();");
+      emit("}");
+    }
+
+    void emitLoadMethod(const std::vector<std::string>& names) {
+      emit("void loadJson(fr::codegen::json::JsonReader& reader) {");
+      emit("reader.beginObject();");
+      emit("std::string_view key;");
+      emit("while (reader.nextKey(key)) {");
+      if (!names.empty()) {
+        auto table = json::perfectHash(names);
+        emit("switch (fr::codegen::json::fieldHash(key, " + std::to_string(table.seed) + ") & " +
+             std::to_string(table.mask) + ") {");
+        for (const auto& name : names) {
+          emit("case " + std::to_string(json::fieldHash(name, table.seed) & table.mask) + ":");
+          emit("if (key == \"" + name + "\") { reader.read(" + name + "); continue; }");
+          emit("break;");
+        }
+        emit("}");
+      }
+      emit("reader.skipValue();");
+      emit("}");
+      emit("}");
+    }
+
+    void process(const std::string& line) override {
+      // Look for tag
+      std::string lineCopy = line;
+      // Remove all whitespace from line
+      lineCopy.erase(std::remove_if(lineCopy.begin(),
+                                    lineCopy.end(),
+                                    ::isspace),
+                     lineCopy.end());
+      if (lineCopy == "[[genJsonCodec]]") {
+        if (_currentClass) {
+          auto names = serializedMembers();
+          emitSaveMethod(names);
+          emitLoadMethod(names);
+        } else {
+          *_warnings << "WARNING: [[genJsonCodec]] encountered, but not in a class" << std::endl;
         }
       } else {
         emit(line);
@@ -18,11 +18,15 @@
 
 #pragma once
 
+#include <boost/core/demangle.hpp>
 #include <boost/signals2.hpp>
+#include <fr/codegen/trace.h>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <typeinfo>
 #include <vector>
 
 namespace fr::codegen {
@@ -49,6 +53,32 @@ namespace fr::codegen {
   class LblSubscriber {
   protected:
     std::vector<boost::signals2::connection> _subscriptions;
+
+    // If line is a [[directive]] on a line by itself, returns the
+    // directive, otherwise an empty view
+    static std::string_view directive(const std::string& line) {
+      auto start = line.find_first_not_of(" \t");
+      if (start == std::string::npos || line.compare(start, 2, "[[") != 0) {
+        return {};
+      }
+      auto end = line.find_last_not_of(" \t\r");
+      return std::string_view(line).substr(start, end - start + 1);
+    }
+
+    // Processes a line, with a trace span for this stage if it's a
+    // directive and we're tracing
+    void traceProcess(const std::string& toProcess) {
+      if (trace::enabled()) {
+        auto found = directive(toProcess);
+        if (!found.empty()) {
+          trace::Span span("lbl", stageName(), found);
+          process(toProcess);
+          return;
+        }
+      }
+      process(toProcess);
+    }
+
   public:
     LblSubscriber() = default;
     virtual ~LblSubscriber() { unsubscribe(); }
@@ -60,6 +90,20 @@ namespace fr::codegen {
 
     virtual void process(const std::string& toProcess) = 0;
 
+    /**
+     * What this stage is called in traces. Defaults to the class name.
+     */
+
+    virtual std::string stageName() const {
+      std::string name = boost::core::demangle(typeid(*this).name());
+      // Leave the namespaces off unless it's a template
+      auto colons = name.rfind("::");
+      if (colons != std::string::npos && name.find('<') == std::string::npos) {
+        name.erase(0, colons + 2);
+      }
+      return name;
+    }
+
     /**
      * Drop all subscriptions
      */
@@ -79,7 +123,7 @@ namespace fr::codegen {
 
     virtual void subscribeTo(LblEmitter* emitter) {
       auto subscription = emitter->emit.connect([&](const std::string& toProcess) {
-        process(toProcess);
+        traceProcess(toProcess);
       });
       _subscriptions.push_back(subscription);
     }
@@ -154,6 +198,11 @@ namespace fr::codegen {
     void process(const std::string& line) {
       stream << line << std::endl;
     }
+
+    // Finish writing the file now instead of when this goes away
+    void close() {
+      stream.close();
+    }
   };
   
 }
@@ -0,0 +1,168 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * A template read and mini-parsed once, for as many filter chains as
+ * want it.
+ *
+ * Emitters are signals, so any number of chains can subscribe to one
+ * LblTemplateReader (or one LblMiniparser) and they all get every
+ * line in the same pass, each going to its own LblWriter:
+ *
+ *   LblTemplateReader reader(LblTemplate::read("Config.h.in"));
+ *   LblEmitGetSetMethods getSet(classes);
+ *   getSet.subscribeTo(reader);
+ *   LblEmitModuleStart module(classes);
+ *   module.subscribeTo(reader);
+ *   ... a writer on the end of each ...
+ *   reader.process();
+ *
+ * LblTemplate remembers what the reader and mini-parser did, so the
+ * generators running in one process (codegen run, codegend) don't
+ * each read and mini-parse a template they've all been given. The
+ * tools get them from the TemplateCache in their ToolContext.
+ */
+
+#pragma once
+
+#include <fr/codegen/index.h>
+#include <fr/codegen/LblFilter.h>
+#include <fr/codegen/LblMiniParser.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fr::codegen {
+
+  /**
+   * Everything LblMiniparser said about a file, in the order it said
+   * it. It doesn't change once it's read, so one can be shared between
+   * threads.
+   */
+  class LblTemplate {
+  public:
+    struct Event {
+      enum class Kind { line, classPush, classPop };
+      Kind kind;
+      // The line, or the class name for classPush
+      std::string text;
+    };
+
+  private:
+    std::vector<Event> _events;
+
+  public:
+    LblTemplate() = default;
+    ~LblTemplate() = default;
+
+    // Reads filename through a LblMiniparser, same as the tools used to
+    static std::shared_ptr<const LblTemplate> read(const std::string& filename) {
+      auto ret = std::make_shared<LblTemplate>();
+      LblReader reader(filename);
+      miniparser::LblMiniparser parser;
+      parser.subscribeTo(reader);
+      auto& events = ret->_events;
+      parser.classPush.connect([&events](const std::string& name) {
+        events.push_back({Event::Kind::classPush, name});
+      });
+      parser.classPop.connect([&events]() {
+        events.push_back({Event::Kind::classPop, ""});
+      });
+      parser.emit.connect([&events](const std::string& line) {
+        events.push_back({Event::Kind::line, line});
+      });
+      reader.process();
+      return ret;
+    }
+
+    const std::vector<Event>& events() const {
+      return _events;
+    }
+  };
+
+  /**
+   * Plays a LblTemplate to everything subscribed to it. It's a
+   * LblMiniparser, so the LblMiniParserFilters subscribe to it the
+   * same way they do to one of those, and it's a drop-in for a
+   * LblReader with a LblMiniparser on it.
+   */
+  class LblTemplateReader : public miniparser::LblMiniparser {
+    std::shared_ptr<const LblTemplate> _template;
+
+  public:
+    LblTemplateReader(std::shared_ptr<const LblTemplate> lblTemplate) : _template(std::move(lblTemplate)) {
+    }
+
+    virtual ~LblTemplateReader() = default;
+
+    // You can still hand it lines yourself
+    using miniparser::LblMiniparser::process;
+
+    void process() {
+      for (const auto& event : _template->events()) {
+        switch (event.kind) {
+        case LblTemplate::Event::Kind::classPush:
+          classPush(event.text);
+          break;
+        case LblTemplate::Event::Kind::classPop:
+          classPop();
+          break;
+        case LblTemplate::Event::Kind::line:
+          emit(event.text);
+          break;
+        }
+      }
+    }
+  };
+
+  /**
+   * Keeps templates around so the generators running in one process
+   * only read each one once. A template gets read again if the file's
+   * been touched since.
+   */
+  class TemplateCache {
+    std::mutex _mutex;
+    std::map<std::string, std::pair<FileStamp, std::shared_ptr<const LblTemplate>>> _templates;
+
+  public:
+    std::shared_ptr<const LblTemplate> load(const std::string& filename) {
+      auto stamp = FileStamp::of(filename);
+      if (!stamp) {
+        // Nothing to remember it by, and LblReader will find nothing there anyway
+        return LblTemplate::read(filename);
+      }
+      {
+        std::lock_guard lock(_mutex);
+        auto it = _templates.find(stamp->path);
+        if (it != _templates.end() && it->second.first == *stamp) {
+          return it->second.second;
+        }
+      }
+      // Two steps after the same template might both read it, which is
+      // no worse than before
+      auto ret = LblTemplate::read(filename);
+      std::lock_guard lock(_mutex);
+      _templates[stamp->path] = {*stamp, ret};
+      return ret;
+    }
+
+    size_t size() {
+      std::lock_guard lock(_mutex);
+      return _templates.size();
+    }
+  };
+
+}
@@ -0,0 +1,332 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * What OstreamOpsFromIndex writes, split out of the program so the
+ * tests can get at it. Everything here writes to a stream. Deciding
+ * which files to write (and which ones are up to date) is still the
+ * program's job.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/index.h>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fr::codegen::ostreamops {
+
+  // Emit the function declarations for a set of enums
+  inline void generateDeclarations(const EnumMap& enums, std::ostream& stream) {
+    for (const auto& [name, ptr] : enums) {
+      stream << "std::string to_string(const " << name << "& value);" << std::endl;
+      stream << "std::ostream& operator<<(std::ostream& stream, const " << name << "& value);" << std::endl;
+    }
+  }
+
+  // Generate header file from enum map
+  inline void generateHeader(const EnumMap& enums, std::ostream& stream) {
+    stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+    stream << "#pragma once" << std::endl;
+    stream << "#include <string>" << std::endl;
+    stream << "#include <iostream>" << std::endl;
+    std::vector<std::string> includedFiles;
+    for (const auto& [name, ptr] : enums) {
+      // Only include each unique file once
+      if (std::find(includedFiles.begin(), includedFiles.end(), ptr->definedIn) == includedFiles.end()) {
+        stream << "#include <" << ptr->definedIn << ">" << std::endl;
+        includedFiles.push_back(ptr->definedIn);
+      }
+    }
+
+    // Emit header definitions
+    generateDeclarations(enums, stream);
+  }
+
+  // Can we write an opaque declaration for this enum instead of including
+  // its header? We need to know its underlying type to do that, which we do
+  // for enum classes without one (int) or anything that spells out a plain
+  // integer type. If it uses a typedef of its own, we'd need its header to
+  // find that anyway.
+  inline bool canForwardDeclare(const EnumData& data) {
+    static const std::set<std::string> integerTypes{
+      "char", "signed char", "unsigned char", "wchar_t", "char8_t", "char16_t", "char32_t",
+      "short", "short int", "signed short", "unsigned short", "unsigned short int",
+      "int", "signed", "signed int", "unsigned", "unsigned int",
+      "long", "long int", "signed long", "unsigned long", "unsigned long int",
+      "long long", "long long int", "signed long long", "unsigned long long", "unsigned long long int",
+      "int8_t", "int16_t", "int32_t", "int64_t",
+      "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+      "size_t"
+    };
+    if (data.underlyingType.empty()) {
+      return data.isClassEnum;
+    }
+    std::string type = data.underlyingType;
+    for (std::string prefix : {"::", "std::"}) {
+      if (type.starts_with(prefix)) {
+        type = type.substr(prefix.size());
+      }
+    }
+    return integerTypes.contains(type);
+  }
+
+  // Write a companion header declaring just the functions for the enums in
+  // one source header.
+  inline void generateCompanionHeader(const EnumMap& enums, std::ostream& stream) {
+    stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+    stream << "#pragma once" << std::endl;
+    // The forward declarations' underlying types come from these
+    stream << "#include <cstddef>" << std::endl;
+    stream << "#include <cstdint>" << std::endl;
+    stream << "#include <iosfwd>" << std::endl;
+    stream << "#include <string>" << std::endl;
+    std::set<std::string> includedFiles;
+    for (const auto& [name, ptr] : enums) {
+      if (!canForwardDeclare(*ptr) && includedFiles.insert(ptr->definedIn).second) {
+        stream << "#include <" << ptr->definedIn << ">" << std::endl;
+      }
+    }
+    stream << std::endl;
+    for (const auto& [name, ptr] : enums) {
+      if (!canForwardDeclare(*ptr)) {
+        continue;
+      }
+      std::string enumNamespace = ptr->enumNamespace();
+      if (enumNamespace.size()) {
+        stream << "namespace " << enumNamespace << " { ";
+      }
+      stream << (ptr->isClassEnum ? "enum class " : "enum ") << ptr->name;
+      if (ptr->underlyingType.size()) {
+        stream << " : " << ptr->underlyingType;
+      }
+      stream << ";";
+      if (enumNamespace.size()) {
+        stream << " }";
+      }
+      stream << std::endl;
+    }
+    stream << std::endl;
+    generateDeclarations(enums, stream);
+  }
+
+  // Enums by the header they're defined in
+  inline std::map<std::string, EnumMap> enumsByHeader(const EnumMap& enums) {
+    std::map<std::string, EnumMap> ret;
+    for (const auto& [name, ptr] : enums) {
+      ret[ptr->definedIn][name] = ptr;
+    }
+    return ret;
+  }
+
+  // What each header's companion header is called. foo/a.h and bar/a.h
+  // both want a_ops.h, so the second one gets a_2_ops.h
+  inline std::map<std::string, std::string> companionNames(const std::map<std::string, EnumMap>& byHeader) {
+    std::map<std::string, std::string> ret;
+    std::set<std::string> usedNames;
+    for (const auto& [definedIn, headerEnums] : byHeader) {
+      std::string stem = std::filesystem::path(definedIn).stem().string();
+      std::string companionName = stem + "_ops.h";
+      for (int suffix = 2; usedNames.contains(companionName); ++suffix) {
+        companionName = stem + "_" + std::to_string(suffix) + "_ops.h";
+      }
+      usedNames.insert(companionName);
+      ret[definedIn] = companionName;
+    }
+    return ret;
+  }
+
+  // The header that includes all the companions, by the names from
+  // companionNames
+  inline void generateUmbrellaHeader(const std::map<std::string, std::string>& names, std::ostream& stream) {
+    stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+    stream << "#pragma once" << std::endl;
+    for (const auto& [definedIn, companionName] : names) {
+      stream << "#include \"" << companionName << "\"" << std::endl;
+    }
+  }
+
+  // The companions an umbrella header includes, so the ones that
+  // aren't generated any more can be cleaned up. Anything that doesn't
+  // look like one of ours is left out.
+  inline std::vector<std::string> umbrellaIncludes(std::istream& umbrella) {
+    std::vector<std::string> ret;
+    std::string line;
+    while (std::getline(umbrella, line)) {
+      if (line.starts_with("#include \"") && line.ends_with("_ops.h\"")) {
+        ret.push_back(line.substr(10, line.size() - 11));
+      }
+    }
+    return ret;
+  }
+
+  // Generate the to_string functions and ostream operators themselves
+  inline void generateFunctions(const EnumMap& enums, std::ostream& stream) {
+    for (const auto& [name, ptr] : enums) {
+      stream << "std::string to_string(const " << name << "& value) {" << std::endl;
+      stream << "// Default value if not found" << std::endl;
+      stream << "std::string ret(\"UKNOWN VALUE IN " << name << "\");" << std::endl;
+      stream << "  switch(value) {" << std::endl;
+      for(auto id : ptr->identifiers) {
+        stream << "     case ";
+          if (ptr->isClassEnum) {
+            // If it's a class enum we need to include the enum namespace
+            // and name, which name has, so we can just append the identifier
+            // name after that
+            stream << name << "::" << id;
+          } else {
+            // Otherwise we have to include the namespace the enum is defined
+            // in but NOT the enum name
+            if (ptr->namespaces.size()) {
+              stream << ptr->enumNamespace() << "::";
+            }
+            stream << id;
+          }
+        stream << ":" << std::endl;
+        stream << "       ret = \"";
+        if (ptr->isClassEnum) {
+          stream << name << "::" << id;
+        } else {
+          if (ptr->namespaces.size()) {
+            stream << ptr->enumNamespace() << "::";
+          }
+          stream << id;
+        }
+        stream << "\";" << std::endl;
+        stream << "       break;" << std::endl;
+      }
+      stream << "  }" << std::endl;
+      stream << " return ret;" << std::endl;
+      stream << "}" << std::endl << std::endl;
+      stream << "std::ostream& operator<<(std::ostream& stream, const " << name << "& value) {" << std::endl;
+      stream << "  stream << to_string(value);" << std::endl;
+      stream << "  return stream;" << std::endl;
+      stream << "}" << std::endl << std::endl;
+    }
+  }
+
+  // Generate CPP file -- needs header file name so it can included it, fortunately
+  // user passed it in
+  inline void generateSource(const EnumMap& enums, std::ostream& stream, const std::string& headerFile) {
+    stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+    stream << "#include \"" << headerFile << "\"" << std::endl;
+    generateFunctions(enums, stream);
+  }
+
+  // ops.cpp, 2 -> ops_shard2.cpp
+  inline std::string shardFileName(const std::string& cppFile, int shard) {
+    std::filesystem::path path(cppFile);
+    std::string name = path.stem().string();
+    name.append("_shard");
+    name.append(std::to_string(shard));
+    name.append(path.extension().string());
+    return path.replace_filename(name).string();
+  }
+
+  // Split the enums into count shards. Enums from the same header always
+  // land in the same shard so each shard includes as few headers as
+  // possible. Headers are handed out biggest first to whichever shard
+  // has the fewest identifiers so far, which keeps the shards roughly
+  // the same size.
+  inline std::vector<EnumMap> shardEnums(const EnumMap& enums, int count) {
+    std::map<std::string, EnumMap> byHeader;
+    std::map<std::string, size_t> headerSize;
+    for (const auto& [name, ptr] : enums) {
+      byHeader[ptr->definedIn][name] = ptr;
+      headerSize[ptr->definedIn] += ptr->identifiers.size() + 1;
+    }
+    std::vector<std::string> headers;
+    for (const auto& [header, size] : headerSize) {
+      headers.push_back(header);
+    }
+    std::stable_sort(headers.begin(), headers.end(), [&headerSize](const auto& a, const auto& b) {
+      return headerSize[a] > headerSize[b];
+    });
+
+    std::vector<EnumMap> shards(count);
+    std::vector<size_t> shardSize(count, 0);
+    for (const auto& header : headers) {
+      auto smallest = std::min_element(shardSize.begin(), shardSize.end()) - shardSize.begin();
+      shards[smallest].insert(byHeader[header].begin(), byHeader[header].end());
+      shardSize[smallest] += headerSize[header];
+    }
+    return shards;
+  }
+
+  // Generate one shard of the CPP file. This only includes the headers
+  // the enums in the shard were defined in, not the whole generated header.
+  inline void generateShard(const EnumMap& enums, std::ostream& stream) {
+    stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
+    stream << "#include <string>" << std::endl;
+    stream << "#include <iostream>" << std::endl;
+    std::set<std::string> includedFiles;
+    for (const auto& [name, ptr] : enums) {
+      if (includedFiles.insert(ptr->definedIn).second) {
+        stream << "#include <" << ptr->definedIn << ">" << std::endl;
+      }
+    }
+    generateFunctions(enums, stream);
+  }
+
+  // What the header reads from an enum. Changing the identifiers doesn't
+  // change any of the declarations, so it doesn't change this either.
+  inline std::string declarationHash(const EnumData& data) {
+    std::string signature(data.name);
+    for (const auto& ns : data.namespaces) {
+      signature.append("|");
+      signature.append(ns);
+    }
+    signature.append("|");
+    signature.append(data.definedIn);
+    signature.append("|");
+    signature.append(data.underlyingType);
+    signature.append(data.isClassEnum ? "|class" : "|plain");
+    return toHex(fnv1a(signature));
+  }
+
+  // The full index hashes for a set of enums plus whatever options
+  // change the output
+  inline HashMap enumInputs(const Index& index, const EnumMap& enums,
+                     const std::vector<std::string>& options) {
+    HashMap inputs;
+    for (const auto& [name, ptr] : enums) {
+      std::string key = enumKey(name);
+      inputs[key] = index.hashOf(key);
+    }
+    for (const auto& option : options) {
+      inputs[DependencyTracker::optionKey(option)] = "";
+    }
+    return inputs;
+  }
+
+  // What a companion reads, which is just the declarations of its
+  // header's enums
+  inline HashMap companionInputs(const EnumMap& enums) {
+    HashMap inputs;
+    for (const auto& [name, ptr] : enums) {
+      inputs[enumKey(name)] = declarationHash(*ptr);
+    }
+    inputs[DependencyTracker::optionKey("companion")] = "";
+    return inputs;
+  }
+
+}
@@ -0,0 +1,239 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Allocation counting. If you configure with
+ * -DFR_CODEGEN_ALLOC_HOOKS=ON, the programs and tests get
+ * src/AllocHooks.cpp, which replaces operator new and delete with
+ * versions that count allocations, bytes and live heap against
+ * whatever phase the allocating thread is in. Phases are the same
+ * ones --stats uses, and --stats reports the counts too.
+ *
+ * Without the hooks none of this counts anything, and tagging a phase
+ * is just a thread local assignment.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace fr::codegen::alloc {
+
+  /**
+   * What one phase allocated. live is what it allocated that
+   * hasn't been freed yet, and peakLive is the most heap the whole
+   * program had in use while something in this phase was allocating.
+   */
+  struct Counts {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;
+    int64_t live = 0;
+    uint64_t peakLive = 0;
+  };
+
+  namespace detail {
+
+    // The hooks can't allocate, so phases live in a fixed table
+    constexpr size_t maxPhases = 32;
+    constexpr size_t maxName = 32;
+
+    struct PhaseCounters {
+      char name[maxName];
+      std::atomic<uint64_t> allocations;
+      std::atomic<uint64_t> frees;
+      std::atomic<uint64_t> bytes;
+      std::atomic<int64_t> live;
+      std::atomic<uint64_t> peakLive;
+    };
+
+    struct State {
+      // Phase 0 is everything that isn't in a phase
+      std::array<PhaseCounters, maxPhases> phases;
+      std::atomic<size_t> phaseCount;
+      std::atomic<int64_t> live;
+      std::mutex mutex;
+    };
+
+    inline State& state() {
+      static State instance;
+      return instance;
+    }
+
+    inline size_t& currentPhase() {
+      static thread_local size_t phase = 0;
+      return phase;
+    }
+
+    inline void raise(std::atomic<uint64_t>& peak, uint64_t value) {
+      uint64_t seen = peak.load(std::memory_order_relaxed);
+      while (seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+      }
+    }
+
+  }
+
+  // Were we built with the hooks?
+  inline constexpr bool instrumented() {
+#ifdef FR_CODEGEN_ALLOC_HOOKS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Finds or adds the phase called name. If we run out of room, the
+   * rest of the phases all count as "other".
+   */
+  inline size_t phaseId(std::string_view name) {
+    auto& global = detail::state();
+    name = name.substr(0, detail::maxName - 1);
+    size_t count = global.phaseCount.load();
+    for (size_t i = 1; i < count; ++i) {
+      if (name == global.phases[i].name) {
+        return i;
+      }
+    }
+    std::lock_guard lock(global.mutex);
+    count = global.phaseCount.load();
+    for (size_t i = 1; i < count; ++i) {
+      if (name == global.phases[i].name) {
+        return i;
+      }
+    }
+    // Nothing's been added yet, so start after "other"
+    count = std::max<size_t>(count, 1);
+    if (count == detail::maxPhases) {
+      return 0;
+    }
+    std::memcpy(global.phases[count].name, name.data(), name.size());
+    global.phases[count].name[name.size()] = '\0';
+    global.phaseCount = count + 1;
+    return count;
+  }
+
+  // Makes this thread's allocations count against name until you
+  // leave, and returns what to pass to leave
+  inline size_t enter(std::string_view name) {
+    size_t previous = detail::currentPhase();
+    if (instrumented()) {
+      detail::currentPhase() = phaseId(name);
+    }
+    return previous;
+  }
+
+  inline void leave(size_t previous) {
+    detail::currentPhase() = previous;
+  }
+
+  // Tags the current scope with a phase
+  class Phase {
+    size_t _previous;
+    bool _active = true;
+
+  public:
+    Phase(std::string_view name) : _previous(enter(name)) {}
+
+    Phase(const Phase&) = delete;
+    Phase& operator=(const Phase&) = delete;
+
+    ~Phase() {
+      end();
+    }
+
+    void end() {
+      if (_active) {
+        leave(_previous);
+        _active = false;
+      }
+    }
+  };
+
+  /**
+   * The hooks call these. They don't allocate.
+   */
+  inline size_t current() {
+    return detail::currentPhase();
+  }
+
+  inline void allocated(size_t phase, size_t bytes) {
+    auto& global = detail::state();
+    auto& counters = global.phases[phase];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    counters.live.fetch_add(bytes, std::memory_order_relaxed);
+    int64_t live = global.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    detail::raise(counters.peakLive, live);
+  }
+
+  inline void freed(size_t phase, size_t bytes) {
+    auto& global = detail::state();
+    auto& counters = global.phases[phase];
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.live.fetch_sub(bytes, std::memory_order_relaxed);
+    global.live.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  // Everything counted so far, by phase
+  inline std::map<std::string, Counts> report() {
+    std::map<std::string, Counts> ret;
+    auto& global = detail::state();
+    size_t count = std::max<size_t>(global.phaseCount.load(), 1);
+    for (size_t i = 0; i < count; ++i) {
+      auto& counters = global.phases[i];
+      Counts counts;
+      counts.allocations = counters.allocations;
+      counts.frees = counters.frees;
+      counts.bytes = counters.bytes;
+      counts.live = counters.live;
+      counts.peakLive = counters.peakLive;
+      if (counts.allocations || counts.frees) {
+        ret[i == 0 ? "other" : counters.name] = counts;
+      }
+    }
+    return ret;
+  }
+
+  inline Counts report(std::string_view phase) {
+    auto all = report();
+    auto found = all.find(std::string(phase));
+    return found == all.end() ? Counts() : found->second;
+  }
+
+  /**
+   * Zeroes the counts, so a test can look at just what it did. Live
+   * bytes aren't touched, since that memory's still out there and
+   * will get freed against its phase eventually.
+   */
+  inline void reset() {
+    auto& global = detail::state();
+    for (auto& counters : global.phases) {
+      counters.allocations = 0;
+      counters.frees = 0;
+      counters.bytes = 0;
+      counters.peakLive = 0;
+    }
+  }
+
+}
@@ -0,0 +1,541 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * A local cache of generated files, along the lines of ccache. The
+ * generators look their outputs up by what went into them (input
+ * files, the index entities they read, their options and which
+ * version of the generator is running) and if somebody already
+ * generated the same thing, they link the cached copy into place
+ * instead of generating it again. That's mostly a win for clean
+ * builds in CI and fresh worktrees, where the sidecar files --deps
+ * uses don't exist yet.
+ *
+ * Set CODEGEN_CACHE_DIR (or pass --cache DIR) to turn it on, and
+ * CODEGEN_CACHE_SIZE to change how big it gets (1G by default,
+ * K, M and G suffixes work.) The least recently used entries get
+ * thrown out when it grows past that. Like ccache, it keeps a running
+ * total in a size file so storing something doesn't mean walking the
+ * whole cache to find out whether it's full.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#ifndef FR_CODEGEN_VERSION
+#define FR_CODEGEN_VERSION "unknown"
+#endif
+
+namespace fr::codegen {
+
+  /**
+   * Lookups take two steps, like ccache's direct mode. The generator
+   * hands us what it knows it reads before it starts (files and
+   * options) and that picks a manifest. The manifest lists the index
+   * entities outputs generated from those inputs went on to read,
+   * since the line by line generators only find out which classes
+   * they need as they go. We hash those entities as they are in the
+   * index we're running with, and if that matches an entry we have,
+   * it's a hit.
+   *
+   * Outputs get materialized with a reflink if the filesystem can do
+   * that, a hard link if it can't, and a copy if the cache is on
+   * another filesystem. Since a hard linked output is the cache
+   * entry, a miss unlinks any outputs that are shared before the
+   * generator writes over them. Don't edit generated files in place
+   * if you're using the cache with hard links (you weren't going to
+   * anyway, right?)
+   */
+
+  class OutputCache {
+    std::filesystem::path _directory;
+    uint64_t _maxBytes;
+
+    // Keeps variants from piling up in a manifest for an input file
+    // whose classes keep changing
+    static constexpr size_t maxVariants = 16;
+
+    // Two FNV-1a passes with different offsets, so 128 bits of key.
+    // One pass is plenty to notice a change, but here a collision
+    // would hand you somebody else's output.
+    static std::string keyOf(const std::string& data) {
+      return toHex(fnv1a(data)) + toHex(fnv1a(data, 0x6c62272e07bb0142ull));
+    }
+
+    // The generator itself is an input too. The version covers
+    // releases, and the executable's size and time stamp cover you
+    // hacking on it.
+    static std::string executableStamp() {
+      std::error_code error;
+      auto exe = std::filesystem::read_symlink("/proc/self/exe", error);
+      if (error) {
+        return "";
+      }
+      auto size = std::filesystem::file_size(exe, error);
+      auto time = std::filesystem::last_write_time(exe, error);
+      return std::to_string(size) + "@" + std::to_string(time.time_since_epoch().count());
+    }
+
+    std::string primaryKey(const std::string& tool, const HashMap& known, size_t outputs) const {
+      std::string data = std::string(FR_CODEGEN_VERSION) + "\n" + executableStamp() + "\n" + tool + "\n" +
+        std::to_string(outputs) + "\n";
+      for (const auto& [key, hash] : known) {
+        // Where an input file lives doesn't change what we generate from
+        // it, so leave its name out and worktrees can share entries
+        if (key.starts_with("file:")) {
+          data.append("file");
+        } else {
+          data.append(key);
+        }
+        data.append("=");
+        data.append(hash);
+        data.append("\n");
+      }
+      return keyOf(data);
+    }
+
+    static std::string entryKey(const std::string& primary, const std::vector<std::string>& variant,
+                                const HashMap& hashes) {
+      std::string data = primary;
+      for (const auto& key : variant) {
+        auto it = hashes.find(key);
+        data.append("\n");
+        data.append(key);
+        data.append("=");
+        data.append(it == hashes.end() ? std::string() : it->second);
+      }
+      return keyOf(data);
+    }
+
+    template <typename Indexes>
+    static std::string currentHash(const std::string& key, const Indexes& index) {
+      if (key.starts_with("file:")) {
+        return fileHash(key.substr(5));
+      }
+      return index.hashOf(key);
+    }
+
+    std::filesystem::path manifestFile(const std::string& primary) const {
+      return _directory / "manifests" / (primary + ".json");
+    }
+
+    std::filesystem::path entryDirectory(const std::string& key) const {
+      return _directory / "entries" / key;
+    }
+
+    std::vector<std::vector<std::string>> loadManifest(const std::string& primary) const {
+      std::vector<std::vector<std::string>> variants;
+      std::ifstream stream(manifestFile(primary));
+      if (!stream) {
+        return variants;
+      }
+      try {
+        cereal::JSONInputArchive archive(stream);
+        archive(variants);
+      } catch (cereal::Exception&) {
+        variants.clear();
+      }
+      return variants;
+    }
+
+    // Somewhere to put things together before renaming them into the
+    // cache, so nobody ever sees half an entry
+    std::filesystem::path temporary(const std::string& name) const {
+      static thread_local std::mt19937_64 random(std::random_device{}());
+      auto directory = _directory / "tmp";
+      std::filesystem::create_directories(directory);
+      return directory / (name + "." + std::to_string(getpid()) + "." + toHex(random()));
+    }
+
+    /**
+     * The running total of what's in entries. It's locked as long as
+     * it's open so concurrent stores don't lose each other's updates.
+     * If the cache directory isn't there yet, there's nothing to lock
+     * and reads come back empty.
+     */
+    class SizeFile {
+      int _fd;
+
+    public:
+      explicit SizeFile(const std::filesystem::path& path)
+        : _fd(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+        if (_fd >= 0) {
+          flock(_fd, LOCK_EX);
+        }
+      }
+
+      ~SizeFile() {
+        if (_fd >= 0) {
+          close(_fd);
+        }
+      }
+
+      SizeFile(const SizeFile&) = delete;
+      SizeFile& operator=(const SizeFile&) = delete;
+
+      // Nothing if there's no total yet, which is a new cache or one
+      // from before we kept one
+      std::optional<uint64_t> read() const {
+        char buffer[32] = {};
+        if (_fd < 0 || pread(_fd, buffer, sizeof(buffer) - 1, 0) <= 0) {
+          return std::nullopt;
+        }
+        char* end = nullptr;
+        uint64_t total = std::strtoull(buffer, &end, 10);
+        if (end == buffer) {
+          return std::nullopt;
+        }
+        return total;
+      }
+
+      void write(uint64_t total) {
+        std::string text = std::to_string(total) + "\n";
+        if (_fd >= 0 && pwrite(_fd, text.data(), text.size(), 0) == static_cast<ssize_t>(text.size())) {
+          [[maybe_unused]] int truncated = ftruncate(_fd, text.size());
+        }
+      }
+    };
+
+    std::filesystem::path sizeFile() const {
+      return _directory / "size";
+    }
+
+    // Walks the entries and adds them up. That only happens when
+    // there's no running total or we're trimming.
+    uint64_t countSize() const {
+      uint64_t total = 0;
+      std::error_code error;
+      for (const auto& file : std::filesystem::recursive_directory_iterator(_directory / "entries", error)) {
+        if (file.is_regular_file(error)) {
+          total += file.file_size(error);
+        }
+      }
+      return total;
+    }
+
+    static void touch(const std::filesystem::path& path) {
+      std::error_code error;
+      std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    // Tries a reflink, then a hard link, then a copy
+    static void materialize(const std::filesystem::path& from, const std::filesystem::path& to) {
+      auto staging = to;
+      staging += ".cache";
+      std::filesystem::remove(staging);
+      bool done = false;
+#ifdef FICLONE
+      int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+      if (in >= 0) {
+        int out = open(staging.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out >= 0) {
+          done = ioctl(out, FICLONE, in) == 0;
+          close(out);
+        }
+        close(in);
+      }
+      if (!done) {
+        std::filesystem::remove(staging);
+      }
+#endif
+      if (!done) {
+        std::error_code error;
+        std::filesystem::create_hard_link(from, staging, error);
+        done = !error;
+      }
+      if (!done) {
+        std::filesystem::copy_file(from, staging);
+      }
+      // Renaming over the old output means we never write into a file
+      // that might be linked to something else
+      std::filesystem::rename(staging, to);
+      // Otherwise make thinks the output is older than what it was
+      // generated from
+      touch(to);
+    }
+
+  public:
+    static constexpr uint64_t defaultSize = 1024ull * 1024 * 1024;
+
+    // An empty directory turns the cache off
+    OutputCache(const std::string& directory, uint64_t maxBytes = defaultSize)
+      : _directory(directory), _maxBytes(maxBytes) {}
+
+    /**
+     * Uses directory if you passed --cache, otherwise
+     * CODEGEN_CACHE_DIR if it's set. The size comes from
+     * CODEGEN_CACHE_SIZE. The tools pass their context's getenv, so
+     * runs codegend does for a build get the build's settings.
+     */
+    template <typename Getenv>
+    static OutputCache fromEnvironment(const std::string& directory, const Getenv& getenv) {
+      std::string where = directory;
+      if (where.empty()) {
+        const char* env = getenv("CODEGEN_CACHE_DIR");
+        where = env ? env : "";
+      }
+      const char* size = getenv("CODEGEN_CACHE_SIZE");
+      return OutputCache(where, size ? parseSize(size) : defaultSize);
+    }
+
+    // "500M" -> 524288000. Anything we can't make sense of gets the default.
+    static uint64_t parseSize(const std::string& text) {
+      char* end = nullptr;
+      double value = std::strtod(text.c_str(), &end);
+      if (end == text.c_str() || value <= 0) {
+        return defaultSize;
+      }
+      switch (*end) {
+      case 'k': case 'K': value *= 1024; break;
+      case 'm': case 'M': value *= 1024.0 * 1024; break;
+      case 'g': case 'G': value *= 1024.0 * 1024 * 1024; break;
+      default: break;
+      }
+      return static_cast<uint64_t>(value);
+    }
+
+    bool enabled() const {
+      return !_directory.empty();
+    }
+
+    /**
+     * Takes a file we're about to write over out of the cache, if it's
+     * a hard link into it. fetch does this for you on a miss, but call
+     * it yourself if you write a file that doesn't go through the
+     * cache and might have before.
+     */
+    static void detach(const std::string& output) {
+      std::error_code error;
+      if (std::filesystem::hard_link_count(output, error) > 1 && !error) {
+        std::filesystem::remove(output, error);
+      }
+    }
+
+    const std::filesystem::path& directory() const {
+      return _directory;
+    }
+
+    /**
+     * Looks up outputs generated by tool from known (the inputs the
+     * tool knows about up front, in the same form DependencyTracker
+     * uses) and materializes them if we have them. On a hit you get
+     * back everything the cached outputs were generated from, which
+     * you can hand to DependencyTracker::consumed. On a miss you get
+     * nothing and it's up to you to generate the outputs and store
+     * them.
+     */
+    template <typename Indexes>
+    std::optional<HashMap> fetch(const std::string& tool, const HashMap& known, const Indexes& index,
+                                 const std::vector<std::string>& outputs) const {
+      if (!enabled()) {
+        return std::nullopt;
+      }
+      std::string primary = primaryKey(tool, known, outputs.size());
+      for (const auto& variant : loadManifest(primary)) {
+        HashMap current;
+        for (const auto& key : variant) {
+          current[key] = currentHash(key, index);
+        }
+        auto entry = entryDirectory(entryKey(primary, variant, current));
+        if (!std::filesystem::exists(entry / "inputs.json")) {
+          continue;
+        }
+        try {
+          for (size_t i = 0; i < outputs.size(); ++i) {
+            materialize(entry / std::to_string(i), outputs[i]);
+          }
+          touch(entry);
+          HashMap inputs = known;
+          inputs.insert(current.begin(), current.end());
+          return inputs;
+        } catch (std::filesystem::filesystem_error&) {
+          // Somebody trimmed it out from under us. We'll just generate
+          // everything again.
+          break;
+        }
+      }
+      for (const auto& output : outputs) {
+        detach(output);
+      }
+      return std::nullopt;
+    }
+
+    /**
+     * Stores outputs you just generated. consumed is everything they
+     * read, including what's in known. Anything in consumed that isn't
+     * in known gets its hash checked against the index on the way back
+     * out, so put options in known. Failing to store something isn't
+     * an error, it just won't be in the cache.
+     */
+    void store(const std::string& tool, const HashMap& known, const HashMap& consumed,
+               const std::vector<std::string>& outputs) {
+      if (!enabled()) {
+        return;
+      }
+      uint64_t added = 0;
+      try {
+        std::string primary = primaryKey(tool, known, outputs.size());
+        std::vector<std::string> variant;
+        for (const auto& [key, hash] : consumed) {
+          if (!known.contains(key)) {
+            variant.push_back(key);
+          }
+        }
+        std::string key = entryKey(primary, variant, consumed);
+        auto entry = entryDirectory(key);
+        if (!std::filesystem::exists(entry)) {
+          auto staging = temporary(key);
+          std::filesystem::create_directories(staging);
+          for (size_t i = 0; i < outputs.size(); ++i) {
+            std::filesystem::copy_file(outputs[i], staging / std::to_string(i));
+            added += std::filesystem::file_size(staging / std::to_string(i));
+          }
+          {
+            std::ofstream stream(staging / "inputs.json");
+            cereal::JSONOutputArchive archive(stream);
+            archive(cereal::make_nvp("inputs", consumed));
+          }
+          added += std::filesystem::file_size(staging / "inputs.json");
+          std::filesystem::create_directories(entry.parent_path());
+          std::error_code error;
+          std::filesystem::rename(staging, entry, error);
+          if (error) {
+            // Somebody else stored the same thing first
+            std::filesystem::remove_all(staging, error);
+            added = 0;
+          }
+        }
+
+        // Most recent variant first, since it's the likeliest to match
+        auto variants = loadManifest(primary);
+        variants.erase(std::remove(variants.begin(), variants.end(), variant), variants.end());
+        variants.insert(variants.begin(), variant);
+        if (variants.size() > maxVariants) {
+          variants.resize(maxVariants);
+        }
+        auto manifest = manifestFile(primary);
+        std::filesystem::create_directories(manifest.parent_path());
+        auto staging = temporary(primary);
+        {
+          std::ofstream stream(staging);
+          cereal::JSONOutputArchive archive(stream);
+          archive(cereal::make_nvp("variants", variants));
+        }
+        std::filesystem::rename(staging, manifest);
+      } catch (std::filesystem::filesystem_error&) {
+        return;
+      }
+      if (added == 0) {
+        return;
+      }
+      uint64_t total = 0;
+      {
+        SizeFile sizes(sizeFile());
+        // Without a total, counting finds the entry we just added too
+        auto recorded = sizes.read();
+        total = recorded ? *recorded + added : countSize();
+        sizes.write(total);
+      }
+      if (total > _maxBytes) {
+        trim();
+      }
+    }
+
+    // How much the entries take up, in bytes
+    uint64_t size() const {
+      if (!enabled()) {
+        return 0;
+      }
+      SizeFile sizes(sizeFile());
+      if (auto recorded = sizes.read()) {
+        return *recorded;
+      }
+      uint64_t total = countSize();
+      sizes.write(total);
+      return total;
+    }
+
+    /**
+     * Throws out the least recently used entries until the cache fits
+     * in its size. Manifests are tiny and are left alone. One that
+     * points at entries that aren't there any more is just a miss.
+     * store only calls this once the running total says the cache is
+     * full, and this counts everything again to set the total right.
+     */
+    void trim() {
+      if (!enabled()) {
+        return;
+      }
+      // Stores wait for the trim rather than adding to a total that's
+      // about to be replaced
+      SizeFile sizes(sizeFile());
+      struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type used;
+        uint64_t bytes = 0;
+      };
+      std::vector<Entry> entries;
+      uint64_t total = 0;
+      std::error_code error;
+      for (const auto& directory : std::filesystem::directory_iterator(_directory / "entries", error)) {
+        Entry entry{directory.path(), directory.last_write_time(error)};
+        for (const auto& file : std::filesystem::directory_iterator(directory.path(), error)) {
+          if (file.is_regular_file(error)) {
+            entry.bytes += file.file_size(error);
+          }
+        }
+        total += entry.bytes;
+        entries.push_back(entry);
+      }
+      if (total <= _maxBytes) {
+        sizes.write(total);
+        return;
+      }
+      std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used < b.used;
+      });
+      for (const auto& entry : entries) {
+        if (total <= _maxBytes) {
+          break;
+        }
+        std::filesystem::remove_all(entry.path, error);
+        total -= entry.bytes;
+      }
+      sizes.write(total);
+    }
+  };
+
+}
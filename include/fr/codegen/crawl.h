@@ -0,0 +1,123 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Finding headers to index without having to list them all, and
+ * telling which ones aren't worth parsing. IndexCode --root DIR
+ * --glob '*.h' uses these.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fnmatch.h>
+#include <functional>
+#include <fr/codegen/workpool.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fr::codegen {
+
+  /**
+   * Does pattern match file? Patterns with a / in them are matched
+   * against the path relative to the root (so "include/fr_*.h"
+   * only finds headers directly under include), the rest just against the
+   * file name.
+   */
+  inline bool globMatches(const std::string& pattern, const std::filesystem::path& relative) {
+    if (pattern.find('/') != std::string::npos) {
+      return fnmatch(pattern.c_str(), relative.generic_string().c_str(), FNM_PATHNAME) == 0;
+    }
+    return fnmatch(pattern.c_str(), relative.filename().c_str(), 0) == 0;
+  }
+
+  /**
+   * Finds the files under root that match any of globs, walking the
+   * directories in parallel. Hidden directories (.git and friends)
+   * are skipped and symlinked directories aren't followed, so we
+   * can't go around in circles. Paths come back as root/relative,
+   * sorted, so the index comes out the same every time.
+   */
+  inline std::vector<std::string> findHeaders(const std::string& root, const std::vector<std::string>& globs,
+                                              size_t threads = 0) {
+    std::vector<std::string> found;
+    std::mutex mutex;
+    std::filesystem::path rootPath(root);
+    WorkStealingPool pool(threads);
+
+    std::function<void(std::filesystem::path)> crawl = [&](std::filesystem::path directory) {
+      std::vector<std::string> matches;
+      std::error_code error;
+      auto options = std::filesystem::directory_options::skip_permission_denied;
+      for (std::filesystem::directory_iterator it(directory, options, error), end; !error && it != end;
+           it.increment(error)) {
+        const auto& entry = *it;
+        std::error_code statusError;
+        if (entry.is_directory(statusError) && !entry.is_symlink(statusError)) {
+          if (!entry.path().filename().string().starts_with(".")) {
+            pool.submit([&crawl, path = entry.path()]() { crawl(path); });
+          }
+          continue;
+        }
+        if (!entry.is_regular_file(statusError)) {
+          continue;
+        }
+        auto relative = entry.path().lexically_relative(rootPath);
+        for (const auto& pattern : globs) {
+          if (globMatches(pattern, relative)) {
+            matches.push_back(entry.path().string());
+            break;
+          }
+        }
+      }
+      if (!matches.empty()) {
+        std::lock_guard lock(mutex);
+        found.insert(found.end(), matches.begin(), matches.end());
+      }
+    };
+
+    pool.submit([&crawl, rootPath]() { crawl(rootPath); });
+    pool.wait();
+    std::sort(found.begin(), found.end());
+    return found;
+  }
+
+  /**
+   * Could this header have anything for the index in it? Everything
+   * we index starts with enum, class or struct, so a header without
+   * any of those words can skip the parser. Annotations only count
+   * inside a class, so they don't need looking for separately. This
+   * is just a byte search, so a comment mentioning a class gets the
+   * header parsed anyway, which is fine.
+   */
+  inline bool mightDeclare(std::string_view contents) {
+    for (std::string_view word : {"class", "struct", "enum"}) {
+#ifdef __GLIBC__
+      if (memmem(contents.data(), contents.size(), word.data(), word.size())) {
+        return true;
+      }
+#else
+      if (contents.find(word) != std::string_view::npos) {
+        return true;
+      }
+#endif
+    }
+    return false;
+  }
+
+}
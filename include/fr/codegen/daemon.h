@@ -0,0 +1,328 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Talking to codegend. A build runs the generators dozens of times
+ * and every one of them used to start up and read the whole index
+ * in. If codegend is running, the programs just hand it their command
+ * line over a Unix socket and print whatever it sends back. If it
+ * isn't, they do the work themselves like they always did.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sched.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fr::codegen::daemon {
+
+  // Bump this if the messages change, so an old daemon and a new
+  // client don't try to talk to each other.
+  constexpr const char* protocolVersion = "codegend-2";
+
+  // The environment variables the tools read. Programs send theirs
+  // along, so a run the daemon does for a build gets the build's
+  // settings instead of whatever the daemon was started with.
+  inline const std::vector<std::string>& forwardedVariables() {
+    static const std::vector<std::string> names{"CODEGEN_CACHE_DIR", "CODEGEN_CACHE_SIZE"};
+    return names;
+  }
+
+  /**
+   * CODEGEND_SOCKET if you set it, otherwise a socket in
+   * XDG_RUNTIME_DIR, or /tmp if you don't have one of those.
+   */
+  inline std::string socketPath() {
+    if (const char* path = std::getenv("CODEGEND_SOCKET")) {
+      return path;
+    }
+    std::string dir("/tmp");
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR")) {
+      dir = runtime;
+    }
+    return dir + "/codegend-" + std::to_string(getuid()) + ".sock";
+  }
+
+  // How long the daemon waits on a client that connected and then
+  // didn't say anything
+  constexpr int requestTimeoutSeconds = 5;
+
+  // Set CODEGEND_DISABLE to anything to make the programs always run
+  // in-process
+  inline bool disabled() {
+    return std::getenv("CODEGEND_DISABLE") != nullptr;
+  }
+
+  /**
+   * Messages are a count of strings followed by each string, all
+   * prefixed with 32 bit lengths. These return false if the other end
+   * went away.
+   */
+  inline bool writeAll(int fd, const void* data, size_t size) {
+    const char* buffer = static_cast<const char*>(data);
+    while (size > 0) {
+      ssize_t written = ::write(fd, buffer, size);
+      if (written <= 0) {
+        return false;
+      }
+      buffer += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  inline bool readAll(int fd, void* data, size_t size) {
+    char* buffer = static_cast<char*>(data);
+    while (size > 0) {
+      ssize_t got = ::read(fd, buffer, size);
+      if (got <= 0) {
+        return false;
+      }
+      buffer += got;
+      size -= got;
+    }
+    return true;
+  }
+
+  inline bool writeMessage(int fd, const std::vector<std::string>& message) {
+    uint32_t count = message.size();
+    if (!writeAll(fd, &count, sizeof(count))) {
+      return false;
+    }
+    for (const auto& part : message) {
+      uint32_t size = part.size();
+      if (!writeAll(fd, &size, sizeof(size)) || !writeAll(fd, part.data(), size)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  inline bool readMessage(int fd, std::vector<std::string>& message) {
+    // Nobody's sending us a million strings, so if we see that the
+    // other end is something that isn't us
+    constexpr uint32_t maxCount = 1 << 20;
+    uint32_t count;
+    if (!readAll(fd, &count, sizeof(count)) || count > maxCount) {
+      return false;
+    }
+    message.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t size;
+      if (!readAll(fd, &size, sizeof(size))) {
+        return false;
+      }
+      std::string part(size, '\0');
+      if (!readAll(fd, part.data(), size)) {
+        return false;
+      }
+      message.push_back(std::move(part));
+    }
+    return true;
+  }
+
+  /**
+   * A program asking the daemon to run a tool for it. On the wire
+   * it's { protocolVersion, "run", tool, directory, variable count,
+   * NAME=value..., argv... }
+   */
+  struct RunRequest {
+    std::string tool;
+    // Where the program was run
+    std::string directory;
+    // The forwardedVariables that were set
+    std::map<std::string, std::string> environment;
+    std::vector<std::string> args;
+
+    // One for the program we're in
+    static RunRequest ours(const std::string& tool, int argc, char* argv[]) {
+      RunRequest request;
+      request.tool = tool;
+      request.directory = std::filesystem::current_path().string();
+      for (const auto& name : forwardedVariables()) {
+        if (const char* value = std::getenv(name.c_str())) {
+          request.environment[name] = value;
+        }
+      }
+      for (int i = 0; i < argc; ++i) {
+        request.args.push_back(argv[i]);
+      }
+      return request;
+    }
+
+    std::vector<std::string> message() const {
+      std::vector<std::string> ret{protocolVersion, "run", tool, directory, std::to_string(environment.size())};
+      for (const auto& [name, value] : environment) {
+        ret.push_back(name + "=" + value);
+      }
+      ret.insert(ret.end(), args.begin(), args.end());
+      return ret;
+    }
+
+    // Empty if message isn't a run request
+    static std::optional<RunRequest> parse(const std::vector<std::string>& message) {
+      if (message.size() < 5 || message[0] != protocolVersion || message[1] != "run") {
+        return std::nullopt;
+      }
+      RunRequest request;
+      request.tool = message[2];
+      request.directory = message[3];
+      size_t variables = 0;
+      try {
+        variables = std::stoul(message[4]);
+      } catch (std::exception&) {
+        return std::nullopt;
+      }
+      // Needs room for the variables and at least argv[0]
+      if (variables >= message.size() - 5) {
+        return std::nullopt;
+      }
+      auto part = message.begin() + 5;
+      for (size_t i = 0; i < variables; ++i, ++part) {
+        auto equals = part->find('=');
+        if (equals == std::string::npos) {
+          return std::nullopt;
+        }
+        request.environment[part->substr(0, equals)] = part->substr(equals + 1);
+      }
+      request.args.assign(part, message.end());
+      return request;
+    }
+
+    // Looks a variable up in environment the way getenv would
+    const char* getenv(const char* name) const {
+      auto found = environment.find(name);
+      return found == environment.end() ? nullptr : found->second.c_str();
+    }
+  };
+
+  /**
+   * The socket can end up in /tmp, where anybody could have put one
+   * under our name first, so both ends only talk to processes
+   * running as the same user they are.
+   */
+  inline bool peerIsUs(int fd) {
+    ucred credentials{};
+    socklen_t size = sizeof(credentials);
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 &&
+      credentials.uid == geteuid();
+  }
+
+  // Reads and writes on fd give up after seconds
+  inline void setTimeout(int fd, int seconds) {
+    timeval timeout{seconds, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  }
+
+  /**
+   * Gives the calling thread its own current directory and moves it
+   * to directory. The daemon runs each request on its own thread in
+   * the directory the client was in, so requests from different
+   * directories can run at the same time without moving each other's
+   * relative paths around. Threads started from this one get the same
+   * directory. Returns false if it couldn't.
+   */
+  inline bool enterDirectory(const std::string& directory) {
+    return ::unshare(CLONE_FS) == 0 && ::chdir(directory.c_str()) == 0;
+  }
+
+  /**
+   * Connects to the daemon, returns -1 if it isn't there or it isn't
+   * ours.
+   */
+  inline int connectTo(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+      return -1;
+    }
+    struct stat status;
+    if (::stat(path.c_str(), &status) != 0 || !S_ISSOCK(status.st_mode) || status.st_uid != geteuid()) {
+      return -1;
+    }
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    // The file could have been swapped out since we looked at it, so
+    // check who actually answered
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || !peerIsUs(fd)) {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  /**
+   * Try to get the daemon to run tool with our command line. Returns
+   * true and sets exitCode if it did, in which case you're done.
+   * Returns false if there's no daemon (or it's already running as
+   * many requests as it will, or couldn't help us) and you should just
+   * run the tool yourself.
+   *
+   * Requests are a RunRequest, and replies look like
+   * { exit code, output }, or { "busy" }.
+   */
+  inline bool forward(const std::string& tool, int argc, char* argv[], int& exitCode) {
+    if (disabled()) {
+      return false;
+    }
+    int fd = connectTo(socketPath());
+    if (fd < 0) {
+      return false;
+    }
+    std::vector<std::string> reply;
+    bool ok = writeMessage(fd, RunRequest::ours(tool, argc, argv).message()) &&
+      readMessage(fd, reply) && reply.size() == 2;
+    ::close(fd);
+    if (!ok) {
+      return false;
+    }
+    try {
+      exitCode = std::stoi(reply[0]);
+    } catch (std::exception&) {
+      return false;
+    }
+    std::cout << reply[1] << std::flush;
+    return true;
+  }
+
+  // Ask the daemon to exit. Returns false if there wasn't one.
+  inline bool shutdown(const std::string& path) {
+    int fd = connectTo(path);
+    if (fd < 0) {
+      return false;
+    }
+    std::vector<std::string> reply;
+    bool ok = writeMessage(fd, {protocolVersion, "shutdown"}) && readMessage(fd, reply);
+    ::close(fd);
+    return ok;
+  }
+
+}
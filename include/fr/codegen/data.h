@@ -23,8 +23,10 @@
 #include <cereal/types/memory.hpp>
 #include <cereal/types/vector.hpp>
 #include <cereal/types/map.hpp>
+#include <cstring>
 #include <map>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <fr/codegen/parser.h>
 
@@ -56,9 +58,12 @@ namespace fr::codegen {
     std::string definedIn;
     // identifiers in the enum
     std::vector<std::string> identifiers;    
+    // Fixed underlying type, as written in the declaration. Empty
+    // if the enum didn't declare one.
+    std::string underlyingType;
 
     // Returns the C++ formatted namespace for this enum
-    std::string enumNamespace() {
+    std::string enumNamespace() const {
       std::string ret;
       for (auto n = namespaces.begin(); n != namespaces.end(); ++n) {
 	if (ret.size()) {
@@ -73,6 +78,7 @@ namespace fr::codegen {
       namespaces.clear();
       identifiers.clear();
       name.clear();
+      underlyingType.clear();
       isClassEnum = false;
     }
 
@@ -85,6 +91,7 @@ namespace fr::codegen {
       ar(cereal::make_nvp("isClassEnum", isClassEnum));
       ar(cereal::make_nvp("definedIn", definedIn));
       ar(cereal::make_nvp("identifiers", identifiers));
+      ar(cereal::make_nvp("underlyingType", underlyingType));
     }
 
     template <typename Archive>
@@ -94,6 +101,18 @@ namespace fr::codegen {
       ar(isClassEnum);
       ar(definedIn);
       ar(identifiers);
+      // Indexes written before underlyingType was a thing don't have
+      // one, and there's no telling until we look at the next name.
+      // The binary archives are only ever ones we just wrote, so they
+      // always have it.
+      if constexpr (std::is_same_v<Archive, cereal::JSONInputArchive>) {
+        const char* next = ar.getNodeName();
+        if (next == nullptr || std::strcmp(next, "underlyingType") != 0) {
+          underlyingType.clear();
+          return;
+        }
+      }
+      ar(underlyingType);
     }
     
   };
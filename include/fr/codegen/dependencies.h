@@ -0,0 +1,195 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Tracks which index entities (and files) went into each file a
+ * generator writes, so the next run can tell if it needs to
+ * write that file again.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fr::codegen {
+
+  /**
+   * The generators record everything they read to produce an output
+   * file: index entities by their key in Index::hashes, input files
+   * with fileKey(), and the options that change what they write with
+   * optionKey() (put the value in there too, "shards=4"). That gets
+   * written to a sidecar file. On the next run an output whose inputs
+   * all hash the same as last time doesn't need to be generated again.
+   *
+   * If you change the header a class is defined in, the index gets
+   * rebuilt, but only the outputs that actually read that class
+   * will notice.
+   */
+
+  class DependencyTracker {
+    std::string _filename;
+    // Output file -> what it read last time
+    std::map<std::string, HashMap> _previous;
+    // Output file -> what it read this time
+    std::map<std::string, HashMap> _current;
+
+  public:
+    // An empty filename turns tracking off, so nothing is ever up to date
+    DependencyTracker(const std::string& filename) : _filename(filename) {
+      if (_filename.empty() || !std::filesystem::exists(_filename)) {
+        return;
+      }
+      std::ifstream stream(_filename);
+      try {
+        cereal::JSONInputArchive archive(stream);
+        archive(_previous);
+      } catch (cereal::Exception&) {
+        // A broken sidecar just means we regenerate everything
+        _previous.clear();
+      }
+    }
+
+    ~DependencyTracker() = default;
+
+    static std::string fileKey(const std::string& filename) {
+      return std::string("file:") + filename;
+    }
+
+    static std::string optionKey(const std::string& option) {
+      return std::string("option:") + option;
+    }
+
+    bool enabled() const {
+      return !_filename.empty();
+    }
+
+    // Record that output was generated from entity
+    void consumed(const std::string& output, const std::string& entity, const std::string& hash) {
+      _current[output][entity] = hash;
+    }
+
+    // index is an Index or an IndexSet
+    template <typename Indexes>
+    void consumed(const std::string& output, const Indexes& index, const std::string& entity) {
+      consumed(output, entity, index.hashOf(entity));
+    }
+
+    void consumedFile(const std::string& output, const std::string& filename) {
+      consumed(output, fileKey(filename), fileHash(filename));
+    }
+
+    void consumedOption(const std::string& output, const std::string& option) {
+      consumed(output, optionKey(option), "");
+    }
+
+    // Record everything at once, if the generator knows up front
+    void consumed(const std::string& output, const HashMap& inputs) {
+      _current[output] = inputs;
+    }
+
+    // What output has read so far this run
+    HashMap inputsOf(const std::string& output) const {
+      auto it = _current.find(output);
+      return it == _current.end() ? HashMap() : it->second;
+    }
+
+    /**
+     * Use this one when the generator can work out what an output
+     * will read before generating it. The output is up to date if it
+     * exists and read exactly the same stuff last time.
+     */
+    bool upToDate(const std::string& output, const HashMap& inputs) const {
+      if (!enabled() || !std::filesystem::exists(output)) {
+        return false;
+      }
+      auto it = _previous.find(output);
+      return it != _previous.end() && it->second == inputs;
+    }
+
+    /**
+     * Use this one when the generator only finds out what it reads
+     * as it goes (the Lbl filters). The output is up to date if it
+     * exists, was generated with the same options and everything it
+     * read last time still hashes the same. Files are rehashed,
+     * everything else is looked up in the index (or indexes, if you
+     * hand it an IndexSet).
+     */
+    template <typename Indexes>
+    bool upToDate(const std::string& output, const Indexes& index,
+                  const std::vector<std::string>& options = {}) const {
+      if (!enabled() || !std::filesystem::exists(output)) {
+        return false;
+      }
+      auto it = _previous.find(output);
+      if (it == _previous.end()) {
+        return false;
+      }
+      size_t optionCount = 0;
+      for (const auto& [entity, hash] : it->second) {
+        if (entity.starts_with("option:")) {
+          optionCount++;
+          if (std::find(options.begin(), options.end(), entity.substr(7)) == options.end()) {
+            return false;
+          }
+          continue;
+        }
+        std::string current;
+        if (entity.starts_with("file:")) {
+          current = fileHash(entity.substr(5));
+        } else {
+          current = index.hashOf(entity);
+        }
+        if (current.empty() || current != hash) {
+          return false;
+        }
+      }
+      return optionCount == options.size();
+    }
+
+    /**
+     * Bump the timestamp on an output you didn't regenerate because
+     * it was up to date. Its contents are already right, but make
+     * only looks at timestamps, and an output older than the index it
+     * depends on gets its rule run again on every build.
+     */
+    static void touch(const std::string& output) {
+      std::error_code error;
+      std::filesystem::last_write_time(output, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    // Carry an up to date output's record forward to the next run
+    void keep(const std::string& output) {
+      auto it = _previous.find(output);
+      if (it != _previous.end()) {
+        _current[output] = it->second;
+      }
+    }
+
+    void save() {
+      if (!enabled()) {
+        return;
+      }
+      std::ofstream stream(_filename);
+      cereal::JSONOutputArchive archive(stream);
+      archive(cereal::make_nvp("outputs", _current));
+    }
+  };
+
+}
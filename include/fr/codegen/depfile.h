@@ -0,0 +1,79 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Writes Makefile style depfiles, the same kind the compiler writes
+ * with -MD, so the CMake rules can hand them to add_custom_command
+ * as a DEPFILE and the build knows what each generator read.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fr::codegen {
+
+  // Escapes the characters Make and Ninja care about in a path
+  inline std::string depfileEscape(const std::string& path) {
+    std::string ret;
+    for (char c : path) {
+      switch(c) {
+      case ' ':
+      case '#':
+      case '\\':
+        ret.push_back('\\');
+        ret.push_back(c);
+        break;
+      case '$':
+        ret.append("$$");
+        break;
+      default:
+        ret.push_back(c);
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Writes "outputs: inputs" to filename. Paths are made absolute so
+   * it doesn't matter what directory the build runs us in. An empty
+   * filename doesn't write anything, so the programs can just call
+   * this whether or not they were asked for a depfile.
+   */
+  inline void writeDepfile(const std::string& filename,
+                           const std::vector<std::string>& outputs,
+                           const std::vector<std::string>& inputs) {
+    if (filename.empty()) {
+      return;
+    }
+    std::ofstream stream(filename);
+    bool first = true;
+    for (const auto& output : outputs) {
+      if (!first) {
+        stream << " ";
+      }
+      first = false;
+      stream << depfileEscape(std::filesystem::absolute(output).string());
+    }
+    stream << ":";
+    for (const auto& input : inputs) {
+      stream << " \\" << std::endl << "  " << depfileEscape(std::filesystem::absolute(input).string());
+    }
+    stream << std::endl;
+  }
+
+}
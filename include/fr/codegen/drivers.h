@@ -103,6 +103,10 @@ namespace fr::codegen {
     void handleEnumIdentifier(const std::string& enumName, const std::string& identifier) {
       currentEnum.identifiers.push_back(identifier);
     }
+
+    void handleUnderlyingType(const std::string& type) {
+      currentEnum.underlyingType = type;
+    }
     
   public:
     boost::signals2::signal<void(const std::string&, const EnumData&)> enumAvailable;
@@ -136,6 +140,9 @@ namespace fr::codegen {
 								 const std::string &identifier) {
 	handleEnumIdentifier(enumName, identifier);
       });
+      auto underlyingTypeSub = parser.enumUnderlyingTypeFound.connect([&](const std::string &type) {
+        handleUnderlyingType(type);
+      });
       // We need to check if we're in an enum whenever we see a scope pop and
       // finalize our enum if we were working on one. There's nothing magic about scope
       // pops after enums, it's just a standard decScope, so we need to check whenever we receive one.
@@ -159,6 +166,7 @@ namespace fr::codegen {
       subscriptions.push_back(enumSub);
       subscriptions.push_back(enumClassSub);
       subscriptions.push_back(enumIdentifierSub);
+      subscriptions.push_back(underlyingTypeSub);
       subscriptions.push_back(enumScopePopSub);
     }
 
@@ -0,0 +1,835 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The index laid out flat in one block of memory, with offsets from
+ * the start of the block instead of pointers, so it can be mapped in
+ * anywhere and read where it lies. IndexCode --shared publishes one
+ * of these as a POSIX shared memory segment, and the generators
+ * attach to it instead of reading the JSON when it's there and
+ * still matches the JSON file.
+ *
+ * IndexCode --flat writes one to a file, for packages to install
+ * instead of the JSON.
+ *
+ * FlatIndex and the views it hands out don't copy anything. Use
+ * toIndex() if you want the usual Index back.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FR_CODEGEN_HAVE_SHM 1
+#endif
+
+namespace fr::codegen {
+
+  namespace flat {
+
+    // Everything in the block is one of these, or an array of them.
+    // Offsets are from the start of the block.
+
+    struct Str {
+      uint32_t offset;
+      uint32_t length;
+    };
+
+    struct List {
+      uint32_t offset;
+      uint32_t count;
+    };
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      // Set last when the block is published, so a reader can tell a
+      // half written segment from a finished one
+      uint32_t ready;
+      uint64_t size;
+      List enums;
+      List classes;
+      // Which index file this came from, so readers can tell if it's stale
+      int64_t sourceModified;
+      uint64_t sourceSize;
+    };
+
+    struct EnumRecord {
+      Str key;
+      Str name;
+      Str definedIn;
+      Str underlyingType;
+      Str hash;
+      List namespaces;
+      List identifiers;
+      uint32_t isClassEnum;
+      uint32_t unused;
+    };
+
+    struct ParameterRecord {
+      Str type;
+      Str name;
+      uint8_t typeConst;
+      uint8_t nameConst;
+      uint8_t unused[6];
+    };
+
+    struct MethodRecord {
+      Str returnType;
+      Str name;
+      List parameters;
+      uint8_t isPublic;
+      uint8_t isProtected;
+      uint8_t isVirtual;
+      uint8_t isConst;
+      uint8_t isStatic;
+      uint8_t unused[3];
+    };
+
+    struct MemberRecord {
+      Str type;
+      Str name;
+      uint8_t isPublic;
+      uint8_t isProtected;
+      uint8_t isConst;
+      uint8_t isStatic;
+      uint8_t serializable;
+      uint8_t generateGetter;
+      uint8_t generateSetter;
+      uint8_t unused;
+    };
+
+    struct ClassRecord {
+      Str key;
+      Str name;
+      Str definedIn;
+      Str hash;
+      List namespaces;
+      List parents;
+      List methods;
+      List members;
+      uint8_t isStruct;
+      uint8_t serializable;
+      uint8_t unused[6];
+    };
+
+    constexpr char magic[8] = {'F', 'R', 'C', 'G', 'I', 'D', 'X', '\0'};
+    constexpr uint32_t version = 1;
+
+    /**
+     * Lays an index out flat. Strings are only stored once no matter
+     * how many things use them, which adds up with all the
+     * "std::string"s in member types.
+     */
+    class Builder {
+      std::string _block;
+      std::unordered_map<std::string, Str> _strings;
+
+      uint32_t allocate(size_t bytes) {
+        size_t offset = (_block.size() + 7) & ~size_t(7);
+        _block.resize(offset + bytes);
+        return offset;
+      }
+
+      template <typename T>
+      void put(uint32_t offset, const T& record) {
+        std::memcpy(_block.data() + offset, &record, sizeof(T));
+      }
+
+      Str string(const std::string& text) {
+        auto it = _strings.find(text);
+        if (it != _strings.end()) {
+          return it->second;
+        }
+        Str ret{static_cast<uint32_t>(_block.size()), static_cast<uint32_t>(text.size())};
+        _block.append(text);
+        _strings.emplace(text, ret);
+        return ret;
+      }
+
+      List strings(const std::vector<std::string>& texts) {
+        std::vector<Str> refs;
+        for (const auto& text : texts) {
+          refs.push_back(string(text));
+        }
+        List ret{allocate(sizeof(Str) * refs.size()), static_cast<uint32_t>(refs.size())};
+        for (size_t i = 0; i < refs.size(); ++i) {
+          put(ret.offset + i * sizeof(Str), refs[i]);
+        }
+        return ret;
+      }
+
+      EnumRecord record(const std::string& key, const EnumData& data, const std::string& hash) {
+        EnumRecord ret{};
+        ret.key = string(key);
+        ret.name = string(data.name);
+        ret.definedIn = string(data.definedIn);
+        ret.underlyingType = string(data.underlyingType);
+        ret.hash = string(hash);
+        ret.namespaces = strings(data.namespaces);
+        ret.identifiers = strings(data.identifiers);
+        ret.isClassEnum = data.isClassEnum;
+        return ret;
+      }
+
+      MethodRecord record(const MethodData& data) {
+        std::vector<ParameterRecord> parameters;
+        for (const auto& parameter : data.parameters) {
+          ParameterRecord p{};
+          p.type = string(parameter.type);
+          p.name = string(parameter.name);
+          p.typeConst = parameter.typeConst;
+          p.nameConst = parameter.nameConst;
+          parameters.push_back(p);
+        }
+        MethodRecord ret{};
+        ret.returnType = string(data.returnType);
+        ret.name = string(data.name);
+        ret.parameters = {allocate(sizeof(ParameterRecord) * parameters.size()),
+                          static_cast<uint32_t>(parameters.size())};
+        for (size_t i = 0; i < parameters.size(); ++i) {
+          put(ret.parameters.offset + i * sizeof(ParameterRecord), parameters[i]);
+        }
+        ret.isPublic = data.isPublic;
+        ret.isProtected = data.isProtected;
+        ret.isVirtual = data.isVirtual;
+        ret.isConst = data.isConst;
+        ret.isStatic = data.isStatic;
+        return ret;
+      }
+
+      ClassRecord record(const std::string& key, const ClassData& data, const std::string& hash) {
+        ClassRecord ret{};
+        ret.key = string(key);
+        ret.name = string(data.name);
+        ret.definedIn = string(data.definedIn);
+        ret.hash = string(hash);
+        ret.namespaces = strings(data.namespaces);
+        ret.parents = strings(data.parents);
+        std::vector<MethodRecord> methods;
+        for (const auto& method : data.methods) {
+          methods.push_back(record(method));
+        }
+        ret.methods = {allocate(sizeof(MethodRecord) * methods.size()), static_cast<uint32_t>(methods.size())};
+        for (size_t i = 0; i < methods.size(); ++i) {
+          put(ret.methods.offset + i * sizeof(MethodRecord), methods[i]);
+        }
+        std::vector<MemberRecord> members;
+        for (const auto& member : data.members) {
+          MemberRecord m{};
+          m.type = string(member.type);
+          m.name = string(member.name);
+          m.isPublic = member.isPublic;
+          m.isProtected = member.isProtected;
+          m.isConst = member.isConst;
+          m.isStatic = member.isStatic;
+          m.serializable = member.serializable;
+          m.generateGetter = member.generateGetter;
+          m.generateSetter = member.generateSetter;
+          members.push_back(m);
+        }
+        ret.members = {allocate(sizeof(MemberRecord) * members.size()), static_cast<uint32_t>(members.size())};
+        for (size_t i = 0; i < members.size(); ++i) {
+          put(ret.members.offset + i * sizeof(MemberRecord), members[i]);
+        }
+        ret.isStruct = data.isStruct;
+        ret.serializable = data.serializable;
+        return ret;
+      }
+
+    public:
+      /**
+       * The whole block for index. The maps are already sorted by key,
+       * so the tables come out sorted and lookups can binary search.
+       * stamp says which file the index was saved to, if any.
+       */
+      std::string build(const Index& index, const std::optional<FileStamp>& stamp = std::nullopt) {
+        _block.clear();
+        _strings.clear();
+        Header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        allocate(sizeof(Header));
+        header.enums = {allocate(sizeof(EnumRecord) * index.enums.size()),
+                        static_cast<uint32_t>(index.enums.size())};
+        header.classes = {allocate(sizeof(ClassRecord) * index.classes.size()),
+                          static_cast<uint32_t>(index.classes.size())};
+        uint32_t slot = header.enums.offset;
+        for (const auto& [key, data] : index.enums) {
+          put(slot, record(key, *data, index.hashOf(enumKey(key))));
+          slot += sizeof(EnumRecord);
+        }
+        slot = header.classes.offset;
+        for (const auto& [key, data] : index.classes) {
+          put(slot, record(key, *data, index.hashOf(classKey(key))));
+          slot += sizeof(ClassRecord);
+        }
+        if (stamp) {
+          header.sourceModified = stamp->modified.time_since_epoch().count();
+          header.sourceSize = stamp->size;
+        }
+        header.size = _block.size();
+        header.ready = 1;
+        put(0, header);
+        return std::move(_block);
+      }
+    };
+
+  }
+
+  class FlatIndex;
+
+  /**
+   * Random access over an array of records in the block, handing out
+   * View for each one.
+   */
+  template <typename View, typename Record>
+  class FlatList {
+    const FlatIndex* _index = nullptr;
+    const Record* _records = nullptr;
+    size_t _count = 0;
+
+  public:
+    FlatList() = default;
+    FlatList(const FlatIndex* index, const Record* records, size_t count) :
+      _index(index), _records(records), _count(count) {}
+
+    size_t size() const {
+      return _count;
+    }
+
+    bool empty() const {
+      return _count == 0;
+    }
+
+    View operator[](size_t i) const {
+      return View(_index, _records + i);
+    }
+
+    class iterator {
+      const FlatList* _list;
+      size_t _i;
+    public:
+      iterator(const FlatList* list, size_t i) : _list(list), _i(i) {}
+      View operator*() const { return (*_list)[_i]; }
+      iterator& operator++() { ++_i; return *this; }
+      bool operator==(const iterator& other) const { return _i == other._i; }
+    };
+
+    iterator begin() const {
+      return iterator(this, 0);
+    }
+
+    iterator end() const {
+      return iterator(this, _count);
+    }
+
+    // Copies the strings out, for the views that are just strings
+    std::vector<std::string> strings() const {
+      std::vector<std::string> ret;
+      for (size_t i = 0; i < _count; ++i) {
+        ret.emplace_back((*this)[i]);
+      }
+      return ret;
+    }
+  };
+
+  class FlatIndex {
+    const char* _block = nullptr;
+    size_t _size = 0;
+
+  public:
+    // Strings hand back string_views into the block
+    struct StringView {
+      std::string_view text;
+      StringView(const FlatIndex* index, const flat::Str* str) : text(index->string(*str)) {}
+      operator std::string_view() const { return text; }
+      operator std::string() const { return std::string(text); }
+    };
+
+    /**
+     * Wraps a block. If it isn't a complete flat index from this
+     * version, valid() is false and it looks empty.
+     */
+    FlatIndex() = default;
+    FlatIndex(std::string_view block) {
+      if (block.size() < sizeof(flat::Header)) {
+        return;
+      }
+      flat::Header header;
+      std::memcpy(&header, block.data(), sizeof(header));
+      if (std::memcmp(header.magic, flat::magic, sizeof(flat::magic)) != 0 ||
+          header.version != flat::version || header.size > block.size() ||
+          header.enums.offset + uint64_t(header.enums.count) * sizeof(flat::EnumRecord) > header.size ||
+          header.classes.offset + uint64_t(header.classes.count) * sizeof(flat::ClassRecord) > header.size) {
+        return;
+      }
+      _block = block.data();
+      _size = header.size;
+    }
+
+    bool valid() const {
+      return _block != nullptr;
+    }
+
+    const flat::Header& header() const {
+      return *reinterpret_cast<const flat::Header*>(_block);
+    }
+
+    // Anything pointing outside the block comes back empty rather
+    // than running off the end of it
+    std::string_view string(const flat::Str& str) const {
+      if (uint64_t(str.offset) + str.length > _size) {
+        return {};
+      }
+      return std::string_view(_block + str.offset, str.length);
+    }
+
+    template <typename View, typename Record>
+    FlatList<View, Record> list(const flat::List& list) const {
+      if (!_block || uint64_t(list.offset) + uint64_t(list.count) * sizeof(Record) > _size ||
+          list.offset % alignof(Record)) {
+        return {};
+      }
+      return FlatList<View, Record>(this, reinterpret_cast<const Record*>(_block + list.offset), list.count);
+    }
+
+    class EnumView;
+    class ClassView;
+
+    FlatList<EnumView, flat::EnumRecord> enums() const {
+      return valid() ? list<EnumView, flat::EnumRecord>(header().enums) : FlatList<EnumView, flat::EnumRecord>();
+    }
+
+    FlatList<ClassView, flat::ClassRecord> classes() const {
+      return valid() ? list<ClassView, flat::ClassRecord>(header().classes) : FlatList<ClassView, flat::ClassRecord>();
+    }
+
+    // Binary search on the key, like the std::map it came from
+    template <typename Records>
+    static auto find(const Records& records, std::string_view key) -> std::optional<decltype(records[0])> {
+      size_t low = 0;
+      size_t high = records.size();
+      while (low < high) {
+        size_t middle = (low + high) / 2;
+        auto candidate = records[middle];
+        if (candidate.key() < key) {
+          low = middle + 1;
+        } else {
+          high = middle;
+        }
+      }
+      if (low < records.size() && records[low].key() == key) {
+        return records[low];
+      }
+      return std::nullopt;
+    }
+
+    std::optional<EnumView> findEnum(std::string_view key) const;
+    std::optional<ClassView> findClass(std::string_view key) const;
+
+    // Copies everything back out into an Index, hashes and all
+    std::shared_ptr<Index> toIndex() const;
+  };
+
+  // Views hold on to the index and the record and dig things out on
+  // demand
+  template <typename Record>
+  class FlatView {
+  protected:
+    const FlatIndex* _index;
+    const Record* _record;
+
+    std::string_view string(const flat::Str& str) const {
+      return _index->string(str);
+    }
+
+  public:
+    FlatView(const FlatIndex* index, const Record* record) : _index(index), _record(record) {}
+
+    const Record& record() const {
+      return *_record;
+    }
+  };
+
+  using FlatStrings = FlatList<FlatIndex::StringView, flat::Str>;
+
+  class FlatParameterView : public FlatView<flat::ParameterRecord> {
+  public:
+    using FlatView::FlatView;
+    std::string_view type() const { return string(_record->type); }
+    std::string_view name() const { return string(_record->name); }
+    bool typeConst() const { return _record->typeConst; }
+    bool nameConst() const { return _record->nameConst; }
+
+    ParameterData data() const {
+      return ParameterData{std::string(type()), std::string(name()), typeConst(), nameConst()};
+    }
+  };
+
+  class FlatMethodView : public FlatView<flat::MethodRecord> {
+  public:
+    using FlatView::FlatView;
+    std::string_view returnType() const { return string(_record->returnType); }
+    std::string_view name() const { return string(_record->name); }
+    FlatList<FlatParameterView, flat::ParameterRecord> parameters() const {
+      return _index->list<FlatParameterView, flat::ParameterRecord>(_record->parameters);
+    }
+    bool isPublic() const { return _record->isPublic; }
+    bool isProtected() const { return _record->isProtected; }
+    bool isVirtual() const { return _record->isVirtual; }
+    bool isConst() const { return _record->isConst; }
+    bool isStatic() const { return _record->isStatic; }
+
+    MethodData data() const {
+      MethodData ret;
+      ret.returnType = returnType();
+      ret.name = name();
+      for (auto parameter : parameters()) {
+        ret.parameters.push_back(parameter.data());
+      }
+      ret.isPublic = isPublic();
+      ret.isProtected = isProtected();
+      ret.isVirtual = isVirtual();
+      ret.isConst = isConst();
+      ret.isStatic = isStatic();
+      return ret;
+    }
+  };
+
+  class FlatMemberView : public FlatView<flat::MemberRecord> {
+  public:
+    using FlatView::FlatView;
+    std::string_view type() const { return string(_record->type); }
+    std::string_view name() const { return string(_record->name); }
+    bool isPublic() const { return _record->isPublic; }
+    bool isProtected() const { return _record->isProtected; }
+    bool isConst() const { return _record->isConst; }
+    bool isStatic() const { return _record->isStatic; }
+    bool serializable() const { return _record->serializable; }
+    bool generateGetter() const { return _record->generateGetter; }
+    bool generateSetter() const { return _record->generateSetter; }
+
+    MemberData data() const {
+      MemberData ret;
+      ret.type = type();
+      ret.name = name();
+      ret.isPublic = isPublic();
+      ret.isProtected = isProtected();
+      ret.isConst = isConst();
+      ret.isStatic = isStatic();
+      ret.serializable = serializable();
+      ret.generateGetter = generateGetter();
+      ret.generateSetter = generateSetter();
+      return ret;
+    }
+  };
+
+  class FlatIndex::EnumView : public FlatView<flat::EnumRecord> {
+  public:
+    using FlatView::FlatView;
+    std::string_view key() const { return string(_record->key); }
+    std::string_view name() const { return string(_record->name); }
+    std::string_view definedIn() const { return string(_record->definedIn); }
+    std::string_view underlyingType() const { return string(_record->underlyingType); }
+    std::string_view hash() const { return string(_record->hash); }
+    bool isClassEnum() const { return _record->isClassEnum; }
+    FlatStrings namespaces() const { return _index->list<FlatIndex::StringView, flat::Str>(_record->namespaces); }
+    FlatStrings identifiers() const { return _index->list<FlatIndex::StringView, flat::Str>(_record->identifiers); }
+
+    EnumData data() const {
+      EnumData ret;
+      ret.namespaces = namespaces().strings();
+      ret.name = name();
+      ret.isClassEnum = isClassEnum();
+      ret.definedIn = definedIn();
+      ret.identifiers = identifiers().strings();
+      ret.underlyingType = underlyingType();
+      return ret;
+    }
+  };
+
+  class FlatIndex::ClassView : public FlatView<flat::ClassRecord> {
+  public:
+    using FlatView::FlatView;
+    std::string_view key() const { return string(_record->key); }
+    std::string_view name() const { return string(_record->name); }
+    std::string_view definedIn() const { return string(_record->definedIn); }
+    std::string_view hash() const { return string(_record->hash); }
+    bool isStruct() const { return _record->isStruct; }
+    bool serializable() const { return _record->serializable; }
+    FlatStrings namespaces() const { return _index->list<FlatIndex::StringView, flat::Str>(_record->namespaces); }
+    FlatStrings parents() const { return _index->list<FlatIndex::StringView, flat::Str>(_record->parents); }
+    FlatList<FlatMethodView, flat::MethodRecord> methods() const {
+      return _index->list<FlatMethodView, flat::MethodRecord>(_record->methods);
+    }
+    FlatList<FlatMemberView, flat::MemberRecord> members() const {
+      return _index->list<FlatMemberView, flat::MemberRecord>(_record->members);
+    }
+
+    ClassData data() const {
+      ClassData ret;
+      ret.definedIn = definedIn();
+      ret.namespaces = namespaces().strings();
+      ret.name = name();
+      ret.parents = parents().strings();
+      for (auto method : methods()) {
+        ret.methods.push_back(method.data());
+      }
+      for (auto member : members()) {
+        ret.members.push_back(member.data());
+      }
+      ret.isStruct = isStruct();
+      ret.serializable = serializable();
+      return ret;
+    }
+  };
+
+  inline std::optional<FlatIndex::EnumView> FlatIndex::findEnum(std::string_view key) const {
+    return find(enums(), key);
+  }
+
+  inline std::optional<FlatIndex::ClassView> FlatIndex::findClass(std::string_view key) const {
+    return find(classes(), key);
+  }
+
+  inline std::shared_ptr<Index> FlatIndex::toIndex() const {
+    auto index = std::make_shared<Index>();
+    for (auto e : enums()) {
+      std::string key(e.key());
+      index->enums.emplace_hint(index->enums.end(), key, std::make_shared<EnumData>(e.data()));
+      index->hashes[enumKey(key)] = e.hash();
+    }
+    for (auto c : classes()) {
+      std::string key(c.key());
+      index->classes.emplace_hint(index->classes.end(), key, std::make_shared<ClassData>(c.data()));
+      index->hashes[classKey(key)] = c.hash();
+    }
+    return index;
+  }
+
+  /**
+   * Writes index laid out flat to filename. IndexCode --flat does this
+   * for indexes a package installs (see codegen_install_index), and
+   * the generators take the file anywhere they take the JSON. It's
+   * only good for a codegen with the same flat::version on a machine
+   * with the same byte order, so ship the JSON if you need to go
+   * further afield than that.
+   */
+  inline void saveFlatIndex(const std::string& filename, const Index& index) {
+    auto block = flat::Builder().build(index);
+    std::ofstream stream(filename, std::ios::binary);
+    stream.write(block.data(), block.size());
+    if (!stream) {
+      throw std::runtime_error("Couldn't write " + filename);
+    }
+  }
+
+  // Does filename start like a flat index? Only reads that much of it.
+  inline bool isFlatIndexFile(const std::string& filename) {
+    char magic[sizeof(flat::magic)] = {};
+    std::ifstream stream(filename, std::ios::binary);
+    stream.read(magic, sizeof(magic));
+    return stream && std::memcmp(magic, flat::magic, sizeof(magic)) == 0;
+  }
+
+  /**
+   * An IndexCache source for files saveFlatIndex wrote. It maps the
+   * file rather than reading it in. Anything else (like the JSON) gets
+   * null, so the next source has a go at it.
+   */
+  inline std::shared_ptr<Index> loadFlatIndexFile(const std::string& filename, const FileStamp&) {
+    if (!isFlatIndexFile(filename)) {
+      return nullptr;
+    }
+    std::shared_ptr<Index> ret;
+#ifdef FR_CODEGEN_HAVE_SHM
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    void* address = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &status) == 0 && status.st_size > 0) {
+      address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (address != MAP_FAILED) {
+      FlatIndex index(std::string_view(static_cast<const char*>(address), status.st_size));
+      if (index.valid()) {
+        ret = index.toIndex();
+      }
+      munmap(address, status.st_size);
+    }
+#else
+    std::ifstream stream(filename, std::ios::binary);
+    std::string block((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    FlatIndex index(block);
+    if (index.valid()) {
+      ret = index.toIndex();
+    }
+#endif
+    // It's ours, but not one we can read, and it's certainly not JSON
+    if (!ret) {
+      throw std::runtime_error(filename + " is a flat index from a different version of codegen");
+    }
+    return ret;
+  }
+
+#ifdef FR_CODEGEN_HAVE_SHM
+
+  /**
+   * A flat index in a POSIX shared memory segment. IndexCode --shared
+   * publishes one per index file, and every generator on the machine
+   * maps the same pages read only. Segments stick around until
+   * they're replaced, removed or the machine reboots (on Linux
+   * they're the files in /dev/shm/frcodegen-*).
+   *
+   * The names are machine wide, so a segment only gets used if it
+   * belongs to us and nobody else can write to it. Otherwise anyone
+   * who can stat your index could publish one for it first and have
+   * your generators write their code.
+   */
+  class SharedIndex {
+    void* _address = MAP_FAILED;
+    size_t _size = 0;
+
+    SharedIndex(void* address, size_t size) : _address(address), _size(size) {}
+
+  public:
+    SharedIndex(const SharedIndex&) = delete;
+    SharedIndex& operator=(const SharedIndex&) = delete;
+
+    SharedIndex(SharedIndex&& other) noexcept :
+      _address(std::exchange(other._address, MAP_FAILED)), _size(other._size) {}
+
+    ~SharedIndex() {
+      if (_address != MAP_FAILED) {
+        munmap(_address, _size);
+      }
+    }
+
+    // The segment for an index file, going by its absolute path
+    static std::string segmentName(const std::string& indexFile) {
+      std::error_code error;
+      auto path = std::filesystem::absolute(indexFile, error).lexically_normal().string();
+      return "/frcodegen-" + std::to_string(geteuid()) + "-" + toHex(fnv1a(path));
+    }
+
+    /**
+     * Replaces whatever was published under name. Anyone who already
+     * has the old one mapped keeps it until they let go. Returns false
+     * if we couldn't make the segment, which just means everyone reads
+     * the JSON like they used to.
+     */
+    static bool publish(const std::string& name, const std::string& block) {
+      if (block.size() < sizeof(flat::Header)) {
+        return false;
+      }
+      shm_unlink(name.c_str());
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd < 0) {
+        return false;
+      }
+      bool ok = ftruncate(fd, block.size()) == 0;
+      void* address = ok ? mmap(nullptr, block.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+      close(fd);
+      if (address == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+      }
+      // Everything with the ready flag clear, then the ready flag, so
+      // nobody attaching in the middle of this sees a partial index
+      flat::Header header;
+      std::memcpy(&header, block.data(), sizeof(header));
+      header.ready = 0;
+      std::memcpy(address, &header, sizeof(header));
+      std::memcpy(static_cast<char*>(address) + sizeof(header), block.data() + sizeof(header),
+                  block.size() - sizeof(header));
+      __atomic_store_n(&static_cast<flat::Header*>(address)->ready, 1, __ATOMIC_RELEASE);
+      munmap(address, block.size());
+      return true;
+    }
+
+    static void remove(const std::string& name) {
+      shm_unlink(name.c_str());
+    }
+
+    // Maps name read only, if it's there, finished and ours
+    static std::optional<SharedIndex> attach(const std::string& name) {
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd < 0) {
+        return std::nullopt;
+      }
+      struct stat status;
+      void* address = MAP_FAILED;
+      if (fstat(fd, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(flat::Header)) &&
+          status.st_uid == geteuid() && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0) {
+        address = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      }
+      close(fd);
+      if (address == MAP_FAILED) {
+        return std::nullopt;
+      }
+      SharedIndex shared(address, status.st_size);
+      auto* header = static_cast<const flat::Header*>(address);
+      if (__atomic_load_n(&header->ready, __ATOMIC_ACQUIRE) != 1 || !shared.index().valid()) {
+        return std::nullopt;
+      }
+      return shared;
+    }
+
+    FlatIndex index() const {
+      return FlatIndex(std::string_view(static_cast<const char*>(_address), _size));
+    }
+
+    // Was this published from the index file as it is right now?
+    bool matches(const FileStamp& stamp) const {
+      const auto& header = index().header();
+      return header.sourceModified == stamp.modified.time_since_epoch().count() &&
+        header.sourceSize == stamp.size;
+    }
+  };
+
+  /**
+   * An IndexCache source that picks up the segment IndexCode --shared
+   * published for filename, as long as the file hasn't changed since.
+   */
+  inline std::shared_ptr<Index> loadSharedIndex(const std::string& filename, const FileStamp& stamp) {
+    auto shared = SharedIndex::attach(SharedIndex::segmentName(filename));
+    if (!shared || !shared->matches(stamp)) {
+      return nullptr;
+    }
+    return shared->index().toIndex();
+  }
+
+#endif
+
+}
@@ -0,0 +1,463 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The index IndexCode writes and all the generators read. Every
+ * program was loading the maps out of the JSON by hand, so it lives
+ * here now along with a content hash for each entity in it, which
+ * the generators use to figure out whether they need to run at all.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fr/codegen/data.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fr::codegen {
+
+  using EnumMap = std::map<std::string, std::shared_ptr<EnumData>>;
+  using ClassMap = std::map<std::string, std::shared_ptr<ClassData>>;
+  // Entity key -> hex content hash
+  using HashMap = std::map<std::string, std::string>;
+
+  // 64 bit FNV-1a. It's not cryptographic, it just has to notice
+  // when something changed.
+  inline uint64_t fnv1a(std::string_view data, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  inline std::string toHex(uint64_t value) {
+    std::stringstream stream;
+    stream << std::hex << std::setw(16) << std::setfill('0') << value;
+    return stream.str();
+  }
+
+  // Hash of an entity's serialized form, so it changes if anything
+  // the parser recorded about it changes.
+  template <typename T>
+  std::string entityHash(const T& entity) {
+    std::stringstream stream;
+    {
+      cereal::BinaryOutputArchive archive(stream);
+      archive(entity);
+    }
+    return toHex(fnv1a(stream.view()));
+  }
+
+  // Hash of a file's contents. Missing files hash to an empty string
+  // so they never match anything that was there.
+  inline std::string fileHash(const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream) {
+      return "";
+    }
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return toHex(fnv1a(contents.view()));
+  }
+
+  // Keys for entities in Index::hashes. Classes and enums can have the
+  // same name, so they get a prefix.
+  inline std::string enumKey(const std::string& name) {
+    return std::string("enum:") + name;
+  }
+
+  inline std::string classKey(const std::string& name) {
+    return std::string("class:") + name;
+  }
+
+  // Which class a bare name meant, for generators that only see bare
+  // names. hashOf gives you the key it means now instead of a hash, so
+  // a name that starts meaning some other class counts as a change.
+  inline std::string classNameKey(const std::string& name) {
+    return std::string("classname:") + name;
+  }
+
+  struct Index {
+    EnumMap enums;
+    ClassMap classes;
+    HashMap hashes;
+
+    void computeHashes() {
+      hashes.clear();
+      for (const auto& [name, data] : enums) {
+        hashes[enumKey(name)] = entityHash(*data);
+      }
+      for (const auto& [name, data] : classes) {
+        hashes[classKey(name)] = entityHash(*data);
+      }
+    }
+
+    // The Lbl filters only see bare class names, this finds the index
+    // key for one. You get an empty string if there isn't one, or if
+    // more than one namespace has a class by that name, since there's
+    // no telling which one they meant.
+    std::string findClassKey(const std::string& name) const {
+      std::string ret;
+      for (const auto& [key, data] : classes) {
+        if (data->name == name) {
+          if (!ret.empty()) {
+            return "";
+          }
+          ret = key;
+        }
+      }
+      return ret;
+    }
+
+    // Returns the entity's hash or an empty string if we don't have it
+    std::string hashOf(const std::string& key) const {
+      if (key.starts_with("classname:")) {
+        return findClassKey(key.substr(10));
+      }
+      auto it = hashes.find(key);
+      return (it == hashes.end()) ? std::string() : it->second;
+    }
+
+    void load(std::istream& stream) {
+      cereal::JSONInputArchive archive(stream);
+      archive(enums);
+      archive(classes);
+      // Indexes written before hashes were a thing won't have them
+      try {
+        archive(hashes);
+      } catch (cereal::Exception&) {
+        computeHashes();
+      }
+    }
+
+    void load(const std::string& filename) {
+      std::ifstream stream(filename);
+      load(stream);
+    }
+
+    void save(std::ostream& stream) {
+      computeHashes();
+      cereal::JSONOutputArchive archive(stream);
+      archive(cereal::make_nvp("enums", enums));
+      archive(cereal::make_nvp("classes", classes));
+      archive(cereal::make_nvp("hashes", hashes));
+    }
+
+    void save(const std::string& filename) {
+      std::ofstream stream(filename);
+      save(stream);
+    }
+  };
+
+  /**
+   * A few indexes looked at together without merging them. The first
+   * one is what you're generating code for, and the rest are usually
+   * indexes other packages installed for the headers you depend on
+   * (see codegen_install_index), so nobody has to parse those again.
+   * Lookups try them in order and the first one with the name wins.
+   */
+  class IndexSet {
+    std::vector<std::shared_ptr<const Index>> _indexes;
+    // Bare class name -> class, and every key with that name, built
+    // for each index the first time somebody looks a class up by name
+    mutable std::vector<std::map<std::string, std::shared_ptr<ClassData>>> _byName;
+    mutable std::vector<std::map<std::string, std::vector<std::string>>> _keysByName;
+    mutable std::once_flag _byNameBuilt;
+
+    void buildByName() const {
+      std::call_once(_byNameBuilt, [this]() {
+        _byName.resize(_indexes.size());
+        _keysByName.resize(_indexes.size());
+        for (size_t i = 0; i < _indexes.size(); ++i) {
+          for (const auto& [key, data] : _indexes[i]->classes) {
+            _byName[i][data->name] = data;
+            _keysByName[i][data->name].push_back(key);
+          }
+        }
+      });
+    }
+
+  public:
+    IndexSet() = default;
+    explicit IndexSet(std::shared_ptr<const Index> index) {
+      add(std::move(index));
+    }
+
+    // Only add before you start looking things up
+    void add(std::shared_ptr<const Index> index) {
+      _indexes.push_back(std::move(index));
+    }
+
+    bool empty() const {
+      return _indexes.empty();
+    }
+
+    const std::vector<std::shared_ptr<const Index>>& indexes() const {
+      return _indexes;
+    }
+
+    // The one you're generating for
+    const Index& primary() const {
+      return *_indexes.front();
+    }
+
+    std::shared_ptr<EnumData> findEnum(const std::string& key) const {
+      for (const auto& index : _indexes) {
+        auto it = index->enums.find(key);
+        if (it != index->enums.end()) {
+          return it->second;
+        }
+      }
+      return nullptr;
+    }
+
+    std::shared_ptr<ClassData> findClass(const std::string& key) const {
+      for (const auto& index : _indexes) {
+        auto it = index->classes.find(key);
+        if (it != index->classes.end()) {
+          return it->second;
+        }
+      }
+      return nullptr;
+    }
+
+    // Same as Index::findClassKey, from the first index that has the
+    // name. If that one has it more than once it's still ambiguous.
+    std::string findClassKey(const std::string& name) const {
+      buildByName();
+      for (const auto& keys : _keysByName) {
+        auto it = keys.find(name);
+        if (it != keys.end()) {
+          return it->second.size() == 1 ? it->second.front() : "";
+        }
+      }
+      return "";
+    }
+
+    // By the bare name the Lbl filters see
+    std::shared_ptr<ClassData> findClassByName(const std::string& name) const {
+      buildByName();
+      for (const auto& names : _byName) {
+        auto it = names.find(name);
+        if (it != names.end()) {
+          return it->second;
+        }
+      }
+      return nullptr;
+    }
+
+    std::string hashOf(const std::string& key) const {
+      // The first index with the name decides, even if it's ambiguous there
+      if (key.starts_with("classname:")) {
+        return findClassKey(key.substr(10));
+      }
+      for (const auto& index : _indexes) {
+        auto hash = index->hashOf(key);
+        if (!hash.empty()) {
+          return hash;
+        }
+      }
+      return "";
+    }
+  };
+
+  /**
+   * Enough about a file to tell if it changed without reading it.
+   * Paths are absolute so a long running process doesn't care what
+   * directory its callers were in.
+   */
+  struct FileStamp {
+    std::string path;
+    std::filesystem::file_time_type modified;
+    uintmax_t size = 0;
+
+    static std::optional<FileStamp> of(const std::string& filename) {
+      std::error_code error;
+      FileStamp stamp;
+      stamp.path = std::filesystem::absolute(filename, error).lexically_normal().string();
+      stamp.modified = std::filesystem::last_write_time(filename, error);
+      if (error) {
+        return std::nullopt;
+      }
+      stamp.size = std::filesystem::file_size(filename, error);
+      if (error) {
+        return std::nullopt;
+      }
+      return stamp;
+    }
+
+    bool operator==(const FileStamp&) const = default;
+  };
+
+  // Where IndexCode --journal keeps the changes it hasn't folded into
+  // the index file yet (see journal.h)
+  inline std::string journalFile(const std::string& indexFile) {
+    return indexFile + ".journal";
+  }
+
+  // The index changes whenever its journal does, and a full rewrite
+  // deletes the journal, so that's the stamp to check if there is one
+  inline std::optional<FileStamp> indexStamp(const std::string& indexFile) {
+    auto journal = FileStamp::of(journalFile(indexFile));
+    return journal ? journal : FileStamp::of(indexFile);
+  }
+
+  /**
+   * Keeps loaded indexes around so something that runs a bunch of
+   * generators (codegend) only reads each index once. An index gets
+   * reloaded if the file's been touched since we read it. The Index
+   * you get back is shared, so don't modify it.
+   */
+  class IndexCache {
+  public:
+    // Somewhere other than the file an index might already be, like
+    // the shared memory segments in flat.h. Returns null if it isn't.
+    using Source = std::function<std::shared_ptr<Index>(const std::string& filename, const FileStamp& stamp)>;
+
+  private:
+    struct Loaded {
+      FileStamp stamp;
+      std::optional<FileStamp> journal;
+      std::shared_ptr<const Index> index;
+    };
+
+    std::mutex _mutex;
+    std::vector<Source> _sources;
+    std::map<std::string, Loaded> _indexes;
+    // Indexes that were never written anywhere, by the name they'd have had
+    std::map<std::string, std::shared_ptr<const Index>> _unwritten;
+
+    static std::string absolute(const std::string& filename) {
+      std::error_code error;
+      return std::filesystem::absolute(filename, error).lexically_normal().string();
+    }
+
+  public:
+    std::shared_ptr<const Index> load(const std::string& filename) {
+      auto stamp = FileStamp::of(filename);
+      auto journal = FileStamp::of(journalFile(filename));
+      std::lock_guard lock(_mutex);
+      auto unwritten = _unwritten.find(absolute(filename));
+      if (unwritten != _unwritten.end()) {
+        return unwritten->second;
+      }
+      if (stamp) {
+        auto it = _indexes.find(stamp->path);
+        if (it != _indexes.end() && it->second.stamp == *stamp && it->second.journal == journal) {
+          return it->second.index;
+        }
+      }
+      std::shared_ptr<Index> index;
+      if (stamp) {
+        for (const auto& source : _sources) {
+          if ((index = source(filename, journal ? *journal : *stamp))) {
+            break;
+          }
+        }
+      }
+      if (!index) {
+        index = std::make_shared<Index>();
+        index->load(filename);
+      }
+      if (stamp) {
+        _indexes[stamp->path] = {*stamp, journal, index};
+      }
+      return index;
+    }
+
+    // Sources get tried in the order they're added, before the file.
+    // They get indexStamp(filename) to check themselves against.
+    void addSource(Source source) {
+      std::lock_guard lock(_mutex);
+      _sources.push_back(std::move(source));
+    }
+
+    // Hand it an index you just built so nobody has to read it back in
+    void store(const std::string& filename, std::shared_ptr<const Index> index) {
+      auto stamp = FileStamp::of(filename);
+      auto journal = FileStamp::of(journalFile(filename));
+      std::lock_guard lock(_mutex);
+      _unwritten.erase(absolute(filename));
+      if (stamp) {
+        _indexes[stamp->path] = {*stamp, journal, index};
+      }
+    }
+
+    // Same thing for an index that only exists in memory. Anyone who
+    // loads filename from this cache gets it, whether or not there's
+    // a file by that name.
+    void publish(const std::string& filename, std::shared_ptr<const Index> index) {
+      std::lock_guard lock(_mutex);
+      _unwritten[absolute(filename)] = index;
+    }
+  };
+
+  /**
+   * What IndexCode found in one header, kept so only headers that
+   * changed get parsed again.
+   */
+  struct HeaderIndex {
+    EnumMap enums;
+    ClassMap classes;
+  };
+
+  class HeaderCache {
+    std::mutex _mutex;
+    std::map<std::string, std::pair<FileStamp, std::shared_ptr<const HeaderIndex>>> _headers;
+
+    // The enums remember the header name they were given, so the same
+    // file asked for by another name has to be parsed again. Same goes
+    // for a header parsed at a different detail level.
+    static std::string key(const FileStamp& stamp, const std::string& filename, const std::string& detail) {
+      return stamp.path + "|" + filename + "|" + detail;
+    }
+
+  public:
+    // Returns null if we haven't seen the header or it changed
+    std::shared_ptr<const HeaderIndex> find(const std::string& filename, const std::string& detail = "full") {
+      auto stamp = FileStamp::of(filename);
+      if (!stamp) {
+        return nullptr;
+      }
+      std::lock_guard lock(_mutex);
+      auto it = _headers.find(key(*stamp, filename, detail));
+      if (it == _headers.end() || !(it->second.first == *stamp)) {
+        return nullptr;
+      }
+      return it->second.second;
+    }
+
+    void store(const std::string& filename, std::shared_ptr<const HeaderIndex> header,
+               const std::string& detail = "full") {
+      auto stamp = FileStamp::of(filename);
+      if (stamp) {
+        std::lock_guard lock(_mutex);
+        _headers[key(*stamp, filename, detail)] = {*stamp, header};
+      }
+    }
+  };
+
+}
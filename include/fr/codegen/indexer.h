@@ -0,0 +1,120 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Turning headers into an Index without going through IndexCode.
+ * indexHeader is what IndexCode does with each header it reads, and
+ * indexHeaders does a whole list of them on a thread pool, for things
+ * like the Python module that want an index without writing one out.
+ */
+
+#pragma once
+
+#include <fr/codegen/crawl.h>
+#include <fr/codegen/drivers.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/parser.h>
+#include <fr/codegen/workpool.h>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fr::codegen {
+
+  // Gets a look at the parser and drivers for a header before it's
+  // parsed, to hook up logging and the like
+  using IndexSetup = std::function<void(parser::ParserDriver&, EnumDriver&, ClassDriver&)>;
+
+  /**
+   * Parses one header into the enums and classes it defines. The
+   * header name is what ends up in definedIn. If the parse fails you
+   * still get whatever it found before it gave up.
+   */
+  inline std::shared_ptr<HeaderIndex> indexHeader(const std::string& header, std::string_view input,
+                                                  parser::IndexDetail detail, bool& success,
+                                                  const IndexSetup& setup = {}) {
+    auto found = std::make_shared<HeaderIndex>();
+    parser::ParserDriver parser;
+    parser.detail = detail;
+    EnumDriver enums;
+    ClassDriver classes;
+    enums.regParser(parser);
+    classes.regParser(parser);
+    enums.setCurrentFile(header);
+    classes.setCurrentFile(header);
+    enums.enumAvailable.connect([&found](const std::string& key, const EnumData& data) {
+      found->enums[key] = std::make_shared<EnumData>(data);
+    });
+    classes.classAvailable.connect([&found](const std::string& key, const ClassData& data) {
+      found->classes[key] = std::make_shared<ClassData>(data);
+    });
+    if (setup) {
+      setup(parser, enums, classes);
+    }
+    std::string result;
+    success = parser.parse(input.begin(), input.end(), result);
+    return found;
+  }
+
+  /**
+   * Reads and parses headers on jobs threads (0 for one per core) and
+   * puts the index together the way IndexCode does, with headers later
+   * in the list winning if two define the same thing. Headers that
+   * couldn't be read or parsed go in failed if you pass it.
+   */
+  inline std::shared_ptr<Index> indexHeaders(const std::vector<std::string>& headers, parser::IndexDetail detail,
+                                             size_t jobs = 0, std::vector<std::string>* failed = nullptr) {
+    std::vector<std::shared_ptr<HeaderIndex>> found(headers.size());
+    std::vector<char> ok(headers.size(), 1);
+    {
+      WorkStealingPool pool(jobs);
+      for (size_t i = 0; i < headers.size(); ++i) {
+        pool.submit([&, i]() {
+          std::ifstream stream(headers[i], std::ios::binary);
+          std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+          if (!stream.good() && !stream.eof()) {
+            ok[i] = 0;
+          }
+          if (!mightDeclare(contents)) {
+            found[i] = std::make_shared<HeaderIndex>();
+            return;
+          }
+          bool success = false;
+          found[i] = indexHeader(headers[i], contents, detail, success);
+          ok[i] = ok[i] && success;
+        });
+      }
+      pool.wait();
+    }
+    auto index = std::make_shared<Index>();
+    for (size_t i = 0; i < headers.size(); ++i) {
+      for (auto& [key, data] : found[i]->enums) {
+        index->enums[key] = std::move(data);
+      }
+      for (auto& [key, data] : found[i]->classes) {
+        index->classes[key] = std::move(data);
+      }
+      if (!ok[i] && failed) {
+        failed->push_back(headers[i]);
+      }
+    }
+    index->computeHashes();
+    return index;
+  }
+
+}
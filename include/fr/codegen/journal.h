@@ -0,0 +1,351 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Changing one header used to mean rewriting the whole index JSON.
+ * With IndexCode --journal, the JSON is a snapshot and the changes go
+ * on the end of index.json.journal instead, one record per header
+ * that got replaced or removed. The journal starts with a snapshot
+ * record saying which JSON file it goes with and which version of
+ * every header is in it, so IndexCode can tell what changed without
+ * reading the index. Readers load the JSON and play the journal over
+ * it. When the journal gets too big IndexCode folds it back into the
+ * JSON and starts a new one.
+ *
+ * Each record is a length, a kind, a cereal binary payload and a
+ * checksum. A record that didn't get completely written, or that
+ * IndexCode is still writing while a generator reads the journal,
+ * just gets ignored.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fr::codegen {
+
+  /**
+   * The version of a header the index has, close enough to FileStamp
+   * to compare against one and simple enough to write to the journal.
+   */
+  struct HeaderStamp {
+    int64_t modified = 0;
+    uint64_t size = 0;
+
+    static HeaderStamp of(const FileStamp& stamp) {
+      return {static_cast<int64_t>(stamp.modified.time_since_epoch().count()), stamp.size};
+    }
+
+    bool operator==(const HeaderStamp&) const = default;
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+      ar(modified, size);
+    }
+  };
+
+  // Header name (as IndexCode was given it) -> version in the index
+  using HeaderManifest = std::map<std::string, HeaderStamp>;
+
+  class IndexJournal {
+  public:
+    enum class Record : uint8_t { snapshot = 1, replace = 2, remove = 3 };
+
+  private:
+    static constexpr char magic[8] = {'F', 'R', 'C', 'G', 'J', 'N', 'L', '\0'};
+    // Length and checksum around each record
+    static constexpr size_t overhead = sizeof(uint32_t) + sizeof(uint64_t);
+
+    std::string _filename;
+    std::string _detail;
+    HeaderManifest _headers;
+    // Replace and remove records in the order they were written,
+    // still serialized. Only the ones that get applied get unpacked.
+    std::vector<std::pair<Record, std::string>> _records;
+    // Bytes of good records, anything after that is a torn write
+    uint64_t _size = 0;
+    bool _trimmed = false;
+
+    template <typename... Args>
+    static std::string pack(Args&&... args) {
+      std::ostringstream stream;
+      {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(std::forward<Args>(args)...);
+      }
+      return stream.str();
+    }
+
+    static void writeRecord(std::ostream& stream, Record kind, const std::string& payload) {
+      std::string body(1, static_cast<char>(kind));
+      body += payload;
+      uint32_t length = body.size();
+      uint64_t checksum = fnv1a(body);
+      stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      stream.write(body.data(), body.size());
+      stream.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    }
+
+    // Reads the record at offset, returns false if there isn't a whole one there
+    static bool readRecord(std::string_view data, size_t& offset, Record& kind, std::string_view& payload) {
+      uint32_t length = 0;
+      if (data.size() - offset < overhead + 1) {
+        return false;
+      }
+      std::memcpy(&length, data.data() + offset, sizeof(length));
+      if (length == 0 || data.size() - offset - overhead < length) {
+        return false;
+      }
+      std::string_view body = data.substr(offset + sizeof(length), length);
+      uint64_t checksum = 0;
+      std::memcpy(&checksum, body.data() + length, sizeof(checksum));
+      if (checksum != fnv1a(body)) {
+        return false;
+      }
+      kind = static_cast<Record>(body[0]);
+      payload = body.substr(1);
+      offset += length + overhead;
+      return true;
+    }
+
+    void append(Record kind, const std::string& payload) {
+      // Get rid of a torn record before putting anything after it
+      if (!_trimmed) {
+        std::error_code error;
+        if (std::filesystem::file_size(_filename, error) != _size && !error) {
+          std::filesystem::resize_file(_filename, _size, error);
+        }
+        _trimmed = true;
+      }
+      std::ofstream stream(_filename, std::ios::binary | std::ios::app);
+      writeRecord(stream, kind, payload);
+      stream.flush();
+      if (!stream) {
+        throw std::runtime_error("Couldn't append to " + _filename);
+      }
+      _size += payload.size() + 1 + overhead;
+      _records.emplace_back(kind, payload);
+    }
+
+    // Just the header name off the front of a replace or remove record
+    static std::string headerOf(const std::string& payload) {
+      std::istringstream stream(payload);
+      cereal::BinaryInputArchive archive(stream);
+      std::string header;
+      archive(header);
+      return header;
+    }
+
+  public:
+    /**
+     * Reads the journal that goes with indexFile. You get nullopt if
+     * there isn't one, or if it was started for some other version of
+     * the JSON than the one that's there now.
+     */
+    static std::optional<IndexJournal> open(const std::string& indexFile) {
+      auto snapshot = FileStamp::of(indexFile);
+      if (!snapshot) {
+        return std::nullopt;
+      }
+      IndexJournal journal;
+      journal._filename = journalFile(indexFile);
+      std::ifstream stream(journal._filename, std::ios::binary);
+      if (!stream) {
+        return std::nullopt;
+      }
+      std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+      if (data.size() < sizeof(magic) || std::memcmp(data.data(), magic, sizeof(magic)) != 0) {
+        return std::nullopt;
+      }
+      size_t offset = sizeof(magic);
+      Record kind;
+      std::string_view payload;
+      if (!readRecord(data, offset, kind, payload) || kind != Record::snapshot) {
+        return std::nullopt;
+      }
+      try {
+        HeaderStamp jsonStamp;
+        {
+          std::istringstream snapshotStream{std::string(payload)};
+          cereal::BinaryInputArchive archive(snapshotStream);
+          archive(jsonStamp, journal._detail, journal._headers);
+        }
+        if (!(jsonStamp == HeaderStamp::of(*snapshot))) {
+          return std::nullopt;
+        }
+        while (readRecord(data, offset, kind, payload)) {
+          std::string record(payload);
+          std::istringstream recordStream(record);
+          cereal::BinaryInputArchive archive(recordStream);
+          std::string header;
+          if (kind == Record::replace) {
+            HeaderStamp stamp;
+            archive(header, stamp);
+            journal._headers[header] = stamp;
+          } else if (kind == Record::remove) {
+            archive(header);
+            journal._headers.erase(header);
+          } else {
+            break;
+          }
+          journal._records.emplace_back(kind, std::move(record));
+        }
+      } catch (cereal::Exception&) {
+        return std::nullopt;
+      }
+      journal._size = offset;
+      return journal;
+    }
+
+    /**
+     * Starts a fresh journal for the JSON that was just written to
+     * indexFile, which has headers in it. It's written off to the
+     * side and renamed into place, so nobody reading the old one gets
+     * half of the new one.
+     */
+    static std::optional<IndexJournal> start(const std::string& indexFile, const std::string& detail,
+                                             const HeaderManifest& headers) {
+      auto snapshot = FileStamp::of(indexFile);
+      if (!snapshot) {
+        return std::nullopt;
+      }
+      IndexJournal journal;
+      journal._filename = journalFile(indexFile);
+      journal._detail = detail;
+      journal._headers = headers;
+      std::string temporary = journal._filename + ".tmp";
+      {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        stream.write(magic, sizeof(magic));
+        writeRecord(stream, Record::snapshot, pack(HeaderStamp::of(*snapshot), detail, headers));
+        if (!stream) {
+          return std::nullopt;
+        }
+      }
+      std::error_code error;
+      std::filesystem::rename(temporary, journal._filename, error);
+      if (error) {
+        return std::nullopt;
+      }
+      journal._size = std::filesystem::file_size(journal._filename, error);
+      journal._trimmed = true;
+      return journal;
+    }
+
+    // Every header in the index, with the version of it that's there
+    const HeaderManifest& headers() const { return _headers; }
+    // The --detail the index was made with
+    const std::string& detail() const { return _detail; }
+    // How big the journal is on disk
+    uint64_t size() const { return _size; }
+    // Replace and remove records since the snapshot
+    size_t records() const { return _records.size(); }
+
+    // What's in header now replaces whatever the index had from it
+    void replace(const std::string& header, const HeaderStamp& stamp, const HeaderIndex& found) {
+      append(Record::replace, pack(header, stamp, found.enums, found.classes));
+      _headers[header] = stamp;
+    }
+
+    // header's gone, so is everything it defined
+    void remove(const std::string& header) {
+      append(Record::remove, pack(header));
+      _headers.erase(header);
+    }
+
+    /**
+     * Plays the journal over the snapshot. Only the last record for
+     * each header matters, so everything from those headers comes out
+     * of the index in one pass and their latest versions go back in.
+     * If two headers define the same thing, the one that changed most
+     * recently wins, where a full index would have taken the one later
+     * on the command line.
+     */
+    void apply(Index& index) const {
+      std::vector<std::string> headers;
+      std::map<std::string, size_t> last;
+      for (size_t i = 0; i < _records.size(); ++i) {
+        headers.push_back(headerOf(_records[i].second));
+        last[headers.back()] = i;
+      }
+      if (last.empty()) {
+        return;
+      }
+      for (auto it = index.enums.begin(); it != index.enums.end();) {
+        if (last.count(it->second->definedIn)) {
+          index.hashes.erase(enumKey(it->first));
+          it = index.enums.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      for (auto it = index.classes.begin(); it != index.classes.end();) {
+        if (last.count(it->second->definedIn)) {
+          index.hashes.erase(classKey(it->first));
+          it = index.classes.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      for (size_t i = 0; i < _records.size(); ++i) {
+        if (last[headers[i]] != i || _records[i].first != Record::replace) {
+          continue;
+        }
+        std::istringstream stream(_records[i].second);
+        cereal::BinaryInputArchive archive(stream);
+        std::string name;
+        HeaderStamp stamp;
+        HeaderIndex found;
+        archive(name, stamp, found.enums, found.classes);
+        for (auto& [key, data] : found.enums) {
+          index.hashes[enumKey(key)] = entityHash(*data);
+          index.enums[key] = std::move(data);
+        }
+        for (auto& [key, data] : found.classes) {
+          index.hashes[classKey(key)] = entityHash(*data);
+          index.classes[key] = std::move(data);
+        }
+      }
+    }
+  };
+
+  /**
+   * An IndexCache source for indexes with a journal. Returns null if
+   * filename doesn't have one that goes with it, and the cache reads
+   * the plain JSON.
+   */
+  inline std::shared_ptr<Index> loadJournaledIndex(const std::string& filename, const FileStamp&) {
+    auto journal = IndexJournal::open(filename);
+    if (!journal) {
+      return nullptr;
+    }
+    auto index = std::make_shared<Index>();
+    index->load(filename);
+    journal->apply(*index);
+    return index;
+  }
+
+}
@@ -0,0 +1,646 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * What the code [[genJsonCodec]] generates needs at run time. The
+ * generated saveJson writes straight into a JsonWriter's buffer and
+ * the generated loadJson pulls fields out of a JsonReader one at a
+ * time, so there's no document tree and no iostreams in between like
+ * there is with cereal's JSON archives.
+ *
+ * You can read and write these members:
+ *  * bool, integers, floating point and enums (as their underlying number)
+ *  * std::string (std::string_view too, for writing)
+ *  * std::vector and std::optional of anything on this list
+ *  * Anything with its own saveJson/loadJson
+ *
+ * NaN and infinity don't exist in JSON, so they get written as null,
+ * and null reads back into a double as NaN.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fr::codegen::json {
+
+  /**
+   * Hash the generated loadJson switches on to find a field. The
+   * generator picks a seed that gives every field of the class its own
+   * slot, so one compare is all it takes to check a name.
+   */
+  constexpr uint32_t fieldHash(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+  }
+
+  /**
+   * A seed and table size (as a mask) for which fieldHash doesn't
+   * collide on any of names. Starts with the smallest power of two
+   * table that fits them all and goes bigger if no seed turns up.
+   */
+  struct FieldTable {
+    uint32_t seed = 0;
+    uint32_t mask = 0;
+  };
+
+  inline FieldTable perfectHash(const std::vector<std::string>& names) {
+    uint32_t size = 1;
+    while (size < names.size()) {
+      size <<= 1;
+    }
+    for (;; size <<= 1) {
+      std::vector<bool> used(size);
+      for (uint32_t seed = 0; seed < 4096; ++seed) {
+        std::fill(used.begin(), used.end(), false);
+        bool collided = false;
+        for (const auto& name : names) {
+          uint32_t slot = fieldHash(name, seed) & (size - 1);
+          if (used[slot]) {
+            collided = true;
+            break;
+          }
+          used[slot] = true;
+        }
+        if (!collided) {
+          return {seed, size - 1};
+        }
+      }
+    }
+  }
+
+  namespace detail {
+
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    constexpr uint64_t highs = 0x8080808080808080ull;
+
+    // Sets the high bit of the bytes of word that are zero (and maybe
+    // some after the first one, which we don't care about)
+    constexpr uint64_t zeroBytes(uint64_t word) {
+      return (word - ones) & ~word & highs;
+    }
+
+    /**
+     * Where the next quote or backslash (or control character, if controls
+     * is set) is in text, starting at from. This checks 8 bytes at a
+     * time, since most strings don't have anything in them that needs
+     * escaping and it's nice to get past them quickly.
+     */
+    inline size_t plainRun(std::string_view text, size_t from, bool controls) {
+      auto special = [controls](unsigned char c) {
+        return c == '"' || c == '\\' || (controls && c < 0x20);
+      };
+      size_t i = from;
+      for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        uint64_t found = zeroBytes(word ^ (ones * '"')) | zeroBytes(word ^ (ones * '\\'));
+        if (controls) {
+          found |= (word - ones * 0x20) & ~word & highs;
+        }
+        if (found) {
+          break;
+        }
+      }
+      while (i < text.size() && !special(text[i])) {
+        ++i;
+      }
+      return i;
+    }
+
+  }
+
+  class JsonWriter;
+  class JsonReader;
+
+  template <typename T>
+  concept JsonSaveable = requires(const T& t, JsonWriter& writer) {
+    t.saveJson(writer);
+  };
+
+  template <typename T>
+  concept JsonLoadable = requires(T& t, JsonReader& reader) {
+    t.loadJson(reader);
+  };
+
+  /**
+   * Appends JSON to a string that grows as it needs to. Keep one
+   * around and clear() it between objects to reuse the buffer.
+   */
+  class JsonWriter {
+    std::string _buffer;
+    bool _needComma = false;
+
+    void separate() {
+      if (_needComma) {
+        _buffer.push_back(',');
+      }
+    }
+
+    void string(std::string_view text) {
+      static constexpr char hex[] = "0123456789abcdef";
+      _buffer.push_back('"');
+      size_t start = 0;
+      while (true) {
+        size_t i = detail::plainRun(text, start, true);
+        _buffer.append(text.data() + start, i - start);
+        if (i == text.size()) {
+          break;
+        }
+        unsigned char c = text[i];
+        start = i + 1;
+        switch (c) {
+        case '"': _buffer.append("\\\""); break;
+        case '\\': _buffer.append("\\\\"); break;
+        case '\n': _buffer.append("\\n"); break;
+        case '\r': _buffer.append("\\r"); break;
+        case '\t': _buffer.append("\\t"); break;
+        case '\b': _buffer.append("\\b"); break;
+        case '\f': _buffer.append("\\f"); break;
+        default:
+          _buffer.append("\\u00");
+          _buffer.push_back(hex[c >> 4]);
+          _buffer.push_back(hex[c & 0xf]);
+        }
+      }
+      _buffer.push_back('"');
+    }
+
+    template <typename T>
+    void number(T value) {
+      char digits[64];
+      auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+      _buffer.append(digits, end);
+    }
+
+  public:
+    JsonWriter(size_t reserve = 256) {
+      _buffer.reserve(reserve);
+    }
+
+    void beginObject() {
+      separate();
+      _buffer.push_back('{');
+      _needComma = false;
+    }
+
+    void endObject() {
+      _buffer.push_back('}');
+      _needComma = true;
+    }
+
+    void beginArray() {
+      separate();
+      _buffer.push_back('[');
+      _needComma = false;
+    }
+
+    void endArray() {
+      _buffer.push_back(']');
+      _needComma = true;
+    }
+
+    void key(std::string_view name) {
+      separate();
+      string(name);
+      _buffer.push_back(':');
+      _needComma = false;
+    }
+
+    void null() {
+      separate();
+      _buffer.append("null");
+      _needComma = true;
+    }
+
+    void value(bool b) {
+      separate();
+      _buffer.append(b ? "true" : "false");
+      _needComma = true;
+    }
+
+    template <typename T>
+      requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    void value(T number) {
+      if constexpr (std::is_floating_point_v<T>) {
+        if (number != number || number - number != 0) {
+          null();
+          return;
+        }
+      }
+      separate();
+      this->number(number);
+      _needComma = true;
+    }
+
+    template <typename T>
+      requires std::is_enum_v<T>
+    void value(T e) {
+      value(static_cast<std::underlying_type_t<T>>(e));
+    }
+
+    void value(std::string_view text) {
+      separate();
+      string(text);
+      _needComma = true;
+    }
+
+    void value(const std::string& text) {
+      value(std::string_view(text));
+    }
+
+    void value(const char* text) {
+      value(std::string_view(text));
+    }
+
+    template <typename T>
+    void value(const std::vector<T>& values) {
+      beginArray();
+      for (const auto& v : values) {
+        value(v);
+      }
+      endArray();
+    }
+
+    template <typename T>
+    void value(const std::optional<T>& maybe) {
+      if (maybe) {
+        value(*maybe);
+      } else {
+        null();
+      }
+    }
+
+    template <JsonSaveable T>
+    void value(const T& object) {
+      object.saveJson(*this);
+    }
+
+    template <typename T>
+    void field(std::string_view name, const T& v) {
+      key(name);
+      value(v);
+    }
+
+    std::string_view view() const {
+      return _buffer;
+    }
+
+    std::string take() {
+      _needComma = false;
+      return std::move(_buffer);
+    }
+
+    void clear() {
+      _buffer.clear();
+      _needComma = false;
+    }
+  };
+
+  class JsonError : public std::runtime_error {
+  public:
+    JsonError(const std::string& what, size_t position) :
+      std::runtime_error(what + " at offset " + std::to_string(position)) {}
+  };
+
+  /**
+   * Pulls values out of a JSON document as you ask for them. Nothing
+   * gets copied unless you read it into something, and anything you
+   * don't ask for gets skipped. The text has to outlive the reader.
+   */
+  class JsonReader {
+    std::string_view _text;
+    size_t _position = 0;
+    bool _first = true;
+    // Keys with escapes in them get unescaped into here
+    std::string _key;
+
+    [[noreturn]] void fail(const std::string& what) const {
+      throw JsonError(what, _position);
+    }
+
+    void whitespace() {
+      while (_position < _text.size()) {
+        char c = _text[_position];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+          break;
+        }
+        ++_position;
+      }
+    }
+
+    char peek() {
+      whitespace();
+      if (_position >= _text.size()) {
+        fail("Unexpected end of JSON");
+      }
+      return _text[_position];
+    }
+
+    void expect(char c) {
+      if (peek() != c) {
+        fail(std::string("Expected '") + c + "'");
+      }
+      ++_position;
+    }
+
+    bool literal(std::string_view word) {
+      if (_text.substr(_position, word.size()) == word) {
+        _position += word.size();
+        return true;
+      }
+      return false;
+    }
+
+    unsigned hex4() {
+      if (_position + 4 > _text.size()) {
+        fail("Short \\u escape");
+      }
+      unsigned code = 0;
+      auto [end, error] = std::from_chars(_text.data() + _position, _text.data() + _position + 4, code, 16);
+      if (error != std::errc() || end != _text.data() + _position + 4) {
+        fail("Bad \\u escape");
+      }
+      _position += 4;
+      return code;
+    }
+
+    static void utf8(std::string& out, unsigned code) {
+      if (code < 0x80) {
+        out.push_back(code);
+      } else if (code < 0x800) {
+        out.push_back(0xc0 | (code >> 6));
+        out.push_back(0x80 | (code & 0x3f));
+      } else if (code < 0x10000) {
+        out.push_back(0xe0 | (code >> 12));
+        out.push_back(0x80 | ((code >> 6) & 0x3f));
+        out.push_back(0x80 | (code & 0x3f));
+      } else {
+        out.push_back(0xf0 | (code >> 18));
+        out.push_back(0x80 | ((code >> 12) & 0x3f));
+        out.push_back(0x80 | ((code >> 6) & 0x3f));
+        out.push_back(0x80 | (code & 0x3f));
+      }
+    }
+
+    // Reads a string into out, or just skips it if out is null.
+    // Runs without escapes get appended in one go.
+    void string(std::string* out) {
+      expect('"');
+      while (true) {
+        size_t start = _position;
+        _position = detail::plainRun(_text, _position, false);
+        if (_position >= _text.size()) {
+          fail("Unterminated string");
+        }
+        if (out) {
+          out->append(_text.data() + start, _position - start);
+        }
+        if (_text[_position++] == '"') {
+          return;
+        }
+        if (_position >= _text.size()) {
+          fail("Unterminated string");
+        }
+        char escaped = _text[_position++];
+        char c;
+        switch (escaped) {
+        case '"': c = '"'; break;
+        case '\\': c = '\\'; break;
+        case '/': c = '/'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          unsigned code = hex4();
+          if (code >= 0xd800 && code < 0xdc00 && literal("\\u")) {
+            unsigned low = hex4();
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+          }
+          if (out) {
+            utf8(*out, code);
+          }
+          continue;
+        }
+        default:
+          fail("Bad escape");
+        }
+        if (out) {
+          out->push_back(c);
+        }
+      }
+    }
+
+    // The extent of the number starting here
+    std::string_view numberText() {
+      whitespace();
+      size_t start = _position;
+      while (_position < _text.size() && _text[_position] && std::strchr("+-0123456789.eE", _text[_position])) {
+        ++_position;
+      }
+      if (start == _position) {
+        fail("Expected a number");
+      }
+      return _text.substr(start, _position - start);
+    }
+
+  public:
+    JsonReader(std::string_view text) : _text(text) {}
+
+    void beginObject() {
+      expect('{');
+      _first = true;
+    }
+
+    /**
+     * Moves on to the next key in the current object, and returns
+     * false when there aren't any more. You have to read or skip the
+     * value before asking for the next key. The key's only good until
+     * then too.
+     */
+    bool nextKey(std::string_view& key) {
+      if (peek() == '}') {
+        ++_position;
+        _first = false;
+        return false;
+      }
+      if (!_first) {
+        expect(',');
+      }
+      _first = false;
+      expect('"');
+      size_t start = _position;
+      _position = detail::plainRun(_text, _position, false);
+      if (_position < _text.size() && _text[_position] == '"') {
+        key = _text.substr(start, _position - start);
+        ++_position;
+      } else {
+        _position = start - 1;
+        _key.clear();
+        string(&_key);
+        key = _key;
+      }
+      expect(':');
+      return true;
+    }
+
+    void beginArray() {
+      expect('[');
+      _first = true;
+    }
+
+    // Like nextKey, but for arrays
+    bool nextElement() {
+      if (peek() == ']') {
+        ++_position;
+        _first = false;
+        return false;
+      }
+      if (!_first) {
+        expect(',');
+      }
+      _first = false;
+      return true;
+    }
+
+    // True (and eats it) if the next value is null
+    bool null() {
+      peek();
+      return literal("null");
+    }
+
+    void read(bool& b) {
+      peek();
+      if (literal("true")) {
+        b = true;
+      } else if (literal("false")) {
+        b = false;
+      } else {
+        fail("Expected true or false");
+      }
+    }
+
+    template <typename T>
+      requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    void read(T& number) {
+      if constexpr (std::is_floating_point_v<T>) {
+        if (null()) {
+          number = std::numeric_limits<T>::quiet_NaN();
+          return;
+        }
+      }
+      auto text = numberText();
+      // from_chars doesn't take a leading +, which JSON doesn't allow anyway
+      auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+      if (error != std::errc() || end != text.data() + text.size()) {
+        fail("Bad number " + std::string(text));
+      }
+    }
+
+    template <typename T>
+      requires std::is_enum_v<T>
+    void read(T& e) {
+      std::underlying_type_t<T> number;
+      read(number);
+      e = static_cast<T>(number);
+    }
+
+    void read(std::string& text) {
+      text.clear();
+      string(&text);
+    }
+
+    template <typename T>
+    void read(std::vector<T>& values) {
+      values.clear();
+      beginArray();
+      while (nextElement()) {
+        read(values.emplace_back());
+      }
+    }
+
+    template <typename T>
+    void read(std::optional<T>& maybe) {
+      if (null()) {
+        maybe.reset();
+      } else {
+        read(maybe.emplace());
+      }
+    }
+
+    template <JsonLoadable T>
+    void read(T& object) {
+      object.loadJson(*this);
+    }
+
+    // Skip whatever the next value is, however deep it goes
+    void skipValue() {
+      char c = peek();
+      if (c == '"') {
+        string(nullptr);
+      } else if (c == '{' || c == '[') {
+        size_t depth = 0;
+        do {
+          c = peek();
+          if (c == '"') {
+            string(nullptr);
+            continue;
+          }
+          if (c == '{' || c == '[') {
+            ++depth;
+          } else if (c == '}' || c == ']') {
+            --depth;
+          }
+          ++_position;
+        } while (depth > 0);
+        _first = false;
+      } else if (!literal("true") && !literal("false") && !literal("null")) {
+        numberText();
+      }
+    }
+  };
+
+  // Whole objects to and from strings, for anything with generated codecs
+
+  template <JsonSaveable T>
+  std::string toJson(const T& object) {
+    JsonWriter writer;
+    object.saveJson(writer);
+    return writer.take();
+  }
+
+  template <JsonLoadable T>
+  void fromJson(T& object, std::string_view text) {
+    JsonReader reader(text);
+    object.loadJson(reader);
+  }
+
+}
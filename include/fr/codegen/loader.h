@@ -0,0 +1,513 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Reads a bunch of files in the background and hands them over as
+ * they come in, so IndexCode can parse one header while the next
+ * few are still being read. On Linux this batches the opens and
+ * reads up with io_uring, and everywhere else (or if the kernel
+ * won't give us a ring) a few threads do it with pread.
+ *
+ * io_uring is talked to with the raw system calls rather than
+ * liburing, so there's nothing extra to install. Configure with
+ * -DFR_CODEGEN_IO_URING=OFF if you don't want it at all.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <fr/codegen/trace.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>) && !defined(FR_CODEGEN_NO_IO_URING)
+#define FR_CODEGEN_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace fr::codegen {
+
+  enum class ReadBackend {
+    // io_uring if we can get a ring, threads if we can't
+    automatic,
+    uring,
+    threads
+  };
+
+  /**
+   * A file the loader read. id is where it was in the list you gave
+   * the loader, and error is an errno if we couldn't read it, in
+   * which case contents is empty.
+   */
+  struct LoadedFile {
+    size_t id = 0;
+    std::string filename;
+    std::string contents;
+    int error = 0;
+  };
+
+#ifdef FR_CODEGEN_HAVE_IO_URING
+
+  /**
+   * Just enough of an io_uring to submit some operations and reap
+   * what comes back. Only one thread uses a ring.
+   */
+  class IoRing {
+    int _fd = -1;
+    unsigned _entries = 0;
+    void* _sqRing = MAP_FAILED;
+    void* _cqRing = MAP_FAILED;
+    size_t _sqRingSize = 0;
+    size_t _cqRingSize = 0;
+    io_uring_sqe* _sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t _sqesSize = 0;
+    unsigned* _sqHead = nullptr;
+    unsigned* _sqTail = nullptr;
+    unsigned* _sqMask = nullptr;
+    unsigned* _sqArray = nullptr;
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned* _cqMask = nullptr;
+    io_uring_cqe* _cqes = nullptr;
+    // Entries we've filled in but haven't told the kernel about
+    unsigned _queued = 0;
+
+    template <typename T>
+    static T* at(void* base, uint32_t offset) {
+      return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+  public:
+    IoRing(unsigned entries) {
+      io_uring_params params{};
+      _fd = syscall(__NR_io_uring_setup, entries, &params);
+      if (_fd < 0) {
+        return;
+      }
+      _entries = params.sq_entries;
+      _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+      if (singleMap) {
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+      }
+      _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+      if (_sqRing == MAP_FAILED) {
+        return;
+      }
+      if (singleMap) {
+        _cqRing = _sqRing;
+      } else {
+        _cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        if (_cqRing == MAP_FAILED) {
+          return;
+        }
+      }
+      _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      _sqes = static_cast<io_uring_sqe*>(mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+      if (_sqes == MAP_FAILED) {
+        return;
+      }
+      _sqHead = at<unsigned>(_sqRing, params.sq_off.head);
+      _sqTail = at<unsigned>(_sqRing, params.sq_off.tail);
+      _sqMask = at<unsigned>(_sqRing, params.sq_off.ring_mask);
+      _sqArray = at<unsigned>(_sqRing, params.sq_off.array);
+      _cqHead = at<unsigned>(_cqRing, params.cq_off.head);
+      _cqTail = at<unsigned>(_cqRing, params.cq_off.tail);
+      _cqMask = at<unsigned>(_cqRing, params.cq_off.ring_mask);
+      _cqes = at<io_uring_cqe>(_cqRing, params.cq_off.cqes);
+    }
+
+    ~IoRing() {
+      if (_sqes != MAP_FAILED) {
+        munmap(_sqes, _sqesSize);
+      }
+      if (_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingSize);
+      }
+      if (_sqRing != MAP_FAILED) {
+        munmap(_sqRing, _sqRingSize);
+      }
+      if (_fd >= 0) {
+        close(_fd);
+      }
+    }
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    bool ok() const {
+      return _fd >= 0 && _sqes != MAP_FAILED;
+    }
+
+    unsigned entries() const {
+      return _entries;
+    }
+
+    // Null if the submission queue's full
+    io_uring_sqe* get() {
+      unsigned head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+      unsigned tail = *_sqTail + _queued;
+      if (tail - head >= _entries) {
+        return nullptr;
+      }
+      unsigned slot = tail & *_sqMask;
+      io_uring_sqe* sqe = &_sqes[slot];
+      std::memset(sqe, 0, sizeof(*sqe));
+      _sqArray[slot] = slot;
+      _queued++;
+      return sqe;
+    }
+
+    // Hands everything queued to the kernel and waits for at least
+    // waitFor completions
+    int submit(unsigned waitFor) {
+      __atomic_store_n(_sqTail, *_sqTail + _queued, __ATOMIC_RELEASE);
+      unsigned count = _queued;
+      _queued = 0;
+      int ret;
+      do {
+        ret = syscall(__NR_io_uring_enter, _fd, count, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+      } while (ret < 0 && errno == EINTR);
+      return ret;
+    }
+
+    bool reap(io_uring_cqe& cqe) {
+      unsigned head = *_cqHead;
+      if (head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+      }
+      cqe = _cqes[head & *_cqMask];
+      __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+  };
+
+#endif
+
+  /**
+   * Loads files on background threads. Call next() to get them in
+   * whatever order they finish. At most depth of them sit around
+   * loaded waiting for you, so a slow consumer doesn't end up with
+   * the whole tree in memory.
+   */
+  class FileLoader {
+    std::vector<std::string> _files;
+    ReadBackend _backend;
+    size_t _depth;
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::condition_variable _space;
+    std::deque<LoadedFile> _loaded;
+    size_t _delivered = 0;
+    bool _stopping = false;
+
+    std::atomic<size_t> _nextFile{0};
+    std::vector<std::thread> _threads;
+
+    // Blocks while the queue's full. False if we're shutting down.
+    bool deliver(LoadedFile&& file) {
+      std::unique_lock lock(_mutex);
+      _space.wait(lock, [this]() { return _stopping || _loaded.size() < _depth; });
+      if (_stopping) {
+        return false;
+      }
+      _loaded.push_back(std::move(file));
+      _ready.notify_one();
+      return true;
+    }
+
+    static void readAll(LoadedFile& file) {
+      int fd = open(file.filename.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        file.error = errno;
+        return;
+      }
+      struct stat info;
+      if (fstat(fd, &info) < 0) {
+        file.error = errno;
+        close(fd);
+        return;
+      }
+      file.contents.resize(info.st_size);
+      size_t offset = 0;
+      while (offset < file.contents.size()) {
+        ssize_t got = pread(fd, file.contents.data() + offset, file.contents.size() - offset, offset);
+        if (got < 0 && errno == EINTR) {
+          continue;
+        }
+        if (got < 0) {
+          file.error = errno;
+          file.contents.clear();
+          break;
+        }
+        if (got == 0) {
+          // It got shorter while we were reading it
+          file.contents.resize(offset);
+          break;
+        }
+        offset += got;
+      }
+      close(fd);
+    }
+
+    void threadLoop() {
+      while (true) {
+        size_t id = _nextFile.fetch_add(1);
+        if (id >= _files.size()) {
+          return;
+        }
+        LoadedFile file;
+        file.id = id;
+        file.filename = _files[id];
+        {
+          trace::Span span("header", "read", file.filename);
+          readAll(file);
+        }
+        if (!deliver(std::move(file))) {
+          return;
+        }
+      }
+    }
+
+#ifdef FR_CODEGEN_HAVE_IO_URING
+
+    /**
+     * Keeps up to a ring's worth of files in flight. Each file gets
+     * an openat, then reads until we have all of it. Looking up the
+     * size in between is a plain fstat, since the open already pulled
+     * the inode in.
+     */
+    void uringLoop(IoRing& ring) {
+      enum Stage : uint64_t { opening = 0, reading = 1 };
+      struct InFlight {
+        LoadedFile file;
+        int fd = -1;
+        size_t offset = 0;
+        int64_t started = 0;
+      };
+      std::vector<InFlight> inFlight(_files.size());
+      std::vector<char> done(_files.size(), false);
+      size_t nextFile = 0;
+      size_t active = 0;
+
+      auto queueRead = [&ring](InFlight& entry, uint64_t id) {
+        io_uring_sqe* sqe = ring.get();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = entry.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(entry.file.contents.data() + entry.offset);
+        sqe->len = entry.file.contents.size() - entry.offset;
+        sqe->off = entry.offset;
+        sqe->user_data = (id << 1) | reading;
+      };
+
+      auto finish = [this, &active, &done](InFlight& entry) {
+        done[entry.file.id] = true;
+        if (entry.fd >= 0) {
+          close(entry.fd);
+          entry.fd = -1;
+        }
+        active--;
+        trace::complete("header", "read", entry.file.filename, entry.started, trace::now());
+        return deliver(std::move(entry.file));
+      };
+
+      while (nextFile < _files.size() || active > 0) {
+        // Every file in flight has at most one operation outstanding, so
+        // keeping active under the ring size means there's always room
+        // for the read that follows an open
+        while (nextFile < _files.size() && active < ring.entries()) {
+          io_uring_sqe* sqe = ring.get();
+          if (!sqe) {
+            break;
+          }
+          auto& entry = inFlight[nextFile];
+          entry.file.id = nextFile;
+          entry.file.filename = _files[nextFile];
+          entry.started = trace::enabled() ? trace::now() : 0;
+          sqe->opcode = IORING_OP_OPENAT;
+          sqe->fd = AT_FDCWD;
+          sqe->addr = reinterpret_cast<uint64_t>(_files[nextFile].c_str());
+          sqe->open_flags = O_RDONLY | O_CLOEXEC;
+          sqe->user_data = (static_cast<uint64_t>(nextFile) << 1) | opening;
+          nextFile++;
+          active++;
+        }
+        if (ring.submit(1) < 0) {
+          // The ring broke somehow. Read whatever's left the slow way.
+          for (size_t id = 0; id < _files.size(); ++id) {
+            if (inFlight[id].fd >= 0) {
+              close(inFlight[id].fd);
+            }
+            if (done[id]) {
+              continue;
+            }
+            LoadedFile file;
+            file.id = id;
+            file.filename = _files[id];
+            readAll(file);
+            if (!deliver(std::move(file))) {
+              return;
+            }
+          }
+          return;
+        }
+        io_uring_cqe cqe;
+        while (ring.reap(cqe)) {
+          uint64_t id = cqe.user_data >> 1;
+          auto& entry = inFlight[id];
+          if ((cqe.user_data & 1) == opening) {
+            if (cqe.res < 0) {
+              entry.file.error = -cqe.res;
+              if (!finish(entry)) {
+                return;
+              }
+              continue;
+            }
+            entry.fd = cqe.res;
+            struct stat info;
+            if (fstat(entry.fd, &info) < 0) {
+              entry.file.error = errno;
+              if (!finish(entry)) {
+                return;
+              }
+              continue;
+            }
+            entry.file.contents.resize(info.st_size);
+            if (entry.file.contents.empty()) {
+              if (!finish(entry)) {
+                return;
+              }
+              continue;
+            }
+            queueRead(entry, id);
+          } else {
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+              queueRead(entry, id);
+              continue;
+            }
+            if (cqe.res < 0) {
+              entry.file.error = -cqe.res;
+              entry.file.contents.clear();
+            } else if (cqe.res == 0) {
+              entry.file.contents.resize(entry.offset);
+            } else {
+              entry.offset += cqe.res;
+              if (entry.offset < entry.file.contents.size()) {
+                queueRead(entry, id);
+                continue;
+              }
+            }
+            if (!finish(entry)) {
+              return;
+            }
+          }
+        }
+      }
+    }
+
+#endif
+
+  public:
+    /**
+     * threads is how many threads read files if we're not using
+     * io_uring, and depth is how many loaded files can be waiting for
+     * you (and how many io_uring keeps in flight.)
+     */
+    FileLoader(const std::vector<std::string>& files, ReadBackend backend = ReadBackend::automatic,
+               size_t threads = 4, size_t depth = 64)
+      : _files(files), _backend(ReadBackend::threads), _depth(std::max<size_t>(depth, 1)) {
+      if (_files.empty()) {
+        return;
+      }
+#ifdef FR_CODEGEN_HAVE_IO_URING
+      if (backend != ReadBackend::threads) {
+        auto ring = std::make_shared<IoRing>(static_cast<unsigned>(std::min<size_t>(_depth, 256)));
+        if (ring->ok()) {
+          _backend = ReadBackend::uring;
+          _threads.emplace_back([this, ring]() { uringLoop(*ring); });
+          return;
+        }
+      }
+#endif
+      threads = std::clamp<size_t>(threads, 1, _files.size());
+      for (size_t i = 0; i < threads; ++i) {
+        _threads.emplace_back([this]() { threadLoop(); });
+      }
+    }
+
+    ~FileLoader() {
+      {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+      }
+      _space.notify_all();
+      for (auto& thread : _threads) {
+        thread.join();
+      }
+    }
+
+    FileLoader(const FileLoader&) = delete;
+    FileLoader& operator=(const FileLoader&) = delete;
+
+    // What we ended up reading with
+    ReadBackend backend() const {
+      return _backend;
+    }
+
+    static bool uringAvailable() {
+#ifdef FR_CODEGEN_HAVE_IO_URING
+      return IoRing(1).ok();
+#else
+      return false;
+#endif
+    }
+
+    /**
+     * Waits for the next file to finish loading. Once you've had them
+     * all, you get nothing.
+     */
+    std::optional<LoadedFile> next() {
+      std::unique_lock lock(_mutex);
+      if (_delivered == _files.size()) {
+        return std::nullopt;
+      }
+      _ready.wait(lock, [this]() { return !_loaded.empty(); });
+      LoadedFile file = std::move(_loaded.front());
+      _loaded.pop_front();
+      _delivered++;
+      _space.notify_one();
+      return file;
+    }
+  };
+
+}
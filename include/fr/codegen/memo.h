@@ -0,0 +1,153 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Packrat memoization for x3. Wrap a parser in memo[] and the first
+ * time it's tried at a position, whether it matched and where it
+ * ended up get written down. The next time anything tries it at that
+ * position, it gets the answer out of the table instead of parsing
+ * it again. A grammar whose alternatives keep backing up and
+ * reparsing the same thing then parses each position at most once
+ * per memoized rule.
+ *
+ * The table comes in through the context, so it's opt-in per parse:
+ *
+ *   MemoTable<Iterator> table(first);
+ *   x3::phrase_parse(first, last, x3::with<MemoTag>(&table)[grammar], skipper);
+ *
+ * Without one (or with a null one) memo[] just runs its subject. Only
+ * wrap things without semantic actions, since a hit doesn't run the
+ * subject and its actions won't fire. memo[] doesn't have an
+ * attribute either.
+ */
+
+#pragma once
+
+#include <boost/spirit/home/x3.hpp>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+
+namespace fr::codegen::parser {
+
+  namespace x3 = boost::spirit::x3;
+
+  // What x3::with hands memo[] the table under
+  struct MemoTag;
+
+  template <typename Iterator>
+  class MemoTable {
+  public:
+    struct Entry {
+      bool matched;
+      Iterator end;
+    };
+
+  private:
+    struct Key {
+      const void* rule;
+      size_t offset;
+
+      bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& key) const {
+        return std::hash<const void*>()(key.rule) ^ (key.offset * 0x9e3779b97f4a7c15ull);
+      }
+    };
+
+    Iterator _begin;
+    std::unordered_map<Key, Entry, KeyHash> _entries;
+
+  public:
+    // Answers that came out of the table, and ones that had to be parsed
+    size_t hits = 0;
+    size_t misses = 0;
+
+    // begin is where the parse starts, positions are kept as offsets from it
+    explicit MemoTable(Iterator begin) : _begin(begin) {}
+
+    const Entry* find(const void* rule, Iterator at) const {
+      auto found = _entries.find(Key{rule, static_cast<size_t>(std::distance(_begin, at))});
+      return found == _entries.end() ? nullptr : &found->second;
+    }
+
+    void store(const void* rule, Iterator at, bool matched, Iterator end) {
+      _entries[Key{rule, static_cast<size_t>(std::distance(_begin, at))}] = Entry{matched, end};
+    }
+
+    size_t size() const {
+      return _entries.size();
+    }
+  };
+
+  namespace detail {
+
+    // One address per memoized parser and skipper, which is the rule
+    // half of the key. The same rule parses differently with and
+    // without a skipper, so they get separate entries.
+    template <typename Subject, typename Skipper>
+    inline constexpr char memoId = 0;
+
+  }
+
+  template <typename Subject>
+  struct MemoParser : x3::unary_parser<Subject, MemoParser<Subject>> {
+    using base_type = x3::unary_parser<Subject, MemoParser<Subject>>;
+    using attribute_type = x3::unused_type;
+    static bool const has_attribute = false;
+
+    constexpr MemoParser(Subject const& subject) : base_type(subject) {}
+
+    template <typename Iterator, typename Context, typename RContext, typename Attribute>
+    bool parse(Iterator& first, Iterator const& last, Context const& context, RContext& rcontext, Attribute&) const {
+      using Table = std::decay_t<decltype(x3::get<MemoTag>(context))>;
+      if constexpr (!std::is_same_v<Table, MemoTable<Iterator>*>) {
+        return this->subject.parse(first, last, context, rcontext, x3::unused);
+      } else {
+        MemoTable<Iterator>* table = x3::get<MemoTag>(context);
+        if (!table) {
+          return this->subject.parse(first, last, context, rcontext, x3::unused);
+        }
+        using Skipper = std::decay_t<decltype(x3::get<x3::skipper_tag>(context))>;
+        const void* rule = &detail::memoId<Subject, Skipper>;
+        if (auto entry = table->find(rule, first)) {
+          ++table->hits;
+          if (entry->matched) {
+            first = entry->end;
+          }
+          return entry->matched;
+        }
+        ++table->misses;
+        Iterator start = first;
+        bool matched = this->subject.parse(first, last, context, rcontext, x3::unused);
+        table->store(rule, start, matched, first);
+        return matched;
+      }
+    }
+  };
+
+  struct MemoGen {
+    template <typename Subject>
+    constexpr MemoParser<typename x3::extension::as_parser<Subject>::value_type> operator[](Subject const& subject) const {
+      return {x3::as_parser(subject)};
+    }
+  };
+
+  inline constexpr MemoGen memo = MemoGen();
+
+}
@@ -20,6 +20,8 @@
 
 #include <boost/signals2.hpp>
 #include <boost/spirit/home/x3.hpp>
+#include <fr/codegen/memo.h>
+#include <fr/codegen/skipper.h>
 #include <string>
 #include <vector>
 
@@ -27,7 +29,8 @@ namespace fr::codegen::parser {
 
   namespace x3 = boost::spirit::x3;
 
-  // Ignore rules for comments
+  // Ignore rules for comments. The parser skips with the Skipper in
+  // skipper.h, which skips the same things these do a lot faster.
 
   x3::rule<class SingleLineComment> const singleLineComment = "singleline_comment";
   auto const singleLineComment_def =
@@ -113,16 +116,23 @@ namespace fr::codegen::parser {
 
   x3::rule<class TemplateGuts> const templateGuts = "template_guts";
   auto const templateGuts_def = x3::lexeme[x3::char_("<") >>
-       *(x3::char_ - x3::char_("<>")) >> *templateGuts | x3::char_(">")];
+       *(x3::char_ - x3::char_("<>")) >> *memo[templateGuts] | x3::char_(">")];
 
   // Ignore the next scope and all the scopes inside it
   x3::rule<class IgnoreScopes> const ignoreScopes = "ignore_scopes";
   auto const ignoreScopes_def =
     x3::lexeme[x3::char_('{') >>
-               *((x3::char_ - x3::char_("{}")) >> *ignoreScopes) >>
+               *((x3::char_ - x3::char_("{}")) | memo[ignoreScopes]) >>
                x3::char_("}")];
   
-  BOOST_SPIRIT_DEFINE(pragmaKeyword, includeKeyword, templateGuts, ignoreScopes);
+  // Ignore a parameter list and any parentheses inside it
+  x3::rule<class IgnoreParameters> const ignoreParameters = "ignore_parameters";
+  auto const ignoreParameters_def =
+    x3::lexeme[x3::char_('(') >>
+               *((x3::char_ - x3::char_("()")) | memo[ignoreParameters]) >>
+               x3::char_(')')];
+  
+  BOOST_SPIRIT_DEFINE(pragmaKeyword, includeKeyword, templateGuts, ignoreScopes, ignoreParameters);
   
   // Identifier
 
@@ -134,6 +144,14 @@ namespace fr::codegen::parser {
   auto const enhancedIdentifier_def = x3::lexeme[(x3::alpha | x3::char_('_')) >> *(x3::alnum | x3::char_("_<>:&*"))];
 
   BOOST_SPIRIT_DEFINE(identifier, enhancedIdentifier);
+
+  // Fixed underlying type of an enum, the "unsigned int" in
+  // enum class Foo : unsigned int {. Raw will hand us the whitespace
+  // between words (and possibly some after), so the action trims it.
+  x3::rule<class EnumUnderlyingType, std::string> const enumUnderlyingType = "enum_underlying_type";
+  auto const enumUnderlyingType_def = x3::raw[+enhancedIdentifier];
+
+  BOOST_SPIRIT_DEFINE(enumUnderlyingType);
   
   // Scope stuff
 
@@ -145,6 +163,19 @@ namespace fr::codegen::parser {
 
   BOOST_SPIRIT_DEFINE(scopePush, scopePop);
 
+  // How much the parser digs out of a header. Everything you don't ask
+  // for gets skipped over without firing any signals, which makes for
+  // a smaller index and a quicker parse.
+  //  enums - Just enums. Class bodies get skipped whole.
+  //  members - Enums, classes, parents and members, but no methods.
+  //            Parameter lists get skipped without being looked at.
+  //  full - Everything, including methods and their parameters.
+  enum class IndexDetail {
+    enums,
+    members,
+    full
+  };
+
   // Driver for parsing. This exposes some boost signal callbacks you can
   // subscribe to be provided information about what the parser is collecting.
 
@@ -175,6 +206,9 @@ namespace fr::codegen::parser {
     // name we just parsed. It would easy to extend this to include the
     // value as well, but I'm not doing anything with those currently    
     boost::signals2::signal<void(const std::string&, const std::string&)> enumIdentifier;
+    // Called after enumPush or enumClassPush if the enum declares a fixed
+    // underlying type. The parameter is the type, as written.
+    boost::signals2::signal<void(const std::string&)> enumUnderlyingTypeFound;
     // Called when we encounter a non-template class declaration. The
     // callback parameters are the class name and the current scope depth.
     boost::signals2::signal<void(const std::string&, int)> classPush;
@@ -203,6 +237,16 @@ namespace fr::codegen::parser {
     // We encountered an annotation - parameter passed in is the annotation we encountered
     boost::signals2::signal<void(const std::string&)> annotationFound;
 
+    // What to look for. Set this before calling parse.
+    IndexDetail detail = IndexDetail::full;
+
+    // Remember where the skipped scopes, parameter lists and template
+    // guts ended at each position, so backing out of an alternative
+    // doesn't skip over them all over again. See memo.h. The grammar
+    // doesn't back up far enough for this to pay for itself on
+    // ordinary headers, so it's off unless you ask.
+    bool memoize = false;
+
     // Some things to track keywords inside a class. These will be set/reset
     // when we run across things like "const", "static", "virtual" or "override"
     bool inClassConst;
@@ -228,7 +272,6 @@ namespace fr::codegen::parser {
       inClassConst = false;
       inClassStatic = false;
       inClassVirtual = false;
-      inClassStruct;
       inClassEnhancedIdentifier = "";
       inClassIdentifier = "";
     }
@@ -250,6 +293,7 @@ namespace fr::codegen::parser {
     template <typename Iterator>
     bool parse(Iterator first, Iterator last, std::string& result) {
       int scopeDepth = 0;
+      inClassStruct = false;
       resetInClassFlags();
       resetParameterFlags();
       resetDestructorFlag();
@@ -300,16 +344,29 @@ namespace fr::codegen::parser {
 	x3::_attr(ctx) = "";
       };
 
+      auto handleEnumUnderlyingType = [&](auto& ctx) {
+        std::string type = x3::_attr(ctx);
+        auto first = type.find_first_not_of(" \t\r\n");
+        auto last = type.find_last_not_of(" \t\r\n");
+        if (first != std::string::npos) {
+          enumUnderlyingTypeFound(type.substr(first, last - first + 1));
+        }
+        x3::_attr(ctx) = "";
+      };
+
       auto handleClassPush = [&](auto& ctx) {
         if (!inClassStruct) {
           classPush(x3::_attr(ctx), scopeDepth);
         } else {
           structPush(x3::_attr(ctx), scopeDepth);
         }
+        // Used up, so a class nested in a struct is still a class
+        inClassStruct = false;
 	x3::_attr(ctx) = "";
       };
 
       auto handleClassPop = [&]() {
+        inClassStruct = false;
 	classPop();
       };
 
@@ -367,14 +424,20 @@ namespace fr::codegen::parser {
 	resetInClassFlags();
       };
 
+      // The grammar still has to recognize methods to get past them, it
+      // just doesn't tell anyone about them below full detail
       auto handleMethodFound = [&](){
-	methodFound(inClassConst, inClassStatic, inClassVirtual, inClassEnhancedIdentifier, inClassIdentifier);
+        if (detail == IndexDetail::full) {
+          methodFound(inClassConst, inClassStatic, inClassVirtual, inClassEnhancedIdentifier, inClassIdentifier);
+        }
 	resetInClassFlags();
       };
 
       auto handleConstructorDestructor = [&](){
-        std::string cd = (destructorFlag ? std::string("destructor") : std::string("constructor"));
-        methodFound(inClassConst, inClassStatic, inClassVirtual, cd, cd);
+        if (detail == IndexDetail::full) {
+          std::string cd = (destructorFlag ? std::string("destructor") : std::string("constructor"));
+          methodFound(inClassConst, inClassStatic, inClassVirtual, cd, cd);
+        }
         resetInClassFlags();
         resetDestructorFlag();
       };
@@ -430,6 +493,7 @@ namespace fr::codegen::parser {
       auto const enumGrammar =
 	enumKeyword >> !classKeyword >> 
 	identifier [ handleEnumPush ] >>
+	-(x3::lit(":") >> enumUnderlyingType [ handleEnumUnderlyingType ]) >>
 	scopePush [ handleScopePush ] >>
 	// We are now in the enum scope, where we set up identifiers and optionally
 	// assign them to values
@@ -440,6 +504,7 @@ namespace fr::codegen::parser {
 	enumKeyword >>
 	classKeyword >>
 	identifier [ handleEnumClassPush ] >>
+	-(x3::lit(":") >> enumUnderlyingType [ handleEnumUnderlyingType ]) >>
 	scopePush [ handleScopePush ] >>
 	*(identifier [ handleEnumIdentifier ] >> -(x3::lit("=") >> +x3::alnum) >> -(x3::lit(","))) >>
 	scopePop [ handleScopePop ] >>
@@ -451,7 +516,7 @@ namespace fr::codegen::parser {
       // more complex things, but I'll try to handle what I can.
       auto const templateClassGrammar =
 	templateKeyword >>
-	templateGuts >>
+	memo[templateGuts] >>
 	(classKeyword | structKeyword) >>
 	identifier >>
 	// Don't want to trigger a scope push here
@@ -478,16 +543,21 @@ namespace fr::codegen::parser {
 	enhancedIdentifier [handleInClassEnhancedIdentifier] >>
 	identifier [handleInClassIdentifier];
 
-      // Simply eat everything in the parameter list. It wouldn't be terribly difficult
-      // to parse out, I just don't particualrly need it for anything.
-      auto const parameterGrammar = x3::char_('(') >>
-        *(-constKeyword [handleParameterTypeConst] >>
-          enhancedIdentifier [handleParameterType] >>
-          -constKeyword [handleParameterNameConst] >>
-          enhancedIdentifier [handleParameterFound] >>
-          -x3::char_(',')
-          ) >>
-        x3::char_(')');
+      // Pick the parameters out of a parameter list. Below full detail
+      // nobody wants them, so we just skip to the matching parenthesis.
+      // The eps checks are decided when the grammar gets put together,
+      // so only one side of the alternative is ever tried.
+      auto const parameterGrammar =
+        x3::omit[x3::eps(detail == IndexDetail::full) >>
+         x3::char_('(') >>
+         *(-constKeyword [handleParameterTypeConst] >>
+           enhancedIdentifier [handleParameterType] >>
+           -constKeyword [handleParameterNameConst] >>
+           enhancedIdentifier [handleParameterFound] >>
+           -x3::char_(',')
+           ) >>
+         x3::char_(')')] |
+        x3::omit[x3::eps(detail != IndexDetail::full) >> memo[ignoreParameters]];
 
       auto const ignoreUsing = x3::lit("using") >> *(x3::char_ - x3::char_(';')) >> x3::char_(';');
       
@@ -499,7 +569,7 @@ namespace fr::codegen::parser {
         identifier >>
         parameterGrammar [handleConstructorDestructor] >>
         *(initializerList |
-          ignoreScopes |
+          memo[ignoreScopes] |
           defaultMethod |
           x3::char_(';'));
 
@@ -510,9 +580,9 @@ namespace fr::codegen::parser {
              parameterGrammar  >>
              *(overrideKeyword [handleVirtualMember] |
                constKeyword [handleConstMember]) >>
-             -(x3::char_(';') | ignoreScopes)[handleMethodFound]);
+             -(x3::char_(';') | memo[ignoreScopes])[handleMethodFound]);
         
-      auto const classGrammar =
+      auto const indexedClassGrammar =
         *annotation [handleAnnotation] >>
         (classKeyword | structKeyword [handleStructKeyword]) >>
 	identifier [handleClassPush] >>
@@ -524,13 +594,27 @@ namespace fr::codegen::parser {
            annotation [handleAnnotation] |
            constructorDestructor |
            ignoreUsing |
-           (templateKeyword >> templateGuts) |
+           (templateKeyword >> memo[templateGuts]) |
 	   (publicKeyword [handlePublicInClass] >> x3::lit(":")) |
 	   (protectedKeyword [handleProtectedInClass] >> x3::lit(":")) |
 	   (privateKeyword [handlePrivateInClass] >> x3::lit(":")) |          
 	   methodOrMember
 	   ) >>
 	x3::lit("};") [handleClassPop];
+
+      // If all we want is enums, a class is just something to get past
+      // without firing anything
+      auto const skippedClassGrammar =
+        *annotation >>
+        (classKeyword | structKeyword) >>
+        identifier >>
+        -(x3::lit(":") >> +(-(privateKeyword | protectedKeyword | publicKeyword) >> enhancedIdentifier >> *x3::lit(","))) >>
+        memo[ignoreScopes] >>
+        x3::lit(";");
+
+      auto const classGrammar =
+        x3::omit[x3::eps(detail != IndexDetail::enums) >> indexedClassGrammar] |
+        x3::omit[x3::eps(detail == IndexDetail::enums) >> skippedClassGrammar];
 	
 		
       auto const programGrammar = * (
@@ -545,15 +629,15 @@ namespace fr::codegen::parser {
 				     classGrammar |
 				     scopePop);
       
-      auto const ignoreStuff =
-	blockComment |
-	singleLineComment |
-	x3::ascii::space;
+      // memo[] looks the table up on every try, so it gets a null one
+      // when we're not memoizing and just parses
+      MemoTable<Iterator> table(first);
+      MemoTable<Iterator>* memoTable = memoize ? &table : nullptr;
 
       // Parse all the things      
       return x3::phrase_parse(first, last,
-			      programGrammar,
-			      ignoreStuff,
+			      x3::with<MemoTag>(memoTable)[programGrammar],
+			      skipper,
 			      result);      
     }
 
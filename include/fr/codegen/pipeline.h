@@ -0,0 +1,522 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Runs a whole set of IndexCode and generator steps described in a
+ * manifest in one process. See "codegen run" for what the manifest
+ * looks like.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <filesystem>
+#include <fnmatch.h>
+#include <fr/codegen/crawl.h>
+#include <fr/codegen/tools.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/workpool.h>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fr::codegen {
+
+  /**
+   * One run of one tool. inputs and outputs are worked out from the
+   * command line, and that's how the pipeline figures out what has to
+   * run before what.
+   */
+  struct PipelineStep {
+    std::string name;
+    std::string tool;
+    std::vector<std::string> args;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    // Outputs we only know the shape of until the step runs, as
+    // fnmatch patterns (OstreamOpsFromIndex --companions)
+    std::vector<std::string> outputPatterns;
+    // Directories the step crawls for inputs and what it crawls them
+    // for (IndexCode --root), so files that show up there later count
+    // too
+    std::vector<std::string> inputRoots;
+    std::vector<std::string> inputGlobs;
+    // Indexes of the steps that have to finish first
+    std::vector<size_t> dependsOn;
+    std::vector<size_t> dependents;
+  };
+
+  class Pipeline {
+    std::vector<PipelineStep> _steps;
+    std::map<std::string, tools::Tool> _tools;
+
+    // A step's options, as they were written, and what was given for them
+    using StepOptions = std::map<std::string, std::vector<std::string>>;
+
+    /**
+     * Which options of each tool name files it reads and writes, and
+     * how to work out the ones that aren't named on the command line
+     * (shards, crawled headers and so on). This has to match the
+     * tools' option tables, so if you add a file option to a tool,
+     * add it here too.
+     */
+    struct FileOptions {
+      std::set<std::string> inputs;
+      std::set<std::string> outputs;
+      std::function<void(const StepOptions&, PipelineStep&)> derived;
+    };
+
+    // Everything given for any of names, in order
+    static std::vector<std::string> values(const StepOptions& given, std::initializer_list<const char*> names) {
+      std::vector<std::string> ret;
+      for (const char* name : names) {
+        auto it = given.find(name);
+        if (it != given.end()) {
+          ret.insert(ret.end(), it->second.begin(), it->second.end());
+        }
+      }
+      return ret;
+    }
+
+    static int shardCount(const StepOptions& given) {
+      auto shards = values(given, {"-n", "--shards"});
+      if (shards.empty()) {
+        return 0;
+      }
+      try {
+        return std::stoi(shards.back());
+      } catch (std::exception&) {
+        // The tool will complain about it
+        return 0;
+      }
+    }
+
+    static const std::map<std::string, FileOptions>& fileOptions() {
+      static const std::map<std::string, FileOptions> options{
+        {"IndexCode", {{"-h", "--headers"}, {"-o", "--output", "--flat"},
+                       [](const StepOptions& given, PipelineStep& step) {
+                         // Crawl the same way IndexCode will
+                         auto globs = values(given, {"-g", "--glob"});
+                         if (globs.empty()) {
+                           globs = {"*.h", "*.hpp"};
+                         }
+                         for (const auto& root : values(given, {"-r", "--root"})) {
+                           for (const auto& header : findHeaders(root, globs)) {
+                             step.inputs.push_back(normalize(header));
+                           }
+                           step.inputRoots.push_back(normalize(root));
+                         }
+                         step.inputGlobs = globs;
+                       }}},
+        {"OstreamOpsFromIndex", {{"-i", "--index"}, {"-h", "--header"},
+                                 [](const StepOptions& given, PipelineStep& step) {
+                                   auto cpp = values(given, {"-c", "--cpp"});
+                                   int shards = shardCount(given);
+                                   for (const auto& file : cpp) {
+                                     if (shards <= 0) {
+                                       step.outputs.push_back(normalize(file));
+                                     }
+                                     for (int shard = 0; shard < shards; ++shard) {
+                                       step.outputs.push_back(normalize(shardFileName(file, shard)));
+                                     }
+                                   }
+                                   // One per indexed header, next to the header, and
+                                   // we won't know which until the index is there
+                                   if (given.contains("--companions")) {
+                                     for (const auto& header : values(given, {"-h", "--header"})) {
+                                       auto directory = std::filesystem::path(normalize(header)).parent_path();
+                                       step.outputPatterns.push_back((directory / "*_ops.h").string());
+                                     }
+                                   }
+                                 }}},
+        {"GenerateFunctions", {{"-h", "--header", "-i", "--index"}, {"-o", "--output"}, nullptr}},
+        {"GeneratePythonApi", {{"-s", "--source", "-i", "--index"}, {"-o", "--output"},
+                               [](const StepOptions& given, PipelineStep& step) {
+                                 int shards = shardCount(given);
+                                 for (const auto& file : values(given, {"-o", "--output"})) {
+                                   for (int shard = 0; shard < shards; ++shard) {
+                                     step.outputs.push_back(normalize(shardFileName(file, shard)));
+                                   }
+                                 }
+                               }}},
+        {"GenerateEnumFunctions", {{"-i", "--input"}, {"-h", "--header", "-c", "--cpp"}, nullptr}}
+      };
+      return options;
+    }
+
+    static std::string normalize(const std::string& path) {
+      return std::filesystem::absolute(path).lexically_normal().string();
+    }
+
+    // The names OstreamOpsFromIndex and GeneratePythonApi give their shards
+    static std::string shardFileName(const std::string& file, int shard) {
+      std::filesystem::path path(file);
+      std::string name = path.stem().string();
+      name.append("_shard");
+      name.append(std::to_string(shard));
+      name.append(path.extension().string());
+      return path.replace_filename(name).string();
+    }
+
+    // Sorts a step's file arguments into inputs and outputs
+    static void findFiles(PipelineStep& step) {
+      auto options = fileOptions().find(step.tool);
+      if (options == fileOptions().end()) {
+        throw std::runtime_error("Step " + step.name + " uses unknown tool " + step.tool);
+      }
+      StepOptions given;
+      for (size_t i = 0; i < step.args.size(); ++i) {
+        std::string option = step.args[i];
+        if (!option.starts_with("-")) {
+          continue;
+        }
+        // Switches pick up the next argument too, which is harmless
+        // since nothing looks at what a switch was given
+        std::string value;
+        auto equals = option.find('=');
+        if (option.starts_with("--") && equals != std::string::npos) {
+          value = option.substr(equals + 1);
+          option = option.substr(0, equals);
+        } else if (i + 1 < step.args.size()) {
+          value = step.args[i + 1];
+        }
+        given[option].push_back(value);
+        if (options->second.inputs.contains(option)) {
+          step.inputs.push_back(normalize(value));
+        } else if (options->second.outputs.contains(option)) {
+          step.outputs.push_back(normalize(value));
+        }
+      }
+      if (options->second.derived) {
+        options->second.derived(given, step);
+      }
+    }
+
+    // Does step read file? That's either one of its inputs or anything
+    // its crawl would find
+    static bool reads(const PipelineStep& step, const std::string& file) {
+      if (std::find(step.inputs.begin(), step.inputs.end(), file) != step.inputs.end()) {
+        return true;
+      }
+      for (const auto& root : step.inputRoots) {
+        auto relative = std::filesystem::path(file).lexically_relative(root);
+        if (relative.empty() || relative.begin()->string() == "..") {
+          continue;
+        }
+        for (const auto& pattern : step.inputGlobs) {
+          if (globMatches(pattern, relative)) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    // Which step writes input, if any
+    std::optional<size_t> writerOf(const std::map<std::string, size_t>& writers, const std::string& input) const {
+      auto writer = writers.find(input);
+      if (writer != writers.end()) {
+        return writer->second;
+      }
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        for (const auto& pattern : _steps[i].outputPatterns) {
+          if (fnmatch(pattern.c_str(), input.c_str(), FNM_PATHNAME) == 0) {
+            return i;
+          }
+        }
+      }
+      return std::nullopt;
+    }
+
+    // Kahn's algorithm, just to make sure there's an order at all
+    void checkForCycles() const {
+      std::vector<size_t> waitingOn(_steps.size());
+      std::vector<size_t> ready;
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        waitingOn[i] = _steps[i].dependsOn.size();
+        if (waitingOn[i] == 0) {
+          ready.push_back(i);
+        }
+      }
+      size_t visited = 0;
+      while (!ready.empty()) {
+        size_t step = ready.back();
+        ready.pop_back();
+        visited++;
+        for (size_t dependent : _steps[step].dependents) {
+          if (--waitingOn[dependent] == 0) {
+            ready.push_back(dependent);
+          }
+        }
+      }
+      if (visited != _steps.size()) {
+        throw std::runtime_error("Pipeline steps depend on each other in a circle");
+      }
+    }
+
+  public:
+    Pipeline(std::map<std::string, tools::Tool> tools = tools::allTools()) : _tools(tools) {}
+    ~Pipeline() = default;
+
+    const std::vector<PipelineStep>& steps() const {
+      return _steps;
+    }
+
+    /**
+     * Adds a step. Paths in args are relative to the current directory.
+     * IndexCode steps keep their index in memory unless write is set.
+     */
+    void addStep(const std::string& name, const std::string& tool,
+                 std::vector<std::string> args, bool write = false) {
+      PipelineStep step;
+      step.name = name.empty() ? tool + " " + std::to_string(_steps.size()) : name;
+      step.tool = tool;
+      if (tool == "IndexCode" && !write) {
+        args.push_back("--keep-in-memory");
+      }
+      step.args = args;
+      findFiles(step);
+      _steps.push_back(step);
+    }
+
+    /**
+     * Reads steps out of a manifest, which looks like
+     *
+     * { "steps": [
+     *     { "name": "index", "tool": "IndexCode",
+     *       "args": ["-h", "Config.h.in", "-o", "index.json"] },
+     *     { "tool": "GenerateFunctions",
+     *       "args": ["-h", "Config.h.in", "-i", "index.json", "-o", "Config.h"] }
+     * ] }
+     *
+     * "write": true on an IndexCode step writes the index file too.
+     */
+    void load(std::istream& manifest) {
+      boost::property_tree::ptree tree;
+      boost::property_tree::read_json(manifest, tree);
+      for (const auto& [unused, stepTree] : tree.get_child("steps")) {
+        std::vector<std::string> args;
+        if (auto argsTree = stepTree.get_child_optional("args")) {
+          for (const auto& [unusedArg, arg] : *argsTree) {
+            args.push_back(arg.get_value<std::string>());
+          }
+        }
+        addStep(stepTree.get<std::string>("name", ""),
+                stepTree.get<std::string>("tool"),
+                args,
+                stepTree.get<bool>("write", false));
+      }
+    }
+
+    /**
+     * A step depends on every step that writes a file it reads. Two
+     * steps writing the same file is an error, since there'd be no
+     * telling which one you'd get.
+     */
+    void buildGraph() {
+      std::map<std::string, size_t> writers;
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        _steps[i].dependsOn.clear();
+        _steps[i].dependents.clear();
+        for (const auto& output : _steps[i].outputs) {
+          auto [it, inserted] = writers.emplace(output, i);
+          if (!inserted) {
+            throw std::runtime_error("Steps " + _steps[it->second].name + " and " +
+                                     _steps[i].name + " both write " + output);
+          }
+        }
+      }
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        std::set<size_t> dependencies;
+        for (const auto& input : _steps[i].inputs) {
+          auto writer = writerOf(writers, input);
+          if (writer && *writer != i) {
+            dependencies.insert(*writer);
+          }
+        }
+        // Generated headers the crawl didn't see because they aren't
+        // there yet
+        if (!_steps[i].inputRoots.empty()) {
+          for (const auto& [output, writer] : writers) {
+            if (writer != i && reads(_steps[i], output)) {
+              dependencies.insert(writer);
+            }
+          }
+        }
+        for (size_t dependency : dependencies) {
+          _steps[i].dependsOn.push_back(dependency);
+          _steps[dependency].dependents.push_back(i);
+        }
+      }
+      checkForCycles();
+    }
+
+    /**
+     * Files the steps read that no step writes, which are the ones
+     * worth watching for changes. Call buildGraph first.
+     */
+    std::set<std::string> sourceFiles() const {
+      std::map<std::string, size_t> writers;
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        for (const auto& output : _steps[i].outputs) {
+          writers.emplace(output, i);
+        }
+      }
+      std::set<std::string> sources;
+      for (const auto& step : _steps) {
+        for (const auto& input : step.inputs) {
+          if (!writerOf(writers, input)) {
+            sources.insert(input);
+          }
+        }
+      }
+      return sources;
+    }
+
+    /**
+     * The steps that read any of the changed files (absolute paths),
+     * plus everything downstream of them. Call buildGraph first.
+     */
+    std::set<size_t> affectedBy(const std::set<std::string>& changed) const {
+      std::set<size_t> affected;
+      std::vector<size_t> toVisit;
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        for (const auto& file : changed) {
+          if (reads(_steps[i], file)) {
+            toVisit.push_back(i);
+            break;
+          }
+        }
+      }
+      while (!toVisit.empty()) {
+        size_t step = toVisit.back();
+        toVisit.pop_back();
+        if (affected.insert(step).second) {
+          toVisit.insert(toVisit.end(), _steps[step].dependents.begin(), _steps[step].dependents.end());
+        }
+      }
+      return affected;
+    }
+
+    /**
+     * Runs everything, as many at a time as the dependencies and
+     * threads allow. Each step's output is written to out in one
+     * piece when it finishes. If a step fails, nothing that depends
+     * on it runs. Returns the number of steps that failed or didn't
+     * run.
+     */
+    size_t run(std::ostream& out, size_t threads = 0) {
+      buildGraph();
+      tools::ToolContext context;
+      std::set<size_t> everything;
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        everything.insert(i);
+      }
+      return run(out, threads, context, everything);
+    }
+
+    /**
+     * Runs just the steps in only, treating the rest as already done,
+     * with a context you keep around between runs. That way IndexCode
+     * only parses the headers that changed since last time and the
+     * generators get the index it patched together in memory. Call
+     * buildGraph first.
+     */
+    size_t run(std::ostream& out, size_t threads, tools::ToolContext& context, const std::set<size_t>& only) {
+      std::mutex outMutex;
+      std::vector<std::atomic<size_t>> waitingOn(_steps.size());
+      std::vector<std::atomic<bool>> failed(_steps.size());
+      std::atomic<size_t> failures{0};
+      WorkStealingPool pool(threads);
+
+      std::function<void(size_t)> runStep = [&](size_t index) {
+        auto& step = _steps[index];
+        std::stringstream stepOut;
+        int exitCode = 1;
+        if (failed[index]) {
+          stepOut << "Skipped because a step it needs failed" << std::endl;
+        } else {
+          std::vector<std::string> args{step.tool};
+          args.insert(args.end(), step.args.begin(), step.args.end());
+          std::vector<char*> argv;
+          for (auto& arg : args) {
+            argv.push_back(arg.data());
+          }
+          argv.push_back(nullptr);
+          try {
+            trace::Span span("pipeline", "step", step.name);
+            exitCode = _tools.at(step.tool)(args.size(), argv.data(), stepOut, context);
+          } catch (std::exception& e) {
+            stepOut << step.tool << " failed: " << e.what() << std::endl;
+          }
+        }
+        if (exitCode != 0) {
+          failures++;
+        }
+        {
+          std::lock_guard lock(outMutex);
+          out << "=== " << step.name << (exitCode == 0 ? "" : " (FAILED)") << std::endl;
+          out << stepOut.str();
+        }
+        for (size_t dependent : step.dependents) {
+          if (!only.contains(dependent)) {
+            continue;
+          }
+          if (exitCode != 0) {
+            failed[dependent] = true;
+          }
+          if (--waitingOn[dependent] == 0) {
+            pool.submit([&runStep, dependent]() { runStep(dependent); });
+          }
+        }
+      };
+
+      for (size_t i = 0; i < _steps.size(); ++i) {
+        waitingOn[i] = 0;
+        for (size_t dependency : _steps[i].dependsOn) {
+          if (only.contains(dependency)) {
+            waitingOn[i]++;
+          }
+        }
+        failed[i] = false;
+      }
+      // Find them all before submitting any, since a step that finishes
+      // right away releases its dependents and they'd look ready twice
+      std::vector<size_t> ready;
+      for (size_t i : only) {
+        if (waitingOn[i] == 0) {
+          ready.push_back(i);
+        }
+      }
+      for (size_t i : ready) {
+        pool.submit([&runStep, i]() { runStep(i); });
+      }
+      pool.wait();
+      return failures;
+    }
+  };
+
+}
@@ -0,0 +1,260 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The pieces of CodegenScaling that don't need to run anything: the
+ * synthetic corpus it feeds the pipeline, the results file it writes
+ * and the checks it does on the results. CodegenScaling runs the
+ * whole chain (IndexCode, then the generators) over bigger and bigger
+ * corpora and records how long each stage took, how much memory it
+ * used and how much it wrote. Then it looks for stages that got
+ * disproportionately slower as the corpus grew, and for stages that
+ * got slower or bigger than they were in a baseline results file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fr/codegen/json.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fr::codegen::scaling {
+
+  // How one stage did on one size of corpus
+  struct Measurement {
+    std::string stage;
+    uint64_t classes = 0;
+    double wallMs = 0.0;
+    uint64_t peakRssKb = 0;
+    uint64_t outputBytes = 0;
+
+    void saveJson(json::JsonWriter& writer) const {
+      writer.beginObject();
+      writer.field("stage", stage);
+      writer.field("classes", classes);
+      writer.field("wall_ms", wallMs);
+      writer.field("peak_rss_kb", peakRssKb);
+      writer.field("output_bytes", outputBytes);
+      writer.endObject();
+    }
+
+    void loadJson(json::JsonReader& reader) {
+      reader.beginObject();
+      std::string_view key;
+      while (reader.nextKey(key)) {
+        if (key == "stage") {
+          reader.read(stage);
+        } else if (key == "classes") {
+          reader.read(classes);
+        } else if (key == "wall_ms") {
+          reader.read(wallMs);
+        } else if (key == "peak_rss_kb") {
+          reader.read(peakRssKb);
+        } else if (key == "output_bytes") {
+          reader.read(outputBytes);
+        } else {
+          reader.skipValue();
+        }
+      }
+    }
+  };
+
+  struct Results {
+    std::vector<Measurement> measurements;
+
+    const Measurement* find(const std::string& stage, uint64_t classes) const {
+      for (const auto& measurement : measurements) {
+        if (measurement.stage == stage && measurement.classes == classes) {
+          return &measurement;
+        }
+      }
+      return nullptr;
+    }
+
+    // Each stage's measurements, smallest corpus first
+    std::map<std::string, std::vector<Measurement>> byStage() const {
+      std::map<std::string, std::vector<Measurement>> ret;
+      for (const auto& measurement : measurements) {
+        ret[measurement.stage].push_back(measurement);
+      }
+      for (auto& [stage, list] : ret) {
+        std::sort(list.begin(), list.end(), [](const Measurement& a, const Measurement& b) {
+          return a.classes < b.classes;
+        });
+      }
+      return ret;
+    }
+
+    void saveJson(json::JsonWriter& writer) const {
+      writer.beginObject();
+      writer.field("measurements", measurements);
+      writer.endObject();
+    }
+
+    void loadJson(json::JsonReader& reader) {
+      reader.beginObject();
+      std::string_view key;
+      while (reader.nextKey(key)) {
+        if (key == "measurements") {
+          reader.read(measurements);
+        } else {
+          reader.skipValue();
+        }
+      }
+    }
+
+    void save(const std::string& filename) const {
+      std::ofstream stream(filename);
+      stream << json::toJson(*this) << std::endl;
+      if (!stream) {
+        throw std::runtime_error("Couldn't write " + filename);
+      }
+    }
+
+    void load(const std::string& filename) {
+      std::ifstream stream(filename);
+      if (!stream) {
+        throw std::runtime_error("Couldn't read " + filename);
+      }
+      std::stringstream contents;
+      contents << stream.rdbuf();
+      json::fromJson(*this, contents.str());
+    }
+  };
+
+  // What writeCorpus wrote
+  struct Corpus {
+    std::filesystem::path headerDirectory;
+    std::vector<std::filesystem::path> headers;
+    std::filesystem::path pythonTemplate;
+  };
+
+  /**
+   * Writes classes annotated classes and as many enums to directory,
+   * perHeader of each to a header, plus a GeneratePythonApi template.
+   * Everything's at the top level, named by number so nothing
+   * collides across headers. The headers are .h.in so GenerateFunctions
+   * has something to rewrite.
+   */
+  inline Corpus writeCorpus(const std::filesystem::path& directory, size_t classes, size_t perHeader = 100) {
+    Corpus corpus;
+    corpus.headerDirectory = directory / "headers";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(corpus.headerDirectory);
+    perHeader = std::max<size_t>(perHeader, 1);
+    for (size_t first = 0; first < classes; first += perHeader) {
+      auto header = corpus.headerDirectory / ("synthetic_" + std::to_string(first / perHeader) + ".h.in");
+      std::ofstream stream(header);
+      stream << "#pragma once" << std::endl;
+      stream << "#include <string>" << std::endl << std::endl;
+      for (size_t i = first; i < std::min(first + perHeader, classes); ++i) {
+        stream << "enum class Kind" << i << " {" << std::endl;
+        stream << "  alpha," << std::endl;
+        stream << "  beta," << std::endl;
+        stream << "  gamma" << std::endl;
+        stream << "};" << std::endl << std::endl;
+        stream << "class Synthetic" << i << " {" << std::endl;
+        stream << "  [[cereal,get,set]] std::string _name;" << std::endl;
+        stream << "  [[cereal,get,set]] int _count;" << std::endl;
+        stream << "  [[cereal,get,set]] double _weight;" << std::endl;
+        stream << "  [[cereal,get,set]] Kind" << i << " _kind;" << std::endl << std::endl;
+        stream << "public:" << std::endl;
+        stream << "  Synthetic" << i << "() = default;" << std::endl;
+        stream << "  void reset(int count, const std::string& name);" << std::endl << std::endl;
+        stream << "  [[genGetSetMethods]]" << std::endl;
+        stream << "  [[genCerealLoadSave]]" << std::endl;
+        stream << "};" << std::endl << std::endl;
+      }
+      if (!stream) {
+        throw std::runtime_error("Couldn't write " + header.string());
+      }
+      corpus.headers.push_back(header);
+    }
+    corpus.pythonTemplate = directory / "PythonApi.cpp.in";
+    std::ofstream stream(corpus.pythonTemplate);
+    stream << "#include <nanobind/nanobind.h>" << std::endl;
+    stream << "#include <nanobind/stl/string.h>" << std::endl << std::endl;
+    stream << "[[StartModule (Synthetic)]]" << std::endl;
+    stream << "[[PythonApi]]" << std::endl;
+    stream << "}" << std::endl;
+    return corpus;
+  }
+
+  /**
+   * Stages whose time grew faster than size^maxExponent between two
+   * consecutive corpus sizes. Times under minMs are mostly process
+   * startup and noise, so pairs starting below that don't count.
+   */
+  inline std::vector<std::string> superLinear(const Results& results, double maxExponent, double minMs) {
+    std::vector<std::string> ret;
+    for (const auto& [stage, list] : results.byStage()) {
+      for (size_t i = 1; i < list.size(); ++i) {
+        const auto& smaller = list[i - 1];
+        const auto& larger = list[i];
+        if (smaller.wallMs < minMs || larger.classes <= smaller.classes) {
+          continue;
+        }
+        double exponent = std::log(larger.wallMs / smaller.wallMs) /
+                          std::log(static_cast<double>(larger.classes) / smaller.classes);
+        if (exponent > maxExponent) {
+          std::ostringstream message;
+          message << stage << " grew as size^" << exponent << " from " << smaller.classes << " to "
+                  << larger.classes << " classes (" << smaller.wallMs << " ms to " << larger.wallMs << " ms)";
+          ret.push_back(message.str());
+        }
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Stages that took more than thresholdPercent longer, or used that
+   * much more memory, than the same stage on the same size corpus in
+   * baseline.
+   */
+  inline std::vector<std::string> regressions(const Results& results, const Results& baseline,
+                                              double thresholdPercent, double minMs) {
+    std::vector<std::string> ret;
+    double limit = 1.0 + thresholdPercent / 100.0;
+    for (const auto& measurement : results.measurements) {
+      auto before = baseline.find(measurement.stage, measurement.classes);
+      if (!before) {
+        continue;
+      }
+      std::ostringstream message;
+      if (measurement.wallMs >= minMs && measurement.wallMs > before->wallMs * limit) {
+        message << measurement.stage << " at " << measurement.classes << " classes took " << measurement.wallMs
+                << " ms, baseline was " << before->wallMs << " ms";
+        ret.push_back(message.str());
+        message.str("");
+      }
+      if (before->peakRssKb && measurement.peakRssKb > before->peakRssKb * limit) {
+        message << measurement.stage << " at " << measurement.classes << " classes peaked at "
+                << measurement.peakRssKb << " KB, baseline was " << before->peakRssKb << " KB";
+        ret.push_back(message.str());
+      }
+    }
+    return ret;
+  }
+
+}
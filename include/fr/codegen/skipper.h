@@ -0,0 +1,143 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The skipper the parser runs between tokens. It skips the same things
+ * blockComment | singleLineComment | x3::ascii::space does, but x3
+ * tries that alternative one character or comment at a time, three
+ * parsers deep, before every token. This one skips everything up to
+ * the next token in one call. Whitespace gets looked up in a table,
+ * and comments get skipped by memchr'ing for the end of them, which
+ * glibc does with SIMD.
+ *
+ * Same as the rules, a // comment needs a line ending and a block
+ * comment needs to be closed. If they're not, they don't get skipped.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <boost/spirit/home/x3.hpp>
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+namespace fr::codegen::parser {
+
+  namespace x3 = boost::spirit::x3;
+
+  namespace detail {
+
+    // The characters x3::ascii::space matches
+    inline constexpr std::array<bool, 256> spaceTable = []() {
+      std::array<bool, 256> ret{};
+      for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        ret[c] = true;
+      }
+      return ret;
+    }();
+
+    // The first c in [first, last), or last
+    template <typename Iterator>
+    Iterator findChar(Iterator first, Iterator last, char c) {
+      if constexpr (std::contiguous_iterator<Iterator> && sizeof(std::iter_value_t<Iterator>) == 1) {
+        auto begin = std::to_address(first);
+        auto found = static_cast<decltype(begin)>(std::memchr(begin, c, last - first));
+        return found ? first + (found - begin) : last;
+      } else {
+        return std::find(first, last, c);
+      }
+    }
+
+    // first is just past the //. Moves it past the line ending that
+    // finishes the comment, or returns false if there isn't one.
+    template <typename Iterator>
+    bool skipLineComment(Iterator& first, Iterator const& last) {
+      Iterator newline = findChar(first, last, '\n');
+      // A \r on its own ends the line too
+      Iterator ret = findChar(first, newline, '\r');
+      if (ret != newline) {
+        ++ret;
+        if (ret != last && *ret == '\n') {
+          ++ret;
+        }
+        first = ret;
+        return true;
+      }
+      if (newline == last) {
+        return false;
+      }
+      first = std::next(newline);
+      return true;
+    }
+
+    // first is just past the opening of a block comment. Moves it past
+    // the end of it, or returns false if it doesn't have one.
+    template <typename Iterator>
+    bool skipBlockComment(Iterator& first, Iterator const& last) {
+      Iterator at = first;
+      while (true) {
+        Iterator star = findChar(at, last, '*');
+        if (star == last) {
+          return false;
+        }
+        at = std::next(star);
+        if (at != last && *at == '/') {
+          first = std::next(at);
+          return true;
+        }
+      }
+    }
+
+  }
+
+  struct Skipper : x3::parser<Skipper> {
+    using attribute_type = x3::unused_type;
+    static bool const has_attribute = false;
+
+    template <typename Iterator, typename Context, typename RContext, typename Attribute>
+    bool parse(Iterator& first, Iterator const& last, Context const&, RContext&, Attribute&) const {
+      Iterator start = first;
+      while (first != last) {
+        if (detail::spaceTable[static_cast<unsigned char>(*first)]) {
+          ++first;
+          while (first != last && detail::spaceTable[static_cast<unsigned char>(*first)]) {
+            ++first;
+          }
+          continue;
+        }
+        if (*first != '/') {
+          break;
+        }
+        Iterator next = std::next(first);
+        if (next == last) {
+          break;
+        }
+        Iterator body = std::next(next);
+        if (*next == '/' && detail::skipLineComment(body, last)) {
+          first = body;
+        } else if (*next == '*' && detail::skipBlockComment(body, last)) {
+          first = body;
+        } else {
+          break;
+        }
+      }
+      return first != start;
+    }
+  };
+
+  inline constexpr Skipper skipper = Skipper();
+
+}
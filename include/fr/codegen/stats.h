@@ -0,0 +1,301 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Where the time goes. The programs all take --stats FILE and write
+ * the wall and CPU time they spent in each phase, some counters and
+ * their peak memory use to FILE as JSON, so you can keep track of
+ * how your code generation performs over time.
+ */
+
+#pragma once
+
+#include <boost/signals2.hpp>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fr/codegen/alloc.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <sys/resource.h>
+
+namespace fr::codegen {
+
+  /**
+   * Phases and counters are just names, but try to stick to these so
+   * the output from different programs lines up:
+   *
+   * Phases: "read" (reading input files), "parse" (running the parser,
+   * which includes "drive"), "drive" (the drivers handling parser
+   * signals), "index load", "generate", "write".
+   *
+   * Counters: "bytes in", "bytes out", "lines in", "lines out",
+   * "declarations", "signals".
+   *
+   * The line by line programs read, generate and write one line at a
+   * time, so all of that shows up as "generate" for them.
+   *
+   * A Stats with no filename doesn't record anything, and everything
+   * it does is cheap enough to leave in. Timers tag allocations with
+   * their phase either way, so a build with the allocation hooks (see
+   * alloc.h) can tell where the memory went.
+   */
+
+  class Stats {
+  public:
+    struct Phase {
+      double wallMs = 0.0;
+      double cpuMs = 0.0;
+      uint64_t count = 0;
+    };
+
+  private:
+    std::string _filename;
+    std::string _tool;
+    std::mutex _mutex;
+    std::map<std::string, Phase> _phases;
+    std::map<std::string, uint64_t> _counters;
+
+    // When the signal we're in started. Signals don't nest in the
+    // parser, so one is enough.
+    std::chrono::steady_clock::time_point _signalWall;
+    double _signalCpu = 0.0;
+    size_t _signalAllocPhase = 0;
+
+    static std::string escape(const std::string& text) {
+      std::string ret;
+      for (char c : text) {
+        if (c == '"' || c == '\\') {
+          ret.push_back('\\');
+        }
+        ret.push_back(c);
+      }
+      return ret;
+    }
+
+  public:
+    // CPU time used by this thread, so codegend running several things
+    // doesn't count the other ones against you
+    static double cpuMs() {
+      timespec now;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+      return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+    }
+
+    // Peak resident set size of the whole process, in kilobytes
+    static long peakRssKb() {
+      rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+      return usage.ru_maxrss;
+    }
+
+    /**
+     * Times the phase from construction to destruction (or stop, if
+     * you want to end it early.)
+     */
+    class Timer {
+      Stats* _stats;
+      std::string _phase;
+      std::chrono::steady_clock::time_point _wall;
+      double _cpu;
+      alloc::Phase _allocPhase;
+
+    public:
+      Timer(Stats* stats, const std::string& phase) : _stats(stats), _phase(phase), _allocPhase(phase) {
+        if (_stats) {
+          _wall = std::chrono::steady_clock::now();
+          _cpu = cpuMs();
+        }
+      }
+
+      Timer(const Timer&) = delete;
+      Timer& operator=(const Timer&) = delete;
+
+      ~Timer() {
+        stop();
+      }
+
+      void stop() {
+        _allocPhase.end();
+        if (_stats) {
+          std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - _wall;
+          _stats->addTime(_phase, wall.count(), cpuMs() - _cpu);
+          _stats = nullptr;
+        }
+      }
+    };
+
+    Stats(const std::string& filename, const std::string& tool) : _filename(filename), _tool(tool) {}
+
+    // The file gets written when this goes away, so you don't have to
+    // remember to on every way out of your program
+    ~Stats() {
+      save();
+    }
+
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    bool enabled() const {
+      return !_filename.empty();
+    }
+
+    Timer time(const std::string& phase) {
+      return Timer(enabled() ? this : nullptr, phase);
+    }
+
+    void addTime(const std::string& phase, double wallMs, double cpuMs) {
+      if (!enabled()) {
+        return;
+      }
+      std::lock_guard lock(_mutex);
+      auto& entry = _phases[phase];
+      entry.wallMs += wallMs;
+      entry.cpuMs += cpuMs;
+      entry.count++;
+    }
+
+    void count(const std::string& counter, uint64_t amount = 1) {
+      if (!enabled()) {
+        return;
+      }
+      std::lock_guard lock(_mutex);
+      _counters[counter] += amount;
+    }
+
+    const std::map<std::string, Phase>& phases() const {
+      return _phases;
+    }
+
+    const std::map<std::string, uint64_t>& counters() const {
+      return _counters;
+    }
+
+    /**
+     * Counts a signal in "signals" and times whatever's connected to
+     * it as phase. This connects a slot at the front and one at the
+     * back, so connect it after everything else and the slots in
+     * between get timed.
+     */
+    template <typename... Args>
+    void instrument(boost::signals2::signal<void(Args...)>& signal, const std::string& phase = "drive") {
+      if (!enabled() && !alloc::instrumented()) {
+        return;
+      }
+      signal.connect([this, phase](Args...) {
+        _signalAllocPhase = alloc::enter(phase);
+        if (enabled()) {
+          _signalWall = std::chrono::steady_clock::now();
+          _signalCpu = cpuMs();
+          count("signals");
+        }
+      }, boost::signals2::at_front);
+      signal.connect([this, phase](Args...) {
+        alloc::leave(_signalAllocPhase);
+        if (enabled()) {
+          std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - _signalWall;
+          addTime(phase, wall.count(), cpuMs() - _signalCpu);
+        }
+      }, boost::signals2::at_back);
+    }
+
+    // Instruments all of a ParserDriver's signals. Do this after the
+    // drivers are registered with it.
+    template <typename Parser>
+    void instrumentParser(Parser& parser) {
+      instrument(parser.incScope);
+      instrument(parser.decScope);
+      instrument(parser.namespacePush);
+      instrument(parser.enumPush);
+      instrument(parser.enumClassPush);
+      instrument(parser.enumIdentifier);
+      instrument(parser.enumUnderlyingTypeFound);
+      instrument(parser.classPush);
+      instrument(parser.classPop);
+      instrument(parser.structPush);
+      instrument(parser.privateClassParent);
+      instrument(parser.protectedClassParent);
+      instrument(parser.publicClassParent);
+      instrument(parser.privateInClass);
+      instrument(parser.protectedInClass);
+      instrument(parser.publicInClass);
+      instrument(parser.memberFound);
+      instrument(parser.methodFound);
+      instrument(parser.parameterFound);
+      instrument(parser.annotationFound);
+    }
+
+    // Counts lines and bytes going past on an Lbl emitter
+    template <typename Emitter>
+    void countLines(Emitter& emitter, const std::string& lines, const std::string& bytes) {
+      if (!enabled()) {
+        return;
+      }
+      emitter.emit.connect([this, lines, bytes](const std::string& line) {
+        count(lines);
+        // Plus the newline it'll get
+        count(bytes, line.size() + 1);
+      });
+    }
+
+    void write(std::ostream& stream) {
+      std::lock_guard lock(_mutex);
+      stream << "{" << std::endl;
+      stream << "  \"tool\": \"" << escape(_tool) << "\"," << std::endl;
+      stream << "  \"phases\": {";
+      bool first = true;
+      for (const auto& [name, phase] : _phases) {
+        stream << (first ? "" : ",") << std::endl;
+        first = false;
+        stream << "    \"" << escape(name) << "\": { \"wall_ms\": " << phase.wallMs
+               << ", \"cpu_ms\": " << phase.cpuMs << ", \"count\": " << phase.count << " }";
+      }
+      stream << std::endl << "  }," << std::endl;
+      stream << "  \"counters\": {";
+      first = true;
+      for (const auto& [name, value] : _counters) {
+        stream << (first ? "" : ",") << std::endl;
+        first = false;
+        stream << "    \"" << escape(name) << "\": " << value;
+      }
+      stream << std::endl << "  }," << std::endl;
+      if (alloc::instrumented()) {
+        stream << "  \"allocations\": {";
+        first = true;
+        for (const auto& [name, counts] : alloc::report()) {
+          stream << (first ? "" : ",") << std::endl;
+          first = false;
+          stream << "    \"" << escape(name) << "\": { \"allocations\": " << counts.allocations
+                 << ", \"frees\": " << counts.frees << ", \"bytes\": " << counts.bytes
+                 << ", \"live_bytes\": " << counts.live << ", \"peak_live_bytes\": " << counts.peakLive << " }";
+        }
+        stream << std::endl << "  }," << std::endl;
+      }
+      stream << "  \"peak_rss_kb\": " << peakRssKb() << std::endl;
+      stream << "}" << std::endl;
+    }
+
+    // Writes the file if we were given one
+    void save() {
+      if (enabled()) {
+        std::ofstream stream(_filename);
+        write(stream);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,107 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The programs in src/ are also functions, so codegend can run them
+ * without starting a new process each time. Each one takes the same
+ * command line the program does and writes what it would have printed
+ * to out. They're defined in the program's source file, so you have to
+ * compile that in (with FR_CODEGEN_NO_MAIN defined, so you don't get
+ * its main) to use one.
+ */
+
+#pragma once
+
+#include <fr/codegen/flat.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/journal.h>
+#include <fr/codegen/LblTemplate.h>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace fr::codegen::tools {
+
+  // The caches a ToolContext and its copies share
+  struct ToolCaches {
+    IndexCache indexes;
+    HeaderCache headers;
+    TemplateCache templates;
+
+    ToolCaches() {
+#ifdef FR_CODEGEN_HAVE_SHM
+      // Whatever IndexCode --shared left in shared memory beats reading the JSON
+      indexes.addSource(loadSharedIndex);
+#endif
+      // An installed index might be a flat one
+      indexes.addSource(loadFlatIndexFile);
+      // Then the JSON with IndexCode --journal's changes played over it
+      indexes.addSource(loadJournaledIndex);
+    }
+  };
+
+  /**
+   * Stuff the tools can hang on to between runs. A program running
+   * by itself gets a fresh one every time, so nothing's cached, but
+   * codegend keeps one around for as long as it runs.
+   *
+   * Copies share the caches, so codegend gives each request a copy
+   * with the environment of the program that asked for it.
+   */
+  struct ToolContext {
+    using Getenv = std::function<const char*(const char* name)>;
+
+    std::shared_ptr<ToolCaches> caches;
+    IndexCache& indexes;
+    HeaderCache& headers;
+    TemplateCache& templates;
+    // Where the tools look up environment variables. Ours, unless
+    // somebody else asked for the run.
+    Getenv getenv = [](const char* name) -> const char* { return std::getenv(name); };
+
+    ToolContext() : ToolContext(std::make_shared<ToolCaches>()) {
+    }
+
+    explicit ToolContext(std::shared_ptr<ToolCaches> shared)
+      : caches(std::move(shared)), indexes(caches->indexes), headers(caches->headers), templates(caches->templates) {
+    }
+
+    ToolContext(const ToolContext&) = default;
+    ToolContext& operator=(const ToolContext&) = delete;
+  };
+
+  using Tool = std::function<int(int argc, char* argv[], std::ostream& out, ToolContext& context)>;
+
+  int indexCode(int argc, char* argv[], std::ostream& out, ToolContext& context);
+  int ostreamOpsFromIndex(int argc, char* argv[], std::ostream& out, ToolContext& context);
+  int generateFunctions(int argc, char* argv[], std::ostream& out, ToolContext& context);
+  int generatePythonApi(int argc, char* argv[], std::ostream& out, ToolContext& context);
+  int generateEnumFunctions(int argc, char* argv[], std::ostream& out, ToolContext& context);
+
+  // Program name -> tool. You only get the ones you linked in, so
+  // only use this where you have all of them.
+  inline std::map<std::string, Tool> allTools() {
+    return {
+      {"IndexCode", indexCode},
+      {"OstreamOpsFromIndex", ostreamOpsFromIndex},
+      {"GenerateFunctions", generateFunctions},
+      {"GeneratePythonApi", generatePythonApi},
+      {"GenerateEnumFunctions", generateEnumFunctions}
+    };
+  }
+
+}
@@ -0,0 +1,286 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Timeline tracing. The programs take --trace FILE and write Chrome
+ * trace event JSON to it, which you can load in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing to see what ran when on which
+ * thread, and where things sat around waiting.
+ *
+ * Each thread records into its own buffer, so recording doesn't make
+ * the threads wait on each other. When nobody's tracing, a span is a
+ * check of one flag.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+namespace fr::codegen::trace {
+
+  /**
+   * A complete ("X") event. Times are microseconds since the process
+   * started tracing anything.
+   */
+  struct Event {
+    const char* category;
+    std::string name;
+    int64_t start;
+    int64_t duration;
+  };
+
+  namespace detail {
+
+    // One per thread that's ever recorded anything. The registry keeps
+    // them alive so a thread that's gone still shows up in the trace.
+    struct Buffer {
+      uint32_t thread;
+      // Only contended when the session's writing the file
+      std::mutex mutex;
+      std::vector<Event> events;
+    };
+
+    struct State {
+      std::atomic<bool> enabled{false};
+      std::mutex mutex;
+      std::vector<std::shared_ptr<Buffer>> buffers;
+      uint32_t nextThread = 1;
+      std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    inline State& state() {
+      static State instance;
+      return instance;
+    }
+
+    inline Buffer& buffer() {
+      static thread_local std::shared_ptr<Buffer> mine;
+      if (!mine) {
+        mine = std::make_shared<Buffer>();
+        auto& global = state();
+        std::lock_guard lock(global.mutex);
+        mine->thread = global.nextThread++;
+        global.buffers.push_back(mine);
+      }
+      return *mine;
+    }
+
+    inline void escape(std::ostream& stream, const std::string& text) {
+      for (char c : text) {
+        if (c == '"' || c == '\\') {
+          stream << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+          stream << ' ';
+        } else {
+          stream << c;
+        }
+      }
+    }
+
+  }
+
+  inline bool enabled() {
+    return detail::state().enabled.load(std::memory_order_relaxed);
+  }
+
+  inline int64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - detail::state().epoch).count();
+  }
+
+  /**
+   * Records something that ran from start to end (from now()). name
+   * and what get joined with a space, which only costs anything if
+   * we're tracing.
+   */
+  inline void complete(const char* category, std::string_view name, std::string_view what,
+                       int64_t start, int64_t end) {
+    if (!enabled()) {
+      return;
+    }
+    std::string fullName(name);
+    if (!what.empty()) {
+      fullName.append(" ");
+      fullName.append(what);
+    }
+    auto& mine = detail::buffer();
+    std::lock_guard lock(mine.mutex);
+    mine.events.push_back(Event{category, std::move(fullName), start, end - start});
+  }
+
+  /**
+   * Records the time from construction to destruction. The category
+   * is what kind of thing it is, and the name shows up as "name what":
+   * Span span("header", "parse", filename);
+   */
+  class Span {
+    const char* _category;
+    std::string _name;
+    int64_t _start = 0;
+    bool _recording;
+
+  public:
+    Span(const char* category, std::string_view name, std::string_view what = {})
+      : _category(category), _recording(enabled()) {
+      if (_recording) {
+        _name = name;
+        if (!what.empty()) {
+          _name.append(" ");
+          _name.append(what);
+        }
+        _start = now();
+      }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span() {
+      if (_recording) {
+        complete(_category, _name, {}, _start, now());
+      }
+    }
+  };
+
+  /**
+   * Writes everything recorded so far as trace event JSON and clears
+   * the buffers. Don't call this while other threads are still
+   * recording if you want their last events in the file.
+   */
+  inline void write(std::ostream& stream) {
+    auto& global = detail::state();
+    std::lock_guard lock(global.mutex);
+    auto pid = getpid();
+    stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+    bool first = true;
+    for (auto& buffer : global.buffers) {
+      std::lock_guard bufferLock(buffer->mutex);
+      if (!first) {
+        stream << "," << std::endl;
+      }
+      first = false;
+      stream << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid << ", \"tid\": "
+             << buffer->thread << ", \"args\": {\"name\": \"thread " << buffer->thread << "\"}}";
+      for (const auto& event : buffer->events) {
+        stream << "," << std::endl << "{\"ph\": \"X\", \"cat\": \"" << event.category << "\", \"name\": \"";
+        detail::escape(stream, event.name);
+        stream << "\", \"pid\": " << pid << ", \"tid\": " << buffer->thread
+               << ", \"ts\": " << event.start << ", \"dur\": " << event.duration << "}";
+      }
+      buffer->events.clear();
+    }
+    stream << std::endl << "]}" << std::endl;
+  }
+
+  /**
+   * Turns tracing on until it goes away, then writes filename. If
+   * there's already a session going (a tool run by codegen run with
+   * --trace, say) this doesn't do anything and the events end up in
+   * that one's file. An empty filename doesn't do anything either.
+   */
+  class Session {
+    std::string _filename;
+
+  public:
+    Session(const std::string& filename) {
+      if (!filename.empty() && !detail::state().enabled.exchange(true)) {
+        _filename = filename;
+      }
+    }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    ~Session() {
+      if (_filename.empty()) {
+        return;
+      }
+      detail::state().enabled = false;
+      std::ofstream stream(_filename);
+      write(stream);
+    }
+
+    bool active() const {
+      return !_filename.empty();
+    }
+  };
+
+  /**
+   * Records a span for each top level enum, class and struct the parser
+   * finds. Declarations nested in those are part of their parent's span.
+   */
+  template <typename Parser>
+  void traceDeclarations(Parser& parser) {
+    if (!enabled()) {
+      return;
+    }
+    struct Open {
+      std::string name;
+      int64_t start = 0;
+      int depth = 0;
+      int classes = 0;
+      bool isEnum = false;
+      bool open = false;
+    };
+    auto current = std::make_shared<Open>();
+    auto depth = std::make_shared<int>(0);
+    auto begin = [current, depth](const std::string& name, bool isEnum) {
+      if (!current->open) {
+        current->name = name;
+        current->start = now();
+        current->depth = *depth;
+        current->classes = 0;
+        current->isEnum = isEnum;
+        current->open = true;
+      }
+    };
+    auto end = [current]() {
+      complete("declaration", current->isEnum ? "enum" : "class", current->name, current->start, now());
+      current->open = false;
+    };
+    parser.incScope.connect([depth]() { ++*depth; });
+    parser.decScope.connect([current, depth, end]() {
+      --*depth;
+      if (current->open && current->isEnum && *depth == current->depth) {
+        end();
+      }
+    });
+    parser.enumPush.connect([begin](const std::string& name, int) { begin(name, true); });
+    parser.enumClassPush.connect([begin](const std::string& name, int) { begin(name, true); });
+    auto classBegin = [current, begin](const std::string& name, int) {
+      begin(name, false);
+      if (!current->isEnum) {
+        current->classes++;
+      }
+    };
+    parser.classPush.connect(classBegin);
+    parser.structPush.connect(classBegin);
+    parser.classPop.connect([current, end]() {
+      if (current->open && !current->isEnum && --current->classes == 0) {
+        end();
+      }
+    });
+  }
+
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Tells you when files change, using inotify. This is what
+ * "codegen watch" uses to rerun just the steps whose inputs you
+ * saved.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <poll.h>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fr::codegen {
+
+  /**
+   * Watches the directories the files are in rather than the files
+   * themselves, since a lot of editors save by writing a new file and
+   * renaming it over the old one, and a watch on the old file would
+   * never hear about that.
+   */
+  class FileWatcher {
+    int _fd;
+    // Watch descriptor to directory
+    std::map<int, std::string> _directories;
+    std::set<std::string> _files;
+
+    static std::string normalize(const std::string& path) {
+      return std::filesystem::absolute(path).lexically_normal().string();
+    }
+
+    // Reads whatever events are waiting and adds the watched files they
+    // touched to changed
+    void drain(std::set<std::string>& changed) {
+      alignas(inotify_event) char buffer[16384];
+      while (true) {
+        ssize_t length = read(_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+          return;
+        }
+        for (char* at = buffer; at < buffer + length; ) {
+          auto event = reinterpret_cast<inotify_event*>(at);
+          at += sizeof(inotify_event) + event->len;
+          auto directory = _directories.find(event->wd);
+          if (directory == _directories.end() || event->len == 0) {
+            continue;
+          }
+          std::string path = (std::filesystem::path(directory->second) / event->name).string();
+          if (_files.contains(path)) {
+            changed.insert(path);
+          }
+        }
+      }
+    }
+
+  public:
+    FileWatcher() : _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+      if (_fd < 0) {
+        throw std::runtime_error(std::string("Couldn't start inotify: ") + strerror(errno));
+      }
+    }
+
+    ~FileWatcher() {
+      close(_fd);
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    const std::set<std::string>& files() const {
+      return _files;
+    }
+
+    void watch(const std::string& file) {
+      std::string path = normalize(file);
+      std::string directory = std::filesystem::path(path).parent_path().string();
+      // Adding the same directory again just gives us the same descriptor
+      int wd = inotify_add_watch(_fd, directory.c_str(),
+                                 IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+      if (wd < 0) {
+        throw std::runtime_error("Couldn't watch " + directory + ": " + strerror(errno));
+      }
+      _directories[wd] = directory;
+      _files.insert(path);
+    }
+
+    /**
+     * Waits up to timeoutMs (forever if it's negative) for watched files
+     * to change and returns their absolute paths. Once something
+     * changes this waits settleMs more for anything else, so saving a
+     * few files at once or an editor's write-then-rename comes back as
+     * one batch.
+     */
+    std::set<std::string> wait(int timeoutMs = -1, int settleMs = 5) {
+      std::set<std::string> changed;
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+      while (changed.empty()) {
+        int remaining = -1;
+        if (timeoutMs >= 0) {
+          auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+          if (left.count() <= 0) {
+            return changed;
+          }
+          remaining = left.count();
+        }
+        pollfd fd{_fd, POLLIN, 0};
+        int ready = poll(&fd, 1, remaining);
+        if (ready < 0 && errno != EINTR) {
+          throw std::runtime_error(std::string("Waiting for file changes failed: ") + strerror(errno));
+        }
+        if (ready > 0) {
+          drain(changed);
+        }
+        if (ready < 0) {
+          // Interrupted, let the caller see if it's time to quit
+          return changed;
+        }
+      }
+      pollfd fd{_fd, POLLIN, 0};
+      while (poll(&fd, 1, settleMs) > 0) {
+        drain(changed);
+      }
+      return changed;
+    }
+  };
+
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * A small work stealing thread pool. Each worker has its own queue
+ * and works off the back of it. Work submitted from a worker goes on
+ * that worker's queue, so a job that unlocks more jobs tends to run
+ * them next, while everything they need is still warm. A worker that
+ * runs out steals the oldest job from the front of somebody else's
+ * queue.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fr::codegen {
+
+  class WorkStealingPool {
+    using Job = std::function<void()>;
+
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    // Guards sleeping and waking, and _queued, not the queues
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _idle;
+    // Jobs sitting in the queues. It goes up before a job goes in and
+    // down after one comes out, so a worker that sees 0 can sleep
+    // knowing submit will wake it.
+    size_t _queued = 0;
+    // Submitted but not finished yet
+    std::atomic<size_t> _pending{0};
+    std::atomic<size_t> _next{0};
+    bool _stopping = false;
+
+    // Which worker the current thread is, if it's one of ours
+    static size_t& currentWorker() {
+      static thread_local size_t worker = static_cast<size_t>(-1);
+      return worker;
+    }
+
+    bool popLocal(size_t worker, Job& job) {
+      auto& queue = *_queues[worker];
+      std::lock_guard lock(queue.mutex);
+      if (queue.jobs.empty()) {
+        return false;
+      }
+      job = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+      return true;
+    }
+
+    bool steal(size_t worker, Job& job) {
+      for (size_t i = 1; i < _queues.size(); ++i) {
+        auto& queue = *_queues[(worker + i) % _queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+          job = std::move(queue.jobs.front());
+          queue.jobs.pop_front();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void work(size_t worker) {
+      currentWorker() = worker;
+      while (true) {
+        Job job;
+        if (popLocal(worker, job) || steal(worker, job)) {
+          {
+            std::lock_guard lock(_mutex);
+            --_queued;
+          }
+          job();
+          if (--_pending == 0) {
+            std::lock_guard lock(_mutex);
+            _idle.notify_all();
+          }
+          continue;
+        }
+        std::unique_lock lock(_mutex);
+        if (_stopping) {
+          return;
+        }
+        _wake.wait(lock, [this]() { return _stopping || _queued > 0; });
+      }
+    }
+
+  public:
+    // 0 threads means one per core
+    WorkStealingPool(size_t threads = 0) {
+      if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+      for (size_t i = 0; i < threads; ++i) {
+        _queues.push_back(std::make_unique<Queue>());
+      }
+      for (size_t i = 0; i < threads; ++i) {
+        _threads.emplace_back([this, i]() { work(i); });
+      }
+    }
+
+    ~WorkStealingPool() {
+      {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+      }
+      _wake.notify_all();
+      for (auto& thread : _threads) {
+        thread.join();
+      }
+    }
+
+    size_t size() const {
+      return _threads.size();
+    }
+
+    void submit(Job job) {
+      size_t worker = currentWorker();
+      if (worker >= _queues.size()) {
+        worker = _next++ % _queues.size();
+      }
+      ++_pending;
+      {
+        std::lock_guard lock(_mutex);
+        ++_queued;
+      }
+      {
+        std::lock_guard lock(_queues[worker]->mutex);
+        _queues[worker]->jobs.push_back(std::move(job));
+      }
+      _wake.notify_one();
+    }
+
+    // Blocks until everything submitted (including whatever those
+    // jobs submitted) is done. Don't call it from a job.
+    void wait() {
+      std::unique_lock lock(_mutex);
+      _idle.wait(lock, [this]() { return _pending == 0; });
+    }
+  };
+
+}
@@ -0,0 +1,262 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * The frcodegen Python module. Scripts that wanted to look at an index
+ * were loading the JSON with the json module, which takes forever on
+ * a big one. This puts the index in a flat block (see flat.h), or maps
+ * the one IndexCode --shared already put in shared memory, and hands
+ * Python views into it. Nothing gets copied until you ask a view for
+ * a string, and then you just get that string.
+ *
+ * parse_headers parses headers on a thread pool with the GIL released
+ * and hands back the same kind of store.
+ *
+ *   import frcodegen
+ *   store = frcodegen.IndexStore.load("index.json")
+ *   for c in store.classes:
+ *       print(c.key, [m.name for m in c.members])
+ *   store = frcodegen.parse_headers(["a.h", "b.h"], jobs=8)
+ */
+
+#include <fr/codegen/flat.h>
+#include <fr/codegen/indexer.h>
+#include <fr/codegen/tools.h>
+#include <memory>
+#include <nanobind/nanobind.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/string_view.h>
+#include <nanobind/stl/unique_ptr.h>
+#include <nanobind/stl/vector.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace nb = nanobind;
+using namespace fr::codegen;
+
+namespace {
+
+  /**
+   * Owns the block a FlatIndex looks at, either a copy we flattened
+   * ourselves or a mapped shared memory segment. Views point at the
+   * FlatIndex in here, so the store never moves once it's made and
+   * everything Python gets out of it keeps it alive.
+   */
+  class IndexStore {
+    std::string _block;
+#ifdef FR_CODEGEN_HAVE_SHM
+    std::optional<SharedIndex> _shared;
+#endif
+    FlatIndex _index;
+
+  public:
+    std::vector<std::string> failed;
+
+    explicit IndexStore(const Index& index) : _block(flat::Builder().build(index)), _index(_block) {}
+
+#ifdef FR_CODEGEN_HAVE_SHM
+    explicit IndexStore(SharedIndex shared) : _shared(std::move(shared)), _index(_shared->index()) {}
+#endif
+
+    IndexStore(const IndexStore&) = delete;
+    IndexStore& operator=(const IndexStore&) = delete;
+
+    // The shared memory segment if IndexCode --shared left a current
+    // one, otherwise the JSON (and its journal)
+    static std::unique_ptr<IndexStore> load(const std::string& filename) {
+#ifdef FR_CODEGEN_HAVE_SHM
+      auto stamp = indexStamp(filename);
+      if (stamp) {
+        auto shared = SharedIndex::attach(SharedIndex::segmentName(filename));
+        if (shared && shared->matches(*stamp)) {
+          return std::make_unique<IndexStore>(std::move(*shared));
+        }
+      }
+#endif
+      tools::ToolContext context;
+      return std::make_unique<IndexStore>(*context.indexes.load(filename));
+    }
+
+    const FlatIndex& index() const {
+      return _index;
+    }
+
+    bool shared() const {
+#ifdef FR_CODEGEN_HAVE_SHM
+      return _shared.has_value();
+#else
+      return false;
+#endif
+    }
+
+    void save(const std::string& filename) const {
+      _index.toIndex()->save(filename);
+    }
+  };
+
+  std::optional<parser::IndexDetail> indexDetail(const std::string& name) {
+    if (name == "enums") {
+      return parser::IndexDetail::enums;
+    }
+    if (name == "members") {
+      return parser::IndexDetail::members;
+    }
+    if (name == "full") {
+      return parser::IndexDetail::full;
+    }
+    return std::nullopt;
+  }
+
+  // Python indexes count from the back if they're negative
+  size_t position(Py_ssize_t i, size_t size) {
+    if (i < 0) {
+      i += size;
+    }
+    if (i < 0 || static_cast<size_t>(i) >= size) {
+      throw nb::index_error();
+    }
+    return i;
+  }
+
+  // A FlatList as a read only Python sequence of views
+  template <typename View, typename Record>
+  void bindList(nb::module_& m, const char* name) {
+    using List = FlatList<View, Record>;
+    auto list = nb::class_<List>(m, name)
+      .def("__len__", &List::size)
+      .def("__bool__", [](const List& list) { return !list.empty(); });
+    // Strings come back as str, and iterating goes through
+    // __getitem__ so it does too
+    if constexpr (std::is_same_v<View, FlatIndex::StringView>) {
+      list.def("__getitem__", [](const List& list, Py_ssize_t i) {
+        return std::string_view(list[position(i, list.size())]);
+      });
+    } else {
+      list.def("__getitem__", [](const List& list, Py_ssize_t i) {
+        return list[position(i, list.size())];
+      }, nb::keep_alive<0, 1>());
+      // The views come out of __next__ by value, and reference_internal
+      // only keeps the iterator alive for references, so each view gets
+      // an explicit keep_alive on the iterator. The iterator keeps the
+      // list alive and the list keeps the store.
+      list.def("__iter__", [](const List& list) {
+        return nb::make_iterator<nb::rv_policy::reference_internal>(nb::type<List>(), "iterator",
+                                                                    list.begin(), list.end(),
+                                                                    nb::keep_alive<0, 1>());
+      }, nb::keep_alive<0, 1>());
+    }
+  }
+
+}
+
+NB_MODULE(frcodegen, m) {
+  m.doc() = "Read only views of an FR codegen index, and a parallel header parser to make one";
+
+  // Everything that hands back a view or a list keeps whatever it
+  // came from alive, all the way back to the store
+  nb::class_<FlatParameterView>(m, "ParameterView")
+    .def_prop_ro("type", &FlatParameterView::type)
+    .def_prop_ro("name", &FlatParameterView::name)
+    .def_prop_ro("type_const", &FlatParameterView::typeConst)
+    .def_prop_ro("name_const", &FlatParameterView::nameConst);
+
+  nb::class_<FlatMethodView>(m, "MethodView")
+    .def_prop_ro("return_type", &FlatMethodView::returnType)
+    .def_prop_ro("name", &FlatMethodView::name)
+    .def_prop_ro("parameters", &FlatMethodView::parameters, nb::keep_alive<0, 1>())
+    .def_prop_ro("is_public", &FlatMethodView::isPublic)
+    .def_prop_ro("is_protected", &FlatMethodView::isProtected)
+    .def_prop_ro("is_virtual", &FlatMethodView::isVirtual)
+    .def_prop_ro("is_const", &FlatMethodView::isConst)
+    .def_prop_ro("is_static", &FlatMethodView::isStatic);
+
+  nb::class_<FlatMemberView>(m, "MemberView")
+    .def_prop_ro("type", &FlatMemberView::type)
+    .def_prop_ro("name", &FlatMemberView::name)
+    .def_prop_ro("is_public", &FlatMemberView::isPublic)
+    .def_prop_ro("is_protected", &FlatMemberView::isProtected)
+    .def_prop_ro("is_const", &FlatMemberView::isConst)
+    .def_prop_ro("is_static", &FlatMemberView::isStatic)
+    .def_prop_ro("serializable", &FlatMemberView::serializable)
+    .def_prop_ro("generate_getter", &FlatMemberView::generateGetter)
+    .def_prop_ro("generate_setter", &FlatMemberView::generateSetter);
+
+  nb::class_<FlatIndex::EnumView>(m, "EnumView")
+    .def_prop_ro("key", &FlatIndex::EnumView::key)
+    .def_prop_ro("name", &FlatIndex::EnumView::name)
+    .def_prop_ro("defined_in", &FlatIndex::EnumView::definedIn)
+    .def_prop_ro("underlying_type", &FlatIndex::EnumView::underlyingType)
+    .def_prop_ro("hash", &FlatIndex::EnumView::hash)
+    .def_prop_ro("is_class_enum", &FlatIndex::EnumView::isClassEnum)
+    .def_prop_ro("namespaces", &FlatIndex::EnumView::namespaces, nb::keep_alive<0, 1>())
+    .def_prop_ro("identifiers", &FlatIndex::EnumView::identifiers, nb::keep_alive<0, 1>())
+    .def("__repr__", [](const FlatIndex::EnumView& view) {
+      return "<EnumView " + std::string(view.key()) + ">";
+    });
+
+  nb::class_<FlatIndex::ClassView>(m, "ClassView")
+    .def_prop_ro("key", &FlatIndex::ClassView::key)
+    .def_prop_ro("name", &FlatIndex::ClassView::name)
+    .def_prop_ro("defined_in", &FlatIndex::ClassView::definedIn)
+    .def_prop_ro("hash", &FlatIndex::ClassView::hash)
+    .def_prop_ro("is_struct", &FlatIndex::ClassView::isStruct)
+    .def_prop_ro("serializable", &FlatIndex::ClassView::serializable)
+    .def_prop_ro("namespaces", &FlatIndex::ClassView::namespaces, nb::keep_alive<0, 1>())
+    .def_prop_ro("parents", &FlatIndex::ClassView::parents, nb::keep_alive<0, 1>())
+    .def_prop_ro("methods", &FlatIndex::ClassView::methods, nb::keep_alive<0, 1>())
+    .def_prop_ro("members", &FlatIndex::ClassView::members, nb::keep_alive<0, 1>())
+    .def("__repr__", [](const FlatIndex::ClassView& view) {
+      return "<ClassView " + std::string(view.key()) + ">";
+    });
+
+  bindList<FlatIndex::StringView, flat::Str>(m, "StringList");
+  bindList<FlatParameterView, flat::ParameterRecord>(m, "ParameterList");
+  bindList<FlatMethodView, flat::MethodRecord>(m, "MethodList");
+  bindList<FlatMemberView, flat::MemberRecord>(m, "MemberList");
+  bindList<FlatIndex::EnumView, flat::EnumRecord>(m, "EnumList");
+  bindList<FlatIndex::ClassView, flat::ClassRecord>(m, "ClassList");
+
+  nb::class_<IndexStore>(m, "IndexStore")
+    .def_static("load", &IndexStore::load, nb::arg("filename"),
+                "Load an index IndexCode wrote, from shared memory if IndexCode --shared published it")
+    .def_prop_ro("enums", [](const IndexStore& store) { return store.index().enums(); }, nb::keep_alive<0, 1>())
+    .def_prop_ro("classes", [](const IndexStore& store) { return store.index().classes(); }, nb::keep_alive<0, 1>())
+    .def_prop_ro("shared", &IndexStore::shared, "True if this is mapped from shared memory")
+    .def_ro("failed", &IndexStore::failed, "Headers parse_headers couldn't read or parse")
+    .def("find_enum", [](const IndexStore& store, std::string_view key) { return store.index().findEnum(key); },
+         nb::arg("key"), nb::keep_alive<0, 1>(), "The enum with this index key, or None")
+    .def("find_class", [](const IndexStore& store, std::string_view key) { return store.index().findClass(key); },
+         nb::arg("key"), nb::keep_alive<0, 1>(), "The class with this index key, or None")
+    .def("save", &IndexStore::save, nb::arg("filename"), "Write the index out as JSON, like IndexCode does");
+
+  m.def("parse_headers", [](const std::vector<std::string>& paths, size_t jobs, const std::string& detail) {
+    auto level = indexDetail(detail);
+    if (!level) {
+      throw nb::value_error("detail has to be enums, members or full");
+    }
+    std::vector<std::string> failed;
+    std::unique_ptr<IndexStore> store;
+    {
+      nb::gil_scoped_release release;
+      store = std::make_unique<IndexStore>(*indexHeaders(paths, *level, jobs, &failed));
+    }
+    store->failed = std::move(failed);
+    return store;
+  }, nb::arg("paths"), nb::arg("jobs") = 0, nb::arg("detail") = "full",
+     "Parse headers on jobs threads (0 for one per core) without holding the GIL");
+}
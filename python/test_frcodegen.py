@@ -0,0 +1,94 @@
+# Copyright 2026 Bruce Ide
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+# Smoke test for the frcodegen module. The views point straight into
+# the store's block, so the thing to check is that everything you get
+# out of a store still works after you've let go of the store and the
+# list it came out of. python/CMakeLists.txt runs this as
+#
+#   test_frcodegen.py IndexCode work_directory
+
+import gc
+import os
+import subprocess
+import sys
+
+import frcodegen
+
+HEADER = """
+namespace shapes {
+  enum class Color { Red, Green };
+  class Circle {
+  public:
+    int radius;
+    Color color;
+    int area() const;
+    void grow(int by);
+  };
+}
+"""
+
+
+def check_views(load):
+    # Nothing but the views is holding on to the store by the time we
+    # look at them
+    assert list(load().classes)[0].key.endswith("Circle")
+    circle = list(load().classes)[0]
+    members = list(circle.members)
+    methods = list(load().classes)[0].methods
+    grow = [method for method in methods if method.name == "grow"][0]
+    parameters = list(grow.parameters)
+    color = list(load().enums)[0]
+    identifiers = load().enums[0].identifiers
+    del circle, methods, grow
+    gc.collect()
+
+    assert [member.name for member in members] == ["radius", "color"]
+    assert [parameter.name for parameter in parameters] == ["by"]
+    assert color.key == "shapes::Color"
+    assert list(identifiers) == ["Red", "Green"]
+
+
+def main():
+    index_code, work = sys.argv[1], sys.argv[2]
+    os.makedirs(work, exist_ok=True)
+    headers = []
+    for i in range(4):
+        header = os.path.join(work, "shapes%d.h" % i)
+        with open(header, "w") as stream:
+            # Only the first one has anything in it, so the views can't
+            # come from somewhere else
+            stream.write(HEADER if i == 0 else "\n")
+        headers.append(header)
+
+    json_index = os.path.join(work, "index.json")
+    shared_index = os.path.join(work, "shared.json")
+    subprocess.run([index_code, "-o", json_index, "-h", headers[0]], check=True, stdout=subprocess.DEVNULL)
+    subprocess.run([index_code, "-o", shared_index, "--shared", "-h", headers[0]], check=True,
+                   stdout=subprocess.DEVNULL)
+
+    assert not frcodegen.IndexStore.load(json_index).shared
+    check_views(lambda: frcodegen.IndexStore.load(json_index))
+    assert frcodegen.IndexStore.load(shared_index).shared
+    check_views(lambda: frcodegen.IndexStore.load(shared_index))
+
+    # The pool hands its results back through the same store
+    store = frcodegen.parse_headers(headers + [os.path.join(work, "missing.h")], jobs=4)
+    assert store.failed == [os.path.join(work, "missing.h")]
+    check_views(lambda: frcodegen.parse_headers(headers, jobs=4))
+    print("frcodegen OK")
+
+
+if __name__ == "__main__":
+    main()
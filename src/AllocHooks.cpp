@@ -0,0 +1,63 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Replacement operator new and delete that count allocations against
+ * the current phase (see fr/codegen/alloc.h). This only gets built
+ * into things when you configure with -DFR_CODEGEN_ALLOC_HOOKS=ON.
+ *
+ * Every block gets a small header in front of it with its size and
+ * the phase that allocated it, so frees get counted against the
+ * right phase no matter which thread or phase does the freeing. The
+ * array, nothrow and sized versions in the standard library all end
+ * up here, so these two are all we need to replace. Over-aligned
+ * allocations go around us.
+ */
+
+#include <cstdlib>
+#include <fr/codegen/alloc.h>
+#include <new>
+
+namespace {
+
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) BlockHeader {
+    size_t size;
+    size_t phase;
+  };
+
+}
+
+void* operator new(std::size_t size) {
+  auto header = static_cast<BlockHeader*>(std::malloc(size + sizeof(BlockHeader)));
+  if (!header) {
+    throw std::bad_alloc();
+  }
+  header->size = size;
+  header->phase = fr::codegen::alloc::current();
+  fr::codegen::alloc::allocated(header->phase, size);
+  return header + 1;
+}
+
+void operator delete(void* block) noexcept {
+  if (!block) {
+    return;
+  }
+  auto header = static_cast<BlockHeader*>(block) - 1;
+  fr::codegen::alloc::freed(header->phase, header->size);
+  std::free(header);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+  operator delete(block);
+}
@@ -0,0 +1,278 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Runs the whole pipeline over synthetic corpora of increasing size
+ * and writes how each stage did to a JSON results file. The stages
+ * are IndexCode over every header, then OstreamOpsFromIndex and
+ * GeneratePythonApi over the whole index and GenerateFunctions on
+ * --samples of the headers. A real build runs GenerateFunctions once
+ * per header, which would take all day at 100k classes, but since
+ * each run loads the whole index a sample still shows how it scales.
+ * Its numbers are the average for one header.
+ *
+ * Each stage is a separate process, so its peak RSS is its own. The
+ * programs are run with the daemon and the output cache turned off,
+ * so everything really gets done.
+ *
+ * Afterwards it checks for stages whose time grew faster than
+ * size^--max-exponent between sizes, and with --baseline for stages
+ * that got more than --threshold percent slower or bigger than in an
+ * earlier results file. If it finds either, it says so and exits 1.
+ * --compare skips the runs and checks a results file you already
+ * have.
+ */
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <fr/codegen/scaling.h>
+#include <iostream>
+#include <spawn.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <vector>
+
+extern char** environ;
+
+using namespace fr::codegen::scaling;
+
+namespace {
+
+  void printHelp(boost::program_options::options_description &desc) {
+    std::cout << "Usage: CodegenScaling [options]" << std::endl << std::endl;
+    std::cout << "Runs IndexCode and the generators over synthetic corpora of" << std::endl;
+    std::cout << "increasing size, records wall time, peak RSS and output size" << std::endl;
+    std::cout << "for each stage, and flags stages that scale badly or got worse" << std::endl;
+    std::cout << "than a baseline." << std::endl;
+    std::cout << desc << std::endl << std::endl;
+  }
+
+  struct Run {
+    bool ok = false;
+    double wallMs = 0.0;
+    uint64_t peakRssKb = 0;
+  };
+
+  // Runs a program with its chatter going to /dev/null
+  Run run(const std::vector<std::string>& command) {
+    std::vector<char*> argv;
+    for (const auto& arg : command) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    Run ret;
+    pid_t pid;
+    auto start = std::chrono::steady_clock::now();
+    int error = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+      std::cerr << "Couldn't run " << command[0] << std::endl;
+      return ret;
+    }
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+      return ret;
+    }
+    ret.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ret.peakRssKb = usage.ru_maxrss;
+    ret.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!ret.ok) {
+      std::cerr << command[0] << " failed" << std::endl;
+    }
+    return ret;
+  }
+
+  uint64_t fileSize(const std::filesystem::path& file) {
+    std::error_code error;
+    auto size = std::filesystem::file_size(file, error);
+    return error ? 0 : size;
+  }
+
+  // Runs one size of corpus through the pipeline, adding a measurement
+  // for each stage to results. Returns false if anything failed.
+  bool measure(const std::filesystem::path& tools, const std::filesystem::path& work, size_t classes,
+               size_t samples, Results& results) {
+    auto directory = work / std::to_string(classes);
+    std::cout << "Writing " << classes << " classes to " << directory.string() << std::endl;
+    auto corpus = writeCorpus(directory, classes);
+    auto index = (directory / "index.json").string();
+    auto output = directory / "generated";
+    std::filesystem::create_directories(output);
+
+    auto record = [&](const std::string& stage, const Run& run, uint64_t bytes) {
+      std::cout << "  " << stage << ": " << run.wallMs << " ms, " << run.peakRssKb << " KB peak, " << bytes
+                << " bytes out" << std::endl;
+      results.measurements.push_back({stage, classes, run.wallMs, run.peakRssKb, bytes});
+    };
+
+    auto indexed = run({(tools / "IndexCode").string(), "--root", corpus.headerDirectory.string(),
+                        "--glob", "*.h.in", "-o", index});
+    if (!indexed.ok) {
+      return false;
+    }
+    record("IndexCode", indexed, fileSize(index));
+
+    auto ops = run({(tools / "OstreamOpsFromIndex").string(), "-i", index, "-h", (output / "ops.h").string(),
+                    "-c", (output / "ops.cpp").string()});
+    if (!ops.ok) {
+      return false;
+    }
+    record("OstreamOpsFromIndex", ops, fileSize(output / "ops.h") + fileSize(output / "ops.cpp"));
+
+    // Averaged over the samples, since small corpora don't have as
+    // many headers as we'd like to sample
+    Run functions{true};
+    uint64_t functionBytes = 0;
+    size_t runs = 0;
+    size_t step = std::max<size_t>(corpus.headers.size() / std::max<size_t>(samples, 1), 1);
+    for (size_t i = 0; i < corpus.headers.size(); i += step, ++runs) {
+      auto generated = output / corpus.headers[i].stem();
+      auto sample = run({(tools / "GenerateFunctions").string(), "-h", corpus.headers[i].string(), "-i", index,
+                         "-o", generated.string()});
+      if (!sample.ok) {
+        return false;
+      }
+      functions.wallMs += sample.wallMs;
+      functions.peakRssKb = std::max(functions.peakRssKb, sample.peakRssKb);
+      functionBytes += fileSize(generated);
+    }
+    functions.wallMs /= runs;
+    record("GenerateFunctions", functions, functionBytes / runs);
+
+    auto api = run({(tools / "GeneratePythonApi").string(), "-s", corpus.pythonTemplate.string(), "-i", index,
+                    "-o", (output / "PythonApi.cpp").string()});
+    if (!api.ok) {
+      return false;
+    }
+    record("GeneratePythonApi", api, fileSize(output / "PythonApi.cpp"));
+
+    std::filesystem::remove_all(directory);
+    return true;
+  }
+
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> sizes;
+  std::string toolDirectory;
+  std::string workDirectory;
+  std::string outputFile;
+  std::string compareFile;
+  std::string baselineFile;
+  size_t samples = 10;
+  double threshold = 10.0;
+  double maxExponent = 1.2;
+  double minMs = 20.0;
+
+  boost::program_options::options_description desc("Options:");
+  boost::program_options::variables_map vm;
+
+  desc.add_options()
+    ("help", "Print this message")
+    ("sizes,s",
+     boost::program_options::value<std::vector<size_t>>(&sizes)->multitoken()->composing(),
+     "Corpus sizes to run, in classes (default 1000 10000 100000)")
+    ("tools,t",
+     boost::program_options::value<std::string>(&toolDirectory),
+     "Directory IndexCode and the generators are in (defaults to the one this program is in)")
+    ("work,w",
+     boost::program_options::value<std::string>(&workDirectory),
+     "Directory to write the corpora to (defaults to codegen_scaling in the temp directory)")
+    ("output,o",
+     boost::program_options::value<std::string>(&outputFile)->default_value("scaling.json"),
+     "JSON results file to write")
+    ("compare,c",
+     boost::program_options::value<std::string>(&compareFile),
+     "Check this results file instead of running anything")
+    ("baseline,b",
+     boost::program_options::value<std::string>(&baselineFile),
+     "Earlier results file to check for regressions against")
+    ("samples",
+     boost::program_options::value<size_t>(&samples)->default_value(10),
+     "How many headers to run GenerateFunctions on at each size")
+    ("threshold",
+     boost::program_options::value<double>(&threshold)->default_value(10.0),
+     "Percent slower or bigger than the baseline that counts as a regression")
+    ("max-exponent",
+     boost::program_options::value<double>(&maxExponent)->default_value(1.2),
+     "Flag stages whose time grows faster than size to this power")
+    ("min-ms",
+     boost::program_options::value<double>(&minMs)->default_value(20.0),
+     "Times shorter than this are too noisy to check");
+
+  try {
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+    boost::program_options::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    printHelp(desc);
+    return 1;
+  }
+
+  if (vm.count("help")) {
+    printHelp(desc);
+    return 0;
+  }
+
+  Results results;
+  try {
+    if (!compareFile.empty()) {
+      results.load(compareFile);
+    } else {
+      if (sizes.empty()) {
+        sizes = {1000, 10000, 100000};
+      }
+      std::filesystem::path tools = toolDirectory.empty()
+        ? std::filesystem::absolute(argv[0]).parent_path()
+        : std::filesystem::path(toolDirectory);
+      std::filesystem::path work = workDirectory.empty()
+        ? std::filesystem::temp_directory_path() / "codegen_scaling"
+        : std::filesystem::path(workDirectory);
+      // We want to time the work, not the daemon or the cache
+      setenv("CODEGEND_DISABLE", "1", 1);
+      unsetenv("CODEGEN_CACHE_DIR");
+      for (auto size : sizes) {
+        if (!measure(tools, work, size, samples, results)) {
+          return 1;
+        }
+      }
+      results.save(outputFile);
+      std::cout << "Wrote " << outputFile << std::endl;
+    }
+
+    auto problems = superLinear(results, maxExponent, minMs);
+    if (!baselineFile.empty()) {
+      Results baseline;
+      baseline.load(baselineFile);
+      auto regressed = regressions(results, baseline, threshold, minMs);
+      problems.insert(problems.end(), regressed.begin(), regressed.end());
+    }
+    for (const auto& problem : problems) {
+      std::cout << "WARNING: " << problem << std::endl;
+    }
+    return problems.empty() ? 0 : 1;
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -24,29 +24,38 @@
  * -i C++ Filename - input file
  * -c Output .cpp file
  * -h Output .cpp header
+ * --stats JSON file to write timing and counters to
+ * --trace JSON file to write a Chrome trace event timeline to
  *
  * Error handling is more or less non-existent. Make sure your enum code
  * compiles prior to feeding it to this application.
  */
 
 #include <boost/program_options.hpp>
+#include <fr/codegen/daemon.h>
 #include <fr/codegen/data.h>
 #include <fr/codegen/parser.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/stats.h>
+#include <fr/codegen/tools.h>
+#include <fr/codegen/trace.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
+// Not fr::codegen::EnumMap, which holds pointers
 using EnumMap = std::map<std::string, fr::codegen::EnumData>;
 
 // generateHeader takes your enum driver, header stream and the name of your enum source file so it can include it
 // and generates a header with function signatures
 
-void generateHeader(EnumMap enums, std::ofstream& stream, const std::string& enumSource) {
+void generateHeader(const EnumMap& enums, std::ofstream& stream, const std::string& enumSource) {
   stream << "/* This is generated code. Do not edit. Unless you really want to. */" << std::endl;
   stream << "#pragma once" << std::endl;
   stream << "#include <string>" << std::endl;
@@ -64,7 +73,7 @@ void generateHeader(EnumMap enums, std::ofstream& stream, const std::string& enu
 
 // TODO: Generated code is kind of awful right now. De-awfulfy when I get a moment
 
-void generateSource(EnumMap &enums, std::ofstream& stream, const std::string& myHeader) {
+void generateSource(const EnumMap& enums, std::ofstream& stream, const std::string& myHeader) {
   stream << "/* This is generated code. Do not edit. Unless you really want to. */" << std::endl;
   stream << "#include <" << myHeader << ">" << std::endl << std::endl;
   
@@ -127,10 +136,12 @@ void generateSource(EnumMap &enums, std::ofstream& stream, const std::string& my
   }
 }
 
-int main(int argc, char* argv[]) {
+int fr::codegen::tools::generateEnumFunctions(int argc, char* argv[], std::ostream& out, ToolContext&) {
   std::string inputFile;
   std::string outputCpp;
   std::string outputHeader;
+  std::string statsFile;
+  std::string traceFile;
 
   // Command line flag handling
 
@@ -140,6 +151,8 @@ int main(int argc, char* argv[]) {
     ("input,i", boost::program_options::value<std::string>(&inputFile)->required(), "Input file with enum declarations")
     ("cpp,c", boost::program_options::value<std::string>(&outputCpp)->required(), "Output .cpp file")
     ("header,h", boost::program_options::value<std::string>(&outputHeader)->required(), "Output header file")
+    ("stats", boost::program_options::value<std::string>(&statsFile), "Write timing and counters for this run to a JSON file")
+    ("trace", boost::program_options::value<std::string>(&traceFile), "Write a Chrome trace event timeline of this run to a JSON file")
     ;
 
   boost::program_options::variables_map vm;
@@ -148,10 +161,13 @@ int main(int argc, char* argv[]) {
 
   fr::codegen::parser::ParserDriver parser;
   fr::codegen::EnumDriver driver;
-  EnumMap enums;
+  ::EnumMap enums;
+  fr::codegen::trace::Session traceSession(traceFile);
+  fr::codegen::Stats stats(statsFile, "GenerateEnumFunctions");
 
-  driver.enumAvailable.connect([&enums](const std::string key, fr::codegen::EnumData value) {
+  driver.enumAvailable.connect([&enums, &stats](const std::string& key, const fr::codegen::EnumData& value) {
     enums[key] = value;
+    stats.count("declarations");
   });
   
   std::string result;
@@ -160,15 +176,41 @@ int main(int argc, char* argv[]) {
   std::ofstream sourceStream(outputCpp);
   std::ofstream headerStream(outputHeader);
   std::stringstream input;
+  auto readTimer = stats.time("read");
   input << inputStream.rdbuf();
+  readTimer.stop();
+  stats.count("bytes in", input.view().size());
+  stats.count("lines in", std::count(input.view().begin(), input.view().end(), '\n'));
 
   // Register enum driver with parser
   driver.regParser(parser);
+  stats.instrumentParser(parser);
+  fr::codegen::trace::traceDeclarations(parser);
+  auto parseTimer = stats.time("parse");
+  auto parseSpan = std::make_unique<fr::codegen::trace::Span>("header", "parse", inputFile);
   bool parseSuccess = parser.parse(input.view().begin(), input.view().end(), result);
+  parseSpan.reset();
+  parseTimer.stop();
   if (parseSuccess) {
+    // These stream straight to the files, so this is generate and write
+    auto timer = stats.time("generate");
+    fr::codegen::trace::Span span("file", "generate", outputCpp);
     generateHeader(enums, headerStream, inputFile);
     generateSource(enums, sourceStream, outputHeader);
   } else {
-    std::cout << "Parse failed" << std::endl;
+    out << "Parse failed" << std::endl;
+    return 1;
   }
+  return 0;
 }
+
+#ifndef FR_CODEGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+  int exitCode = 0;
+  if (fr::codegen::daemon::forward("GenerateEnumFunctions", argc, argv, exitCode)) {
+    return exitCode;
+  }
+  fr::codegen::tools::ToolContext context;
+  return fr::codegen::tools::generateEnumFunctions(argc, argv, std::cout, context);
+}
+#endif
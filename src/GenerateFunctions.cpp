@@ -15,25 +15,45 @@
  *
  * This is a line-by-line preprocessor that reads lines of code from
  * your program and emits lines of code out. If it encounters the
- * annotations [[genGetSetMethods]] or [[genCerealLoadSave]], it will
- * NOT emit those lines and instead will emit getters and setters or
- * cereal serialziation functions instead. If the class they're currently
+ * annotations [[genGetSetMethods]], [[genCerealLoadSave]] or
+ * [[genJsonCodec]], it will NOT emit those lines and instead will emit
+ * getters and setters, cereal serialziation functions or direct JSON
+ * reading and writing functions instead. If the class they're currently
  * in has not tagged any members to generate getter or setters or
  * serialization functions, nothing will be emitted in the place of those
  * lines. Getters and setters must currently be generated as inline
  * methods.
  *
  * An index.json file must exist and be passed to this program on the
- * command line.
+ * command line. You can pass -i more than once. The first index is
+ * yours and the rest are for classes other packages indexed, which
+ * get looked up if the header uses a class that isn't in yours.
+ *
+ * If you pass --deps with a sidecar file, this records which classes
+ * the header actually used. The next run with the same sidecar won't
+ * touch the output if the header and those classes haven't changed,
+ * even if other stuff in the index did.
+ *
+ * --cache (or CODEGEN_CACHE_DIR) looks the output up in a local cache
+ * of generated files before generating it, see cache.h.
  */
 
 #include <boost/program_options.hpp>
+#include <fr/codegen/cache.h>
+#include <fr/codegen/daemon.h>
 #include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/depfile.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/index.h>
 #include <fr/codegen/parser.h>
 #include <fr/codegen/LblFilter.h>
 #include <fr/codegen/LblMiniParser.h>
+#include <fr/codegen/LblTemplate.h>
 #include <fr/codegen/LblEmitFunctions.h>
+#include <fr/codegen/stats.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/tools.h>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -41,25 +61,39 @@
 #include <string>
 #include <vector>
 
-void printHelp(boost::program_options::options_description& desc) {
-  std::cout << "This program reads C++ header code line by line, looking for" << std::endl;
-  std::cout << "[[genGetSetMethods]] and [[genCerealLoadSave]] tags, which" << std::endl;
-  std::cout << "exist in the code on a line by themselves. When one of these" << std::endl;
-  std::cout << "is encoutered, it will be replaced by functions dictated by" << std::endl;
-  std::cout << "annotation tags in the class when the class is indexed by" << std::endl;
-  std::cout << "IndexCode." << std::endl;
-  std::cout << desc << std::endl;    
+namespace {
+
+  void printHelp(boost::program_options::options_description& desc, std::ostream& out) {
+    out << "This program reads C++ header code line by line, looking for" << std::endl;
+    out << "[[genGetSetMethods]], [[genCerealLoadSave]] and [[genJsonCodec]] tags, which" << std::endl;
+    out << "exist in the code on a line by themselves. When one of these" << std::endl;
+    out << "is encoutered, it will be replaced by functions dictated by" << std::endl;
+    out << "annotation tags in the class when the class is indexed by" << std::endl;
+    out << "IndexCode." << std::endl;
+    out << desc << std::endl;    
+  }
+
 }
 
-int main(int argc, char *argv[]) {
+int fr::codegen::tools::generateFunctions(int argc, char *argv[], std::ostream& out, ToolContext& context) {
   using namespace fr::codegen;
   
   // Header to read
   std::string header;
   // output file
   std::string output;
-  // Index file
-  std::string index;
+  // Index files, ours first
+  std::vector<std::string> indexFiles;
+  // Dependency sidecar
+  std::string depsFile;
+  // Depfile for the build system
+  std::string depfile;
+  // Timing and counters
+  std::string statsFile;
+  // Timeline
+  std::string traceFile;
+  // Generated file cache
+  std::string cacheDir;
   
   boost::program_options::options_description desc("Options:");
   boost::program_options::variables_map vm;
@@ -69,34 +103,77 @@ int main(int argc, char *argv[]) {
      boost::program_options::value<std::string>(&header),
      "Header to add functions to")
     ("index,i",
-     boost::program_options::value<std::string>(&index),
-     "json index generated by IndexCode")
+     boost::program_options::value<std::vector<std::string>>(&indexFiles)->composing(),
+     "json index generated by IndexCode. Pass it again for indexes of other packages to look classes up in.")
     ("output,o",
      boost::program_options::value<std::string>(&output),
      "Output file to write modified header to")
+    ("deps,d",
+     boost::program_options::value<std::string>(&depsFile),
+     "Sidecar file to record what the output was generated from")
+    ("depfile",
+     boost::program_options::value<std::string>(&depfile),
+     "Write a Makefile style depfile listing what this read, for the build system")
+    ("stats",
+     boost::program_options::value<std::string>(&statsFile),
+     "Write timing and counters for this run to a JSON file")
+    ("trace",
+     boost::program_options::value<std::string>(&traceFile),
+     "Write a Chrome trace event timeline of this run to a JSON file")
+    ("cache",
+     boost::program_options::value<std::string>(&cacheDir),
+     "Cache generated files in this directory (defaults to CODEGEN_CACHE_DIR)")
     ;
 
   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
   boost::program_options::notify(vm);
 
   if (!vm.count("header") || !vm.count("output")) {
-    printHelp(desc);
-    exit(1);
+    printHelp(desc, out);
+    return 1;
   }
 
-  std::map<std::string, std::shared_ptr<EnumData>> enumMap;
-  std::map<std::string, std::shared_ptr<ClassData>> classMap;
+  trace::Session traceSession(traceFile);
+  Stats stats(statsFile, "GenerateFunctions");
+  std::vector<std::string> inputs{header};
+  inputs.insert(inputs.end(), indexFiles.begin(), indexFiles.end());
+  writeDepfile(depfile, {output}, inputs);
 
-  std::cout << "Reading Index..." << std::endl;
+  out << "Reading Index..." << std::endl;
+  auto loadTimer = stats.time("index load");
+  IndexSet index;
+  for (const auto& indexFile : indexFiles) {
+    index.add(context.indexes.load(indexFile));
+  }
+  if (index.empty()) {
+    index.add(std::make_shared<Index>());
+  }
+  loadTimer.stop();
+  auto& classMap = index.primary().classes;
 
-  std::ifstream indexStream(index);
-  {
-    cereal::JSONInputArchive archive(indexStream);
-    archive(enumMap);
-    archive(classMap);
+  DependencyTracker deps(depsFile);
+  if (deps.upToDate(output, index)) {
+    out << output << " is up to date" << std::endl;
+    DependencyTracker::touch(output);
+    deps.keep(output);
+    deps.save();
+    return 0;
+  }
+  deps.consumedFile(output, header);
+
+  // We find out which classes the header uses as we go, so the cache
+  // works that out from what it recorded last time
+  auto cache = OutputCache::fromEnvironment(cacheDir, context.getenv);
+  HashMap known = deps.inputsOf(output);
+  if (auto cached = cache.fetch("GenerateFunctions", known, index, {output})) {
+    out << output << " came from the cache" << std::endl;
+    stats.count("cache hits");
+    deps.consumed(output, *cached);
+    deps.save();
+    return 0;
   }
 
-  std::cout << "Setting up line by line processor...." << std::endl;
+  out << "Setting up line by line processor...." << std::endl;
 
   // if we add more methods to the chain we just need to keep subscribing to
   // the previous one. Only one filter should subscribe to anything else
@@ -104,34 +181,81 @@ int main(int argc, char *argv[]) {
   // these objects for stuff like telemetry and debugging if you need to.
   // So just shuffle stuff in before the LblWriter.
   
-  LblReader reader(header);
-  
-  fr::codegen::miniparser::LblMiniparser parser;
-  parser.subscribeTo(reader);
+  // Other steps in the same process (codegen run, codegend) get the
+  // same read of the template out of the context
+  auto templateTimer = stats.time("template load");
+  LblTemplateReader parser(context.templates.load(header));
+  templateTimer.stop();
+  stats.countLines(parser, "lines in", "bytes in");
 
-  parser.classPush.connect([](const std::string& className) {
-    std::cout << "Processing " << className << "...";
+  parser.classPush.connect([&](const std::string& className) {
+    out << "Processing " << className << "...";
+    stats.count("declarations");
+    // We only get the bare name, so remember which class it meant as
+    // well as that class's hash. If it's not in the index, or more than
+    // one namespace has a class by that name, it didn't mean any one
+    // class and we'll always regenerate. Which is what we want, since
+    // it might show up in the index later and there's no telling which
+    // one the filters used.
+    deps.consumed(output, index, classNameKey(className));
+    std::string key = index.findClassKey(className);
+    if (!key.empty()) {
+      deps.consumed(output, index, classKey(key));
+    }
   });
 
-  parser.classPop.connect([](){
-    std::cout << "Done" << std::endl;
+  parser.classPop.connect([&out](){
+    out << "Done" << std::endl;
   });
 
   LblEmitGetSetMethods getSetEmitter(classMap);
+  getSetEmitter.resolveWith(index);
+  getSetEmitter.warnTo(out);
   getSetEmitter.subscribeTo(parser);
 
   LblEmitCerealMethods cerealEmitter(classMap);
+  cerealEmitter.resolveWith(index);
+  cerealEmitter.warnTo(out);
   cerealEmitter.subscribeTo(getSetEmitter);
 
+  LblEmitJsonCodec jsonEmitter(classMap);
+  jsonEmitter.resolveWith(index);
+  jsonEmitter.warnTo(out);
+  jsonEmitter.subscribeTo(cerealEmitter);
+
   LblEatAnnotations annotationEater(classMap);
-  annotationEater.subscribeTo(cerealEmitter);
+  annotationEater.resolveWith(index);
+  annotationEater.warnTo(out);
+  annotationEater.subscribeTo(jsonEmitter);
   
   LblWriter writer(output);
   writer.subscribeTo(annotationEater);
+  stats.countLines(annotationEater, "lines out", "bytes out");
 
-  reader.process();
+  {
+    auto timer = stats.time("generate");
+    trace::Span span("file", "generate", output);
+    parser.process();
+  }
+  writer.close();
+  if (cache.enabled()) {
+    stats.count("cache misses");
+    cache.store("GenerateFunctions", known, deps.inputsOf(output), {output});
+  }
+  deps.save();
 
-  std::cout << "Processing complete" << std::endl;
-  exit(0);
+  out << "Processing complete" << std::endl;
+  return 0;
   
 }
+
+#ifndef FR_CODEGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+  int exitCode = 0;
+  if (fr::codegen::daemon::forward("GenerateFunctions", argc, argv, exitCode)) {
+    return exitCode;
+  }
+  fr::codegen::tools::ToolContext context;
+  return fr::codegen::tools::generateFunctions(argc, argv, std::cout, context);
+}
+#endif
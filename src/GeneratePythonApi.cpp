@@ -23,38 +23,77 @@
  * An index.json file must exist and be passed to this program on the
  * command line. The index is generated by the IndexCode program in this
  * directory.
+ *
+ * If you pass --shards N, the class bindings will be written to N
+ * files next to the output file (PythonApi_shard0.cpp and so on) and
+ * the module will just call bind_shard_0(m) through bind_shard_N-1(m),
+ * so the build can compile the bindings in parallel. All the shard
+ * files are always written, even if some of them end up empty. The
+ * shards get the template's includes and using lines from ahead of
+ * NB_MODULE, but nothing else up there, so keep helper code in a
+ * header or in the module body.
+ *
+ * --deps keeps a sidecar file of what each output was generated from.
+ * If nothing the outputs use changed since the last run, this won't
+ * write anything, and if you're sharding only the shards whose classes
+ * changed get rewritten.
+ *
+ * --cache (or CODEGEN_CACHE_DIR) looks the outputs up in a local cache
+ * of generated files before generating them, see cache.h. The module
+ * and its shards are cached together.
  */
 
 #include <boost/program_options.hpp>
+#include <fr/codegen/cache.h>
+#include <fr/codegen/daemon.h>
 #include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/depfile.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/index.h>
 #include <fr/codegen/LblFilter.h>
 #include <fr/codegen/LblMiniParser.h>
+#include <fr/codegen/LblTemplate.h>
 #include <fr/codegen/LblEmitFunctions.h>
 #include <fr/codegen/GenerateNanobind.h>
+#include <fr/codegen/stats.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/tools.h>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-void printHelp(boost::program_options::options_description &desc) {
-  std::cout << "This program reads a .cpp file line by line looking for" << std::endl;
-  std::cout << "[[StartModule (ModuleName)]] and [[PythonApi]] annotations." << std::endl;
-  std::cout << "It will attempt to generate a nanobind API for any classes it" << std::endl;
-  std::cout << "finds in an index.json file generated by IndexCode. See the" << std::endl;
-  std::cout << "examples/config_file example that ships with this project for" << std::endl;
-  std::cout << "general details." << std::endl;
-  std::cout << desc << std::endl;
+namespace {
+
+  void printHelp(boost::program_options::options_description &desc, std::ostream& out) {
+    out << "This program reads a .cpp file line by line looking for" << std::endl;
+    out << "[[StartModule (ModuleName)]] and [[PythonApi]] annotations." << std::endl;
+    out << "It will attempt to generate a nanobind API for any classes it" << std::endl;
+    out << "finds in an index.json file generated by IndexCode. See the" << std::endl;
+    out << "examples/config_file example that ships with this project for" << std::endl;
+    out << "general details." << std::endl;
+    out << desc << std::endl;
+  }
+
 }
 
-int main(int argc, char *argv[]) {
+int fr::codegen::tools::generatePythonApi(int argc, char *argv[], std::ostream& out, ToolContext& context) {
   using namespace fr::codegen;
 
   std::string source;
   std::string output;
-  std::string index;
+  std::string indexFile;
+  std::string depsFile;
+  std::string depfile;
+  std::string statsFile;
+  std::string traceFile;
+  std::string cacheDir;
+  int shards = 0;
 
   boost::program_options::options_description desc("Options:");
   boost::program_options::variables_map vm;
@@ -64,70 +103,193 @@ int main(int argc, char *argv[]) {
      boost::program_options::value<std::string>(&source),
      "Source .cpp file to use as a template.")
     ("index,i",
-     boost::program_options::value<std::string>(&index),
+     boost::program_options::value<std::string>(&indexFile),
      "Index file containing objects to generate API for")
     ("output,o",
      boost::program_options::value<std::string>(&output),
      "Output to write modified source file to")
+    ("shards,n",
+     boost::program_options::value<int>(&shards),
+     "Split class bindings across this many files next to the output file")
+    ("deps,d",
+     boost::program_options::value<std::string>(&depsFile),
+     "Sidecar file to record what the outputs were generated from")
+    ("depfile",
+     boost::program_options::value<std::string>(&depfile),
+     "Write a Makefile style depfile listing what this read, for the build system")
+    ("stats",
+     boost::program_options::value<std::string>(&statsFile),
+     "Write timing and counters for this run to a JSON file")
+    ("trace",
+     boost::program_options::value<std::string>(&traceFile),
+     "Write a Chrome trace event timeline of this run to a JSON file")
+    ("cache",
+     boost::program_options::value<std::string>(&cacheDir),
+     "Cache generated files in this directory (defaults to CODEGEN_CACHE_DIR)")
     ;
 
   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
   boost::program_options::notify(vm);
 
   if (!vm.count("source") || !vm.count("index") || !vm.count("output")) {
-    printHelp(desc);
-    exit(1);
+    printHelp(desc, out);
+    return 1;
   }
 
-  std::map<std::string, std::shared_ptr<EnumData>> enumMap;
-  std::map<std::string, std::shared_ptr<ClassData>> classMap;
-
-  std::cout << "Reading index " << index << "..." << std::endl;
-  std::ifstream indexStream(index);
-  {
-    cereal::JSONInputArchive archive(indexStream);
-    archive(enumMap);
-    archive(classMap);
+  std::vector<std::string> outputs{output};
+  for (int shard = 0; shard < shards; ++shard) {
+    outputs.push_back(LblEmitPythonApi::shardFileName(output, shard));
   }
+  trace::Session traceSession(traceFile);
+  Stats stats(statsFile, "GeneratePythonApi");
+  writeDepfile(depfile, outputs, {source, indexFile});
+
+  out << "Reading index " << indexFile << "..." << std::endl;
+  auto loadTimer = stats.time("index load");
+  auto indexPtr = context.indexes.load(indexFile);
+  loadTimer.stop();
+  const Index& index = *indexPtr;
+  auto& classMap = index.classes;
 
-  std::cout << "Setting up line by line processor..." << std::endl;
+  // The module reads the template and every class. If we're sharding,
+  // each shard reads the template (for its includes) and its classes.
+  DependencyTracker deps(depsFile);
+  std::string shardOption = std::string("shards=") + std::to_string(shards);
+  HashMap moduleInputs;
+  moduleInputs[DependencyTracker::fileKey(source)] = fileHash(source);
+  moduleInputs[DependencyTracker::optionKey(shardOption)] = "";
+  for (const auto& [name, hash] : index.hashes) {
+    if (name.starts_with("class:")) {
+      moduleInputs[name] = hash;
+    }
+  }
+  bool moduleUpToDate = deps.upToDate(output, moduleInputs);
+  deps.consumed(output, moduleInputs);
 
-  LblReader reader(source);
+  out << "Setting up line by line processor..." << std::endl;
 
-  fr::codegen::miniparser::LblMiniparser parser;
-  parser.subscribeTo(reader);
+  // Other steps in the same process (codegen run, codegend) get the
+  // same read of the template out of the context
+  auto templateTimer = stats.time("template load");
+  LblTemplateReader parser(context.templates.load(source));
+  templateTimer.stop();
+  stats.countLines(parser, "lines in", "bytes in");
   
   LblEmitModuleStart moduleProcessor(classMap);
+  moduleProcessor.warnTo(out);
   moduleProcessor.subscribeTo(parser);
 
-  moduleProcessor.startModule.connect([](const std::string& name) {
-    std::cout << "Starting module " << name << std::endl;
+  moduleProcessor.startModule.connect([&out](const std::string& name) {
+    out << "Starting module " << name << std::endl;
   });
   
   LblEmitPythonApi apiProcessor(classMap);
+  apiProcessor.warnTo(out);
   apiProcessor.subscribeTo(moduleProcessor);
+  apiProcessor.setShards(shards, output);
+
+  bool allUpToDate = moduleUpToDate;
+  std::vector<int> upToDateShards;
+  auto shardClasses = apiProcessor.shardClasses();
+  for (int shard = 0; shard < shards; ++shard) {
+    std::string shardFile = LblEmitPythonApi::shardFileName(output, shard);
+    HashMap shardInputs;
+    shardInputs[DependencyTracker::fileKey(source)] = fileHash(source);
+    shardInputs[DependencyTracker::optionKey(shardOption)] = "";
+    for (auto data : shardClasses[shard]) {
+      std::string key = classKey(data->fullClassName());
+      shardInputs[key] = index.hashOf(key);
+    }
+    if (deps.upToDate(shardFile, shardInputs)) {
+      upToDateShards.push_back(shard);
+    } else {
+      allUpToDate = false;
+    }
+    deps.consumed(shardFile, shardInputs);
+  }
+
+  if (allUpToDate) {
+    out << output << " is up to date" << std::endl;
+    for (const auto& file : outputs) {
+      DependencyTracker::touch(file);
+    }
+    deps.save();
+    return 0;
+  }
+
+  // The module reads everything the shards do, so its inputs are the
+  // key for all of them
+  auto cache = OutputCache::fromEnvironment(cacheDir, context.getenv);
+  if (cache.fetch("GeneratePythonApi", moduleInputs, index, outputs)) {
+    out << output << " came from the cache" << std::endl;
+    stats.count("cache hits");
+    deps.save();
+    return 0;
+  }
+  // A miss unlinks outputs that were hard links into the cache, so
+  // check the shards are still there before skipping them
+  for (int shard : upToDateShards) {
+    std::string shardFile = LblEmitPythonApi::shardFileName(output, shard);
+    if (std::filesystem::exists(shardFile)) {
+      apiProcessor.skipShard(shard);
+      DependencyTracker::touch(shardFile);
+    }
+  }
+
+  apiProcessor.processingShard.connect([&out](const std::string& name) {
+    out << "Writing shard " << name << std::endl;
+  });
   
-  apiProcessor.processingClass.connect([](const std::string& name) {
-    std::cout << "Processing class " << name << std::endl;
+  apiProcessor.processingClass.connect([&out, &stats](const std::string& name) {
+    out << "Processing class " << name << std::endl;
+    stats.count("declarations");
   });
 
-  apiProcessor.processingConstructor.connect([](){
-    std::cout << "Processing constructor" << std::endl;
+  apiProcessor.processingConstructor.connect([&out](){
+    out << "Processing constructor" << std::endl;
   });
 
-  apiProcessor.processingMethod.connect([](const std::string& name) {
-    std::cout << "Processing method " << name << std::endl;    
+  apiProcessor.processingMethod.connect([&out](const std::string& name) {
+    out << "Processing method " << name << std::endl;    
   });
 
-  apiProcessor.processingMember.connect([](const std::string& name) {
-    std::cout << "Processing member " << name << std::endl;
+  apiProcessor.processingMember.connect([&out](const std::string& name) {
+    out << "Processing member " << name << std::endl;
   });
 
   LblWriter writer(output);
   writer.subscribeTo(apiProcessor);
+  stats.countLines(apiProcessor, "lines out", "bytes out");
 
-  reader.process();
+  try {
+    auto timer = stats.time("generate");
+    trace::Span span("file", "generate", output);
+    parser.process();
+  } catch (std::runtime_error& e) {
+    // Don't leave half a module around looking newer than its inputs
+    out << e.what() << std::endl;
+    writer.close();
+    std::filesystem::remove(output);
+    return 1;
+  }
+  writer.close();
+  if (cache.enabled()) {
+    stats.count("cache misses");
+    cache.store("GeneratePythonApi", moduleInputs, moduleInputs, outputs);
+  }
+  deps.save();
+
+  out << "Processing complete" << std::endl;
+  return 0;
+}
 
-  std::cout << "Processing complete" << std::endl;
-  exit(0);
+#ifndef FR_CODEGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+  int exitCode = 0;
+  if (fr::codegen::daemon::forward("GeneratePythonApi", argc, argv, exitCode)) {
+    return exitCode;
+  }
+  fr::codegen::tools::ToolContext context;
+  return fr::codegen::tools::generatePythonApi(argc, argv, std::cout, context);
 }
+#endif
@@ -16,28 +16,157 @@
  * This program reads some header files specified on the command
  * line and outputs a JSON file of data about classes and enums
  * that discovered in those files.
+ *
+ * The headers are read in the background (with io_uring if the
+ * kernel lets us, see loader.h) while we parse the ones that have
+ * already come in.
+ *
+ * Instead of listing every header, you can point it at a directory
+ * with --root and it'll index everything under there matching --glob
+ * (*.h and *.hpp if you don't say.) Headers that don't even contain
+ * the words enum, class or struct don't get parsed at all.
+ *
+ * --shared also publishes the index in shared memory (see flat.h),
+ * which the generators map instead of reading the JSON.
+ *
+ * --flat writes the same flat layout to a file as well, which is
+ * what a package installs so the projects using it don't have to
+ * index its headers themselves (see codegen_install_index).
+ *
+ * --journal only parses the headers that changed since last time and
+ * appends them to a journal next to the JSON (see journal.h) instead
+ * of rewriting the whole index.
  */
 
+#include <algorithm>
 #include <boost/program_options.hpp>
+#include <cstring>
+#include <fr/codegen/crawl.h>
+#include <fr/codegen/daemon.h>
 #include <fr/codegen/data.h>
+#include <fr/codegen/depfile.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/flat.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/indexer.h>
+#include <fr/codegen/journal.h>
+#include <fr/codegen/loader.h>
 #include <fr/codegen/parser.h>
+#include <fr/codegen/stats.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/tools.h>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
-void printHelp(boost::program_options::options_description &desc) {
-  std::cout << "Usage: " << std::endl;
-  std::cout << desc << std::endl << std::endl;
+namespace {
+
+  void printHelp(boost::program_options::options_description &desc, std::ostream& out) {
+    out << "Usage: " << std::endl;
+    out << desc << std::endl << std::endl;
+  }
+
+  // Parse one header into the enums and classes it defines
+  std::shared_ptr<fr::codegen::HeaderIndex> parseHeader(const std::string& header, std::string_view input,
+                                                        fr::codegen::parser::IndexDetail detail,
+                                                        std::ostream& out, fr::codegen::Stats& stats,
+                                                        bool& parseSuccess) {
+    fr::codegen::trace::Span span("header", "parse", header);
+    stats.count("bytes in", input.size());
+    stats.count("lines in", std::count(input.begin(), input.end(), '\n'));
+    auto timer = stats.time("parse");
+    return fr::codegen::indexHeader(header, input, detail, parseSuccess,
+      [&out, &stats](auto& parser, auto& enums, auto& classes) {
+        enums.enumAvailable.connect([&out, &stats](const std::string& key, const fr::codegen::EnumData&) {
+          out << "Adding enum " << key << std::endl;
+          stats.count("declarations");
+        });
+        classes.classAvailable.connect([&out, &stats](const std::string &key, const fr::codegen::ClassData&) {
+          out << "Adding class " << key << std::endl;
+          stats.count("declarations");
+        });
+        stats.instrumentParser(parser);
+        fr::codegen::trace::traceDeclarations(parser);
+      });
+  }
+
+  fr::codegen::ReadBackend readBackend(const std::string& name) {
+    if (name == "io_uring") {
+      return fr::codegen::ReadBackend::uring;
+    }
+    if (name == "threads") {
+      return fr::codegen::ReadBackend::threads;
+    }
+    return fr::codegen::ReadBackend::automatic;
+  }
+
+  std::optional<fr::codegen::parser::IndexDetail> indexDetail(const std::string& name) {
+    if (name == "enums") {
+      return fr::codegen::parser::IndexDetail::enums;
+    }
+    if (name == "members") {
+      return fr::codegen::parser::IndexDetail::members;
+    }
+    if (name == "full") {
+      return fr::codegen::parser::IndexDetail::full;
+    }
+    return std::nullopt;
+  }
+
+  // Put the index in shared memory for the generators, stamped with
+  // whatever they're going to check it against
+  void publishShared(const std::string& outputJson, const fr::codegen::Index& index,
+                     std::ostream& out, fr::codegen::Stats& stats) {
+#ifdef FR_CODEGEN_HAVE_SHM
+    auto timer = stats.time("publish");
+    auto name = fr::codegen::SharedIndex::segmentName(outputJson);
+    auto block = fr::codegen::flat::Builder().build(index, fr::codegen::indexStamp(outputJson));
+    if (fr::codegen::SharedIndex::publish(name, block)) {
+      out << "Published index as shared memory segment " << name << std::endl;
+      stats.count("bytes shared", block.size());
+    } else {
+      out << "Couldn't publish " << name << ": " << strerror(errno) << std::endl;
+    }
+#else
+    out << "No shared memory on this platform, just writing the JSON" << std::endl;
+#endif
+  }
+
+  void writeFlat(const std::string& flatFile, const fr::codegen::Index& index,
+                 std::ostream& out, fr::codegen::Stats& stats) {
+    auto timer = stats.time("write");
+    fr::codegen::trace::Span span("file", "write", flatFile);
+    out << "Writing flat index " << flatFile << "..." << std::endl;
+    fr::codegen::saveFlatIndex(flatFile, index);
+    std::error_code error;
+    stats.count("bytes out", std::filesystem::file_size(flatFile, error));
+  }
+
 }
 
-int main(int argc, char *argv[]) {
+int fr::codegen::tools::indexCode(int argc, char *argv[], std::ostream& out, ToolContext& context) {
 
   std::vector<std::string> headers;
+  std::vector<std::string> roots;
+  std::vector<std::string> globs;
   std::string outputJson;
+  std::string flatFile;
+  std::string depfile;
+  bool keepInMemory = false;
+  std::string statsFile;
+  std::string traceFile;
+  std::string reader;
+  std::string detailName;
+  bool shared = false;
+  bool useJournal = false;
+  unsigned compactAt = 50;
   
   boost::program_options::options_description desc("Options:");
   boost::program_options::variables_map vm;
@@ -49,61 +178,283 @@ int main(int argc, char *argv[]) {
     ("headers,h",
      boost::program_options::value<std::vector<std::string>>(&headers)->composing(),
      "Headers to process -- you can specify this option multiple times if you want to process more than one.")
+    ("root,r",
+     boost::program_options::value<std::vector<std::string>>(&roots)->composing(),
+     "Index every header under this directory that matches --glob. You can specify this more than once too.")
+    ("glob,g",
+     boost::program_options::value<std::vector<std::string>>(&globs)->composing(),
+     "File name pattern for --root to look for, like '*.h'. Defaults to *.h and *.hpp.")
     ("output,o",
      boost::program_options::value<std::string>(&outputJson),
-     "JSON output file");
+     "JSON output file")
+    ("flat",
+     boost::program_options::value<std::string>(&flatFile),
+     "Also write the index to this file in the flat format the generators can map, for installing")
+    ("depfile",
+     boost::program_options::value<std::string>(&depfile),
+     "Write a Makefile style depfile listing what this read, for the build system")
+    ("keep-in-memory",
+     boost::program_options::bool_switch(&keepInMemory),
+     "Don't write the output file, just keep the index for the other programs running in the same process (codegen run)")
+    ("stats",
+     boost::program_options::value<std::string>(&statsFile),
+     "Write timing and counters for this run to a JSON file")
+    ("trace",
+     boost::program_options::value<std::string>(&traceFile),
+     "Write a Chrome trace event timeline of this run to a JSON file")
+    ("reader",
+     boost::program_options::value<std::string>(&reader)->default_value("auto"),
+     "How to read the headers: io_uring, threads, or auto to use io_uring if the kernel lets us")
+    ("shared",
+     boost::program_options::bool_switch(&shared),
+     "Also publish the index in shared memory, so generators on this machine can map it instead of reading the JSON")
+    ("journal",
+     boost::program_options::bool_switch(&useJournal),
+     "Only parse headers that changed since the last --journal run and append them to a journal next to the output, instead of rewriting it")
+    ("compact-at",
+     boost::program_options::value<unsigned>(&compactAt)->default_value(50),
+     "Fold the journal back into the output once it's this percent of the output's size")
+    ("detail",
+     boost::program_options::value<std::string>(&detailName)->default_value("full"),
+     "How much to index: enums (enough for OstreamOpsFromIndex), members (enough for GenerateFunctions) or full (GeneratePythonApi needs methods and parameters)");
 
   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
   boost::program_options::notify(vm);
 
-  if (!vm.count("headers") || !vm.count("output")) {
-    printHelp(desc);
-    exit(1);
-  }
-
-  std::map<std::string, std::shared_ptr<fr::codegen::EnumData>> enumMap;
-  std::map<std::string, std::shared_ptr<fr::codegen::ClassData>> classMap;
-  std::cout << "Parsing headers..." << std::endl;
-
-  // Open, read and parse each header.
-  for (const auto& header : headers) {
-    std::string result;
-    std::cout << "Parsing " << header << "... " << std::endl;
-    std::ifstream inputStream(header);
-    std::stringstream input;
-    // Create new instances of drivers for each file
-    fr::codegen::parser::ParserDriver parser;
-    fr::codegen::EnumDriver enums;
-    fr::codegen::ClassDriver classes;
-    // Register enum and class drivers with parser
-    enums.regParser(parser);
-    classes.regParser(parser);
-    // Set filename we're looking at
-    enums.setCurrentFile(header);
-    classes.setCurrentFile(header);
-    // Subscribe to enum and class driver signals
-    enums.enumAvailable.connect([&enumMap](const std::string& key, const fr::codegen::EnumData& data) {
-      std::cout << "Adding enum " << key << std::endl;
-      enumMap[key] = std::make_shared<fr::codegen::EnumData>(data);
-    });
-    classes.classAvailable.connect([&classMap](const std::string &key, const fr::codegen::ClassData& data) {
-      std::cout << "Adding class " << key << std::endl;
-      classMap[key] = std::make_shared<fr::codegen::ClassData>(data);
-    });      
-    input << inputStream.rdbuf();
-    bool parseSuccess = parser.parse(input.view().begin(), input.view().end(), result);
-    std::cout << (parseSuccess ? "Success" : "Failed" ) << std::endl;
-  }
-  std::cout << "Writing JSON..." << std::endl;
-  std::ofstream json(outputJson);
-  {
-    cereal::JSONOutputArchive archive(json);
-    archive(cereal::make_nvp("enums", enumMap));
-    archive(cereal::make_nvp("classes", classMap));
-  }
-  json.close();
-  std::cout << "Processing complete" << std::endl;
+  if ((!vm.count("headers") && !vm.count("root")) || !vm.count("output")) {
+    printHelp(desc, out);
+    return 1;
+  }
+
+  auto detail = indexDetail(detailName);
+  if (!detail) {
+    out << "Unknown detail level " << detailName << ", use enums, members or full" << std::endl;
+    return 1;
+  }
+
+  fr::codegen::trace::Session traceSession(traceFile);
+  fr::codegen::Stats stats(statsFile, "IndexCode");
+
+  if (!roots.empty()) {
+    auto timer = stats.time("crawl");
+    if (globs.empty()) {
+      globs = {"*.h", "*.hpp"};
+    }
+    std::set<std::string> seen;
+    for (const auto& header : headers) {
+      seen.insert(std::filesystem::absolute(header).lexically_normal().string());
+    }
+    for (const auto& root : roots) {
+      fr::codegen::trace::Span span("directory", "crawl", root);
+      for (auto& header : fr::codegen::findHeaders(root, globs)) {
+        if (seen.insert(std::filesystem::absolute(header).lexically_normal().string()).second) {
+          headers.push_back(std::move(header));
+        }
+      }
+    }
+    out << "Found " << headers.size() << " headers" << std::endl;
+  }
+  std::vector<std::string> outputs{outputJson};
+  if (!flatFile.empty()) {
+    outputs.push_back(flatFile);
+  }
+  fr::codegen::writeDepfile(depfile, outputs, headers);
+
+  // With --journal we need to know which version of each header we
+  // read, and if there's already a journal, which ones are in there
+  std::optional<fr::codegen::IndexJournal> journal;
+  std::vector<std::optional<fr::codegen::FileStamp>> stamps(headers.size());
+  if (useJournal && !keepInMemory) {
+    journal = fr::codegen::IndexJournal::open(outputJson);
+    if (journal && journal->detail() != detailName) {
+      out << "Journal was made with --detail " << journal->detail() << ", reindexing everything" << std::endl;
+      journal.reset();
+    }
+    for (size_t i = 0; i < headers.size(); ++i) {
+      stamps[i] = fr::codegen::FileStamp::of(headers[i]);
+    }
+  }
+
+  auto index = std::make_shared<fr::codegen::Index>();
+  out << "Parsing headers..." << std::endl;
+
+  // If we've parsed a header before and it hasn't changed (only
+  // happens in codegend) we use what we found last time. The rest get
+  // read in the background and parsed as they come in. Headers later
+  // on the command line win if two define the same thing, so hang on
+  // to what we find and put the index together in order at the end.
+  std::vector<std::shared_ptr<const fr::codegen::HeaderIndex>> found(headers.size());
+  std::vector<char> failed(headers.size());
+  std::vector<std::string> toRead;
+  std::vector<size_t> readIds;
+  for (size_t i = 0; i < headers.size(); ++i) {
+    // Headers the journal already has this version of stay out of it
+    if (journal && stamps[i]) {
+      auto it = journal->headers().find(headers[i]);
+      if (it != journal->headers().end() && it->second == fr::codegen::HeaderStamp::of(*stamps[i])) {
+        continue;
+      }
+    }
+    found[i] = context.headers.find(headers[i], detailName);
+    if (found[i]) {
+      out << "Parsing " << headers[i] << "... " << std::endl;
+      out << "Unchanged since last time" << std::endl;
+    } else {
+      toRead.push_back(headers[i]);
+      readIds.push_back(i);
+    }
+  }
+
+  fr::codegen::FileLoader loader(toRead, readBackend(reader));
+  while (true) {
+    std::optional<fr::codegen::LoadedFile> file;
+    {
+      // Only the time we spend waiting for a file counts, the rest of
+      // the reading happens while we're parsing
+      auto timer = stats.time("read");
+      file = loader.next();
+    }
+    if (!file) {
+      break;
+    }
+    const std::string& header = file->filename;
+    out << "Parsing " << header << "... " << std::endl;
+    if (file->error) {
+      out << "Couldn't read " << header << ": " << strerror(file->error) << std::endl;
+    }
+    if (!fr::codegen::mightDeclare(file->contents)) {
+      out << "Nothing to index" << std::endl;
+      stats.count("headers skipped");
+      auto empty = std::make_shared<fr::codegen::HeaderIndex>();
+      if (!file->error) {
+        context.headers.store(header, empty, detailName);
+      }
+      found[readIds[file->id]] = empty;
+      continue;
+    }
+    bool parseSuccess = false;
+    auto parsed = parseHeader(header, file->contents, *detail, out, stats, parseSuccess);
+    out << (parseSuccess ? "Success" : "Failed" ) << std::endl;
+    // Don't hang on to a failed parse, the user's probably going to fix it
+    if (parseSuccess) {
+      context.headers.store(header, parsed, detailName);
+    }
+    found[readIds[file->id]] = parsed;
+    failed[readIds[file->id]] = !parseSuccess || file->error;
+  }
+
+  // The journal's version of a header we couldn't read or parse is
+  // one that never matches, so we try it again next time
+  auto headerStamp = [&](size_t i) {
+    return (failed[i] || !stamps[i]) ? fr::codegen::HeaderStamp() : fr::codegen::HeaderStamp::of(*stamps[i]);
+  };
+
+  if (journal) {
+    std::set<std::string> current(headers.begin(), headers.end());
+    std::vector<std::string> gone;
+    for (const auto& [header, stamp] : journal->headers()) {
+      if (!current.count(header)) {
+        gone.push_back(header);
+      }
+    }
+    size_t changed = 0;
+    {
+      auto timer = stats.time("journal");
+      fr::codegen::trace::Span span("file", "journal", fr::codegen::journalFile(outputJson));
+      for (size_t i = 0; i < headers.size(); ++i) {
+        if (found[i]) {
+          journal->replace(headers[i], headerStamp(i), *found[i]);
+          ++changed;
+        }
+      }
+      for (const auto& header : gone) {
+        journal->remove(header);
+      }
+    }
+    out << "Journaled " << changed << " changed and " << gone.size() << " removed headers" << std::endl;
+    stats.count("headers changed", changed);
+    std::error_code error;
+    auto snapshotSize = std::filesystem::file_size(outputJson, error);
+    std::shared_ptr<fr::codegen::Index> merged;
+    if (journal->size() * 100 > snapshotSize * compactAt) {
+      out << "Journal is " << journal->size() << " bytes, folding it into " << outputJson << std::endl;
+      auto timer = stats.time("compact");
+      merged = fr::codegen::loadJournaledIndex(outputJson, {});
+      merged->save(outputJson);
+      fr::codegen::IndexJournal::start(outputJson, detailName, journal->headers());
+      stats.count("bytes out", std::filesystem::file_size(outputJson, error));
+      context.indexes.store(outputJson, merged);
+    }
+    if ((shared || !flatFile.empty()) && !merged) {
+      merged = fr::codegen::loadJournaledIndex(outputJson, {});
+    }
+    if (shared) {
+      publishShared(outputJson, *merged, out, stats);
+    }
+    if (!flatFile.empty()) {
+      writeFlat(flatFile, *merged, out, stats);
+    }
+    out << "Processing complete" << std::endl;
+    return 0;
+  }
+
+  for (const auto& header : found) {
+    for (const auto& [key, data] : header->enums) {
+      index->enums[key] = data;
+    }
+    for (const auto& [key, data] : header->classes) {
+      index->classes[key] = data;
+    }
+  }
+  // Generators running in the same process can use this one instead
+  // of reading it back in
+  if (keepInMemory) {
+    index->computeHashes();
+    out << "Keeping index in memory as " << outputJson << std::endl;
+    context.indexes.publish(outputJson, index);
+  } else {
+    // This also hashes everything in the index so the generators can
+    // tell what changed since the last time they ran
+    out << "Writing JSON..." << std::endl;
+    {
+      auto timer = stats.time("write");
+      fr::codegen::trace::Span span("file", "write", outputJson);
+      index->save(outputJson);
+    }
+    std::error_code error;
+    stats.count("bytes out", std::filesystem::file_size(outputJson, error));
+    // A journal for the old JSON doesn't go with this one. With
+    // --journal we start a new one that says what's in here.
+    if (useJournal) {
+      fr::codegen::HeaderManifest manifest;
+      for (size_t i = 0; i < headers.size(); ++i) {
+        manifest[headers[i]] = headerStamp(i);
+      }
+      fr::codegen::IndexJournal::start(outputJson, detailName, manifest);
+    } else {
+      std::filesystem::remove(fr::codegen::journalFile(outputJson), error);
+    }
+    context.indexes.store(outputJson, index);
+    if (shared) {
+      publishShared(outputJson, *index, out, stats);
+    }
+    if (!flatFile.empty()) {
+      writeFlat(flatFile, *index, out, stats);
+    }
+  }
+  out << "Processing complete" << std::endl;
   
-  exit(0);
+  return 0;
   
 }
+
+#ifndef FR_CODEGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+  int exitCode = 0;
+  if (fr::codegen::daemon::forward("IndexCode", argc, argv, exitCode)) {
+    return exitCode;
+  }
+  fr::codegen::tools::ToolContext context;
+  return fr::codegen::tools::indexCode(argc, argv, std::cout, context);
+}
+#endif
@@ -17,107 +17,142 @@
  * This program reads an index generated by IndexFunctions and generates
  * ostream operators and to_string functions for all the enums in the
  * index.
+ *
+ * If you have a lot of enums, --shards N will split the source into N
+ * files named after the cpp file (ops_shard0.cpp and so on) so the
+ * build can compile them in parallel. Enums are grouped by the header
+ * they were defined in and each shard only includes the headers for
+ * the enums it contains. All N files are always written, even if
+ * some of them wind up empty.
+ *
+ * --companions writes a small header for each header in the index
+ * (foo.h gets foo_ops.h, next to the header you asked for) that only
+ * declares the functions for enums defined in foo.h, and turns the
+ * header you asked for into an umbrella header that includes all of
+ * them. Enum classes and enums with a fixed underlying type get
+ * forward declared instead of pulling in the header they came from,
+ * so a file that just wants to print one enum doesn't have to drag
+ * in your whole tree.
+ *
+ * --deps keeps a sidecar file recording what each output was generated
+ * from. Outputs whose enums haven't changed since the last run don't
+ * get rewritten. The header only cares about the enums' names and where
+ * they're defined, so adding an identifier to an enum just rewrites the
+ * cpp file (or the one shard that enum is in) and nothing that includes
+ * the header has to recompile.
+ *
+ * --cache (or CODEGEN_CACHE_DIR) looks each output up in a local cache
+ * of generated files before generating it, see cache.h. Companion
+ * headers get written along with the umbrella header, so they don't
+ * go through the cache.
  */
 
 #include <algorithm>
 #include <boost/program_options.hpp>
+#include <filesystem>
+#include <fr/codegen/cache.h>
+#include <fr/codegen/daemon.h>
 #include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/depfile.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/OstreamOps.h>
 #include <fr/codegen/parser.h>
+#include <fr/codegen/stats.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/tools.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
-using EnumMap = std::map<std::string, std::shared_ptr<fr::codegen::EnumData>>;
+using fr::codegen::EnumMap;
+using fr::codegen::HashMap;
+using fr::codegen::DependencyTracker;
+using fr::codegen::OutputCache;
+using fr::codegen::Stats;
+using namespace fr::codegen::ostreamops;
 
-void printHelp(boost::program_options::options_description &desc) {
-  std::cout << std::endl;
-  std::cout << "This program reads a json index generated by IndexCode and" << std::endl;
-  std::cout << "generates ostream operators and to_string functions for all" << std::endl;
-  std::cout << "the enums found in the index." << std::endl << std::endl;
-  std::cout << "Usage: " << std::endl;
-  std::cout << desc << std::endl << std::endl;
-}
+namespace {
 
-// Generate header file from enum map
-void generateHeader(EnumMap enums, std::ofstream& stream) {
-  stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
-  stream << "#pragma once" << std::endl;
-  stream << "#include <string>" << std::endl;
-  stream << "#include <iostream>" << std::endl;
-  std::vector<std::string> includedFiles;
-  for (auto [name,ptr] : enums) {
-    // Only include each unique file once
-    if (std::find(includedFiles.begin(), includedFiles.end(), ptr->definedIn) == includedFiles.end()) {
-      stream << "#include <" << ptr->definedIn << ">" << std::endl;
-      includedFiles.push_back(ptr->definedIn);
+  void printHelp(boost::program_options::options_description &desc, std::ostream& out) {
+    out << std::endl;
+    out << "This program reads a json index generated by IndexCode and" << std::endl;
+    out << "generates ostream operators and to_string functions for all" << std::endl;
+    out << "the enums found in the index." << std::endl << std::endl;
+    out << "Usage: " << std::endl;
+    out << desc << std::endl << std::endl;
+  }
+
+  // Runs generate into memory and then writes the result to filename,
+  // so --stats can tell generating apart from writing
+  void writeFile(const std::string& filename, Stats& stats, std::function<void(std::ostream&)> generate) {
+    fr::codegen::trace::Span span("file", "generate", filename);
+    std::stringstream buffer;
+    {
+      auto timer = stats.time("generate");
+      generate(buffer);
     }
+    auto timer = stats.time("write");
+    OutputCache::detach(filename);
+    std::ofstream stream(filename);
+    stream << buffer.rdbuf();
+    stats.count("bytes out", buffer.view().size());
+    stats.count("lines out", std::count(buffer.view().begin(), buffer.view().end(), '\n'));
   }
 
-  // Emit header definitions
-  for (auto [name,ptr] : enums) {
-    stream << "std::string to_string(const " << name << "& value);" << std::endl;
-    stream << "std::ostream& operator<<(std::ostream& stream, const " << name << "& value);" << std::endl;
+  // Same thing, but checks the cache first. Everything these outputs
+  // read is known up front, so inputs is the whole key.
+  void writeFile(const std::string& filename, Stats& stats, OutputCache& cache, const HashMap& inputs,
+                 const fr::codegen::Index& index, std::function<void(std::ostream&)> generate) {
+    if (cache.fetch("OstreamOpsFromIndex", inputs, index, {filename})) {
+      stats.count("cache hits");
+      return;
+    }
+    writeFile(filename, stats, generate);
+    if (cache.enabled()) {
+      stats.count("cache misses");
+      cache.store("OstreamOpsFromIndex", inputs, inputs, {filename});
+    }
   }
-}
 
-// Generate CPP file -- needs header file name so it can included it, fortunately
-// user passed it in
-void generateSource(EnumMap enums, std::ofstream& stream, std::string headerFile) {
-  stream << "/* This is generated code. Do not edit. Unless you REALLY want to */" << std::endl;
-  stream << "#include \"" << headerFile << "\"" << std::endl;
-
-  for (auto [name, ptr] : enums) {
-    stream << "std::string to_string(const " << name << "& value) {" << std::endl;
-    stream << "// Default value if not found" << std::endl;
-    stream << "std::string ret(\"UKNOWN VALUE IN " << name << "\");" << std::endl;
-    stream << "  switch(value) {" << std::endl;
-    for(auto id : ptr->identifiers) {
-      stream << "     case ";
-        if (ptr->isClassEnum) {
-          // If it's a class enum we need to include the enum namespace
-          // and name, which name has, so we can just append the identifier
-          // name after that
-          stream << name << "::" << id;
-        } else {
-          // Otherwise we have to include the namespace the enum is defined
-          // in but NOT the enum name
-          if (ptr->namespaces.size()) {
-            stream << ptr->enumNamespace() << "::";
-          }
-          stream << id;
-        }
-      stream << ":" << std::endl;
-      stream << "       ret = \"";
-      if (ptr->isClassEnum) {
-        stream << name << "::" << id;
-      } else {
-        if (ptr->namespaces.size()) {
-          stream << ptr->enumNamespace() << "::";
-        }
-        stream << id;
+  // Deletes the companions the umbrella header in headerFile includes
+  // that aren't in current any more. Their headers dropped out of the
+  // index, and nothing else is going to clean them up.
+  void removeStaleCompanions(const std::string& headerFile, const std::set<std::string>& current,
+                             std::ostream& out) {
+    std::ifstream previous(headerFile);
+    for (const auto& name : umbrellaIncludes(previous)) {
+      std::filesystem::path companionFile(headerFile);
+      companionFile.replace_filename(name);
+      if (!current.contains(companionFile.string())) {
+        out << "Removing " << companionFile.string() << std::endl;
+        std::error_code error;
+        std::filesystem::remove(companionFile, error);
       }
-      stream << "\";" << std::endl;
-      stream << "       break;" << std::endl;
     }
-    stream << "  }" << std::endl;
-    stream << " return ret;" << std::endl;
-    stream << "}" << std::endl << std::endl;
-    stream << "std::ostream& operator<<(std::ostream& stream, const " << name << "& value) {" << std::endl;
-    stream << "  stream << to_string(value);" << std::endl;
-    stream << "  return stream;" << std::endl;
-    stream << "}" << std::endl << std::endl;
   }
+
 }
 
-int main(int argc, char *argv[]) {
-  EnumMap enums;
+int fr::codegen::tools::ostreamOpsFromIndex(int argc, char *argv[], std::ostream& out, ToolContext& context) {
   std::string indexFile;
   std::string generateHeaderFile;
   std::string generateCppFile;
+  std::string depsFile;
+  std::string depfile;
+  std::string statsFile;
+  std::string traceFile;
+  std::string cacheDir;
+  int shards = 0;
+  bool companions = false;
+  std::vector<std::string> companionsFor;
   
   boost::program_options::options_description desc("Options:");
   boost::program_options::variables_map vm;
@@ -132,6 +167,30 @@ int main(int argc, char *argv[]) {
     ("cpp,c",
      boost::program_options::value<std::string>(&generateCppFile),
      "Cpp file to generate")
+    ("shards,n",
+     boost::program_options::value<int>(&shards),
+     "Split the cpp file into this many files, grouped by the header each enum is defined in")
+    ("companions",
+     boost::program_options::bool_switch(&companions),
+     "Write a small header per indexed header and make the header file an umbrella header for them")
+    ("companion-for",
+     boost::program_options::value<std::vector<std::string>>(&companionsFor),
+     "With --companions, write a companion for this header even if it doesn't have any enums")
+    ("deps,d",
+     boost::program_options::value<std::string>(&depsFile),
+     "Sidecar file to record what the outputs were generated from")
+    ("depfile",
+     boost::program_options::value<std::string>(&depfile),
+     "Write a Makefile style depfile listing what this read, for the build system")
+    ("stats",
+     boost::program_options::value<std::string>(&statsFile),
+     "Write timing and counters for this run to a JSON file")
+    ("trace",
+     boost::program_options::value<std::string>(&traceFile),
+     "Write a Chrome trace event timeline of this run to a JSON file")
+    ("cache",
+     boost::program_options::value<std::string>(&cacheDir),
+     "Cache generated files in this directory (defaults to CODEGEN_CACHE_DIR)")
     ;
   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
   boost::program_options::notify(vm);
@@ -139,25 +198,148 @@ int main(int argc, char *argv[]) {
   if (!vm.count("index") ||
       !vm.count("header") ||
       !vm.count("cpp")) {
-    printHelp(desc);
-    exit(1);
+    printHelp(desc, out);
+    return 1;
   }
 
-  std::cout << "Reading index..." << std::endl;
-  
-  std::ifstream index(indexFile);
-  {
-    cereal::JSONInputArchive archive(index);
-    archive(enums);
+  std::vector<std::string> outputs{generateHeaderFile};
+  if (shards > 0) {
+    for (int shard = 0; shard < shards; ++shard) {
+      outputs.push_back(shardFileName(generateCppFile, shard));
+    }
+  } else {
+    outputs.push_back(generateCppFile);
+  }
+  fr::codegen::trace::Session traceSession(traceFile);
+  Stats stats(statsFile, "OstreamOpsFromIndex");
+
+  out << "Reading index..." << std::endl;
+  auto loadTimer = stats.time("index load");
+  auto indexPtr = context.indexes.load(indexFile);
+  loadTimer.stop();
+  const fr::codegen::Index& index = *indexPtr;
+  auto& enums = index.enums;
+  stats.count("declarations", enums.size());
+
+  // Which companions there are depends on the index, so the depfile
+  // has to wait for it
+  std::map<std::string, EnumMap> byHeader;
+  std::map<std::string, std::string> companionNames;
+  std::map<std::string, std::string> companionFiles;
+  std::set<std::string> currentCompanions;
+  if (companions) {
+    byHeader = enumsByHeader(enums);
+    for (const auto& header : companionsFor) {
+      byHeader[header];
+    }
+    companionNames = fr::codegen::ostreamops::companionNames(byHeader);
+    for (const auto& [definedIn, name] : companionNames) {
+      std::filesystem::path companionFile(generateHeaderFile);
+      companionFile.replace_filename(name);
+      companionFiles[definedIn] = companionFile.string();
+      currentCompanions.insert(companionFile.string());
+      outputs.push_back(companionFile.string());
+    }
   }
+  fr::codegen::writeDepfile(depfile, outputs, {indexFile});
 
+  DependencyTracker deps(depsFile);
+  auto cache = OutputCache::fromEnvironment(cacheDir, context.getenv);
+  std::string companionOption = companions ? "companions" : "single";
 
-  std::ofstream header(generateHeaderFile);
-  std::ofstream cpp(generateCppFile);
-  std::cout << "Generating "<< generateHeaderFile << std::endl;
-  generateHeader(enums, header);
-  std::cout << "Generating " << generateCppFile << std::endl;
-  generateSource(enums, cpp, generateHeaderFile);
-  std::cout << "Done" << std::endl;
-  exit(0);
+  HashMap headerInputs;
+  for (const auto& [name, ptr] : enums) {
+    headerInputs[fr::codegen::enumKey(name)] = declarationHash(*ptr);
+  }
+  headerInputs[DependencyTracker::optionKey(companionOption)] = "";
+  // The umbrella header changes when the companions it includes do
+  for (const auto& [definedIn, name] : companionNames) {
+    headerInputs[DependencyTracker::optionKey("companion=" + name)] = "";
+  }
+  if (deps.upToDate(generateHeaderFile, headerInputs)) {
+    out << generateHeaderFile << " is up to date" << std::endl;
+    DependencyTracker::touch(generateHeaderFile);
+  } else {
+    out << "Generating "<< generateHeaderFile << std::endl;
+    if (companions) {
+      removeStaleCompanions(generateHeaderFile, currentCompanions, out);
+      writeFile(generateHeaderFile, stats, [&companionNames](std::ostream& header) {
+        generateUmbrellaHeader(companionNames, header);
+      });
+    } else {
+      writeFile(generateHeaderFile, stats, cache, headerInputs, index, [&enums](std::ostream& header) {
+        generateHeader(enums, header);
+      });
+    }
+  }
+  deps.consumed(generateHeaderFile, headerInputs);
+
+  // Each companion's checked by itself, so one that got deleted comes
+  // back even though the umbrella header's up to date
+  for (const auto& [definedIn, companionFile] : companionFiles) {
+    const auto& headerEnums = byHeader[definedIn];
+    auto inputs = companionInputs(headerEnums);
+    if (deps.upToDate(companionFile, inputs)) {
+      DependencyTracker::touch(companionFile);
+    } else {
+      out << "Generating " << companionFile << std::endl;
+      writeFile(companionFile, stats, [&headerEnums](std::ostream& companion) {
+        generateCompanionHeader(headerEnums, companion);
+      });
+    }
+    deps.consumed(companionFile, inputs);
+  }
+
+  if (shards > 0) {
+    auto shardMaps = shardEnums(enums, shards);
+    std::string shardOption = std::string("shards=") + std::to_string(shards);
+    for (int shard = 0; shard < shards; ++shard) {
+      std::string shardFile = shardFileName(generateCppFile, shard);
+      auto inputs = enumInputs(index, shardMaps[shard], {shardOption});
+      if (deps.upToDate(shardFile, inputs)) {
+        out << shardFile << " is up to date" << std::endl;
+        DependencyTracker::touch(shardFile);
+      } else {
+        out << "Generating " << shardFile << std::endl;
+        writeFile(shardFile, stats, cache, inputs, index, [&shardMaps, shard](std::ostream& cpp) {
+          generateShard(shardMaps[shard], cpp);
+        });
+      }
+      deps.consumed(shardFile, inputs);
+    }
+  } else {
+    // The unsharded cpp includes the header by name unless it's
+    // doing companion headers
+    auto inputs = enumInputs(index, enums, {companionOption, std::string("header=") + generateHeaderFile});
+    if (deps.upToDate(generateCppFile, inputs)) {
+      out << generateCppFile << " is up to date" << std::endl;
+      DependencyTracker::touch(generateCppFile);
+    } else {
+      out << "Generating " << generateCppFile << std::endl;
+      writeFile(generateCppFile, stats, cache, inputs, index, [&](std::ostream& cpp) {
+        if (companions) {
+          // The companion headers may only have forward declarations, but
+          // the switches need the whole enum
+          generateShard(enums, cpp);
+        } else {
+          generateSource(enums, cpp, generateHeaderFile);
+        }
+      });
+    }
+    deps.consumed(generateCppFile, inputs);
+  }
+  deps.save();
+  out << "Done" << std::endl;
+  return 0;
+}
+
+#ifndef FR_CODEGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+  int exitCode = 0;
+  if (fr::codegen::daemon::forward("OstreamOpsFromIndex", argc, argv, exitCode)) {
+    return exitCode;
+  }
+  fr::codegen::tools::ToolContext context;
+  return fr::codegen::tools::ostreamOpsFromIndex(argc, argv, std::cout, context);
 }
+#endif
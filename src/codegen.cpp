@@ -0,0 +1,187 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * codegen run manifest.json runs all the steps in a manifest (see
+ * pipeline.h for the format) in one process. Instead of running
+ * IndexCode, writing the index out and then having each generator
+ * read it back in, like examples/config_file/BuildIt.sh does, the
+ * index is built once and handed to the generators in memory. Steps
+ * that don't depend on each other run at the same time.
+ *
+ * Paths in the manifest are relative to the directory the manifest
+ * is in.
+ *
+ * codegen watch manifest.json runs everything once and then waits
+ * for the headers and templates the steps read to change. When you
+ * save one, it reruns just the steps that read it and whatever
+ * depends on those. The index stays in memory the whole time and
+ * only the headers that changed get parsed again, so you usually
+ * have new output before you've switched windows.
+ */
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <filesystem>
+#include <fr/codegen/pipeline.h>
+#include <fr/codegen/trace.h>
+#include <fr/codegen/watch.h>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+  // Set when we get a SIGINT or SIGTERM, so watch can stop cleanly
+  volatile std::sig_atomic_t stopping = 0;
+
+  void stop(int) {
+    stopping = 1;
+  }
+
+  void printHelp(boost::program_options::options_description &desc) {
+    std::cout << "Usage: codegen run [options] manifest.json" << std::endl;
+    std::cout << "       codegen watch [options] manifest.json" << std::endl << std::endl;
+    std::cout << "Runs the IndexCode and generator steps in a manifest in one" << std::endl;
+    std::cout << "process, keeping the index in memory and running steps that" << std::endl;
+    std::cout << "don't depend on each other in parallel. watch keeps running" << std::endl;
+    std::cout << "and reruns the steps whose inputs change." << std::endl;
+    std::cout << desc << std::endl << std::endl;
+  }
+
+  int watch(const std::string& manifestFile, size_t jobs) {
+    std::ifstream manifest(manifestFile);
+    if (!manifest) {
+      std::cerr << "Couldn't open " << manifestFile << std::endl;
+      return 1;
+    }
+    fr::codegen::Pipeline pipeline;
+    try {
+      auto directory = std::filesystem::absolute(manifestFile).parent_path();
+      std::filesystem::current_path(directory);
+      pipeline.load(manifest);
+      pipeline.buildGraph();
+
+      fr::codegen::FileWatcher watcher;
+      for (const auto& file : pipeline.sourceFiles()) {
+        watcher.watch(file);
+      }
+      fr::codegen::tools::ToolContext context;
+      std::set<size_t> everything;
+      for (size_t i = 0; i < pipeline.steps().size(); ++i) {
+        everything.insert(i);
+      }
+      pipeline.run(std::cout, jobs, context, everything);
+
+      std::signal(SIGINT, stop);
+      std::signal(SIGTERM, stop);
+      std::cout << "Watching " << watcher.files().size() << " files, ctrl-C to stop" << std::endl;
+      while (!stopping) {
+        auto changed = watcher.wait(1000);
+        if (changed.empty()) {
+          continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& file : changed) {
+          std::cout << "Changed: " << file << std::endl;
+        }
+        auto affected = pipeline.affectedBy(changed);
+        size_t failures = pipeline.run(std::cout, jobs, context, affected);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Reran " << affected.size() << " of " << pipeline.steps().size() << " steps in "
+                  << elapsed.count() << " ms";
+        if (failures > 0) {
+          std::cout << ", " << failures << " failed";
+        }
+        std::cout << std::endl;
+      }
+    } catch (std::exception& e) {
+      std::cerr << manifestFile << ": " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  int run(const std::string& manifestFile, size_t jobs, const std::string& traceFile) {
+    std::ifstream manifest(manifestFile);
+    if (!manifest) {
+      std::cerr << "Couldn't open " << manifestFile << std::endl;
+      return 1;
+    }
+    fr::codegen::Pipeline pipeline;
+    // We're about to change directories
+    fr::codegen::trace::Session traceSession(traceFile.empty() ? "" : std::filesystem::absolute(traceFile).string());
+    try {
+      auto directory = std::filesystem::absolute(manifestFile).parent_path();
+      std::filesystem::current_path(directory);
+      pipeline.load(manifest);
+      size_t failures = pipeline.run(std::cout, jobs);
+      if (failures > 0) {
+        std::cerr << failures << " of " << pipeline.steps().size() << " steps failed" << std::endl;
+        return 1;
+      }
+    } catch (std::exception& e) {
+      std::cerr << manifestFile << ": " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+}
+
+int main(int argc, char *argv[]) {
+  std::string command;
+  std::string manifest;
+  size_t jobs = 0;
+  std::string traceFile;
+
+  boost::program_options::options_description desc("Options:");
+  desc.add_options()
+    ("help", "Print this message")
+    ("jobs,j",
+     boost::program_options::value<size_t>(&jobs),
+     "Steps to run at once (defaults to one per core)")
+    ("trace",
+     boost::program_options::value<std::string>(&traceFile),
+     "Write a Chrome trace event timeline of the whole run to a JSON file")
+    ;
+  boost::program_options::options_description hidden;
+  hidden.add_options()
+    ("command", boost::program_options::value<std::string>(&command))
+    ("manifest", boost::program_options::value<std::string>(&manifest))
+    ;
+  boost::program_options::options_description all;
+  all.add(desc).add(hidden);
+  boost::program_options::positional_options_description positional;
+  positional.add("command", 1).add("manifest", 1);
+
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                .options(all).positional(positional).run(), vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help") || (command != "run" && command != "watch") || manifest.empty()) {
+    printHelp(desc);
+    exit(1);
+  }
+
+  if (command == "watch") {
+    exit(watch(manifest, jobs));
+  }
+  exit(run(manifest, jobs, traceFile));
+}
@@ -0,0 +1,273 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * codegend runs IndexCode, OstreamOpsFromIndex, GenerateFunctions,
+ * GeneratePythonApi and GenerateEnumFunctions for you so they don't each have to start up and
+ * load the index. Start it before your build and the programs will
+ * find it on their own (see daemon.h for where the socket goes) and
+ * pass it their command lines.
+ *
+ * It keeps every index it's read or written in memory and only reads
+ * one again if the file changed. IndexCode requests also reuse what
+ * was found in headers that haven't changed since the last time it
+ * saw them, so reindexing after you edit one header only parses that
+ * header.
+ *
+ * Each request runs on its own thread, in the directory the client
+ * was in, so a parallel build's requests run at the same time. The
+ * caches in the ToolContext they share lock themselves. If a build
+ * somehow has more going than the daemon will run, the extra ones get
+ * told it's busy and the programs do the work themselves.
+ *
+ * A request brings the cache settings the program was run with
+ * (CODEGEN_CACHE_DIR and CODEGEN_CACHE_SIZE), and everything the tool
+ * prints, warnings included, goes back to the program.
+ *
+ * Only programs running as the same user as the daemon get served.
+ */
+
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <fr/codegen/daemon.h>
+#include <fr/codegen/tools.h>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+  volatile std::sig_atomic_t stopRequested = 0;
+
+  void handleSignal(int) {
+    stopRequested = 1;
+  }
+
+  void printHelp(boost::program_options::options_description &desc) {
+    std::cout << "This program keeps code generation indexes in memory and" << std::endl;
+    std::cout << "runs the code generation programs for you when they ask." << std::endl;
+    std::cout << "Usage: " << std::endl;
+    std::cout << desc << std::endl << std::endl;
+  }
+
+  int listenOn(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+      std::cerr << "Socket path " << path << " is too long" << std::endl;
+      return -1;
+    }
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      std::cerr << "Couldn't create socket: " << strerror(errno) << std::endl;
+      return -1;
+    }
+    // Nobody else gets to connect to it
+    mode_t previousMask = ::umask(0077);
+    int bound = ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::umask(previousMask);
+    if (bound < 0 || ::listen(fd, 64) < 0) {
+      std::cerr << "Couldn't listen on " << path << ": " << strerror(errno) << std::endl;
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // Runs a tool for a client and returns { exit code, output }. It
+  // moves the calling thread to the client's directory, so give it a
+  // thread of its own.
+  std::vector<std::string> run(const fr::codegen::daemon::RunRequest& request,
+                               const fr::codegen::tools::ToolContext& shared) {
+    static const auto tools = fr::codegen::tools::allTools();
+    auto tool = tools.find(request.tool);
+    if (tool == tools.end()) {
+      return {"unknown tool"};
+    }
+    std::vector<std::string> args(request.args);
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+      argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    if (!fr::codegen::daemon::enterDirectory(request.directory)) {
+      // Let the client do it itself
+      return {"bad directory"};
+    }
+    // Same caches, the client's settings
+    fr::codegen::tools::ToolContext context(shared);
+    context.getenv = [&request](const char* name) {
+      return request.getenv(name);
+    };
+    std::stringstream out;
+    int exitCode = 1;
+    try {
+      exitCode = tool->second(args.size(), argv.data(), out, context);
+    } catch (std::exception& e) {
+      out << request.tool << " failed: " << e.what() << std::endl;
+    }
+    return {std::to_string(exitCode), out.str()};
+  }
+
+}
+
+int main(int argc, char *argv[]) {
+  std::string socket = fr::codegen::daemon::socketPath();
+  int idleTimeout = 0;
+  bool stop = false;
+
+  boost::program_options::options_description desc("Options:");
+  boost::program_options::variables_map vm;
+
+  desc.add_options()
+    ("help", "Print this message")
+    ("socket,s",
+     boost::program_options::value<std::string>(&socket),
+     "Unix socket to listen on (defaults to CODEGEND_SOCKET or one in XDG_RUNTIME_DIR)")
+    ("idle-timeout,t",
+     boost::program_options::value<int>(&idleTimeout),
+     "Exit after this many seconds without a request. 0 (the default) runs until you stop it")
+    ("stop",
+     boost::program_options::bool_switch(&stop),
+     "Tell the daemon on the socket to exit")
+    ;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help")) {
+    printHelp(desc);
+    exit(0);
+  }
+
+  if (stop) {
+    exit(fr::codegen::daemon::shutdown(socket) ? 0 : 1);
+  }
+
+  // A socket nobody's listening on is left over from a daemon that
+  // didn't exit cleanly. One somebody is listening on is a daemon we
+  // shouldn't step on.
+  int existing = fr::codegen::daemon::connectTo(socket);
+  if (existing >= 0) {
+    ::close(existing);
+    std::cerr << "codegend is already running on " << socket << std::endl;
+    exit(1);
+  }
+  ::unlink(socket.c_str());
+
+  int listener = listenOn(socket);
+  if (listener < 0) {
+    exit(1);
+  }
+  std::signal(SIGINT, handleSignal);
+  std::signal(SIGTERM, handleSignal);
+  std::signal(SIGPIPE, SIG_IGN);
+  std::cout << "Listening on " << socket << std::endl;
+
+  fr::codegen::tools::ToolContext context;
+  // How many requests are running. Sending one back costs the client
+  // a whole index load, so the limit's only there to keep a runaway
+  // build from starting thousands of threads.
+  std::mutex requestsMutex;
+  std::condition_variable requestDone;
+  unsigned activeRequests = 0;
+  const unsigned maxRequests = std::max(16u, 4 * std::thread::hardware_concurrency());
+  auto active = [&]() {
+    std::lock_guard lock(requestsMutex);
+    return activeRequests;
+  };
+  int idleSeconds = 0;
+  bool running = true;
+  while (running && !stopRequested) {
+    // Wake up once a second so signals and the idle timeout get noticed
+    pollfd pfd{listener, POLLIN, 0};
+    int ready = ::poll(&pfd, 1, 1000);
+    if (ready <= 0) {
+      if (active() > 0) {
+        idleSeconds = 0;
+      } else if (idleTimeout > 0 && ++idleSeconds >= idleTimeout) {
+        std::cout << "Idle for " << idleTimeout << " seconds, exiting" << std::endl;
+        break;
+      }
+      continue;
+    }
+    idleSeconds = 0;
+    int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      continue;
+    }
+    if (!fr::codegen::daemon::peerIsUs(client)) {
+      ::close(client);
+      continue;
+    }
+    // A client that connects and then sits there doesn't get to hold
+    // everybody else up
+    fr::codegen::daemon::setTimeout(client, fr::codegen::daemon::requestTimeoutSeconds);
+    std::vector<std::string> message;
+    if (fr::codegen::daemon::readMessage(client, message) && message.size() >= 2) {
+      auto request = fr::codegen::daemon::RunRequest::parse(message);
+      if (message[0] != fr::codegen::daemon::protocolVersion) {
+        fr::codegen::daemon::writeMessage(client, {"protocol mismatch"});
+      } else if (message[1] == "shutdown") {
+        fr::codegen::daemon::writeMessage(client, {"bye"});
+        running = false;
+      } else if (request) {
+        std::unique_lock lock(requestsMutex);
+        if (activeRequests >= maxRequests) {
+          lock.unlock();
+          fr::codegen::daemon::writeMessage(client, {"busy"});
+        } else {
+          activeRequests++;
+          lock.unlock();
+          std::cout << "Running " << request->tool << " in " << request->directory << std::endl;
+          std::thread([client, request = std::move(*request), &context, &requestsMutex, &requestDone, &activeRequests]() {
+            fr::codegen::daemon::writeMessage(client, run(request, context));
+            ::close(client);
+            std::lock_guard lock(requestsMutex);
+            activeRequests--;
+            requestDone.notify_all();
+          }).detach();
+          continue;
+        }
+      } else {
+        fr::codegen::daemon::writeMessage(client, {"bad request"});
+      }
+    }
+    ::close(client);
+  }
+
+  // Let whatever's running finish
+  {
+    std::unique_lock lock(requestsMutex);
+    requestDone.wait(lock, [&activeRequests]() { return activeRequests == 0; });
+  }
+  ::close(listener);
+  ::unlink(socket.c_str());
+  std::cout << "codegend exiting" << std::endl;
+  exit(0);
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Allocation budgets. These build into CodegenAllocationTests with
+ * src/AllocHooks.cpp whether or not you configured with
+ * -DFR_CODEGEN_ALLOC_HOOKS=ON. If one of them fails, something started
+ * allocating a lot more than it used to. Look at what changed before
+ * you raise the budget.
+ */
+
+#include <gtest/gtest.h>
+#include <fr/codegen/alloc.h>
+#include <fr/codegen/drivers.h>
+#include <fr/codegen/LblEmitFunctions.h>
+#include <fr/codegen/LblMiniParser.h>
+#include <fr/codegen/parser.h>
+#include <fr/codegen/stats.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LineCollector.h"
+
+using namespace fr::codegen;
+
+static_assert(alloc::instrumented(), "Allocations.cpp needs src/AllocHooks.cpp and FR_CODEGEN_ALLOC_HOOKS");
+
+namespace {
+
+  const int declarations = 20;
+
+  // Allocations per declaration. The names below are all too long for
+  // the small string buffer, so every one the parser or drivers keep
+  // costs an allocation. The parser was around 19 and the drivers
+  // around 30 when these were set.
+  const size_t parseBudget = 24;
+  const size_t driveBudget = 40;
+  // Allocations for the whole get/set run below, which was around 80
+  const size_t getSetBudget = 100;
+
+  // declarations enums and declarations classes
+  std::string makeHeader() {
+    std::string code;
+    for (int i = 0; i < declarations; ++i) {
+      std::string n = std::to_string(i);
+      code.append("namespace allocation_space_" + n + " {\n");
+      code.append("  enum class AllocationColor" + n + " { allocation_crimson_red, allocation_forest_green, allocation_midnight_blue, allocation_pale_cyan, allocation_deep_magenta };\n");
+      code.append("}\n");
+      code.append("namespace allocation_space_" + n + " {\n");
+      code.append("  class AllocationThing" + n + " {\n");
+      code.append("    [[get]] [[set]] int allocation_count;\n");
+      code.append("    [[cereal]] std::string allocation_display_name;\n");
+      code.append("  public:\n");
+      code.append("    AllocationThing" + n + "(int allocation_count, const std::string& allocation_display_name);\n");
+      code.append("    int allocation_grand_total() const;\n");
+      code.append("  };\n");
+      code.append("}\n");
+    }
+    return code;
+  }
+
+}
+
+TEST(Allocations, HooksCountPhases) {
+  alloc::reset();
+  {
+    alloc::Phase phase("test hooks");
+    std::vector<char> buffer(1000);
+    // report allocates too, so there'll be a few more than one
+    auto counts = alloc::report("test hooks");
+    ASSERT_GE(counts.allocations, 1);
+    ASSERT_GE(counts.bytes, 1000);
+    ASSERT_GE(counts.live, 1000);
+  }
+  // Freed, and counted against the phase that allocated it
+  auto counts = alloc::report("test hooks");
+  ASSERT_GE(counts.frees, 1);
+  ASSERT_EQ(counts.live, 0);
+}
+
+TEST(Allocations, ParseBudget) {
+  std::string code = makeHeader();
+  std::string result;
+  Stats stats("", "test");
+  parser::ParserDriver parser;
+  EnumDriver enums;
+  ClassDriver classes;
+  enums.regParser(parser);
+  classes.regParser(parser);
+  stats.instrumentParser(parser);
+  int found = 0;
+  enums.enumAvailable.connect([&found](const std::string&, const EnumData&) { found++; });
+  classes.classAvailable.connect([&found](const std::string&, const ClassData&) { found++; });
+
+  alloc::reset();
+  {
+    auto timer = stats.time("parse");
+    ASSERT_TRUE(parser.parse(code.begin(), code.end(), result));
+  }
+  ASSERT_EQ(found, declarations * 2);
+  auto parse = alloc::report("parse");
+  auto drive = alloc::report("drive");
+  ASSERT_LE(parse.allocations, declarations * 2 * parseBudget);
+  ASSERT_LE(drive.allocations, declarations * 2 * driveBudget);
+}
+
+TEST(Allocations, GetSetBudget) {
+  ClassMap classMap;
+  auto data = std::make_shared<ClassData>();
+  data->name = "Thing";
+  for (int i = 0; i < 10; ++i) {
+    MemberData member;
+    member.type = "std::string";
+    member.name = "allocation_member_" + std::to_string(i);
+    member.generateGetter = true;
+    member.generateSetter = true;
+    member.serializable = false;
+    data->members.push_back(member);
+  }
+  classMap["Thing"] = data;
+
+  LblEmitter source;
+  miniparser::LblMiniparser parser;
+  parser.subscribeTo(source);
+  LblEmitGetSetMethods getSet(classMap);
+  getSet.subscribeTo(parser);
+  LineCollector collector;
+  collector.subscribeTo(getSet);
+  collector.lines.reserve(100);
+
+  alloc::reset();
+  {
+    alloc::Phase phase("generate");
+    source.emit("class Thing {");
+    source.emit("public:");
+    source.emit("  [[genGetSetMethods]]");
+    source.emit("};");
+  }
+  ASSERT_EQ(collector.lines.size(), 23);
+  auto generate = alloc::report("generate");
+  ASSERT_LE(generate.allocations, getSetBudget);
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/crawl.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  struct Tree {
+    std::filesystem::path root;
+
+    Tree() : root(std::filesystem::temp_directory_path() / "codegen_crawl_test") {
+      std::filesystem::remove_all(root);
+      for (auto file : {"a.h", "b.hpp", "notes.txt", "include/c.h", "include/deep/d.h",
+                        "src/e.cpp", ".git/f.h"}) {
+        auto path = root / file;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "struct Thing {};" << std::endl;
+      }
+      // Following this would find everything twice, or forever
+      std::filesystem::create_directory_symlink(root / "include", root / "include" / "loop");
+    }
+
+    ~Tree() {
+      std::filesystem::remove_all(root);
+    }
+
+    std::vector<std::string> paths(std::vector<std::string> relative) {
+      std::vector<std::string> ret;
+      for (const auto& path : relative) {
+        ret.push_back((root / path).string());
+      }
+      return ret;
+    }
+  };
+
+}
+
+TEST(Crawl, FindsMatchingHeaders) {
+  Tree tree;
+  auto found = findHeaders(tree.root.string(), {"*.h", "*.hpp"}, 4);
+  ASSERT_EQ(found, tree.paths({"a.h", "b.hpp", "include/c.h", "include/deep/d.h"}));
+}
+
+TEST(Crawl, GlobsWithSlashesMatchThePath) {
+  Tree tree;
+  auto found = findHeaders(tree.root.string(), {"include/*.h"});
+  ASSERT_EQ(found, tree.paths({"include/c.h"}));
+  found = findHeaders(tree.root.string(), {"*.cpp"});
+  ASSERT_EQ(found, tree.paths({"src/e.cpp"}));
+}
+
+TEST(Crawl, MissingRootFindsNothing) {
+  ASSERT_TRUE(findHeaders("/nonexistent/codegen/root", {"*.h"}).empty());
+}
+
+TEST(Crawl, Prefilter) {
+  ASSERT_TRUE(mightDeclare("enum class Color { red };"));
+  ASSERT_TRUE(mightDeclare("struct Point { int x; };"));
+  ASSERT_TRUE(mightDeclare("template <class T> T twice(T t);"));
+  ASSERT_FALSE(mightDeclare("#pragma once\n#include <string>\nint add(int a, int b);\n"));
+  ASSERT_FALSE(mightDeclare(""));
+}
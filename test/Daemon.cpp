@@ -0,0 +1,247 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fr/codegen/daemon.h>
+#include <fr/codegen/index.h>
+#include <fr/codegen/tools.h>
+#include <fstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  int listenOn(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, 1) < 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // Pretends to be codegend for one request and answers with reply
+  bool forwardTo(int listener, const std::vector<std::string>& reply, int& exitCode,
+                 std::vector<std::string>* sent = nullptr) {
+    std::thread daemon([listener, &reply, sent]() {
+      int client = accept(listener, nullptr, nullptr);
+      std::vector<std::string> request;
+      daemon::readMessage(client, request);
+      daemon::writeMessage(client, reply);
+      close(client);
+      if (sent) {
+        *sent = request;
+      }
+    });
+    char program[] = "IndexCode";
+    char* argv[] = {program, nullptr};
+    bool ret = daemon::forward("IndexCode", 1, argv, exitCode);
+    daemon.join();
+    return ret;
+  }
+
+}
+
+TEST(Daemon, MessageRoundTrip) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::vector<std::string> sent{daemon::protocolVersion, "run", "IndexCode", "", std::string("a\0b", 3)};
+  ASSERT_TRUE(daemon::writeMessage(fds[0], sent));
+  std::vector<std::string> received;
+  ASSERT_TRUE(daemon::readMessage(fds[1], received));
+  ASSERT_EQ(received, sent);
+  // Other end went away
+  close(fds[0]);
+  ASSERT_FALSE(daemon::readMessage(fds[1], received));
+  close(fds[1]);
+}
+
+TEST(Daemon, NoDaemonMeansNoForward) {
+  auto socket = (std::filesystem::temp_directory_path() / "codegend_test_nobody_home.sock").string();
+  std::filesystem::remove(socket);
+  setenv("CODEGEND_SOCKET", socket.c_str(), 1);
+  char program[] = "IndexCode";
+  char* argv[] = {program, nullptr};
+  int exitCode = 42;
+  ASSERT_FALSE(daemon::forward("IndexCode", 1, argv, exitCode));
+  ASSERT_EQ(exitCode, 42);
+  unsetenv("CODEGEND_SOCKET");
+}
+
+TEST(Daemon, IndexCacheReloadsChangedFiles) {
+  auto filename = (std::filesystem::temp_directory_path() / "codegend_test_index.json").string();
+  Index index;
+  auto data = std::make_shared<EnumData>();
+  data->name = "Color";
+  index.enums["Color"] = data;
+  index.save(filename);
+
+  IndexCache cache;
+  auto first = cache.load(filename);
+  ASSERT_EQ(first->enums.size(), 1);
+  // Same file, same index
+  ASSERT_EQ(cache.load(filename), first);
+
+  auto shape = std::make_shared<EnumData>();
+  shape->name = "Shape";
+  index.enums["Shape"] = shape;
+  index.save(filename);
+  // Make sure the timestamp moves even on a coarse filesystem
+  std::filesystem::last_write_time(filename, std::filesystem::last_write_time(filename) + std::chrono::seconds(1));
+  auto second = cache.load(filename);
+  ASSERT_NE(second, first);
+  ASSERT_EQ(second->enums.size(), 2);
+  std::filesystem::remove(filename);
+}
+
+TEST(Daemon, BusyDaemonMeansRunItYourself) {
+  auto socket = (std::filesystem::temp_directory_path() / "codegend_test_busy.sock").string();
+  std::filesystem::remove(socket);
+  int listener = listenOn(socket);
+  ASSERT_GE(listener, 0);
+  setenv("CODEGEND_SOCKET", socket.c_str(), 1);
+  int exitCode = 42;
+  ASSERT_FALSE(forwardTo(listener, {"busy"}, exitCode));
+  ASSERT_EQ(exitCode, 42);
+  testing::internal::CaptureStdout();
+  ASSERT_TRUE(forwardTo(listener, {"0", "done\n"}, exitCode));
+  ASSERT_EQ(testing::internal::GetCapturedStdout(), "done\n");
+  ASSERT_EQ(exitCode, 0);
+  close(listener);
+  unsetenv("CODEGEND_SOCKET");
+  std::filesystem::remove(socket);
+}
+
+TEST(Daemon, EachRequestGetsItsOwnDirectory) {
+  auto base = std::filesystem::temp_directory_path() / "codegend_test_directories";
+  std::filesystem::remove_all(base);
+  std::filesystem::create_directories(base / "one");
+  std::filesystem::create_directories(base / "two");
+  auto here = std::filesystem::current_path();
+
+  // Both in their own directory at once, writing the same relative path
+  auto request = [](std::filesystem::path directory, const std::string& contents, bool& entered) {
+    entered = daemon::enterDirectory(directory.string());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // Threads it starts go along with it
+    std::thread([&contents]() {
+      std::ofstream("output.txt") << contents;
+    }).join();
+  };
+  bool enteredOne = false;
+  bool enteredTwo = false;
+  std::thread one(request, base / "one", "one", std::ref(enteredOne));
+  std::thread two(request, base / "two", "two", std::ref(enteredTwo));
+  one.join();
+  two.join();
+  ASSERT_TRUE(enteredOne);
+  ASSERT_TRUE(enteredTwo);
+
+  std::string contents;
+  std::ifstream(base / "one" / "output.txt") >> contents;
+  ASSERT_EQ(contents, "one");
+  std::ifstream(base / "two" / "output.txt") >> contents;
+  ASSERT_EQ(contents, "two");
+  // And nobody moved us
+  ASSERT_EQ(std::filesystem::current_path(), here);
+  ASSERT_FALSE(std::filesystem::exists("output.txt"));
+  std::filesystem::remove_all(base);
+}
+
+TEST(Daemon, RunRequestRoundTrip) {
+  daemon::RunRequest request;
+  request.tool = "GenerateFunctions";
+  request.directory = "/somewhere";
+  request.environment["CODEGEN_CACHE_DIR"] = "/cache=here";
+  request.args = {"GenerateFunctions", "-h", "Config.h.in"};
+  auto parsed = daemon::RunRequest::parse(request.message());
+  ASSERT_TRUE(parsed);
+  ASSERT_EQ(parsed->tool, request.tool);
+  ASSERT_EQ(parsed->directory, request.directory);
+  ASSERT_EQ(parsed->environment, request.environment);
+  ASSERT_EQ(parsed->args, request.args);
+  ASSERT_STREQ(parsed->getenv("CODEGEN_CACHE_DIR"), "/cache=here");
+  ASSERT_EQ(parsed->getenv("CODEGEN_CACHE_SIZE"), nullptr);
+
+  // More variables than there's room for
+  auto message = request.message();
+  message[4] = "3";
+  ASSERT_FALSE(daemon::RunRequest::parse(message));
+  // Not a run
+  ASSERT_FALSE(daemon::RunRequest::parse({daemon::protocolVersion, "shutdown"}));
+}
+
+TEST(Daemon, ForwardsTheCacheSettings) {
+  auto socket = (std::filesystem::temp_directory_path() / "codegend_test_environment.sock").string();
+  std::filesystem::remove(socket);
+  int listener = listenOn(socket);
+  ASSERT_GE(listener, 0);
+  setenv("CODEGEND_SOCKET", socket.c_str(), 1);
+  setenv("CODEGEN_CACHE_DIR", "/build/cache", 1);
+  unsetenv("CODEGEN_CACHE_SIZE");
+  int exitCode = 42;
+  std::vector<std::string> sent;
+  testing::internal::CaptureStdout();
+  ASSERT_TRUE(forwardTo(listener, {"0", ""}, exitCode, &sent));
+  testing::internal::GetCapturedStdout();
+  auto request = daemon::RunRequest::parse(sent);
+  ASSERT_TRUE(request);
+  ASSERT_EQ(request->environment.size(), 1);
+  ASSERT_STREQ(request->getenv("CODEGEN_CACHE_DIR"), "/build/cache");
+  ASSERT_EQ(request->args, std::vector<std::string>{"IndexCode"});
+  ASSERT_EQ(request->directory, std::filesystem::current_path().string());
+
+  // A run with the request's settings gets them instead of ours
+  tools::ToolContext shared;
+  tools::ToolContext context(shared);
+  context.getenv = [&request](const char* name) { return request->getenv(name); };
+  ASSERT_EQ(&context.indexes, &shared.indexes);
+  ASSERT_EQ(&context.templates, &shared.templates);
+  setenv("CODEGEN_CACHE_SIZE", "1k", 1);
+  ASSERT_EQ(context.getenv("CODEGEN_CACHE_SIZE"), nullptr);
+  ASSERT_STREQ(shared.getenv("CODEGEN_CACHE_SIZE"), "1k");
+
+  close(listener);
+  unsetenv("CODEGEND_SOCKET");
+  unsetenv("CODEGEN_CACHE_DIR");
+  unsetenv("CODEGEN_CACHE_SIZE");
+  std::filesystem::remove(socket);
+}
+
+TEST(Daemon, OnlyTalksToUs) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(daemon::peerIsUs(fds[0]));
+  close(fds[0]);
+  close(fds[1]);
+
+  // Something that isn't a socket where the socket should be
+  auto socket = (std::filesystem::temp_directory_path() / "codegend_test_not_a_socket.sock").string();
+  std::ofstream(socket) << "hello";
+  ASSERT_LT(daemon::connectTo(socket), 0);
+  std::filesystem::remove(socket);
+}
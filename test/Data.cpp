@@ -18,9 +18,34 @@
 #include <fr/codegen/data.h>
 #include <fr/codegen/parser.h>
 #include <fr/codegen/drivers.h>
+#include <fr/codegen/index.h>
+#include <memory>
+#include <sstream>
 
 using namespace fr::codegen;
 
+namespace {
+
+  // EnumData the way it was saved before it had an underlyingType
+  struct OldEnumData {
+    std::vector<std::string> namespaces;
+    std::string name;
+    bool isClassEnum = false;
+    std::string definedIn;
+    std::vector<std::string> identifiers;
+
+    template <typename Archive>
+    void save(Archive& ar) const {
+      ar(cereal::make_nvp("namespaces", namespaces));
+      ar(cereal::make_nvp("name", name));
+      ar(cereal::make_nvp("isClassEnum", isClassEnum));
+      ar(cereal::make_nvp("definedIn", definedIn));
+      ar(cereal::make_nvp("identifiers", identifiers));
+    }
+  };
+
+}
+
 TEST(ParsingData, FullEnumData) {
   // Yes, this is legit -- strings separated by nothing concatinate
   const std::string enumCode(
@@ -407,3 +432,66 @@ TEST(ParsingData, Parameters) {
   ASSERT_EQ(names[0], "message");
   ASSERT_EQ(names[1], "count");
 }
+
+TEST(ParsingData, EnumUnderlyingType) {
+  const std::string enumCode(
+    "namespace foo { enum class Small : std::uint8_t { a, b }; }"
+    "namespace foo { enum Wide : unsigned long { c, d }; }"
+    "namespace foo { enum class Plain { e, f }; }"
+  );
+
+  fr::codegen::parser::ParserDriver parser;
+  fr::codegen::EnumDriver driver;
+  std::map<std::string, EnumData> data;
+  driver.enumAvailable.connect([&data](const std::string& key, const EnumData& value) {
+    data[key] = value;
+  });
+  std::string result;
+  driver.regParser(parser);
+  ASSERT_TRUE(parser.parse(enumCode.begin(), enumCode.end(), result));
+  ASSERT_EQ(data.size(), 3);
+  ASSERT_EQ(data["foo::Small"].underlyingType, "std::uint8_t");
+  ASSERT_EQ(data["foo::Small"].identifiers.size(), 2);
+  ASSERT_TRUE(data["foo::Small"].isClassEnum);
+  ASSERT_EQ(data["foo::Wide"].underlyingType, "unsigned long");
+  ASSERT_EQ(data["foo::Wide"].identifiers[1], "d");
+  ASSERT_FALSE(data["foo::Wide"].isClassEnum);
+  ASSERT_EQ(data["foo::Plain"].underlyingType, "");
+}
+
+TEST(ParsingData, IndexWithoutUnderlyingType) {
+  std::map<std::string, std::shared_ptr<OldEnumData>> oldEnums;
+  for (auto name : {"Color", "Shape"}) {
+    auto data = std::make_shared<OldEnumData>();
+    data->namespaces = {"foo"};
+    data->name = name;
+    data->isClassEnum = true;
+    data->definedIn = "foo.h";
+    data->identifiers = {"a", "b"};
+    oldEnums[std::string("foo::") + name] = data;
+  }
+  std::stringstream stream;
+  {
+    cereal::JSONOutputArchive archive(stream);
+    archive(cereal::make_nvp("enums", oldEnums));
+    archive(cereal::make_nvp("classes", ClassMap()));
+  }
+
+  Index index;
+  index.load(stream);
+  ASSERT_EQ(index.enums.size(), 2);
+  ASSERT_EQ(index.enums["foo::Shape"]->identifiers.size(), 2);
+  ASSERT_EQ(index.enums["foo::Shape"]->underlyingType, "");
+  ASSERT_TRUE(index.enums["foo::Color"]->isClassEnum);
+  // And no hashes either, so it made its own
+  ASSERT_FALSE(index.hashOf(enumKey("foo::Color")).empty());
+
+  // One that has it still gets it back
+  index.enums["foo::Color"]->underlyingType = "uint8_t";
+  std::stringstream newStream;
+  index.save(newStream);
+  Index again;
+  again.load(newStream);
+  ASSERT_EQ(again.enums["foo::Color"]->underlyingType, "uint8_t");
+  ASSERT_EQ(again.enums["foo::Shape"]->underlyingType, "");
+}
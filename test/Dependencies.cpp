@@ -0,0 +1,275 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::shared_ptr<EnumData> makeEnum(const std::string& name, std::vector<std::string> identifiers) {
+    auto data = std::make_shared<EnumData>();
+    data->name = name;
+    data->namespaces.push_back("foo");
+    data->definedIn = "foo.h";
+    data->identifiers = identifiers;
+    return data;
+  }
+
+  std::string tempFile(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+  }
+
+}
+
+TEST(Dependencies, IndexHashesChangeWithContent) {
+  Index index;
+  index.enums["foo::Color"] = makeEnum("Color", {"red", "green"});
+  index.enums["foo::Shape"] = makeEnum("Shape", {"square"});
+  index.computeHashes();
+  std::string color = index.hashOf(enumKey("foo::Color"));
+  std::string shape = index.hashOf(enumKey("foo::Shape"));
+  ASSERT_FALSE(color.empty());
+  ASSERT_EQ(index.hashOf(enumKey("foo::Nope")), "");
+
+  index.enums["foo::Color"]->identifiers.push_back("blue");
+  index.computeHashes();
+  ASSERT_NE(index.hashOf(enumKey("foo::Color")), color);
+  ASSERT_EQ(index.hashOf(enumKey("foo::Shape")), shape);
+}
+
+TEST(Dependencies, UpToDateAcrossRuns) {
+  std::string output = tempFile("codegen_deps_test_output.h");
+  std::string sidecar = tempFile("codegen_deps_test.json");
+  std::filesystem::remove(sidecar);
+  {
+    std::ofstream stream(output);
+    stream << "generated" << std::endl;
+  }
+
+  Index index;
+  index.enums["foo::Color"] = makeEnum("Color", {"red", "green"});
+  index.enums["foo::Shape"] = makeEnum("Shape", {"square"});
+  index.computeHashes();
+
+  {
+    DependencyTracker deps(sidecar);
+    // Nothing recorded yet
+    ASSERT_FALSE(deps.upToDate(output, index, {"shards=2"}));
+    deps.consumed(output, index, enumKey("foo::Color"));
+    deps.consumedOption(output, "shards=2");
+    deps.save();
+  }
+
+  {
+    DependencyTracker deps(sidecar);
+    ASSERT_TRUE(deps.upToDate(output, index, {"shards=2"}));
+    // Different options mean different output
+    ASSERT_FALSE(deps.upToDate(output, index, {"shards=3"}));
+    ASSERT_FALSE(deps.upToDate(output, index));
+  }
+
+  // Changing an enum the output didn't read doesn't matter
+  index.enums["foo::Shape"]->identifiers.push_back("circle");
+  index.computeHashes();
+  {
+    DependencyTracker deps(sidecar);
+    ASSERT_TRUE(deps.upToDate(output, index, {"shards=2"}));
+  }
+
+  // Changing one it did does
+  index.enums["foo::Color"]->identifiers.push_back("blue");
+  index.computeHashes();
+  {
+    DependencyTracker deps(sidecar);
+    ASSERT_FALSE(deps.upToDate(output, index, {"shards=2"}));
+  }
+
+  // And if the output's gone, it needs to be written no matter what
+  std::filesystem::remove(output);
+  {
+    DependencyTracker deps(sidecar);
+    ASSERT_FALSE(deps.upToDate(output, index, {"shards=2"}));
+  }
+  std::filesystem::remove(sidecar);
+}
+
+TEST(Dependencies, DisabledIsNeverUpToDate) {
+  Index index;
+  DependencyTracker deps("");
+  ASSERT_FALSE(deps.enabled());
+  ASSERT_FALSE(deps.upToDate("anything", index));
+  ASSERT_FALSE(deps.upToDate("anything", HashMap()));
+}
+
+TEST(Dependencies, IndexSetLooksInOrder) {
+  auto mine = std::make_shared<Index>();
+  mine->enums["foo::Color"] = makeEnum("Color", {"red", "green"});
+  mine->computeHashes();
+  auto theirs = std::make_shared<Index>();
+  theirs->enums["foo::Color"] = makeEnum("Color", {"cyan"});
+  theirs->enums["foo::Shape"] = makeEnum("Shape", {"square"});
+  auto widget = std::make_shared<ClassData>();
+  widget->name = "Widget";
+  widget->namespaces.push_back("bar");
+  theirs->classes["bar::Widget"] = widget;
+  theirs->computeHashes();
+
+  IndexSet indexes(mine);
+  indexes.add(theirs);
+  ASSERT_EQ(&indexes.primary(), mine.get());
+  // Mine wins when both have it
+  ASSERT_EQ(indexes.findEnum("foo::Color")->identifiers.size(), 2);
+  ASSERT_EQ(indexes.hashOf(enumKey("foo::Color")), mine->hashOf(enumKey("foo::Color")));
+  // Theirs fills in the rest
+  ASSERT_EQ(indexes.findEnum("foo::Shape"), theirs->enums["foo::Shape"]);
+  ASSERT_EQ(indexes.hashOf(enumKey("foo::Shape")), theirs->hashOf(enumKey("foo::Shape")));
+  ASSERT_EQ(indexes.findClass("bar::Widget"), widget);
+  ASSERT_EQ(indexes.findClassByName("Widget"), widget);
+  ASSERT_EQ(indexes.findClassKey("Widget"), "bar::Widget");
+  ASSERT_FALSE(indexes.findClassByName("Gadget"));
+  ASSERT_EQ(indexes.hashOf(enumKey("foo::Nope")), "");
+}
+
+TEST(Dependencies, UpToDateAcrossIndexes) {
+  std::string output = tempFile("codegen_deps_set_output.h");
+  std::string sidecar = tempFile("codegen_deps_set.json");
+  std::filesystem::remove(sidecar);
+  {
+    std::ofstream stream(output);
+    stream << "generated" << std::endl;
+  }
+
+  auto mine = std::make_shared<Index>();
+  auto theirs = std::make_shared<Index>();
+  theirs->enums["foo::Shape"] = makeEnum("Shape", {"square"});
+  theirs->computeHashes();
+  {
+    IndexSet indexes(mine);
+    indexes.add(theirs);
+    DependencyTracker deps(sidecar);
+    deps.consumed(output, indexes, enumKey("foo::Shape"));
+    deps.save();
+    DependencyTracker again(sidecar);
+    ASSERT_TRUE(again.upToDate(output, indexes));
+  }
+
+  // An output that used something from another package's index goes
+  // stale when that package's index changes
+  auto changed = std::make_shared<Index>();
+  changed->enums["foo::Shape"] = makeEnum("Shape", {"square", "circle"});
+  changed->computeHashes();
+  IndexSet indexes(mine);
+  indexes.add(changed);
+  DependencyTracker deps(sidecar);
+  ASSERT_FALSE(deps.upToDate(output, indexes));
+  std::filesystem::remove(output);
+  std::filesystem::remove(sidecar);
+}
+
+TEST(Dependencies, BareClassNames) {
+  auto makeClass = [](const std::string& ns) {
+    auto data = std::make_shared<ClassData>();
+    data->name = "Thing";
+    data->namespaces.push_back(ns);
+    return data;
+  };
+  std::string output = tempFile("codegen_deps_names_output.h");
+  std::string sidecar = tempFile("codegen_deps_names.json");
+  std::filesystem::remove(sidecar);
+  std::ofstream(output) << "generated";
+
+  // What GenerateFunctions records when the template has a Thing in it
+  auto record = [&](const IndexSet& indexes) {
+    DependencyTracker deps(sidecar);
+    deps.consumed(output, indexes, classNameKey("Thing"));
+    std::string key = indexes.findClassKey("Thing");
+    if (!key.empty()) {
+      deps.consumed(output, indexes, classKey(key));
+    }
+    deps.save();
+  };
+  auto upToDate = [&](const IndexSet& indexes) {
+    return DependencyTracker(sidecar).upToDate(output, indexes);
+  };
+
+  auto index = std::make_shared<Index>();
+  index->classes["a::Thing"] = makeClass("a");
+  index->computeHashes();
+  IndexSet one(index);
+  ASSERT_EQ(one.findClassKey("Thing"), "a::Thing");
+  ASSERT_EQ(one.hashOf(classNameKey("Thing")), "a::Thing");
+  record(one);
+  ASSERT_TRUE(upToDate(one));
+
+  // Now Thing could be either one, so we can't say
+  auto both = std::make_shared<Index>(*index);
+  both->classes["b::Thing"] = makeClass("b");
+  both->computeHashes();
+  IndexSet two(both);
+  ASSERT_EQ(both->findClassKey("Thing"), "");
+  ASSERT_EQ(two.findClassKey("Thing"), "");
+  ASSERT_FALSE(upToDate(two));
+  record(two);
+  ASSERT_FALSE(upToDate(two));
+
+  // Back to one Thing, but a different one than before
+  auto moved = std::make_shared<Index>();
+  moved->classes["b::Thing"] = makeClass("b");
+  moved->computeHashes();
+  record(one);
+  ASSERT_FALSE(upToDate(IndexSet(moved)));
+
+  // The first index with the name decides, even if a later one has it too
+  IndexSet layered(index);
+  layered.add(moved);
+  ASSERT_EQ(layered.findClassKey("Thing"), "a::Thing");
+  ASSERT_TRUE(upToDate(layered));
+  IndexSet ambiguousFirst(both);
+  ambiguousFirst.add(moved);
+  ASSERT_EQ(ambiguousFirst.findClassKey("Thing"), "");
+  std::filesystem::remove(output);
+  std::filesystem::remove(sidecar);
+}
+
+TEST(Dependencies, TouchMakesSkippedOutputsNewer) {
+  auto output = tempFile("codegen_deps_touch.cpp");
+  auto index = tempFile("codegen_deps_touch.json");
+  std::ofstream(output) << "// generated";
+  std::ofstream(index) << "{}";
+  // Otherwise make would run us again next build
+  std::filesystem::last_write_time(output, std::filesystem::last_write_time(index) - std::chrono::seconds(10));
+  DependencyTracker::touch(output);
+  ASSERT_GE(std::filesystem::last_write_time(output), std::filesystem::last_write_time(index));
+  std::ifstream stream(output);
+  std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  ASSERT_EQ(contents, "// generated");
+
+  // Nothing there is nothing to touch
+  std::filesystem::remove(output);
+  DependencyTracker::touch(output);
+  ASSERT_FALSE(std::filesystem::exists(output));
+  std::filesystem::remove(index);
+}
@@ -0,0 +1,207 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/flat.h>
+#include <fr/codegen/tools.h>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace fr::codegen;
+
+namespace {
+
+  Index makeIndex() {
+    Index index;
+    auto color = std::make_shared<EnumData>();
+    color->name = "Color";
+    color->namespaces = {"paint"};
+    color->isClassEnum = true;
+    color->definedIn = "paint.h";
+    color->identifiers = {"red", "green", "blue"};
+    color->underlyingType = "uint8_t";
+    index.enums["paint::Color"] = color;
+
+    auto brush = std::make_shared<ClassData>();
+    brush->name = "Brush";
+    brush->namespaces = {"paint"};
+    brush->definedIn = "paint.h";
+    brush->parents = {"Tool"};
+    brush->serializable = true;
+    MemberData width{};
+    width.type = "std::string";
+    width.name = "width";
+    width.isPublic = true;
+    width.generateGetter = true;
+    brush->members.push_back(width);
+    MethodData paint{};
+    paint.returnType = "void";
+    paint.name = "paint";
+    paint.isVirtual = true;
+    paint.parameters.push_back(ParameterData{"std::string", "where", true, false});
+    brush->methods.push_back(paint);
+    index.classes["paint::Brush"] = brush;
+    auto empty = std::make_shared<ClassData>();
+    empty->name = "Empty";
+    index.classes["Empty"] = empty;
+    index.computeHashes();
+    return index;
+  }
+
+  std::string serialized(const Index& index) {
+    std::stringstream stream;
+    {
+      cereal::BinaryOutputArchive archive(stream);
+      archive(index.enums, index.classes, index.hashes);
+    }
+    return stream.str();
+  }
+
+}
+
+TEST(FlatIndex, Views) {
+  auto index = makeIndex();
+  auto block = flat::Builder().build(index);
+  FlatIndex flatIndex(block);
+  ASSERT_TRUE(flatIndex.valid());
+  ASSERT_EQ(flatIndex.enums().size(), 1);
+  ASSERT_EQ(flatIndex.classes().size(), 2);
+
+  auto color = flatIndex.findEnum("paint::Color");
+  ASSERT_TRUE(color);
+  ASSERT_EQ(color->name(), "Color");
+  ASSERT_EQ(color->identifiers().size(), 3);
+  ASSERT_EQ(std::string_view(color->identifiers()[2]), "blue");
+  ASSERT_EQ(color->hash(), index.hashOf(enumKey("paint::Color")));
+  ASSERT_FALSE(flatIndex.findEnum("paint::Colour"));
+
+  auto brush = flatIndex.findClass("paint::Brush");
+  ASSERT_TRUE(brush);
+  ASSERT_EQ(brush->members()[0].type(), "std::string");
+  ASSERT_TRUE(brush->members()[0].generateGetter());
+  ASSERT_EQ(brush->methods()[0].parameters()[0].name(), "where");
+  ASSERT_TRUE(flatIndex.findClass("Empty"));
+  ASSERT_FALSE(flatIndex.findClass("Full"));
+
+  // The views point into the block, no copies
+  auto name = brush->name();
+  ASSERT_GE(name.data(), block.data());
+  ASSERT_LT(name.data(), block.data() + block.size());
+}
+
+TEST(FlatIndex, RoundTrip) {
+  auto index = makeIndex();
+  auto block = flat::Builder().build(index);
+  auto back = FlatIndex(block).toIndex();
+  ASSERT_EQ(serialized(*back), serialized(index));
+}
+
+TEST(FlatIndex, RejectsGarbage) {
+  auto block = flat::Builder().build(makeIndex());
+  ASSERT_FALSE(FlatIndex(std::string_view(block).substr(0, block.size() / 2)).valid());
+  std::string wrongMagic = block;
+  wrongMagic[0] = 'X';
+  ASSERT_FALSE(FlatIndex(wrongMagic).valid());
+  ASSERT_FALSE(FlatIndex("").valid());
+  ASSERT_TRUE(FlatIndex("").enums().empty());
+}
+
+TEST(FlatIndex, FlatFile) {
+  auto directory = std::filesystem::temp_directory_path() / "codegen_flat_file_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::string flatFile = (directory / "paint.flat").string();
+  std::string json = (directory / "paint.json").string();
+  auto index = makeIndex();
+  saveFlatIndex(flatFile, index);
+  index.save(json);
+
+  ASSERT_TRUE(isFlatIndexFile(flatFile));
+  ASSERT_FALSE(isFlatIndexFile(json));
+  ASSERT_FALSE(isFlatIndexFile((directory / "nope.flat").string()));
+  ASSERT_EQ(serialized(*loadFlatIndexFile(flatFile, *FileStamp::of(flatFile))), serialized(index));
+  // The JSON's somebody else's problem
+  ASSERT_FALSE(loadFlatIndexFile(json, *FileStamp::of(json)));
+
+  // The tools read either one
+  tools::ToolContext context;
+  ASSERT_EQ(serialized(*context.indexes.load(flatFile)), serialized(index));
+  ASSERT_EQ(serialized(*context.indexes.load(json)), serialized(index));
+
+  // Something that says it's flat and isn't is an error, not an
+  // empty index
+  {
+    std::ofstream stream(flatFile, std::ios::binary | std::ios::trunc);
+    stream.write(flat::magic, sizeof(flat::magic));
+    stream << "garbage";
+  }
+  ASSERT_THROW(loadFlatIndexFile(flatFile, *FileStamp::of(flatFile)), std::runtime_error);
+  std::filesystem::remove_all(directory);
+}
+
+#ifdef FR_CODEGEN_HAVE_SHM
+
+TEST(FlatIndex, SharedMemory) {
+  auto directory = std::filesystem::temp_directory_path() / "codegen_flat_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::string json = (directory / "index.json").string();
+  auto index = makeIndex();
+  index.save(json);
+  auto name = SharedIndex::segmentName(json);
+  ASSERT_TRUE(SharedIndex::publish(name, flat::Builder().build(index, FileStamp::of(json))));
+
+  {
+    auto shared = SharedIndex::attach(name);
+    ASSERT_TRUE(shared);
+    ASSERT_TRUE(shared->matches(*FileStamp::of(json)));
+    ASSERT_EQ(shared->index().findEnum("paint::Color")->underlyingType(), "uint8_t");
+
+    // Publishing again doesn't pull the rug out from under us
+    ASSERT_TRUE(SharedIndex::publish(name, flat::Builder().build(Index())));
+    ASSERT_EQ(shared->index().classes().size(), 2);
+  }
+
+  // The tools pick it up when it matches the file and ignore it when it doesn't
+  ASSERT_TRUE(SharedIndex::publish(name, flat::Builder().build(index, FileStamp::of(json))));
+  ASSERT_TRUE(loadSharedIndex(json, *FileStamp::of(json)));
+  tools::ToolContext context;
+  ASSERT_EQ(serialized(*context.indexes.load(json)), serialized(index));
+  index.enums.clear();
+  index.save(json);
+  ASSERT_FALSE(loadSharedIndex(json, *FileStamp::of(json)));
+
+  // Only we get to read it, and one anybody else could have written
+  // to doesn't get used
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  ASSERT_GE(fd, 0);
+  struct stat status;
+  ASSERT_EQ(fstat(fd, &status), 0);
+  ASSERT_EQ(status.st_mode & 0777, 0600);
+  ASSERT_TRUE(SharedIndex::attach(name));
+  ASSERT_EQ(fchmod(fd, 0666), 0);
+  close(fd);
+  ASSERT_FALSE(SharedIndex::attach(name));
+
+  SharedIndex::remove(name);
+  ASSERT_FALSE(SharedIndex::attach(name));
+  std::filesystem::remove_all(directory);
+}
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * Tests for the nanobind API generator
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fr/codegen/GenerateNanobind.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LineCollector.h"
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::shared_ptr<ClassData> makeClass(const std::string& name, const std::string& parent = "") {
+    auto data = std::make_shared<ClassData>();
+    data->name = name;
+    if (!parent.empty()) {
+      data->parents.push_back(parent);
+    }
+    return data;
+  }
+
+  // Alphabetical order is exactly backwards from dependency order
+  // here, which is what the map iterates in.
+  ClassMap backwardsHierarchy() {
+    ClassMap classes;
+    classes["Apple"] = makeClass("Apple", "Banana");
+    classes["Banana"] = makeClass("Banana", "fruit::Cherry");
+    classes["fruit::Cherry"] = makeClass("Cherry");
+    classes["Durian"] = makeClass("Durian");
+    return classes;
+  }
+
+  std::string slurp(const std::string& filename) {
+    std::ifstream stream(filename);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+  }
+}
+
+TEST(GenerateNanobind, ParentsBeforeChildren) {
+  LblEmitPythonApi api(backwardsHierarchy());
+  auto ordered = api.dependencyOrder();
+  ASSERT_EQ(ordered.size(), 4);
+  std::vector<std::string> names;
+  for (auto data : ordered) {
+    names.push_back(data->name);
+  }
+  auto position = [&names](const std::string& name) {
+    return std::find(names.begin(), names.end(), name) - names.begin();
+  };
+  ASSERT_LT(position("Cherry"), position("Banana"));
+  ASSERT_LT(position("Banana"), position("Apple"));
+}
+
+TEST(GenerateNanobind, ShardFileName) {
+  ASSERT_EQ(LblEmitPythonApi::shardFileName("/tmp/build/PythonApi.cpp", 3),
+            "/tmp/build/PythonApi_shard3.cpp");
+}
+
+TEST(GenerateNanobind, ShardedModule) {
+  auto dir = std::filesystem::temp_directory_path() / "codegen_nanobind_test";
+  std::filesystem::create_directories(dir);
+  std::string output = (dir / "PythonApi.cpp").string();
+
+  miniparser::LblMiniparser source;
+  LblEmitModuleStart moduleStart(backwardsHierarchy());
+  moduleStart.subscribeTo(source);
+  LblEmitPythonApi api(backwardsHierarchy());
+  api.subscribeTo(moduleStart);
+  api.setShards(2, output);
+  LineCollector collector;
+  collector.subscribeTo(api);
+
+  source.process("#include <nanobind/nanobind.h>");
+  source.process("[[StartModule (Fruit)]]");
+  source.process("[[PythonApi]]");
+  source.process("}");
+
+  // The module itself should only be calling the shards, in order
+  std::string module;
+  for (const auto& line : collector.lines) {
+    module.append(line);
+    module.append("\n");
+  }
+  ASSERT_EQ(module.find("class_"), std::string::npos);
+  auto shard0 = module.find("bind_shard_0(m);");
+  auto shard1 = module.find("bind_shard_1(m);");
+  ASSERT_NE(shard0, std::string::npos);
+  ASSERT_NE(shard1, std::string::npos);
+  ASSERT_LT(shard0, shard1);
+
+  // Each shard gets the template's includes and its half of the classes
+  std::string first = slurp(LblEmitPythonApi::shardFileName(output, 0));
+  std::string second = slurp(LblEmitPythonApi::shardFileName(output, 1));
+  ASSERT_NE(first.find("#include <nanobind/nanobind.h>"), std::string::npos);
+  ASSERT_NE(second.find("#include <nanobind/nanobind.h>"), std::string::npos);
+  ASSERT_NE(first.find("void bind_shard_0(nanobind::module_& m) {"), std::string::npos);
+  ASSERT_NE(second.find("void bind_shard_1(nanobind::module_& m) {"), std::string::npos);
+  ASSERT_NE(first.find("nanobind::class_<Cherry>"), std::string::npos);
+  ASSERT_NE(first.find("nanobind::class_<Banana, fruit::Cherry>"), std::string::npos);
+  ASSERT_NE(second.find("nanobind::class_<Apple, Banana>"), std::string::npos);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(GenerateNanobind, ShardsOnlyGetIncludesAndUsings) {
+  auto dir = std::filesystem::temp_directory_path() / "codegen_nanobind_preamble_test";
+  std::filesystem::create_directories(dir);
+  std::string output = (dir / "PythonApi.cpp").string();
+
+  miniparser::LblMiniparser source;
+  LblEmitModuleStart moduleStart(backwardsHierarchy());
+  moduleStart.subscribeTo(source);
+  LblEmitPythonApi api(backwardsHierarchy());
+  api.subscribeTo(moduleStart);
+  api.setShards(2, output);
+  LineCollector collector;
+  collector.subscribeTo(api);
+
+  source.process("#include <nanobind/nanobind.h>");
+  source.process("  #  include \"fruit.h\"");
+  source.process("namespace nb = nanobind;");
+  source.process("using namespace fruit;");
+  source.process("static int helper() { return 1; }");
+  source.process("namespace detail {");
+  source.process("  int counter = 0;");
+  source.process("}");
+  source.process("[[StartModule (Fruit)]]");
+  source.process("[[PythonApi]]");
+  source.process("}");
+
+  std::string shard = slurp(LblEmitPythonApi::shardFileName(output, 0));
+  ASSERT_NE(shard.find("#include <nanobind/nanobind.h>"), std::string::npos);
+  ASSERT_NE(shard.find("#  include \"fruit.h\""), std::string::npos);
+  ASSERT_NE(shard.find("namespace nb = nanobind;"), std::string::npos);
+  ASSERT_NE(shard.find("using namespace fruit;"), std::string::npos);
+  // Defined in every shard would be one definition per shard
+  ASSERT_EQ(shard.find("helper"), std::string::npos);
+  ASSERT_EQ(shard.find("namespace detail"), std::string::npos);
+  ASSERT_EQ(shard.find("counter"), std::string::npos);
+  // The module still has all of it
+  ASSERT_NE(std::find(collector.lines.begin(), collector.lines.end(), "static int helper() { return 1; }"),
+            collector.lines.end());
+  std::filesystem::remove_all(dir);
+}
+
+TEST(GenerateNanobind, UnwritableShardThrows) {
+  auto dir = std::filesystem::temp_directory_path() / "codegen_nanobind_missing_test";
+  std::filesystem::remove_all(dir);
+  std::string output = (dir / "PythonApi.cpp").string();
+
+  miniparser::LblMiniparser source;
+  LblEmitModuleStart moduleStart(backwardsHierarchy());
+  moduleStart.subscribeTo(source);
+  LblEmitPythonApi api(backwardsHierarchy());
+  api.subscribeTo(moduleStart);
+  api.setShards(2, output);
+
+  source.process("[[StartModule (Fruit)]]");
+  ASSERT_THROW(source.process("[[PythonApi]]"), std::runtime_error);
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/indexer.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  // A few headers in a scratch directory
+  struct Headers {
+    std::filesystem::path directory;
+    std::vector<std::string> paths;
+
+    Headers() {
+      directory = std::filesystem::temp_directory_path() / "codegen_indexer_test";
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      for (int i = 0; i < 20; ++i) {
+        auto n = std::to_string(i);
+        write("h" + n + ".h",
+              "enum class Kind" + n + " { a, b };\n"
+              "class Widget" + n + " {\n"
+              "public:\n"
+              "  int size;\n"
+              "  void resize(int width, int height);\n"
+              "};\n");
+      }
+      write("nothing.h", "#pragma once\nint add(int a, int b);\n");
+      // Same class as h0.h, later in the list so it wins
+      write("override.h", "class Widget0 {\npublic:\n  double size;\n};\n");
+    }
+
+    ~Headers() {
+      std::filesystem::remove_all(directory);
+    }
+
+    void write(const std::string& name, const std::string& contents) {
+      auto path = (directory / name).string();
+      std::ofstream(path) << contents;
+      paths.push_back(path);
+    }
+  };
+
+}
+
+TEST(Indexer, ParallelMatchesSerial) {
+  Headers headers;
+  std::vector<std::string> failed;
+  auto parallel = indexHeaders(headers.paths, parser::IndexDetail::full, 4, &failed);
+  ASSERT_TRUE(failed.empty());
+  ASSERT_EQ(parallel->enums.size(), 20);
+  ASSERT_EQ(parallel->classes.size(), 20);
+  ASSERT_EQ(parallel->classes["Widget0"]->members[0].type, "double");
+  ASSERT_EQ(parallel->classes["Widget1"]->methods[0].parameters.size(), 2);
+  ASSERT_EQ(parallel->classes["Widget1"]->definedIn, headers.paths[1]);
+
+  auto serial = indexHeaders(headers.paths, parser::IndexDetail::full, 1);
+  ASSERT_EQ(parallel->hashes, serial->hashes);
+}
+
+TEST(Indexer, ReportsFailures) {
+  Headers headers;
+  headers.paths.push_back((headers.directory / "missing.h").string());
+  std::vector<std::string> failed;
+  auto index = indexHeaders(headers.paths, parser::IndexDetail::enums, 0, &failed);
+  ASSERT_EQ(failed, std::vector<std::string>{headers.paths.back()});
+  ASSERT_EQ(index->enums.size(), 20);
+  // Nothing but enums at that level
+  ASSERT_TRUE(index->classes.empty());
+}
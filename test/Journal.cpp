@@ -0,0 +1,174 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/journal.h>
+#include <fr/codegen/tools.h>
+#include <fstream>
+#include <memory>
+#include <string>
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::shared_ptr<EnumData> makeEnum(const std::string& name, const std::string& header,
+                                     std::vector<std::string> identifiers) {
+    auto ret = std::make_shared<EnumData>();
+    ret->name = name;
+    ret->definedIn = header;
+    ret->identifiers = std::move(identifiers);
+    return ret;
+  }
+
+  std::shared_ptr<ClassData> makeClass(const std::string& name, const std::string& header) {
+    auto ret = std::make_shared<ClassData>();
+    ret->name = name;
+    ret->definedIn = header;
+    return ret;
+  }
+
+  // An index of a.h and b.h written to a scratch directory
+  struct Snapshot {
+    std::filesystem::path directory;
+    std::string json;
+
+    Snapshot() {
+      directory = std::filesystem::temp_directory_path() / "codegen_journal_test";
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      json = (directory / "index.json").string();
+      Index index;
+      index.enums["Color"] = makeEnum("Color", "a.h", {"red", "green"});
+      index.classes["Brush"] = makeClass("Brush", "a.h");
+      index.classes["Canvas"] = makeClass("Canvas", "b.h");
+      index.save(json);
+    }
+
+    ~Snapshot() {
+      std::filesystem::remove_all(directory);
+    }
+
+    std::shared_ptr<Index> load() {
+      auto ret = loadJournaledIndex(json, {});
+      if (!ret) {
+        ret = std::make_shared<Index>();
+        ret->load(json);
+      }
+      return ret;
+    }
+  };
+
+  HeaderManifest manifest() {
+    return {{"a.h", {1, 10}}, {"b.h", {2, 20}}};
+  }
+
+}
+
+TEST(Journal, ReplaceAndRemove) {
+  Snapshot snapshot;
+  auto journal = IndexJournal::start(snapshot.json, "full", manifest());
+  ASSERT_TRUE(journal);
+  // A fresh journal doesn't change anything
+  ASSERT_EQ(snapshot.load()->classes.size(), 2);
+
+  HeaderIndex a;
+  a.enums["Color"] = makeEnum("Color", "a.h", {"red", "green", "blue"});
+  a.classes["Palette"] = makeClass("Palette", "a.h");
+  journal->replace("a.h", {3, 30}, a);
+  journal->remove("b.h");
+  ASSERT_EQ(journal->records(), 2);
+
+  auto index = snapshot.load();
+  ASSERT_EQ(index->enums.at("Color")->identifiers.size(), 3);
+  ASSERT_TRUE(index->classes.count("Palette"));
+  ASSERT_FALSE(index->classes.count("Brush"));
+  ASSERT_FALSE(index->classes.count("Canvas"));
+  // The hashes follow along so the generators notice
+  ASSERT_EQ(index->hashOf(enumKey("Color")), entityHash(*a.enums["Color"]));
+  ASSERT_EQ(index->hashOf(classKey("Canvas")), "");
+
+  auto reopened = IndexJournal::open(snapshot.json);
+  ASSERT_TRUE(reopened);
+  ASSERT_EQ(reopened->detail(), "full");
+  ASSERT_EQ(reopened->headers(), (HeaderManifest{{"a.h", {3, 30}}}));
+  ASSERT_EQ(reopened->size(), journal->size());
+  ASSERT_EQ(reopened->size(), std::filesystem::file_size(journalFile(snapshot.json)));
+}
+
+TEST(Journal, LastRecordWins) {
+  Snapshot snapshot;
+  auto journal = IndexJournal::start(snapshot.json, "full", manifest());
+  HeaderIndex first;
+  first.classes["Easel"] = makeClass("Easel", "c.h");
+  journal->replace("c.h", {4, 40}, first);
+  journal->remove("c.h");
+  HeaderIndex second;
+  second.classes["Stool"] = makeClass("Stool", "c.h");
+  journal->replace("c.h", {5, 50}, second);
+
+  auto index = snapshot.load();
+  ASSERT_FALSE(index->classes.count("Easel"));
+  ASSERT_TRUE(index->classes.count("Stool"));
+  ASSERT_TRUE(index->classes.count("Brush"));
+}
+
+TEST(Journal, IgnoresTornRecords) {
+  Snapshot snapshot;
+  auto journal = IndexJournal::start(snapshot.json, "full", manifest());
+  journal->remove("b.h");
+  auto good = journal->size();
+  {
+    // Half a record, like we crashed partway through writing it
+    std::ofstream stream(journalFile(snapshot.json), std::ios::binary | std::ios::app);
+    stream.write("\x40\x00\x00\x00\x03garbage", 12);
+  }
+  auto reopened = IndexJournal::open(snapshot.json);
+  ASSERT_TRUE(reopened);
+  ASSERT_EQ(reopened->records(), 1);
+  ASSERT_EQ(reopened->size(), good);
+  ASSERT_FALSE(snapshot.load()->classes.count("Canvas"));
+
+  // The next append goes where the torn one was
+  reopened->remove("a.h");
+  ASSERT_EQ(std::filesystem::file_size(journalFile(snapshot.json)), reopened->size());
+  ASSERT_EQ(IndexJournal::open(snapshot.json)->records(), 2);
+  ASSERT_TRUE(snapshot.load()->classes.empty());
+}
+
+TEST(Journal, StaleJournalIgnored) {
+  Snapshot snapshot;
+  auto journal = IndexJournal::start(snapshot.json, "full", manifest());
+  journal->remove("b.h");
+  // Someone rewrote the JSON without telling the journal
+  Index other;
+  other.classes["Canvas"] = makeClass("Canvas", "b.h");
+  other.classes["Frame"] = makeClass("Frame", "b.h");
+  other.save(snapshot.json);
+  ASSERT_FALSE(IndexJournal::open(snapshot.json));
+  ASSERT_EQ(snapshot.load()->classes.size(), 2);
+}
+
+TEST(Journal, IndexCacheNoticesAppends) {
+  Snapshot snapshot;
+  auto journal = IndexJournal::start(snapshot.json, "full", manifest());
+  tools::ToolContext context;
+  ASSERT_TRUE(context.indexes.load(snapshot.json)->classes.count("Canvas"));
+  ASSERT_EQ(indexStamp(snapshot.json), FileStamp::of(journalFile(snapshot.json)));
+  journal->remove("b.h");
+  ASSERT_FALSE(context.indexes.load(snapshot.json)->classes.count("Canvas"));
+}
@@ -0,0 +1,264 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <fr/codegen/json.h>
+#include <fr/codegen/LblEmitFunctions.h>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LineCollector.h"
+
+using namespace fr::codegen;
+
+namespace {
+
+  enum class Mood { happy, grumpy };
+
+  struct Point {
+    int x = 0;
+    int y = 0;
+
+    // What [[genJsonCodec]] writes, give or take the seed
+    void saveJson(json::JsonWriter& writer) const {
+      writer.beginObject();
+      writer.field("x", x);
+      writer.field("y", y);
+      writer.endObject();
+    }
+
+    void loadJson(json::JsonReader& reader) {
+      reader.beginObject();
+      std::string_view key;
+      while (reader.nextKey(key)) {
+        switch (json::fieldHash(key, 0) & 1) {
+        case json::fieldHash("x", 0) & 1:
+          if (key == "x") { reader.read(x); continue; }
+          break;
+        case json::fieldHash("y", 0) & 1:
+          if (key == "y") { reader.read(y); continue; }
+          break;
+        }
+        reader.skipValue();
+      }
+    }
+  };
+
+  struct Everything {
+    std::string name;
+    double scale = 0.0;
+    int64_t count = 0;
+    bool enabled = false;
+    Mood mood = Mood::happy;
+    std::vector<Point> points;
+    std::optional<std::string> nickname;
+
+    void saveJson(json::JsonWriter& writer) const {
+      writer.beginObject();
+      writer.field("name", name);
+      writer.field("scale", scale);
+      writer.field("count", count);
+      writer.field("enabled", enabled);
+      writer.field("mood", mood);
+      writer.field("points", points);
+      writer.field("nickname", nickname);
+      writer.endObject();
+    }
+
+    // Not bothering with the hash here, the reader doesn't care
+    void loadJson(json::JsonReader& reader) {
+      reader.beginObject();
+      std::string_view key;
+      while (reader.nextKey(key)) {
+        if (key == "name") { reader.read(name); }
+        else if (key == "scale") { reader.read(scale); }
+        else if (key == "count") { reader.read(count); }
+        else if (key == "enabled") { reader.read(enabled); }
+        else if (key == "mood") { reader.read(mood); }
+        else if (key == "points") { reader.read(points); }
+        else if (key == "nickname") { reader.read(nickname); }
+        else { reader.skipValue(); }
+      }
+    }
+  };
+
+}
+
+TEST(JsonCodec, RoundTrip) {
+  Everything out;
+  out.name = "quote \" backslash \\ newline \n tab \t bell \a caf\xc3\xa9";
+  out.scale = 0.1;
+  out.count = -1234567890123;
+  out.enabled = true;
+  out.mood = Mood::grumpy;
+  out.points = {{1, 2}, {-3, 4}};
+  auto text = json::toJson(out);
+  ASSERT_EQ(text.find('\n'), std::string::npos);
+  ASSERT_NE(text.find("\\u0007"), std::string::npos);
+  ASSERT_NE(text.find("\"scale\":0.1,"), std::string::npos);
+  ASSERT_NE(text.find("\"nickname\":null"), std::string::npos);
+
+  Everything in;
+  in.nickname = "Bob";
+  json::fromJson(in, text);
+  ASSERT_EQ(in.name, out.name);
+  ASSERT_EQ(in.scale, out.scale);
+  ASSERT_EQ(in.count, out.count);
+  ASSERT_EQ(in.enabled, out.enabled);
+  ASSERT_EQ(in.mood, out.mood);
+  ASSERT_EQ(in.points.size(), 2);
+  ASSERT_EQ(in.points[1].x, -3);
+  ASSERT_EQ(in.points[1].y, 4);
+  ASSERT_FALSE(in.nickname);
+}
+
+TEST(JsonCodec, ReadsOtherPeoplesJson) {
+  // Whitespace, escapes and fields we don't know about
+  std::string text = R"( {
+    "unknown" : { "nested" : [1, {"deeper": "}"}, "]"], "more": null },
+    "name" : "snow ☃ 😀 \/",
+    "points" : [ { "y" : 2, "x" : 1, "z" : [] } ],
+    "scale" : 1e3,
+    "alsoUnknown" : -1.5e-3
+  } )";
+  Everything in;
+  json::fromJson(in, text);
+  ASSERT_EQ(in.name, "snow \xe2\x98\x83 \xf0\x9f\x98\x80 /");
+  ASSERT_EQ(in.scale, 1000.0);
+  ASSERT_EQ(in.points.size(), 1);
+  ASSERT_EQ(in.points[0].x, 1);
+  ASSERT_EQ(in.points[0].y, 2);
+}
+
+TEST(JsonCodec, NonFiniteIsNull) {
+  Everything out;
+  out.scale = INFINITY;
+  auto text = json::toJson(out);
+  ASSERT_NE(text.find("\"scale\":null"), std::string::npos);
+  Everything in;
+  json::fromJson(in, text);
+  ASSERT_TRUE(std::isnan(in.scale));
+}
+
+TEST(JsonCodec, BadJsonThrows) {
+  Everything in;
+  ASSERT_THROW(json::fromJson(in, R"({"name": "unterminated)"), json::JsonError);
+  ASSERT_THROW(json::fromJson(in, R"({"count": "seven"})"), json::JsonError);
+  ASSERT_THROW(json::fromJson(in, R"({"count": 1 "scale": 2})"), json::JsonError);
+  ASSERT_THROW(json::fromJson(in, R"({"count": 1,)"), json::JsonError);
+  ASSERT_THROW(json::fromJson(in, "[]"), json::JsonError);
+}
+
+TEST(JsonCodec, PerfectHash) {
+  std::vector<std::string> names;
+  for (int i = 0; i < 40; ++i) {
+    names.push_back("member" + std::to_string(i));
+  }
+  auto table = json::perfectHash(names);
+  std::set<uint32_t> slots;
+  for (const auto& name : names) {
+    slots.insert(json::fieldHash(name, table.seed) & table.mask);
+  }
+  ASSERT_EQ(slots.size(), names.size());
+  ASSERT_LE(table.mask, 127);
+}
+
+TEST(JsonCodec, EmitsCodec) {
+  ClassMap classes;
+  auto config = std::make_shared<ClassData>();
+  config->name = "Config";
+  config->serializable = true;
+  for (auto name : {"searchPath", "gravitationalConstant", "numNipples"}) {
+    MemberData member{};
+    member.name = name;
+    member.type = "int";
+    config->members.push_back(member);
+  }
+  classes["Config"] = config;
+
+  LblEmitJsonCodec emitter(classes);
+  LineCollector collector;
+  collector.subscribeTo(emitter);
+  emitter.handleClassPush("Config");
+  emitter.process("  [[genJsonCodec]]");
+  emitter.process("int unrelated;");
+  emitter.handleClassPop();
+
+  auto& lines = collector.lines;
+  ASSERT_EQ(lines.back(), "int unrelated;");
+  ASSERT_EQ(lines.front(), "void saveJson(fr::codegen::json::JsonWriter& writer) const {");
+  ASSERT_NE(std::find(lines.begin(), lines.end(), "writer.field(\"numNipples\", numNipples);"), lines.end());
+  ASSERT_NE(std::find(lines.begin(), lines.end(),
+                      "if (key == \"searchPath\") { reader.read(searchPath); continue; }"), lines.end());
+  // Every field gets its own case
+  std::set<std::string> cases;
+  for (const auto& line : lines) {
+    if (line.starts_with("case ")) {
+      ASSERT_TRUE(cases.insert(line).second);
+    }
+  }
+  ASSERT_EQ(cases.size(), 3);
+}
+
+TEST(JsonCodec, EmitsCodecForClassesInOtherIndexes) {
+  // Config got indexed by some other package, so it isn't in the
+  // classes we were given
+  auto other = std::make_shared<Index>();
+  auto config = std::make_shared<ClassData>();
+  config->name = "Config";
+  config->namespaces = {"other"};
+  config->serializable = true;
+  MemberData member{};
+  member.name = "searchPath";
+  member.type = "int";
+  config->members.push_back(member);
+  other->classes["other::Config"] = config;
+  IndexSet indexes(std::make_shared<Index>());
+  indexes.add(other);
+
+  LblEmitJsonCodec emitter(ClassMap{});
+  emitter.resolveWith(indexes);
+  LineCollector collector;
+  collector.subscribeTo(emitter);
+  emitter.handleClassPush("Config");
+  emitter.process("  [[genJsonCodec]]");
+  emitter.handleClassPop();
+
+  auto& lines = collector.lines;
+  ASSERT_FALSE(lines.empty());
+  ASSERT_EQ(lines.front(), "void saveJson(fr::codegen::json::JsonWriter& writer) const {");
+  ASSERT_NE(std::find(lines.begin(), lines.end(), "writer.field(\"searchPath\", searchPath);"), lines.end());
+}
+
+TEST(JsonCodec, WarningsGoWhereYouSay) {
+  ClassMap classes;
+  LblEmitJsonCodec emitter(classes);
+  std::stringstream warnings;
+  emitter.warnTo(warnings);
+  LineCollector collector;
+  collector.subscribeTo(emitter);
+  emitter.handleClassPush("Missing");
+  emitter.handleClassPop();
+  emitter.process("  [[genJsonCodec]]");
+
+  auto text = warnings.str();
+  ASSERT_NE(text.find("Class Missing was not found"), std::string::npos);
+  ASSERT_NE(text.find("[[genJsonCodec]] encountered, but not in a class"), std::string::npos);
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fr/codegen/LblEmitFunctions.h>
+#include <fr/codegen/LblTemplate.h>
+#include <fr/codegen/tools.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LineCollector.h"
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::string writeTemplate(const std::string& name, const std::string& contents) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream stream(path, std::ios::trunc);
+    stream << contents;
+    return path;
+  }
+
+  const std::string widgetTemplate(
+    "namespace foo {\n"
+    "  // class NotAClass\n"
+    "  class Widget {\n"
+    "    [[get]] int count;\n"
+    "  public:\n"
+    "    [[genGetSetMethods]]\n"
+    "  };\n"
+    "  struct Gadget { int size; };\n"
+    "}\n");
+
+  ClassMap widgetClasses() {
+    ClassMap classes;
+    auto widget = std::make_shared<ClassData>();
+    widget->name = "Widget";
+    widget->namespaces = {"foo"};
+    MemberData count{};
+    count.type = "int";
+    count.name = "count";
+    count.generateGetter = true;
+    widget->members.push_back(count);
+    classes["foo::Widget"] = widget;
+    auto gadget = std::make_shared<ClassData>();
+    gadget->name = "Gadget";
+    gadget->namespaces = {"foo"};
+    classes["foo::Gadget"] = gadget;
+    return classes;
+  }
+
+}
+
+TEST(LblTemplate, PlaysWhatTheMiniparserSaid) {
+  auto path = writeTemplate("codegen_lbl_template.h.in", widgetTemplate);
+
+  std::vector<std::string> live;
+  {
+    LblReader reader(path);
+    miniparser::LblMiniparser parser;
+    parser.subscribeTo(reader);
+    parser.classPush.connect([&live](const std::string& name) { live.push_back("push " + name); });
+    parser.classPop.connect([&live]() { live.push_back("pop"); });
+    parser.emit.connect([&live](const std::string& line) { live.push_back("line " + line); });
+    reader.process();
+  }
+
+  std::vector<std::string> played;
+  LblTemplateReader reader(LblTemplate::read(path));
+  reader.classPush.connect([&played](const std::string& name) { played.push_back("push " + name); });
+  reader.classPop.connect([&played]() { played.push_back("pop"); });
+  reader.emit.connect([&played](const std::string& line) { played.push_back("line " + line); });
+  reader.process();
+
+  ASSERT_EQ(played, live);
+  ASSERT_NE(std::find(played.begin(), played.end(), "push Widget"), played.end());
+  ASSERT_NE(std::find(played.begin(), played.end(), "push Gadget"), played.end());
+  ASSERT_EQ(std::find(played.begin(), played.end(), "push NotAClass"), played.end());
+  std::filesystem::remove(path);
+}
+
+TEST(LblTemplate, OneReadManyChains) {
+  auto path = writeTemplate("codegen_lbl_fanout.h.in", widgetTemplate);
+  auto classes = widgetClasses();
+  auto lblTemplate = LblTemplate::read(path);
+
+  // Each chain by itself
+  auto runAlone = [&](bool getSet) {
+    LblTemplateReader reader(lblTemplate);
+    LblEmitGetSetMethods getSetEmitter(classes);
+    LblEatAnnotations eater(classes);
+    if (getSet) {
+      getSetEmitter.subscribeTo(reader);
+      eater.subscribeTo(getSetEmitter);
+    } else {
+      eater.subscribeTo(reader);
+    }
+    LineCollector collector;
+    collector.subscribeTo(eater);
+    reader.process();
+    return collector.lines;
+  };
+  auto header = runAlone(true);
+  auto stripped = runAlone(false);
+  ASSERT_NE(std::find(header.begin(), header.end(), "int getcount() const { return count; }"), header.end());
+  ASSERT_NE(header, stripped);
+
+  // And both of them plus a straight copy, off one pass
+  LblTemplateReader reader(lblTemplate);
+  LblEmitGetSetMethods getSetEmitter(classes);
+  getSetEmitter.subscribeTo(reader);
+  LblEatAnnotations headerEater(classes);
+  headerEater.subscribeTo(getSetEmitter);
+  LineCollector headerOut;
+  headerOut.subscribeTo(headerEater);
+  LblEatAnnotations strippedEater(classes);
+  strippedEater.subscribeTo(reader);
+  LineCollector strippedOut;
+  strippedOut.subscribeTo(strippedEater);
+  LineCollector copyOut;
+  copyOut.subscribeTo(reader);
+  reader.process();
+
+  ASSERT_EQ(headerOut.lines, header);
+  ASSERT_EQ(strippedOut.lines, stripped);
+  ASSERT_EQ(copyOut.lines.size(), 9);
+  ASSERT_EQ(copyOut.lines[5], "    [[genGetSetMethods]]");
+  std::filesystem::remove(path);
+}
+
+TEST(LblTemplate, CacheReadsOnce) {
+  auto path = writeTemplate("codegen_lbl_cache.h.in", widgetTemplate);
+  tools::ToolContext context;
+  auto first = context.templates.load(path);
+  ASSERT_EQ(context.templates.load(path), first);
+  ASSERT_EQ(context.templates.size(), 1);
+
+  // A different size is enough to notice the change without waiting
+  // for the clock to tick over
+  writeTemplate("codegen_lbl_cache.h.in", widgetTemplate + "// more\n");
+  auto second = context.templates.load(path);
+  ASSERT_NE(second, first);
+  ASSERT_EQ(second->events().size(), first->events().size() + 1);
+  ASSERT_EQ(context.templates.load(path), second);
+
+  // Nothing there is nothing to play
+  std::filesystem::remove(path);
+  ASSERT_TRUE(context.templates.load(path)->events().empty());
+}
@@ -0,0 +1,30 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <fr/codegen/LblFilter.h>
+#include <string>
+#include <vector>
+
+// Collects everything that comes out the end of a filter chain
+class LineCollector : public fr::codegen::LblSubscriber {
+public:
+  std::vector<std::string> lines;
+  void process(const std::string& line) override {
+    lines.push_back(line);
+  }
+};
@@ -0,0 +1,109 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <filesystem>
+#include <fr/codegen/loader.h>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  // Some headers of different sizes, including an empty one, one
+  // bigger than a single read is likely to return and one that
+  // isn't there
+  struct Files {
+    std::filesystem::path directory;
+    std::vector<std::string> names;
+    std::vector<std::string> contents;
+
+    Files() : directory(std::filesystem::temp_directory_path() / "codegen_loader_test") {
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      for (int i = 0; i < 200; ++i) {
+        std::string text;
+        if (i == 7) {
+          text = std::string(3 * 1024 * 1024, 'x');
+        } else if (i != 3) {
+          for (int line = 0; line < i; ++line) {
+            text.append("enum class E" + std::to_string(i) + "_" + std::to_string(line) + " { a, b };\n");
+          }
+        }
+        auto name = (directory / ("header" + std::to_string(i) + ".h")).string();
+        std::ofstream(name) << text;
+        names.push_back(name);
+        contents.push_back(text);
+      }
+      names.push_back((directory / "missing.h").string());
+      contents.push_back("");
+    }
+
+    ~Files() {
+      std::filesystem::remove_all(directory);
+    }
+
+    void check(ReadBackend backend, size_t depth) {
+      FileLoader loader(names, backend, 4, depth);
+      std::set<size_t> seen;
+      while (auto file = loader.next()) {
+        ASSERT_TRUE(seen.insert(file->id).second);
+        ASSERT_EQ(file->filename, names[file->id]);
+        if (file->id == names.size() - 1) {
+          ASSERT_EQ(file->error, ENOENT);
+        } else {
+          ASSERT_EQ(file->error, 0);
+        }
+        ASSERT_EQ(file->contents, contents[file->id]);
+      }
+      ASSERT_EQ(seen.size(), names.size());
+    }
+  };
+
+}
+
+TEST(Loader, Threads) {
+  Files files;
+  files.check(ReadBackend::threads, 64);
+  // A queue of one makes the readers wait on us the whole time
+  files.check(ReadBackend::threads, 1);
+}
+
+TEST(Loader, Uring) {
+  Files files;
+  {
+    FileLoader loader(files.names, ReadBackend::uring);
+    ASSERT_EQ(loader.backend(), FileLoader::uringAvailable() ? ReadBackend::uring : ReadBackend::threads);
+  }
+  files.check(ReadBackend::uring, 64);
+  files.check(ReadBackend::uring, 1);
+}
+
+TEST(Loader, StopsEarly) {
+  Files files;
+  // Going away without taking everything mustn't hang
+  FileLoader loader(files.names, ReadBackend::automatic, 4, 2);
+  ASSERT_TRUE(loader.next());
+}
+
+TEST(Loader, NothingToLoad) {
+  FileLoader loader({});
+  ASSERT_FALSE(loader.next());
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <fr/codegen/memo.h>
+#include <fr/codegen/parser.h>
+#include <string>
+#include <vector>
+
+namespace x3 = boost::spirit::x3;
+using namespace fr::codegen::parser;
+
+namespace {
+
+  // How many times nest actually got parsed
+  size_t nestParses = 0;
+
+  auto const countNest = [](auto&) { ++nestParses; };
+
+  // About as bad as backtracking gets. Both alternatives parse the
+  // whole nest inside the parentheses before finding out whether they
+  // wanted an a or a b after it, so without memoization every level
+  // of nesting doubles the work.
+  x3::rule<class Nest> const nest = "nest";
+  auto const nest_def = x3::eps[countNest] >>
+    ((x3::lit('(') >> memo[nest] >> x3::lit(')') >> x3::lit('a')) |
+     (x3::lit('(') >> memo[nest] >> x3::lit(')') >> x3::lit('b')) |
+     x3::lit('x'));
+
+  BOOST_SPIRIT_DEFINE(nest);
+
+  std::string nested(size_t depth) {
+    std::string ret(depth, '(');
+    ret += 'x';
+    for (size_t i = 0; i < depth; ++i) {
+      ret += ")b";
+    }
+    return ret;
+  }
+
+  // Parses nested(depth) and returns how many times nest got parsed
+  size_t parseNest(size_t depth, bool memoize) {
+    auto input = nested(depth);
+    auto first = input.cbegin();
+    MemoTable<std::string::const_iterator> table(first);
+    MemoTable<std::string::const_iterator>* memoTable = memoize ? &table : nullptr;
+    nestParses = 0;
+    bool parsed = x3::parse(first, input.cend(), x3::with<MemoTag>(memoTable)[nest]);
+    EXPECT_TRUE(parsed);
+    EXPECT_TRUE(first == input.cend());
+    return nestParses;
+  }
+
+  // Everything the parser said about some code, in order
+  std::vector<std::string> signals(const std::string& code, IndexDetail detail, bool memoize) {
+    std::vector<std::string> ret;
+    ParserDriver parser;
+    parser.detail = detail;
+    parser.memoize = memoize;
+    parser.classPush.connect([&](const std::string& name, int) { ret.push_back("class " + name); });
+    parser.classPop.connect([&]() { ret.push_back("pop"); });
+    parser.enumIdentifier.connect([&](const std::string& name, const std::string& id) {
+      ret.push_back("enum " + name + "::" + id);
+    });
+    parser.memberFound.connect([&](bool, bool, const std::string& type, const std::string& name) {
+      ret.push_back("member " + type + " " + name);
+    });
+    parser.methodFound.connect([&](bool, bool, bool, const std::string& type, const std::string& name) {
+      ret.push_back("method " + type + " " + name);
+    });
+    parser.parameterFound.connect([&](const std::string& type, const std::string& name, bool, bool) {
+      ret.push_back("parameter " + type + " " + name);
+    });
+    std::string result;
+    EXPECT_TRUE(parser.parse(code.begin(), code.end(), result));
+    return ret;
+  }
+
+}
+
+TEST(Memo, BacktrackingGoesLinear) {
+  // Without the table it's 2^depth
+  ASSERT_EQ(parseNest(10, false), (size_t(1) << 11) - 1);
+  ASSERT_EQ(parseNest(11, false), (size_t(1) << 12) - 1);
+  // With it every position gets parsed once, so twice as deep is
+  // twice as much work
+  ASSERT_EQ(parseNest(10, true), 11);
+  ASSERT_EQ(parseNest(11, true), 12);
+  ASSERT_EQ(parseNest(1000, true), 1001);
+}
+
+TEST(Memo, SkipRulesHitTheTable) {
+  // Both alternatives start by skipping the same nested scope
+  std::string input("{ a { b { c } } d } b");
+  auto first = input.cbegin();
+  MemoTable<std::string::const_iterator> table(first);
+  bool parsed = x3::phrase_parse(first, input.cend(),
+                                 x3::with<MemoTag>(&table)[(memo[ignoreScopes] >> x3::lit('a')) |
+                                                           (memo[ignoreScopes] >> x3::lit('b'))],
+                                 x3::ascii::space);
+  ASSERT_TRUE(parsed);
+  ASSERT_TRUE(first == input.cend());
+  ASSERT_EQ(table.hits, 1);
+  // The outer scope from outside the lexeme, then inside it the two
+  // inner scopes and the three closing braces that weren't one
+  ASSERT_EQ(table.misses, 6);
+}
+
+TEST(Memo, NullTableJustParses) {
+  std::string input("{ a { b } }");
+  auto first = input.cbegin();
+  MemoTable<std::string::const_iterator>* table = nullptr;
+  ASSERT_TRUE(x3::phrase_parse(first, input.cend(), x3::with<MemoTag>(table)[memo[ignoreScopes]], x3::ascii::space));
+  ASSERT_TRUE(first == input.cend());
+  // And no table at all
+  first = input.cbegin();
+  ASSERT_TRUE(x3::phrase_parse(first, input.cend(), memo[ignoreScopes], x3::ascii::space));
+  ASSERT_TRUE(first == input.cend());
+}
+
+TEST(Memo, ParserSaysTheSameThing) {
+  std::string code(
+    "namespace foo {\n"
+    "  enum class Color { red, green, blue };\n"
+    "  class Widget : public Base {\n"
+    "    int _count;\n"
+    "    std::vector<std::map<int, int>> _table;\n"
+    "  public:\n"
+    "    Widget() : _count(0) { if (true) { _count = 1; } }\n"
+    "    template <typename T, typename U = std::pair<T, T>> T convert(U u);\n"
+    "    void reset(int count, const std::string& name) { for (;;) { { break; } } }\n"
+    "    int count() const { return _count; }\n"
+    "  };\n"
+    "  template <typename T> class Ignored { T _t; };\n"
+    "}\n");
+  for (auto detail : {IndexDetail::full, IndexDetail::members, IndexDetail::enums}) {
+    auto plain = signals(code, detail, false);
+    ASSERT_FALSE(plain.empty());
+    ASSERT_EQ(signals(code, detail, true), plain);
+  }
+}
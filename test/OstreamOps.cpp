@@ -0,0 +1,250 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/OstreamOps.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+using namespace fr::codegen::ostreamops;
+
+namespace {
+
+  std::shared_ptr<EnumData> makeEnum(const std::string& name, const std::string& definedIn, size_t identifiers) {
+    auto data = std::make_shared<EnumData>();
+    data->name = name;
+    data->namespaces.push_back("paint");
+    data->definedIn = definedIn;
+    data->isClassEnum = true;
+    for (size_t i = 0; i < identifiers; ++i) {
+      data->identifiers.push_back(name + std::to_string(i));
+    }
+    return data;
+  }
+
+  // Three headers of different sizes, one of them with two enums
+  Index makeIndex() {
+    Index index;
+    index.enums["paint::Color"] = makeEnum("Color", "color.h", 6);
+    index.enums["paint::Shade"] = makeEnum("Shade", "color.h", 4);
+    index.enums["paint::Shape"] = makeEnum("Shape", "shape.h", 5);
+    index.enums["paint::Brush"] = makeEnum("Brush", "brush.h", 1);
+    index.computeHashes();
+    return index;
+  }
+
+  std::vector<std::string> includesIn(const std::string& text) {
+    std::vector<std::string> ret;
+    std::stringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line)) {
+      if (line.starts_with("#include")) {
+        ret.push_back(line);
+      }
+    }
+    return ret;
+  }
+
+}
+
+TEST(OstreamOps, ShardNames) {
+  ASSERT_EQ(shardFileName("ops.cpp", 0), "ops_shard0.cpp");
+  ASSERT_EQ(shardFileName("out/enum_ops.cc", 12), "out/enum_ops_shard12.cc");
+}
+
+TEST(OstreamOps, EveryEnumInOneShard) {
+  auto index = makeIndex();
+  for (int count : {1, 2, 3, 5}) {
+    auto shards = shardEnums(index.enums, count);
+    // You always get as many as you asked for, even if some are empty
+    ASSERT_EQ(shards.size(), count);
+    std::multiset<std::string> seen;
+    for (const auto& shard : shards) {
+      for (const auto& [name, ptr] : shard) {
+        seen.insert(name);
+      }
+    }
+    ASSERT_EQ(seen.size(), index.enums.size());
+    for (const auto& [name, ptr] : index.enums) {
+      ASSERT_EQ(seen.count(name), 1);
+    }
+  }
+
+  // Biggest header first, to whichever shard is smallest, and enums
+  // from one header stay together
+  auto shards = shardEnums(index.enums, 3);
+  ASSERT_EQ(shards[0].size(), 2);
+  ASSERT_TRUE(shards[0].contains("paint::Color"));
+  ASSERT_TRUE(shards[0].contains("paint::Shade"));
+  ASSERT_TRUE(shards[1].contains("paint::Shape"));
+  ASSERT_TRUE(shards[2].contains("paint::Brush"));
+  ASSERT_TRUE(shardEnums(index.enums, 5)[4].empty());
+}
+
+TEST(OstreamOps, ShardsOnlyIncludeTheirHeaders) {
+  auto index = makeIndex();
+  auto shards = shardEnums(index.enums, 3);
+  std::stringstream first;
+  generateShard(shards[0], first);
+  ASSERT_EQ(includesIn(first.str()),
+            (std::vector<std::string>{"#include <string>", "#include <iostream>", "#include <color.h>"}));
+  ASSERT_NE(first.str().find("to_string(const paint::Shade& value)"), std::string::npos);
+  ASSERT_EQ(first.str().find("paint::Shape"), std::string::npos);
+
+  std::stringstream empty;
+  generateShard(shardEnums(index.enums, 5)[4], empty);
+  ASSERT_EQ(includesIn(empty.str()), (std::vector<std::string>{"#include <string>", "#include <iostream>"}));
+}
+
+TEST(OstreamOps, UnchangedShardsAreSkipped) {
+  auto sidecar = (std::filesystem::temp_directory_path() / "codegen_ostreamops_deps.json").string();
+  auto directory = std::filesystem::temp_directory_path() / "codegen_ostreamops";
+  std::filesystem::remove(sidecar);
+  std::filesystem::create_directories(directory);
+  auto cpp = (directory / "ops.cpp").string();
+  const std::vector<std::string> options{"shards=3"};
+
+  // What the program does for each shard
+  auto outOfDate = [&](const Index& index) {
+    std::set<int> ret;
+    DependencyTracker deps(sidecar);
+    auto shards = shardEnums(index.enums, 3);
+    for (int shard = 0; shard < 3; ++shard) {
+      auto file = shardFileName(cpp, shard);
+      auto inputs = enumInputs(index, shards[shard], options);
+      if (!deps.upToDate(file, inputs)) {
+        ret.insert(shard);
+        std::ofstream(file) << "generated";
+      }
+      deps.consumed(file, inputs);
+    }
+    deps.save();
+    return ret;
+  };
+
+  auto index = makeIndex();
+  ASSERT_EQ(outOfDate(index), (std::set<int>{0, 1, 2}));
+  ASSERT_TRUE(outOfDate(index).empty());
+
+  // A new identifier only touches the shard its enum is in
+  index.enums["paint::Shape"]->identifiers.push_back("oval");
+  index.computeHashes();
+  ASSERT_EQ(outOfDate(index), std::set<int>{1});
+  ASSERT_TRUE(outOfDate(index).empty());
+
+  // And a missing shard gets written again
+  std::filesystem::remove(shardFileName(cpp, 2));
+  ASSERT_EQ(outOfDate(index), std::set<int>{2});
+
+  std::filesystem::remove_all(directory);
+  std::filesystem::remove(sidecar);
+}
+
+TEST(OstreamOps, WhatCanBeForwardDeclared) {
+  auto data = makeEnum("Color", "color.h", 2);
+  // enum class Color is an int unless it says otherwise
+  ASSERT_TRUE(canForwardDeclare(*data));
+  // A plain enum without a type could be anything that fits
+  data->isClassEnum = false;
+  ASSERT_FALSE(canForwardDeclare(*data));
+  for (std::string type : {"uint8_t", "std::uint8_t", "::int64_t", "unsigned long long", "size_t", "std::size_t"}) {
+    data->underlyingType = type;
+    ASSERT_TRUE(canForwardDeclare(*data)) << type;
+  }
+  // Somebody's typedef needs their header to find out what it is
+  data->underlyingType = "paint::Channel";
+  ASSERT_FALSE(canForwardDeclare(*data));
+  data->isClassEnum = true;
+  ASSERT_FALSE(canForwardDeclare(*data));
+}
+
+TEST(OstreamOps, CompanionHeaders) {
+  EnumMap enums;
+  enums["paint::Color"] = makeEnum("Color", "paint/color.h", 2);
+  auto sized = makeEnum("Size", "paint/color.h", 2);
+  sized->isClassEnum = false;
+  sized->underlyingType = "size_t";
+  enums["paint::Size"] = sized;
+  auto plain = makeEnum("Layer", "paint/color.h", 2);
+  plain->isClassEnum = false;
+  enums["paint::Layer"] = plain;
+
+  std::stringstream stream;
+  generateCompanionHeader(enums, stream);
+  auto text = stream.str();
+  // size_t comes from cstddef, and the plain enum needs its header
+  auto includes = includesIn(text);
+  ASSERT_NE(std::find(includes.begin(), includes.end(), "#include <cstddef>"), includes.end());
+  ASSERT_NE(std::find(includes.begin(), includes.end(), "#include <paint/color.h>"), includes.end());
+  ASSERT_NE(text.find("namespace paint { enum class Color; }"), std::string::npos);
+  ASSERT_NE(text.find("namespace paint { enum Size : size_t; }"), std::string::npos);
+  ASSERT_EQ(text.find("enum Layer"), std::string::npos);
+  ASSERT_NE(text.find("std::string to_string(const paint::Layer& value);"), std::string::npos);
+
+  // Everything forward declared means no headers of ours at all
+  enums.erase("paint::Layer");
+  std::stringstream opaque;
+  generateCompanionHeader(enums, opaque);
+  ASSERT_EQ(opaque.str().find("#include <paint/"), std::string::npos);
+}
+
+TEST(OstreamOps, CompanionNamesDontCollide) {
+  EnumMap enums;
+  enums["a::Color"] = makeEnum("Color", "a/color.h", 1);
+  enums["b::Color"] = makeEnum("Color", "b/color.h", 1);
+  enums["c::Color"] = makeEnum("Color", "c/color.hpp", 1);
+  enums["paint::Shape"] = makeEnum("Shape", "shape.h", 1);
+  auto byHeader = enumsByHeader(enums);
+  ASSERT_EQ(byHeader.size(), 4);
+  auto names = companionNames(byHeader);
+  ASSERT_EQ(names["a/color.h"], "color_ops.h");
+  ASSERT_EQ(names["b/color.h"], "color_2_ops.h");
+  ASSERT_EQ(names["c/color.hpp"], "color_3_ops.h");
+  ASSERT_EQ(names["shape.h"], "shape_ops.h");
+}
+
+TEST(OstreamOps, UmbrellaHeaderRoundTrip) {
+  std::map<std::string, std::string> names = {{"a/color.h", "color_ops.h"}, {"b/color.h", "color_2_ops.h"}};
+  std::stringstream umbrella;
+  generateUmbrellaHeader(names, umbrella);
+  // Somebody else's include doesn't count as a companion
+  umbrella << "#include \"config.h\"" << std::endl;
+  auto included = umbrellaIncludes(umbrella);
+  ASSERT_EQ(included, std::vector<std::string>({"color_ops.h", "color_2_ops.h"}));
+}
+
+TEST(OstreamOps, CompanionInputsOnlyCareAboutDeclarations) {
+  EnumMap enums;
+  enums["paint::Color"] = makeEnum("Color", "color.h", 2);
+  auto inputs = companionInputs(enums);
+  // The companion only declares the functions, so new identifiers
+  // don't change it
+  enums["paint::Color"] = makeEnum("Color", "color.h", 5);
+  ASSERT_EQ(companionInputs(enums), inputs);
+  enums["paint::Color"]->underlyingType = "int";
+  ASSERT_NE(companionInputs(enums), inputs);
+  // A header with no enums still gets a companion to compare against
+  ASSERT_EQ(companionInputs(EnumMap()).size(), 1);
+}
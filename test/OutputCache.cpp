@@ -0,0 +1,243 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/cache.h>
+#include <fr/codegen/data.h>
+#include <fr/codegen/dependencies.h>
+#include <fr/codegen/index.h>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::shared_ptr<EnumData> makeEnum(const std::string& name, std::vector<std::string> identifiers) {
+    auto data = std::make_shared<EnumData>();
+    data->name = name;
+    data->namespaces.push_back("foo");
+    data->definedIn = "foo.h";
+    data->identifiers = identifiers;
+    return data;
+  }
+
+  std::filesystem::path tempDirectory(const std::string& name) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path;
+  }
+
+  void writeText(const std::filesystem::path& file, const std::string& text) {
+    std::ofstream stream(file);
+    stream << text;
+  }
+
+  std::string readText(const std::filesystem::path& file) {
+    std::ifstream stream(file);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+  }
+
+}
+
+TEST(OutputCache, MissThenHit) {
+  auto work = tempDirectory("codegen_cache_test");
+  OutputCache cache((work / "cache").string());
+  std::string input = (work / "input.h.in").string();
+  std::string output = (work / "output.h").string();
+  writeText(input, "template");
+
+  Index index;
+  index.enums["foo::Color"] = makeEnum("Color", {"red", "green"});
+  index.computeHashes();
+
+  HashMap known{{DependencyTracker::fileKey(input), fileHash(input)}};
+  ASSERT_FALSE(cache.fetch("Test", known, index, {output}));
+
+  // Like the line by line generators, we find out what we read as we go
+  writeText(output, "generated from Color");
+  HashMap consumed = known;
+  consumed[enumKey("foo::Color")] = index.hashOf(enumKey("foo::Color"));
+  cache.store("Test", known, consumed, {output});
+
+  std::filesystem::remove(output);
+  auto hit = cache.fetch("Test", known, index, {output});
+  ASSERT_TRUE(hit);
+  ASSERT_EQ(*hit, consumed);
+  ASSERT_EQ(readText(output), "generated from Color");
+
+  // Where the input lives doesn't matter, just what's in it
+  std::string moved = (work / "elsewhere.h.in").string();
+  writeText(moved, "template");
+  HashMap movedKnown{{DependencyTracker::fileKey(moved), fileHash(moved)}};
+  ASSERT_TRUE(cache.fetch("Test", movedKnown, index, {output}));
+
+  // But different tools don't share
+  ASSERT_FALSE(cache.fetch("OtherTest", known, index, {output}));
+  std::filesystem::remove_all(work);
+}
+
+TEST(OutputCache, ConsumedEntitiesPickTheEntry) {
+  auto work = tempDirectory("codegen_cache_variant_test");
+  OutputCache cache((work / "cache").string());
+  std::string output = (work / "output.cpp").string();
+  HashMap known{{DependencyTracker::optionKey("shards=0"), ""}};
+
+  Index index;
+  index.enums["foo::Color"] = makeEnum("Color", {"red"});
+  index.enums["foo::Shape"] = makeEnum("Shape", {"square"});
+  index.computeHashes();
+
+  writeText(output, "red");
+  HashMap consumed = known;
+  consumed[enumKey("foo::Color")] = index.hashOf(enumKey("foo::Color"));
+  cache.store("Test", known, consumed, {output});
+
+  // Changing something the output didn't read is still a hit
+  index.enums["foo::Shape"]->identifiers.push_back("circle");
+  index.computeHashes();
+  ASSERT_TRUE(cache.fetch("Test", known, index, {output}));
+
+  // Changing something it did read isn't
+  index.enums["foo::Color"]->identifiers.push_back("green");
+  index.computeHashes();
+  ASSERT_FALSE(cache.fetch("Test", known, index, {output}));
+
+  // Both versions can live in the cache at once
+  writeText(output, "red green");
+  consumed[enumKey("foo::Color")] = index.hashOf(enumKey("foo::Color"));
+  cache.store("Test", known, consumed, {output});
+  index.enums["foo::Color"]->identifiers.pop_back();
+  index.computeHashes();
+  ASSERT_TRUE(cache.fetch("Test", known, index, {output}));
+  ASSERT_EQ(readText(output), "red");
+  std::filesystem::remove_all(work);
+}
+
+TEST(OutputCache, MissDetachesLinkedOutputs) {
+  auto work = tempDirectory("codegen_cache_detach_test");
+  OutputCache cache((work / "cache").string());
+  std::string output = (work / "output.h").string();
+  HashMap known{{DependencyTracker::optionKey("a"), ""}};
+  Index index;
+
+  writeText(output, "a");
+  cache.store("Test", known, known, {output});
+  ASSERT_TRUE(cache.fetch("Test", known, index, {output}));
+
+  // If the cached copy got linked in, writing over the output after a
+  // miss mustn't change what's in the cache
+  HashMap other{{DependencyTracker::optionKey("b"), ""}};
+  ASSERT_FALSE(cache.fetch("Test", other, index, {output}));
+  writeText(output, "b");
+  ASSERT_TRUE(cache.fetch("Test", known, index, {output}));
+  ASSERT_EQ(readText(output), "a");
+  std::filesystem::remove_all(work);
+}
+
+TEST(OutputCache, TrimsLeastRecentlyUsed) {
+  auto work = tempDirectory("codegen_cache_trim_test");
+  std::string output = (work / "output.h").string();
+  Index index;
+  writeText(output, std::string(100, 'x'));
+
+  auto key = [](const std::string& option) {
+    return HashMap{{DependencyTracker::optionKey(option), ""}};
+  };
+  auto age = [&](const std::string& option, int seconds) {
+    // Back date the entry so the order doesn't depend on how fast the
+    // file system's clock ticks
+    for (const auto& entry : std::filesystem::directory_iterator(work / "cache" / "entries")) {
+      if (readText(entry.path() / "inputs.json").find(option) != std::string::npos) {
+        std::filesystem::last_write_time(entry.path(),
+          std::filesystem::file_time_type::clock::now() - std::chrono::seconds(seconds));
+      }
+    }
+  };
+
+  // Room for two entries, but not three
+  OutputCache unbounded((work / "cache").string());
+  unbounded.store("Test", key("first"), key("first"), {output});
+  uint64_t entrySize = unbounded.size();
+  OutputCache cache((work / "cache").string(), entrySize * 5 / 2);
+  age("first", 30);
+  cache.store("Test", key("second"), key("second"), {output});
+  age("second", 20);
+  // Using the first one makes the second one the oldest
+  ASSERT_TRUE(cache.fetch("Test", key("first"), index, {output}));
+  writeText(output + ".new", std::string(100, 'y'));
+  std::filesystem::rename(output + ".new", output);
+  cache.store("Test", key("third"), key("third"), {output});
+
+  ASSERT_LT(cache.size(), entrySize * 5 / 2);
+  ASSERT_TRUE(cache.fetch("Test", key("first"), index, {output}));
+  ASSERT_FALSE(cache.fetch("Test", key("second"), index, {output}));
+  ASSERT_TRUE(cache.fetch("Test", key("third"), index, {output}));
+  std::filesystem::remove_all(work);
+}
+
+TEST(OutputCache, KeepsARunningSize) {
+  auto work = tempDirectory("codegen_cache_size_test");
+  std::string output = (work / "output.h").string();
+  writeText(output, std::string(100, 'x'));
+  auto key = [](const std::string& option) {
+    return HashMap{{DependencyTracker::optionKey(option), ""}};
+  };
+  auto onDisk = [&]() {
+    uint64_t total = 0;
+    for (const auto& file : std::filesystem::recursive_directory_iterator(work / "cache" / "entries")) {
+      if (file.is_regular_file()) {
+        total += file.file_size();
+      }
+    }
+    return total;
+  };
+
+  OutputCache cache((work / "cache").string());
+  cache.store("Test", key("first"), key("first"), {output});
+  ASSERT_EQ(cache.size(), onDisk());
+  // Storing the same thing again doesn't count it twice
+  cache.store("Test", key("first"), key("first"), {output});
+  cache.store("Test", key("second"), key("second"), {output});
+  ASSERT_EQ(cache.size(), onDisk());
+  ASSERT_EQ(std::stoull(readText(work / "cache" / "size")), onDisk());
+
+  // The total's what store goes by, so one that's way off means a trim
+  // the next time something's stored, which counts it all again
+  writeText(work / "cache" / "size", "99999999999\n");
+  cache.store("Test", key("third"), key("third"), {output});
+  ASSERT_EQ(cache.size(), onDisk());
+  ASSERT_TRUE(cache.fetch("Test", key("first"), Index(), {output}));
+
+  // A cache from before there was a total gets counted
+  std::filesystem::remove(work / "cache" / "size");
+  ASSERT_EQ(cache.size(), onDisk());
+  std::filesystem::remove_all(work);
+}
+
+TEST(OutputCache, Sizes) {
+  ASSERT_EQ(OutputCache::parseSize("100"), 100);
+  ASSERT_EQ(OutputCache::parseSize("2K"), 2048);
+  ASSERT_EQ(OutputCache::parseSize("1.5M"), 1024 * 1024 * 3 / 2);
+  ASSERT_EQ(OutputCache::parseSize("1G"), 1024ull * 1024 * 1024);
+  ASSERT_EQ(OutputCache::parseSize("lots"), OutputCache::defaultSize);
+}
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 #include <fr/codegen/parser.h>
+#include <map>
+#include <string>
 #include <vector>
 
 // Check enum and enum class parsing (basic)
@@ -145,3 +147,79 @@ TEST(ParserSignals, TemplateClassIgnored) {
   ASSERT_EQ(colors[1], "green");
   ASSERT_EQ(colors[2], "blue");
 }
+
+// Each detail level should find the same enums and drop what it
+// doesn't need
+TEST(ParserSignals, DetailLevels) {
+  std::string code =
+    "namespace shapes {\n"
+    "  enum class Color { red, green, blue };\n"
+    "  class Point : Base {\n"
+    "  public:\n"
+    "    Point(int x, int y) : _x(x), _y(y) {}\n"
+    "    int distance(const Point& other) const { if (other.x) { return {}; } return 0; }\n"
+    "    std::vector<int> values;\n"
+    "    int x;\n"
+    "  };\n"
+    "  enum Size { small, large };\n"
+    "}";
+
+  auto parse = [&](fr::codegen::parser::IndexDetail detail) {
+    std::map<std::string, int> counts;
+    std::vector<std::string> identifiers;
+    fr::codegen::parser::ParserDriver parser;
+    parser.detail = detail;
+    parser.enumIdentifier.connect([&](auto& name, auto& identifier) { identifiers.push_back(identifier); });
+    parser.classPush.connect([&](auto&, auto) { counts["class"]++; });
+    parser.classPop.connect([&]() { counts["classPop"]++; });
+    parser.privateClassParent.connect([&](auto&) { counts["parent"]++; });
+    parser.memberFound.connect([&](auto, auto, auto&, auto&) { counts["member"]++; });
+    parser.methodFound.connect([&](auto, auto, auto, auto&, auto&) { counts["method"]++; });
+    parser.parameterFound.connect([&](auto&, auto&, auto, auto) { counts["parameter"]++; });
+    std::string result;
+    auto first = code.begin();
+    EXPECT_TRUE(parser.parse(first, code.end(), result));
+    EXPECT_EQ(identifiers, (std::vector<std::string>{"red", "green", "blue", "small", "large"}));
+    return counts;
+  };
+
+  using fr::codegen::parser::IndexDetail;
+  auto full = parse(IndexDetail::full);
+  ASSERT_EQ(full["class"], 1);
+  ASSERT_EQ(full["classPop"], 1);
+  ASSERT_EQ(full["parent"], 1);
+  ASSERT_EQ(full["member"], 2);
+  ASSERT_EQ(full["method"], 2);
+  ASSERT_GT(full["parameter"], 0);
+
+  auto members = parse(IndexDetail::members);
+  ASSERT_EQ(members["class"], 1);
+  ASSERT_EQ(members["classPop"], 1);
+  ASSERT_EQ(members["parent"], 1);
+  ASSERT_EQ(members["member"], 2);
+  ASSERT_EQ(members["method"], 0);
+  ASSERT_EQ(members["parameter"], 0);
+
+  auto enums = parse(IndexDetail::enums);
+  ASSERT_TRUE(enums.empty());
+}
+
+// Whether a class was declared with struct shouldn't leak into the
+// next one
+TEST(ParserSignals, StructThenClass) {
+  std::string code =
+    "struct Plain { int a; };\n"
+    "class Fancy { int b; };\n"
+    "struct Other { int c; };\n"
+    "struct Again { int d; };\n"
+    "class Last { int e; };\n";
+  std::vector<std::string> structs;
+  std::vector<std::string> classes;
+  fr::codegen::parser::ParserDriver parser;
+  parser.structPush.connect([&](const std::string& name, int) { structs.push_back(name); });
+  parser.classPush.connect([&](const std::string& name, int) { classes.push_back(name); });
+  std::string result;
+  ASSERT_TRUE(parser.parse(code.begin(), code.end(), result));
+  ASSERT_EQ(structs, (std::vector<std::string>{"Plain", "Other", "Again"}));
+  ASSERT_EQ(classes, (std::vector<std::string>{"Fancy", "Last"}));
+}
@@ -0,0 +1,238 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <fr/codegen/pipeline.h>
+#include <fr/codegen/workpool.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+
+namespace {
+
+  // Stand-ins for the real tools that just write down what ran. The
+  // output file name is the last argument.
+  struct Recorder {
+    std::mutex mutex;
+    std::vector<std::string> ran;
+    std::set<std::string> failing;
+
+    tools::Tool tool() {
+      return [this](int argc, char* argv[], std::ostream& out, tools::ToolContext&) {
+        std::string output = argv[argc - 1];
+        if (output == "--keep-in-memory") {
+          output = argv[argc - 2];
+        }
+        std::lock_guard lock(mutex);
+        ran.push_back(output);
+        return failing.contains(output) ? 1 : 0;
+      };
+    }
+
+    std::map<std::string, tools::Tool> tools() {
+      return {
+        {"IndexCode", tool()},
+        {"GenerateEnumFunctions", tool()},
+        {"GenerateFunctions", tool()},
+        {"GeneratePythonApi", tool()},
+        {"OstreamOpsFromIndex", tool()}
+      };
+    }
+  };
+
+  const std::string manifest(
+    "{ \"steps\": ["
+    "  { \"name\": \"functions\", \"tool\": \"GenerateFunctions\","
+    "    \"args\": [\"-h\", \"Config.h.in\", \"-i\", \"index.json\", \"-o\", \"Config.h\"] },"
+    "  { \"name\": \"index\", \"tool\": \"IndexCode\","
+    "    \"args\": [\"-h\", \"Config.h.in\", \"-o\", \"index.json\"] },"
+    "  { \"name\": \"python\", \"tool\": \"GeneratePythonApi\","
+    "    \"args\": [\"-s\", \"PythonApi.cpp.in\", \"-i\", \"index.json\", \"-o\", \"PythonApi.cpp\"] },"
+    "  { \"name\": \"ops\", \"tool\": \"OstreamOpsFromIndex\","
+    "    \"args\": [\"--index=index.json\", \"-h\", \"ops.h\", \"-c\", \"ops.cpp\"] }"
+    "] }"
+  );
+
+}
+
+TEST(Pipeline, DependenciesFromFiles) {
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  std::stringstream stream(manifest);
+  pipeline.load(stream);
+  pipeline.buildGraph();
+  const auto& steps = pipeline.steps();
+  ASSERT_EQ(steps.size(), 4);
+  // Everything reads the index, which is step 1
+  ASSERT_EQ(steps[0].dependsOn, std::vector<size_t>{1});
+  ASSERT_TRUE(steps[1].dependsOn.empty());
+  ASSERT_EQ(steps[2].dependsOn, std::vector<size_t>{1});
+  ASSERT_EQ(steps[3].dependsOn, std::vector<size_t>{1});
+  ASSERT_EQ(steps[1].dependents.size(), 3);
+  // The index stays in memory unless you ask for it
+  ASSERT_EQ(steps[1].args.back(), "--keep-in-memory");
+}
+
+TEST(Pipeline, RunsInDependencyOrder) {
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  std::stringstream stream(manifest);
+  pipeline.load(stream);
+  std::stringstream out;
+  ASSERT_EQ(pipeline.run(out, 4), 0);
+  ASSERT_EQ(recorder.ran.size(), 4);
+  ASSERT_EQ(recorder.ran[0], "index.json");
+}
+
+TEST(Pipeline, FailuresSkipDependents) {
+  Recorder recorder;
+  recorder.failing.insert("index.json");
+  Pipeline pipeline(recorder.tools());
+  std::stringstream stream(manifest);
+  pipeline.load(stream);
+  std::stringstream out;
+  ASSERT_EQ(pipeline.run(out, 2), 4);
+  ASSERT_EQ(recorder.ran, std::vector<std::string>{"index.json"});
+}
+
+TEST(Pipeline, DuplicateOutputsAreAnError) {
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  pipeline.addStep("a", "GenerateFunctions", {"-h", "a.h.in", "-i", "index.json", "-o", "a.h"});
+  pipeline.addStep("b", "GenerateFunctions", {"-h", "b.h.in", "-i", "index.json", "-o", "a.h"});
+  ASSERT_THROW(pipeline.buildGraph(), std::runtime_error);
+}
+
+TEST(Pipeline, CyclesAreAnError) {
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  pipeline.addStep("a", "GenerateFunctions", {"-h", "b.h", "-i", "index.json", "-o", "a.h"});
+  pipeline.addStep("b", "GenerateFunctions", {"-h", "a.h", "-i", "index.json", "-o", "b.h"});
+  ASSERT_THROW(pipeline.buildGraph(), std::runtime_error);
+}
+
+TEST(Pipeline, ChangesRerunDownstreamSteps) {
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  std::stringstream stream(manifest);
+  pipeline.load(stream);
+  pipeline.buildGraph();
+  auto sources = pipeline.sourceFiles();
+  // index.json is written by a step, so it isn't a source
+  ASSERT_EQ(sources.size(), 2);
+  auto header = std::filesystem::absolute("Config.h.in").lexically_normal().string();
+  auto api = std::filesystem::absolute("PythonApi.cpp.in").lexically_normal().string();
+  ASSERT_TRUE(sources.contains(header));
+  ASSERT_TRUE(sources.contains(api));
+
+  // The header feeds the index, so everything reruns
+  ASSERT_EQ(pipeline.affectedBy({header}).size(), 4);
+  // The template only feeds the python step
+  auto affected = pipeline.affectedBy({api});
+  ASSERT_EQ(affected, std::set<size_t>{2});
+
+  tools::ToolContext context;
+  std::stringstream out;
+  ASSERT_EQ(pipeline.run(out, 2, context, affected), 0);
+  ASSERT_EQ(recorder.ran, std::vector<std::string>{"PythonApi.cpp"});
+}
+
+TEST(Pipeline, FilesTheCommandLineDoesntName) {
+  auto directory = std::filesystem::temp_directory_path() / "codegen_pipeline_root";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory / "include" / "sub");
+  std::ofstream(directory / "include" / "a.h") << "enum class A { a };";
+  std::ofstream(directory / "include" / "sub" / "b.hpp") << "enum class B { b };";
+  std::ofstream(directory / "include" / "notes.txt") << "not a header";
+  auto path = [&directory](const std::string& name) {
+    return (directory / name).lexically_normal().string();
+  };
+
+  Recorder recorder;
+  Pipeline pipeline(recorder.tools());
+  // Writes a header into the directory the index crawls, before it's there
+  pipeline.addStep("enums", "GenerateEnumFunctions",
+                   {"-i", path("enums.h"), "-h", path("include/enums_ops.h"), "-c", path("enums_ops.cpp")});
+  pipeline.addStep("index", "IndexCode", {"--root", path("include"), "-o", path("index.json"), "--flat", path("index.flat")});
+  pipeline.addStep("ops", "OstreamOpsFromIndex",
+                   {"-i", path("index.json"), "-h", path("ops/ops.h"), "-c", path("ops/ops.cpp"), "-n", "2", "--companions"});
+  // Reads one of the companion headers
+  pipeline.addStep("functions", "GenerateFunctions", {"-h", path("ops/a_ops.h"), "-i", path("index.json"), "-o", path("a.h")});
+  pipeline.addStep("python", "GeneratePythonApi",
+                   {"-s", path("api.cpp.in"), "-i", path("index.flat"), "-o", path("api.cpp"), "--shards=2"});
+  pipeline.buildGraph();
+  const auto& steps = pipeline.steps();
+
+  auto has = [](const std::vector<std::string>& files, const std::string& file) {
+    return std::find(files.begin(), files.end(), file) != files.end();
+  };
+  ASSERT_EQ(steps[0].inputs, std::vector<std::string>{path("enums.h")});
+  ASSERT_EQ(steps[0].outputs.size(), 2);
+  ASSERT_TRUE(has(steps[1].inputs, path("include/a.h")));
+  ASSERT_TRUE(has(steps[1].inputs, path("include/sub/b.hpp")));
+  ASSERT_FALSE(has(steps[1].inputs, path("include/notes.txt")));
+  ASSERT_TRUE(has(steps[1].outputs, path("index.flat")));
+  ASSERT_EQ(steps[1].dependsOn, std::vector<size_t>{0});
+  ASSERT_TRUE(has(steps[2].outputs, path("ops/ops_shard0.cpp")));
+  ASSERT_TRUE(has(steps[2].outputs, path("ops/ops_shard1.cpp")));
+  ASSERT_FALSE(has(steps[2].outputs, path("ops/ops.cpp")));
+  ASSERT_EQ(steps[3].dependsOn, (std::vector<size_t>{1, 2}));
+  ASSERT_EQ(steps[4].outputs, (std::vector<std::string>{path("api.cpp"), path("api_shard0.cpp"), path("api_shard1.cpp")}));
+  ASSERT_EQ(steps[4].dependsOn, std::vector<size_t>{1});
+
+  // A header that shows up later still gets the index rebuilt
+  auto affected = pipeline.affectedBy({path("include/sub/new.h")});
+  ASSERT_TRUE(affected.contains(1));
+  ASSERT_FALSE(affected.contains(0));
+  ASSERT_TRUE(pipeline.affectedBy({path("include/notes.txt")}).empty());
+  std::filesystem::remove_all(directory);
+}
+
+TEST(WorkStealingPool, RunsNestedJobs) {
+  WorkStealingPool pool(4);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.submit([&pool, &count]() {
+      count++;
+      for (int j = 0; j < 10; ++j) {
+        pool.submit([&count]() { count++; });
+      }
+    });
+  }
+  pool.wait();
+  ASSERT_EQ(count, 1100);
+}
+
+TEST(WorkStealingPool, WakesSleepingWorkers) {
+  // Workers that ran out of work are asleep, not polling, so each of
+  // these only finishes if submit wakes one of them up
+  WorkStealingPool pool(4);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 1000; ++i) {
+    pool.submit([&count]() { count++; });
+    pool.wait();
+  }
+  ASSERT_EQ(count, 1000);
+}
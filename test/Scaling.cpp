@@ -0,0 +1,101 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/indexer.h>
+#include <fr/codegen/scaling.h>
+#include <string>
+#include <vector>
+
+using namespace fr::codegen;
+using namespace fr::codegen::scaling;
+
+namespace {
+
+  Results linear() {
+    Results results;
+    results.measurements = {
+      {"IndexCode", 1000, 40.0, 7000, 650000},
+      {"IndexCode", 10000, 400.0, 25000, 6500000},
+      {"IndexCode", 100000, 4000.0, 200000, 65000000},
+    };
+    return results;
+  }
+
+}
+
+TEST(Scaling, CorpusIndexes) {
+  auto directory = std::filesystem::temp_directory_path() / "codegen_scaling_test";
+  auto corpus = writeCorpus(directory, 25, 10);
+  ASSERT_EQ(corpus.headers.size(), 3);
+  std::vector<std::string> headers;
+  for (const auto& header : corpus.headers) {
+    headers.push_back(header.string());
+  }
+  std::vector<std::string> failed;
+  auto index = indexHeaders(headers, parser::IndexDetail::full, 1, &failed);
+  ASSERT_TRUE(failed.empty());
+  ASSERT_EQ(index->enums.size(), 25);
+  ASSERT_EQ(index->classes.size(), 25);
+  auto synthetic = index->classes.at("Synthetic24");
+  ASSERT_EQ(synthetic->members.size(), 4);
+  ASSERT_TRUE(synthetic->members[0].serializable);
+  ASSERT_TRUE(std::filesystem::exists(corpus.pythonTemplate));
+  std::filesystem::remove_all(directory);
+}
+
+TEST(Scaling, ResultsRoundTrip) {
+  auto file = (std::filesystem::temp_directory_path() / "codegen_scaling_test.json").string();
+  auto results = linear();
+  results.save(file);
+  Results back;
+  back.load(file);
+  ASSERT_EQ(back.measurements.size(), 3);
+  auto found = back.find("IndexCode", 10000);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(found->wallMs, 400.0);
+  ASSERT_EQ(found->peakRssKb, 25000);
+  ASSERT_EQ(found->outputBytes, 6500000);
+  ASSERT_FALSE(back.find("IndexCode", 5));
+  std::filesystem::remove(file);
+}
+
+TEST(Scaling, FlagsSuperLinearGrowth) {
+  auto results = linear();
+  ASSERT_TRUE(superLinear(results, 1.2, 20.0).empty());
+  // Quadratic from 10k to 100k
+  results.measurements[2].wallMs = 40000.0;
+  auto problems = superLinear(results, 1.2, 20.0);
+  ASSERT_EQ(problems.size(), 1);
+  ASSERT_NE(problems[0].find("10000 to 100000"), std::string::npos);
+  // Too quick to tell at the small end
+  results = linear();
+  results.measurements[0].wallMs = 1.0;
+  ASSERT_TRUE(superLinear(results, 1.2, 20.0).empty());
+}
+
+TEST(Scaling, FlagsRegressions) {
+  auto baseline = linear();
+  auto results = linear();
+  results.measurements[1].wallMs = 430.0;
+  ASSERT_TRUE(regressions(results, baseline, 10.0, 20.0).empty());
+  results.measurements[1].wallMs = 450.0;
+  results.measurements[2].peakRssKb = 300000;
+  ASSERT_EQ(regressions(results, baseline, 10.0, 20.0).size(), 2);
+  // Nothing to compare against
+  ASSERT_TRUE(regressions(results, Results(), 10.0, 20.0).empty());
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/drivers.h>
+#include <fr/codegen/parser.h>
+#include <fr/codegen/stats.h>
+#include <sstream>
+#include <string>
+
+using namespace fr::codegen;
+
+TEST(Stats, CountsParserSignals) {
+  auto filename = (std::filesystem::temp_directory_path() / "codegen_test_stats.json").string();
+  std::filesystem::remove(filename);
+  {
+    Stats stats(filename, "test");
+    parser::ParserDriver parser;
+    EnumDriver enums;
+    enums.regParser(parser);
+    stats.instrumentParser(parser);
+    std::string code("namespace foo { enum class Color { red, green, blue }; }");
+    std::string result;
+    {
+      auto timer = stats.time("parse");
+      ASSERT_TRUE(parser.parse(code.begin(), code.end(), result));
+    }
+    stats.count("declarations");
+    // Namespace, enum class, three identifiers and a couple of scopes
+    ASSERT_GE(stats.counters().at("signals"), 5);
+    ASSERT_EQ(stats.phases().at("parse").count, 1);
+    ASSERT_GE(stats.phases().at("drive").count, 5);
+
+    std::stringstream json;
+    stats.write(json);
+    ASSERT_NE(json.str().find("\"tool\": \"test\""), std::string::npos);
+    ASSERT_NE(json.str().find("\"drive\": { \"wall_ms\": "), std::string::npos);
+    ASSERT_NE(json.str().find("\"declarations\": 1"), std::string::npos);
+    ASSERT_NE(json.str().find("\"peak_rss_kb\": "), std::string::npos);
+  }
+  // Written when it went away
+  ASSERT_TRUE(std::filesystem::exists(filename));
+  std::filesystem::remove(filename);
+}
+
+TEST(Stats, DisabledRecordsNothing) {
+  Stats stats("", "test");
+  parser::ParserDriver parser;
+  stats.instrumentParser(parser);
+  {
+    auto timer = stats.time("parse");
+  }
+  stats.count("declarations");
+  ASSERT_TRUE(stats.phases().empty());
+  ASSERT_TRUE(stats.counters().empty());
+  // Unless it has to tag allocations with "drive"
+  if (!alloc::instrumented()) {
+    ASSERT_EQ(parser.enumPush.num_slots(), 0);
+  }
+}
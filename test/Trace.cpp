@@ -0,0 +1,108 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/LblFilter.h>
+#include <fr/codegen/parser.h>
+#include <fr/codegen/trace.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace fr::codegen;
+
+namespace {
+
+  std::string traceFile() {
+    return (std::filesystem::temp_directory_path() / "codegen_test_trace.json").string();
+  }
+
+  std::string readAll(const std::string& filename) {
+    std::ifstream stream(filename);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+  }
+
+  // Passes lines through so we can see it in the trace
+  class PassThrough : public LblFilter {
+  public:
+    void process(const std::string& line) override {
+      emit(line);
+    }
+  };
+
+}
+
+TEST(Trace, DisabledRecordsNothing) {
+  ASSERT_FALSE(trace::enabled());
+  {
+    trace::Span span("header", "parse", "nothing.h");
+  }
+  std::stringstream out;
+  trace::write(out);
+  ASSERT_EQ(out.str().find("nothing.h"), std::string::npos);
+}
+
+TEST(Trace, SpansFromEveryThread) {
+  auto filename = traceFile();
+  {
+    trace::Session session(filename);
+    ASSERT_TRUE(session.active());
+    // Somebody else already tracing gets the events instead
+    trace::Session nested(filename + ".nested");
+    ASSERT_FALSE(nested.active());
+    trace::Span outer("pipeline", "step", "main");
+    std::thread other([]() {
+      trace::Span span("file", "generate", "\"quoted\".h");
+    });
+    other.join();
+  }
+  ASSERT_FALSE(trace::enabled());
+  ASSERT_FALSE(std::filesystem::exists(filename + ".nested"));
+  std::string json = readAll(filename);
+  ASSERT_NE(json.find("\"name\": \"step main\""), std::string::npos);
+  ASSERT_NE(json.find("\"name\": \"generate \\\"quoted\\\".h\""), std::string::npos);
+  ASSERT_NE(json.find("\"ph\": \"X\""), std::string::npos);
+  std::filesystem::remove(filename);
+}
+
+TEST(Trace, DeclarationsAndDirectives) {
+  auto filename = traceFile();
+  {
+    trace::Session session(filename);
+    parser::ParserDriver parser;
+    trace::traceDeclarations(parser);
+    std::string code("namespace foo { enum class Color { red }; class Thing { int x; }; }");
+    std::string result;
+    ASSERT_TRUE(parser.parse(code.begin(), code.end(), result));
+
+    LblEmitter source;
+    PassThrough stage;
+    stage.subscribeTo(source);
+    source.emit("int x;");
+    source.emit("  [[genGetSetMethods]]  ");
+  }
+  std::string json = readAll(filename);
+  ASSERT_NE(json.find("\"name\": \"enum Color\""), std::string::npos);
+  ASSERT_NE(json.find("\"name\": \"class Thing\""), std::string::npos);
+  ASSERT_NE(json.find("\"name\": \"PassThrough [[genGetSetMethods]]\""), std::string::npos);
+  // Only directives get spans
+  ASSERT_EQ(json.find("int x;"), std::string::npos);
+  std::filesystem::remove(filename);
+}
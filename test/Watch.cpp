@@ -0,0 +1,53 @@
+/**
+ * Copyright 2026 Bruce Ide
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fr/codegen/watch.h>
+#include <fstream>
+#include <string>
+
+using namespace fr::codegen;
+
+TEST(FileWatcher, SeesWritesAndRenames) {
+  auto directory = std::filesystem::temp_directory_path() / "codegen_test_watch";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  auto watched = (directory / "watched.h").string();
+  auto other = (directory / "other.h").string();
+  std::ofstream(watched) << "// one" << std::endl;
+
+  FileWatcher watcher;
+  watcher.watch(watched);
+  ASSERT_TRUE(watcher.wait(0).empty());
+
+  // Files we didn't ask about don't count
+  std::ofstream(other) << "// other" << std::endl;
+  ASSERT_TRUE(watcher.wait(50).empty());
+
+  std::ofstream(watched) << "// two" << std::endl;
+  auto changed = watcher.wait(1000);
+  ASSERT_EQ(changed, std::set<std::string>{watched});
+
+  // What a lot of editors do when they save
+  auto temporary = (directory / "watched.h.tmp").string();
+  std::ofstream(temporary) << "// three" << std::endl;
+  std::filesystem::rename(temporary, watched);
+  changed = watcher.wait(1000);
+  ASSERT_EQ(changed, std::set<std::string>{watched});
+
+  std::filesystem::remove_all(directory);
+}
@@ -17,6 +17,7 @@
 #include <gtest/gtest.h>
 #include <fr/codegen/parser.h>
 #include <string>
+#include <vector>
 
 TEST(CommentTest, IgnoreLineComment) {
   std::string data("The quick brown // something something\nwat?");
@@ -44,3 +45,43 @@ TEST(CommentTest, IgnoreBlockComment) {
   ASSERT_TRUE(r);
   ASSERT_EQ(result, "The quick brown wat!");
 }
+
+namespace {
+
+  // What's left of data after skipping with skipper before every char
+  template <typename Skipper>
+  std::string skipped(const std::string& data, const Skipper& skipper) {
+    std::string result;
+    auto first = data.cbegin();
+    boost::spirit::x3::phrase_parse(first, data.cend(), *boost::spirit::x3::char_, skipper, result);
+    return result;
+  }
+
+}
+
+TEST(CommentTest, SkipperSkipsEverything) {
+  std::string data("  class /* a\n block */ Foo // line\n{\t// another\r\n int /**/ x; /* ** */};\n");
+  ASSERT_EQ(skipped(data, fr::codegen::parser::skipper), "classFoo{intx;};");
+}
+
+TEST(CommentTest, SkipperMatchesTheRules) {
+  using namespace fr::codegen::parser;
+  auto const rules = blockComment | singleLineComment | boost::spirit::x3::ascii::space;
+  std::vector<std::string> inputs{
+    "",
+    "   ",
+    "a / b",
+    "a /",
+    "a // no line ending",
+    "a // old mac\rb",
+    "a // windows\r\nb",
+    "a /* unclosed",
+    "a /* stars * and / slashes **/b",
+    "a /*/ not closed yet */b",
+    "a//\n//\n/**//**/b",
+    "\v\f\xe9 b",
+  };
+  for (const auto& input : inputs) {
+    ASSERT_EQ(skipped(input, skipper), skipped(input, rules)) << input;
+  }
+}